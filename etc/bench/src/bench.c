@@ -0,0 +1,1054 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#include "libreplace/replace.h"
+#include "utils.h"
+
+#include <ShellAPI.h> /*CommandLineToArgvW*/
+#include <Psapi.h>    /*GetProcessMemoryInfo*/
+
+/*
+ * Benchmark harness: every case runs in a child process of its own, so that
+ * the peak working-set size reported for a case belongs to that case only.
+ * The in-process engines ("memory", "stream") are run by re-invoking this
+ * executable with '--run', the "cli" engine runs replace.exe end to end on a
+ * temporary file. The "io" engine runs replace.exe once more on some of the
+ * corpora, reading from a file (with overlapped or with synchronous I/O) or
+ * from a pipe, with the legacy fixed buffer size and with the default buffer
+ * sizes, and records the number of read and write operations of the child. Results are written to STDOUT as JSON,
+ * progress to STDERR.
+ */
+
+#define DEFAULT_SIZE_MIB 32U
+#define DEFAULT_REPEAT 3U
+#define MAX_SIZE_MIB 512U
+#define MAX_REPEAT 100U
+#define LONG_NEEDLE_LEN 256U
+#define CMDLINE_MAXLEN 2048U
+#define PIPE_CHUNK_SIZE 0x100000U
+#define LEGACY_BUFFER_SIZE 4096U /*fixed I/O buffer size of earlier versions*/
+
+/* ======================================================================= */
+/* Engines and flag combinations                                           */
+/* ======================================================================= */
+
+#define ENGINE_MEMORY 0U
+#define ENGINE_STREAM 1U
+#define ENGINE_CLI    2U
+#define ENGINE_IO     3U
+#define ENGINE_COUNT  4U
+
+#define ENGINE_BIT(X) (1U << (X))
+#define ENGINES_ALL (ENGINE_BIT(ENGINE_MEMORY) | ENGINE_BIT(ENGINE_STREAM) | ENGINE_BIT(ENGINE_CLI))
+
+static const CHAR *const ENGINE_NAMES[ENGINE_COUNT] = { "memory", "stream", "cli", "io" };
+
+#define INPUT_FILE      0U
+#define INPUT_FILE_SYNC 1U
+#define INPUT_PIPE      2U
+#define INPUT_COUNT     3U
+
+static const CHAR *const INPUT_NAMES[INPUT_COUNT] = { "file", "file_sync", "pipe" };
+
+static const DWORD IO_BUFFER_SIZES[] = { LEGACY_BUFFER_SIZE, 0U /*default*/ };
+
+#define IO_BUFFER_COUNT (sizeof(IO_BUFFER_SIZES) / sizeof(IO_BUFFER_SIZES[0U]))
+
+#define MODE_DEFAULT     0U
+#define MODE_IGNORE_CASE 1U
+#define MODE_GLOBBING    2U
+#define MODE_REVERSE     3U
+#define MODE_NORMALIZE   4U
+#define MODE_TRANSLATE   5U
+
+typedef struct variant_t
+{
+	const CHAR *flags; /*as passed to the CLI*/
+	DWORD mode;
+	DWORD engines;
+	BOOL binary_ok;
+}
+variant_t;
+
+static const variant_t VARIANTS[] =
+{
+	{ "",   MODE_DEFAULT,     ENGINES_ALL, TRUE  },
+	{ "-i", MODE_IGNORE_CASE, ENGINES_ALL, FALSE },
+	{ "-g", MODE_GLOBBING,    ENGINES_ALL, FALSE },
+	{ "-r", MODE_REVERSE,     ENGINES_ALL, TRUE  },
+	{ "-n", MODE_NORMALIZE,   ENGINE_BIT(ENGINE_STREAM) | ENGINE_BIT(ENGINE_CLI), FALSE }, /*in-memory API does not normalize*/
+	{ "-c", MODE_TRANSLATE,   ENGINE_BIT(ENGINE_STREAM) | ENGINE_BIT(ENGINE_CLI), FALSE }
+};
+
+#define VARIANT_COUNT (sizeof(VARIANTS) / sizeof(VARIANTS[0U]))
+
+/* ======================================================================= */
+/* Synthetic corpora                                                       */
+/* ======================================================================= */
+
+typedef void (*generator_func_t)(BYTE *const data, const DWORD data_len, random_t *const state);
+
+typedef struct corpus_t
+{
+	const CHAR *name;
+	generator_func_t generate;
+	const CHAR *needle;   /*NULL = long generated needle*/
+	const CHAR *replacement;
+	DWORD plant_interval; /*0 = needle is never planted*/
+	BOOL binary;
+	BOOL io_bench; /*also run by the "io" engine*/
+}
+corpus_t;
+
+static void bench_seed(random_t *const state, const DWORD seed)
+{
+	state->a = 0x6A09E667U ^ seed;
+	state->b = 0xBB67AE85U;
+	state->c = 0x3C6EF372U;
+	state->d = 0xA54FF53AU;
+	state->counter = 0U;
+}
+
+static void generate_text(BYTE *const data, const DWORD data_len, random_t *const state)
+{
+	DWORD pos = 0U, line_len = 0U;
+	while(pos < data_len)
+	{
+		DWORD word_len = 2U + (random_next(state) % 8U);
+		for(; word_len && (pos < data_len); --word_len, ++line_len)
+		{
+			data[pos++] = (BYTE)('a' + (random_next(state) % 26U));
+		}
+		if(pos < data_len)
+		{
+			if(line_len < 72U)
+			{
+				data[pos++] = ' ';
+				++line_len;
+			}
+			else
+			{
+				data[pos++] = '\r';
+				if(pos < data_len)
+				{
+					data[pos++] = '\n';
+				}
+				line_len = 0U;
+			}
+		}
+	}
+}
+
+static void generate_repetitive(BYTE *const data, const DWORD data_len, random_t *const state)
+{
+	DWORD pos;
+	for(pos = 0U; pos < data_len; ++pos)
+	{
+		data[pos] = ((pos & 0xFFFU) == 0xFFFU) ? 'b' : 'a';
+	}
+	UNUSED_PARAM(state);
+}
+
+static void generate_binary(BYTE *const data, const DWORD data_len, random_t *const state)
+{
+	DWORD pos;
+	for(pos = 0U; pos < data_len; ++pos)
+	{
+		data[pos] = (BYTE)random_next(state);
+	}
+}
+
+static void generate_tokens(BYTE *const data, const DWORD data_len, random_t *const state)
+{
+	static const CHAR *const TOKENS[] = { "foo ", "bar ", "baz ", "qux\n" };
+	DWORD pos = 0U;
+	while(pos < data_len)
+	{
+		const CHAR *token = TOKENS[random_next(state) & 3U];
+		for(; *token && (pos < data_len); ++token)
+		{
+			data[pos++] = *token;
+		}
+	}
+}
+
+static const corpus_t CORPORA[] =
+{
+	{ "random_text",  generate_text,       "lorem",            "ipsum",            0x10000U, FALSE, TRUE  },
+	{ "repetitive",   generate_repetitive, "aaaaaaaaaaaaaaab", "b",                0U,       FALSE, FALSE },
+	{ "binary",       generate_binary,     "\xDE\xAD\xBE\xEF", "\xCA\xFE\xBA\xBE", 0x10000U, TRUE,  FALSE },
+	{ "many_matches", generate_tokens,     "foo",              "quux",             0U,       FALSE, TRUE  },
+	{ "no_matches",   generate_text,       "XYZZY",            "plugh",            0U,       FALSE, FALSE },
+	{ "long_needle",  generate_text,       NULL,               "LONG",             0x40000U, FALSE, FALSE }
+};
+
+#define CORPUS_COUNT (sizeof(CORPORA) / sizeof(CORPORA[0U]))
+
+static DWORD corpus_needle(const corpus_t *const corpus, BYTE *const needle)
+{
+	DWORD len = 0U;
+	if(corpus->needle)
+	{
+		for(; corpus->needle[len]; ++len)
+		{
+			needle[len] = corpus->needle[len];
+		}
+	}
+	else
+	{
+		random_t state;
+		bench_seed(&state, 0xFFFFFFFFU);
+		for(; len < LONG_NEEDLE_LEN; ++len)
+		{
+			needle[len] = (BYTE)('a' + (random_next(&state) % 26U));
+		}
+	}
+	needle[len] = '\0';
+	return len;
+}
+
+static BYTE *corpus_generate(const corpus_t *const corpus, const DWORD corpus_id, const DWORD data_len)
+{
+	BYTE needle[LONG_NEEDLE_LEN + 1U];
+	random_t state;
+	DWORD pos, needle_len, needle_pos;
+
+	BYTE *const data = (BYTE*) LocalAlloc(LMEM_FIXED, sizeof(BYTE) * data_len);
+	if(!data)
+	{
+		return NULL;
+	}
+
+	bench_seed(&state, corpus_id);
+	corpus->generate(data, data_len, &state);
+
+	if(corpus->plant_interval && ((needle_len = corpus_needle(corpus, needle)) <= data_len))
+	{
+		for(pos = corpus->plant_interval >> 1U; pos <= data_len - needle_len; pos += corpus->plant_interval - (random_next(&state) % (corpus->plant_interval >> 2U)))
+		{
+			for(needle_pos = 0U; needle_pos < needle_len; ++needle_pos)
+			{
+				data[pos + needle_pos] = needle[needle_pos];
+			}
+		}
+	}
+
+	return data;
+}
+
+/* ======================================================================= */
+/* Timing                                                                  */
+/* ======================================================================= */
+
+static DWORD elapsed_usec(const LARGE_INTEGER *const start, const LARGE_INTEGER *const end)
+{
+	LARGE_INTEGER frequency;
+	double usec;
+	if(!QueryPerformanceFrequency(&frequency))
+	{
+		return MAXDWORD;
+	}
+	usec = ((double)(end->QuadPart - start->QuadPart) * 1000000.0) / (double)frequency.QuadPart;
+	return (usec < 1.0) ? 1U : ((usec < 2147483647.0) ? (DWORD)(LONG)usec : MAXINT32); /*avoid CRT helpers*/
+}
+
+/* ======================================================================= */
+/* Child: run a single in-process case                                     */
+/* ======================================================================= */
+
+static UINT run_case(const HANDLE std_out, const HANDLE std_err, const DWORD engine, const DWORD kernels, const DWORD corpus_id, const DWORD variant_id, const DWORD data_len, const DWORD repeat)
+{
+	const corpus_t *const corpus = &CORPORA[corpus_id];
+	const variant_t *const variant = &VARIANTS[variant_id];
+	UINT result = EXIT_FAILURE;
+	BYTE needle[LONG_NEEDLE_LEN + 1U];
+	WORD table[256U];
+	BYTE *data = NULL, *output = NULL;
+	WORD *needle_expanded = NULL;
+	libreplace_pattern_t *pattern = NULL;
+	libreplace_context_t *context = NULL;
+	memory_output_t *output_context = NULL;
+	memory_input_t input_context;
+	libreplace_io_t io_functions;
+	libreplace_flags_t options;
+	libreplace_logger_t logger;
+	LARGE_INTEGER time_start, time_end;
+	DWORD needle_len, output_len, round, replacement_count = 0U, best_usec = MAXDWORD;
+
+	init_logging_functions(&logger, print_text_ptr, (DWORD_PTR)std_err);
+	SecureZeroMemory(&options, sizeof(libreplace_flags_t));
+
+	options.case_insensitive = (variant->mode == MODE_IGNORE_CASE);
+	options.reverse = (variant->mode == MODE_REVERSE);
+	options.normalize = (variant->mode == MODE_NORMALIZE);
+
+	if(!libreplace_select_kernels(kernels))
+	{
+		print_text(std_err, "Error: The requested processing kernels are not supported!\n");
+		goto cleanup;
+	}
+
+	needle_len = corpus_needle(corpus, needle);
+	if(!(needle_expanded = expand_wildcards(needle, needle_len, NULL)))
+	{
+		print_text(std_err, "Error: Memory allocation has failed!\n");
+		goto cleanup;
+	}
+
+	if(variant->mode == MODE_GLOBBING)
+	{
+		needle_expanded[needle_len >> 1U] = LIBREPLACE_WILDCARD;
+	}
+
+	if(variant->mode == MODE_TRANSLATE)
+	{
+		build_translation_table(table, needle, needle_len, (const BYTE*)corpus->replacement, min(needle_len, (DWORD)lstrlenA(corpus->replacement)));
+	}
+
+	if(!(data = corpus_generate(corpus, corpus_id, data_len)))
+	{
+		print_text(std_err, "Error: Failed to generate the corpus!\n");
+		goto cleanup;
+	}
+
+	if(engine == ENGINE_MEMORY)
+	{
+		if(!(pattern = libreplace_pattern_compile(&logger, needle_expanded, needle_len, (const BYTE*)corpus->replacement, lstrlenA(corpus->replacement), &options)))
+		{
+			goto cleanup;
+		}
+		if(!(context = libreplace_context_create(pattern)))
+		{
+			print_text(std_err, "Error: Memory allocation has failed!\n");
+			goto cleanup;
+		}
+	}
+	else
+	{
+		if(!(output_context = alloc_memory_output((data_len <= (MAXDWORD >> 1U)) ? (data_len << 1U) : MAXDWORD)))
+		{
+			print_text(std_err, "Error: Memory allocation has failed!\n");
+			goto cleanup;
+		}
+	}
+
+	for(round = 0U; round < repeat; ++round)
+	{
+		DWORD usec;
+		QueryPerformanceCounter(&time_start);
+		if(engine == ENGINE_MEMORY)
+		{
+			if(!libreplace_replace_memory(context, data, data_len, &output, &output_len, &logger, &replacement_count))
+			{
+				goto cleanup;
+			}
+			libreplace_memory_free(output);
+			output = NULL;
+		}
+		else
+		{
+			init_memory_input(&input_context, data, data_len);
+			output_context->pos = output_context->flushed = 0U;
+			init_io_functions(&io_functions, memory_read_byte, memory_write_byte, (DWORD_PTR)&input_context, (DWORD_PTR)output_context);
+			init_io_bulk_functions(&io_functions, memory_read_bulk, memory_write_bulk);
+			init_io_seek_functions(&io_functions, memory_read_at, memory_get_size);
+			if(!((variant->mode == MODE_TRANSLATE)
+				? libreplace_translate(&io_functions, &logger, table, &options, &replacement_count, &g_abort_requested)
+				: libreplace_search_and_replace(&io_functions, &logger, needle_expanded, needle_len, (const BYTE*)corpus->replacement, lstrlenA(corpus->replacement), &options, &replacement_count, &g_abort_requested)))
+			{
+				goto cleanup;
+			}
+		}
+		QueryPerformanceCounter(&time_end);
+		if((usec = elapsed_usec(&time_start, &time_end)) < best_usec)
+		{
+			best_usec = usec;
+		}
+	}
+
+	print_text_fmt(std_out, "%lu %lu\n", best_usec, replacement_count);
+	result = EXIT_SUCCESS;
+
+cleanup:
+
+	if(context)
+	{
+		libreplace_context_free(context);
+	}
+
+	if(pattern)
+	{
+		libreplace_pattern_free(pattern);
+	}
+
+	if(output_context)
+	{
+		LocalFree((HLOCAL)output_context);
+	}
+
+	if(needle_expanded)
+	{
+		LocalFree((HLOCAL)needle_expanded);
+	}
+
+	if(data)
+	{
+		LocalFree((HLOCAL)data);
+	}
+
+	return result;
+}
+
+/* ======================================================================= */
+/* Parent: process management                                              */
+/* ======================================================================= */
+
+typedef struct cmdline_t
+{
+	WCHAR text[CMDLINE_MAXLEN];
+	DWORD len;
+}
+cmdline_t;
+
+static BOOL cmdline_append(cmdline_t *const cmdline, const WCHAR *const arg_w, const CHAR *const arg_a, const BOOL quote)
+{
+	DWORD pos;
+	if(cmdline->len && (cmdline->len < CMDLINE_MAXLEN))
+	{
+		cmdline->text[cmdline->len++] = L' ';
+	}
+	if(quote && (cmdline->len < CMDLINE_MAXLEN))
+	{
+		cmdline->text[cmdline->len++] = L'"';
+	}
+	for(pos = 0U; (arg_w ? arg_w[pos] : arg_a[pos]) && (cmdline->len < CMDLINE_MAXLEN); ++pos)
+	{
+		cmdline->text[cmdline->len++] = arg_w ? arg_w[pos] : (WCHAR)((BYTE)arg_a[pos]);
+	}
+	if(quote && (cmdline->len < CMDLINE_MAXLEN))
+	{
+		cmdline->text[cmdline->len++] = L'"';
+	}
+	if(cmdline->len >= CMDLINE_MAXLEN)
+	{
+		return FALSE;
+	}
+	cmdline->text[cmdline->len] = L'\0';
+	return TRUE;
+}
+
+static BOOL cmdline_append_number(cmdline_t *const cmdline, const DWORD value)
+{
+	CHAR temp[16U];
+	wsprintfA(temp, "%lu", value);
+	return cmdline_append(cmdline, NULL, temp, FALSE);
+}
+
+static BOOL cmdline_append_hex(cmdline_t *const cmdline, const BYTE *const data, const DWORD data_len)
+{
+	static const CHAR *const HEX_CHARS = "0123456789ABCDEF";
+	CHAR temp[(2U * LONG_NEEDLE_LEN) + 3U];
+	DWORD pos;
+	temp[0U] = '0';
+	temp[1U] = 'x';
+	for(pos = 0U; (pos < data_len) && (pos < LONG_NEEDLE_LEN); ++pos)
+	{
+		temp[2U + (2U * pos)] = HEX_CHARS[data[pos] >> 4U];
+		temp[3U + (2U * pos)] = HEX_CHARS[data[pos] & 0xFU];
+	}
+	temp[2U + (2U * pos)] = '\0';
+	return cmdline_append(cmdline, NULL, temp, FALSE);
+}
+
+static BOOL spawn_process(cmdline_t *const cmdline, const HANDLE std_out, const HANDLE std_err, const BYTE *const input_data, const DWORD input_len, DWORD *const exit_code, DWORD *const elapsed, SIZE_T *const peak_rss, IO_COUNTERS *const io_counters)
+{
+	STARTUPINFOW startup_info;
+	PROCESS_INFORMATION process_info;
+	PROCESS_MEMORY_COUNTERS counters;
+	SECURITY_ATTRIBUTES security;
+	LARGE_INTEGER time_start, time_end;
+	HANDLE pipe_rd = NULL, pipe_wr = NULL;
+	DWORD input_pos, bytes_written;
+	BOOL success = FALSE;
+
+	SecureZeroMemory(&startup_info, sizeof(STARTUPINFOW));
+	SecureZeroMemory(&process_info, sizeof(PROCESS_INFORMATION));
+	SecureZeroMemory(&counters, sizeof(PROCESS_MEMORY_COUNTERS));
+
+	startup_info.cb = sizeof(STARTUPINFOW);
+	startup_info.dwFlags = STARTF_USESTDHANDLES;
+	startup_info.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+	startup_info.hStdOutput = std_out;
+	startup_info.hStdError = std_err;
+
+	/* optionally, the input data is fed to the child's STDIN through a pipe */
+	if(input_data)
+	{
+		SecureZeroMemory(&security, sizeof(SECURITY_ATTRIBUTES));
+		security.nLength = sizeof(SECURITY_ATTRIBUTES);
+		security.bInheritHandle = TRUE;
+		if(!CreatePipe(&pipe_rd, &pipe_wr, &security, 0U))
+		{
+			print_text(std_err, "Error: Failed to create pipe!\n");
+			goto cleanup;
+		}
+		SetHandleInformation(pipe_wr, HANDLE_FLAG_INHERIT, 0U);
+		startup_info.hStdInput = pipe_rd;
+	}
+
+	QueryPerformanceCounter(&time_start);
+	if(!CreateProcessW(NULL, cmdline->text, NULL, NULL, TRUE, 0U, NULL, NULL, &startup_info, &process_info))
+	{
+		print_text_fmt(std_err, "Error: Failed to create process! [error: 0x%X]\n", GetLastError());
+		goto cleanup;
+	}
+
+	CloseHandle(process_info.hThread);
+	if(input_data)
+	{
+		CloseHandle(pipe_rd);
+		pipe_rd = NULL;
+		for(input_pos = 0U; input_pos < input_len; input_pos += bytes_written)
+		{
+			if(!WriteFile(pipe_wr, input_data + input_pos, min(input_len - input_pos, PIPE_CHUNK_SIZE), &bytes_written, NULL))
+			{
+				break; /*the child has terminated early*/
+			}
+		}
+		CloseHandle(pipe_wr);
+		pipe_wr = NULL;
+	}
+
+	WaitForSingleObject(process_info.hProcess, INFINITE);
+	QueryPerformanceCounter(&time_end);
+
+	*elapsed = elapsed_usec(&time_start, &time_end);
+	if(!GetExitCodeProcess(process_info.hProcess, exit_code))
+	{
+		*exit_code = (DWORD)(-1);
+	}
+
+	*peak_rss = GetProcessMemoryInfo(process_info.hProcess, &counters, sizeof(PROCESS_MEMORY_COUNTERS)) ? counters.PeakWorkingSetSize : 0U;
+	if(io_counters && (!GetProcessIoCounters(process_info.hProcess, io_counters)))
+	{
+		SecureZeroMemory(io_counters, sizeof(IO_COUNTERS));
+	}
+
+	CloseHandle(process_info.hProcess);
+	success = TRUE;
+
+cleanup:
+
+	if(pipe_rd)
+	{
+		CloseHandle(pipe_rd);
+	}
+
+	if(pipe_wr)
+	{
+		CloseHandle(pipe_wr);
+	}
+
+	return success;
+}
+
+static BOOL parse_numbers(const CHAR *text, DWORD *const values, const DWORD count)
+{
+	DWORD index;
+	for(index = 0U; index < count; ++index)
+	{
+		DWORD value = 0U;
+		while(*text == ' ')
+		{
+			++text;
+		}
+		if((*text < '0') || (*text > '9'))
+		{
+			return FALSE;
+		}
+		for(; (*text >= '0') && (*text <= '9'); ++text)
+		{
+			value = (10U * value) + (*text - '0');
+		}
+		values[index] = value;
+	}
+	return TRUE;
+}
+
+/* run an in-process case in a child and collect "<usec> <matches>" from its STDOUT */
+static BOOL run_child(const WCHAR *const self_path, const HANDLE std_err, const DWORD engine, const DWORD kernels, const DWORD corpus_id, const DWORD variant_id, const DWORD size_mib, const DWORD repeat, DWORD *const usec, DWORD *const matches, SIZE_T *const peak_rss)
+{
+	cmdline_t cmdline;
+	SECURITY_ATTRIBUTES security;
+	HANDLE pipe_rd = NULL, pipe_wr = NULL;
+	CHAR buffer[64U];
+	DWORD exit_code, elapsed, bytes_read, buffer_len = 0U, values[2U];
+	BOOL success = FALSE;
+
+	cmdline.len = 0U;
+	if(!(cmdline_append(&cmdline, self_path, NULL, TRUE) && cmdline_append(&cmdline, L"--run", NULL, FALSE) && cmdline_append_number(&cmdline, engine) && cmdline_append_number(&cmdline, kernels)
+		&& cmdline_append_number(&cmdline, corpus_id) && cmdline_append_number(&cmdline, variant_id) && cmdline_append_number(&cmdline, size_mib) && cmdline_append_number(&cmdline, repeat)))
+	{
+		return FALSE;
+	}
+
+	SecureZeroMemory(&security, sizeof(SECURITY_ATTRIBUTES));
+	security.nLength = sizeof(SECURITY_ATTRIBUTES);
+	security.bInheritHandle = TRUE;
+
+	if(!CreatePipe(&pipe_rd, &pipe_wr, &security, 0U))
+	{
+		print_text(std_err, "Error: Failed to create pipe!\n");
+		return FALSE;
+	}
+
+	SetHandleInformation(pipe_rd, HANDLE_FLAG_INHERIT, 0U);
+	if(spawn_process(&cmdline, pipe_wr, std_err, NULL, 0U, &exit_code, &elapsed, peak_rss, NULL))
+	{
+		CloseHandle(pipe_wr); /*the output is tiny, so the child never blocks on the pipe*/
+		pipe_wr = NULL;
+		while((buffer_len < (sizeof(buffer) - 1U)) && ReadFile(pipe_rd, buffer + buffer_len, sizeof(buffer) - 1U - buffer_len, &bytes_read, NULL) && (bytes_read > 0U))
+		{
+			buffer_len += bytes_read;
+		}
+		buffer[buffer_len] = '\0';
+		if((exit_code == EXIT_SUCCESS) && parse_numbers(buffer, values, 2U))
+		{
+			*usec = values[0U];
+			*matches = values[1U];
+			success = TRUE;
+		}
+	}
+
+	if(pipe_wr)
+	{
+		CloseHandle(pipe_wr);
+	}
+
+	CloseHandle(pipe_rd);
+	return success;
+}
+
+/* run replace.exe end to end, best of '<repeat>' runs, match count taken from the exit code ('-x') */
+static BOOL run_cli(const WCHAR *const cli_path, const HANDLE std_err, const corpus_t *const corpus, const variant_t *const variant, const WCHAR *const input_file, const WCHAR *const output_file, const DWORD repeat, DWORD *const usec, DWORD *const matches, SIZE_T *const peak_rss)
+{
+	cmdline_t cmdline;
+	BYTE needle[LONG_NEEDLE_LEN + 1U];
+	CHAR replacement[LONG_NEEDLE_LEN + 1U];
+	const DWORD needle_len = corpus_needle(corpus, needle);
+	const HANDLE null_handle = CreateFileW(L"NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0U, NULL);
+	DWORD round, exit_code, elapsed;
+	SIZE_T peak;
+	BOOL success = FALSE;
+
+	if(variant->mode == MODE_GLOBBING)
+	{
+		needle[needle_len >> 1U] = '?';
+	}
+
+	lstrcpynA(replacement, corpus->replacement, (variant->mode == MODE_TRANSLATE) ? (needle_len + 1U) : (LONG_NEEDLE_LEN + 1U)); /*'-c' rejects a longer replacement*/
+
+	cmdline.len = 0U;
+	if(!(cmdline_append(&cmdline, cli_path, NULL, TRUE) && cmdline_append(&cmdline, NULL, corpus->binary ? "-xb" : "-x", FALSE)
+		&& ((!variant->flags[0U]) || cmdline_append(&cmdline, NULL, variant->flags, FALSE))
+		&& (corpus->binary ? cmdline_append_hex(&cmdline, needle, needle_len) : cmdline_append(&cmdline, NULL, (const CHAR*)needle, TRUE))
+		&& (corpus->binary ? cmdline_append_hex(&cmdline, (const BYTE*)replacement, lstrlenA(replacement)) : cmdline_append(&cmdline, NULL, replacement, TRUE))
+		&& cmdline_append(&cmdline, input_file, NULL, TRUE) && cmdline_append(&cmdline, output_file, NULL, TRUE)))
+	{
+		print_text(std_err, "Error: Command-line is too long!\n");
+		goto cleanup;
+	}
+
+	*usec = MAXDWORD;
+	*matches = 0U;
+	*peak_rss = 0U;
+
+	for(round = 0U; round < repeat; ++round)
+	{
+		if(!spawn_process(&cmdline, null_handle, std_err, NULL, 0U, &exit_code, &elapsed, &peak, NULL))
+		{
+			goto cleanup;
+		}
+		if(exit_code > ((DWORD)MAXINT32))
+		{
+			print_text(std_err, "Error: The CLI has reported an error!\n");
+			goto cleanup;
+		}
+		*matches = exit_code;
+		*usec = min(*usec, elapsed);
+		*peak_rss = max(*peak_rss, peak);
+	}
+
+	success = TRUE;
+
+cleanup:
+
+	if(null_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(null_handle);
+	}
+
+	return success;
+}
+
+/* run replace.exe on a file (overlapped or synchronous I/O) or on a pipe, with the given I/O buffer size (0 = default), best of '<repeat>' runs */
+static BOOL run_io(const WCHAR *const cli_path, const HANDLE std_err, const corpus_t *const corpus, const DWORD input_mode, const DWORD buffer_size, const WCHAR *const input_file, const WCHAR *const output_file, const BYTE *const data, const DWORD data_len, const DWORD repeat, DWORD *const usec, IO_COUNTERS *const io_counters)
+{
+	cmdline_t cmdline;
+	BYTE needle[LONG_NEEDLE_LEN + 1U];
+	IO_COUNTERS counters;
+	DWORD round, exit_code, elapsed;
+	SIZE_T peak;
+
+	corpus_needle(corpus, needle);
+
+	cmdline.len = 0U;
+	if(!(cmdline_append(&cmdline, cli_path, NULL, TRUE) && cmdline_append(&cmdline, NULL, "-x", FALSE)
+		&& ((!buffer_size) || (cmdline_append(&cmdline, NULL, "--buffer-size", FALSE) && cmdline_append_number(&cmdline, buffer_size)))
+		&& ((input_mode != INPUT_FILE_SYNC) || cmdline_append(&cmdline, NULL, "--sync-io", FALSE))
+		&& cmdline_append(&cmdline, NULL, (const CHAR*)needle, TRUE) && cmdline_append(&cmdline, NULL, corpus->replacement, TRUE)
+		&& ((input_mode == INPUT_PIPE) ? cmdline_append(&cmdline, NULL, "-", FALSE) : cmdline_append(&cmdline, input_file, NULL, TRUE))
+		&& cmdline_append(&cmdline, output_file, NULL, TRUE)))
+	{
+		print_text(std_err, "Error: Command-line is too long!\n");
+		return FALSE;
+	}
+
+	*usec = MAXDWORD;
+	SecureZeroMemory(io_counters, sizeof(IO_COUNTERS));
+
+	for(round = 0U; round < repeat; ++round)
+	{
+		if(!spawn_process(&cmdline, NULL, std_err, (input_mode == INPUT_PIPE) ? data : NULL, data_len, &exit_code, &elapsed, &peak, &counters))
+		{
+			return FALSE;
+		}
+		if(exit_code > ((DWORD)MAXINT32))
+		{
+			print_text(std_err, "Error: The CLI has reported an error!\n");
+			return FALSE;
+		}
+		if(elapsed < *usec)
+		{
+			*usec = elapsed;
+			*io_counters = counters;
+		}
+	}
+
+	return TRUE;
+}
+
+/* ======================================================================= */
+/* Parent: reporting                                                       */
+/* ======================================================================= */
+
+static void print_result(const HANDLE std_out, const BOOL first, const DWORD engine, const CHAR *const kernels, const corpus_t *const corpus, const variant_t *const variant, const DWORD data_len, const DWORD usec, const DWORD matches, const SIZE_T peak_rss)
+{
+	const DWORD mb_per_sec = data_len / usec; /*equals GB/s in units of 1/1000*/
+	const int matches_per_sec = MulDiv((int)min(matches, (DWORD)MAXINT32), 1000000, (int)min(usec, (DWORD)MAXINT32));
+
+	print_text(std_out, first ? "\n    {" : ",\n    {");
+	print_text_fmt(std_out, " \"engine\": \"%s\", \"kernels\": \"%s\", \"corpus\": \"%s\", \"flags\": \"%s\",", ENGINE_NAMES[engine], kernels, corpus->name, variant->flags);
+	print_text_fmt(std_out, " \"bytes\": %lu, \"matches\": %lu, \"seconds\": %lu.%06lu,", data_len, matches, usec / 1000000U, usec % 1000000U);
+	print_text_fmt(std_out, " \"gb_per_sec\": %lu.%03lu, \"matches_per_sec\": %ld, \"peak_rss_kib\": %lu }", mb_per_sec / 1000U, mb_per_sec % 1000U, (matches_per_sec >= 0) ? (LONG)matches_per_sec : MAXINT32, (DWORD)(peak_rss >> 10U));
+}
+
+static void print_io_result(const HANDLE std_out, const BOOL first, const CHAR *const kernels, const corpus_t *const corpus, const DWORD input_mode, const DWORD buffer_size, const DWORD data_len, const DWORD usec, const IO_COUNTERS *const io_counters)
+{
+	const DWORD mb_per_sec = data_len / usec; /*equals GB/s in units of 1/1000*/
+	const DWORD read_ops = (io_counters->ReadOperationCount < MAXDWORD) ? (DWORD)io_counters->ReadOperationCount : MAXDWORD;
+	const DWORD write_ops = (io_counters->WriteOperationCount < MAXDWORD) ? (DWORD)io_counters->WriteOperationCount : MAXDWORD;
+
+	print_text(std_out, first ? "\n    {" : ",\n    {");
+	print_text_fmt(std_out, " \"engine\": \"%s\", \"kernels\": \"%s\", \"corpus\": \"%s\", \"input\": \"%s\", \"buffer_size\": %lu,", ENGINE_NAMES[ENGINE_IO], kernels, corpus->name, INPUT_NAMES[input_mode], buffer_size);
+	print_text_fmt(std_out, " \"bytes\": %lu, \"seconds\": %lu.%06lu, \"gb_per_sec\": %lu.%03lu,", data_len, usec / 1000000U, usec % 1000000U, mb_per_sec / 1000U, mb_per_sec % 1000U);
+	print_text_fmt(std_out, " \"read_ops\": %lu, \"write_ops\": %lu }", read_ops, write_ops);
+}
+
+static void print_progress(const HANDLE std_err, const DWORD engine, const CHAR *const kernels, const corpus_t *const corpus, const variant_t *const variant, const BOOL success)
+{
+	print_text_fmt(std_err, "[Bench] %-6s %-7s %-12s %-2s %s\n", ENGINE_NAMES[engine], kernels, corpus->name, variant->flags[0U] ? variant->flags : "--", success ? "done" : "FAILED");
+}
+
+/* ======================================================================= */
+/* Parent: benchmark driver                                                */
+/* ======================================================================= */
+
+static UINT run_benchmark(const HANDLE std_out, const HANDLE std_err, const WCHAR *const cli_path, const DWORD size_mib, const DWORD repeat)
+{
+	WCHAR self_path[MAX_PATH], temp_path[MAX_PATH];
+	const CHAR *kernel_names[LIBREPLACE_KERNELS_AVX512 + 1U];
+	const DWORD data_len = size_mib << 20U;
+	const WCHAR *input_file = NULL, *output_file = NULL;
+	HANDLE handle = INVALID_HANDLE_VALUE;
+	BYTE *data = NULL;
+	DWORD corpus_id, variant_id, kernels, usec, matches, bytes_written, input_mode, buffer_id;
+	SIZE_T peak_rss;
+	IO_COUNTERS io_counters;
+	BOOL first = TRUE, success;
+	UINT result = EXIT_FAILURE;
+
+	if(!GetModuleFileNameW(NULL, self_path, MAX_PATH))
+	{
+		print_text(std_err, "Error: Failed to determine the executable path!\n");
+		goto cleanup;
+	}
+
+	if(!GetTempPathW(MAX_PATH, temp_path))
+	{
+		print_text(std_err, "Error: Failed to determine the temp directory!\n");
+		goto cleanup;
+	}
+
+	for(kernels = LIBREPLACE_KERNELS_SCALAR; kernels <= LIBREPLACE_KERNELS_AVX512; ++kernels)
+	{
+		kernel_names[kernels] = libreplace_select_kernels(kernels) ? libreplace_kernels_name() : NULL;
+	}
+
+	libreplace_select_kernels(LIBREPLACE_KERNELS_AUTO);
+	kernel_names[LIBREPLACE_KERNELS_AUTO] = libreplace_kernels_name();
+
+	print_text(std_out, "{\n");
+	print_text_fmt(std_out, "  \"version\": \"%lu.%lu.%lu\",\n", LIBREPLACE_VERSION_MAJOR, LIBREPLACE_VERSION_MINOR, LIBREPLACE_VERSION_PATCH);
+	print_text_fmt(std_out, "  \"kernels\": \"%s\",\n", kernel_names[LIBREPLACE_KERNELS_AUTO]);
+	print_text_fmt(std_out, "  \"corpus_bytes\": %lu,\n  \"repeat\": %lu,\n  \"results\": [", data_len, repeat);
+
+	for(corpus_id = 0U; (corpus_id < CORPUS_COUNT) && (!g_abort_requested); ++corpus_id)
+	{
+		const corpus_t *const corpus = &CORPORA[corpus_id];
+
+		/* in-process engines */
+		for(variant_id = 0U; (variant_id < VARIANT_COUNT) && (!g_abort_requested); ++variant_id)
+		{
+			const variant_t *const variant = &VARIANTS[variant_id];
+			if(corpus->binary && (!variant->binary_ok))
+			{
+				continue;
+			}
+			for(kernels = LIBREPLACE_KERNELS_AUTO; kernels <= LIBREPLACE_KERNELS_AVX512; ++kernels)
+			{
+				/* AUTO selects the streaming engine, every explicit kernel set the in-memory API */
+				const DWORD engine = kernels ? ENGINE_MEMORY : ENGINE_STREAM;
+				if((!(variant->engines & ENGINE_BIT(engine))) || (!kernel_names[kernels]))
+				{
+					continue;
+				}
+				success = run_child(self_path, std_err, engine, kernels, corpus_id, variant_id, size_mib, repeat, &usec, &matches, &peak_rss);
+				print_progress(std_err, engine, kernel_names[kernels], corpus, variant, success);
+				if(!success)
+				{
+					goto cleanup;
+				}
+				print_result(std_out, first, engine, kernel_names[kernels], corpus, variant, data_len, usec, matches, peak_rss);
+				first = FALSE;
+			}
+		}
+
+		/* end-to-end CLI runs on a temporary input file */
+		if(NOT_EMPTY(cli_path))
+		{
+			if(!(data = corpus_generate(corpus, corpus_id, data_len)))
+			{
+				print_text(std_err, "Error: Failed to generate the corpus!\n");
+				goto cleanup;
+			}
+			if(!(input_file = generate_temp_file(temp_path, &handle, 0U)))
+			{
+				print_text(std_err, "Error: Failed to create temporary file!\n");
+				goto cleanup;
+			}
+			if(!(WriteFile(handle, data, data_len, &bytes_written, NULL) && (bytes_written == data_len)))
+			{
+				print_text(std_err, "Error: Failed to write temporary file!\n");
+				goto cleanup;
+			}
+			CloseHandle(handle);
+			if(!(output_file = generate_temp_file(temp_path, &handle, 0U)))
+			{
+				print_text(std_err, "Error: Failed to create temporary file!\n");
+				goto cleanup;
+			}
+			CloseHandle(handle);
+			handle = INVALID_HANDLE_VALUE;
+			for(variant_id = 0U; (variant_id < VARIANT_COUNT) && (!g_abort_requested); ++variant_id)
+			{
+				const variant_t *const variant = &VARIANTS[variant_id];
+				if(corpus->binary && (!variant->binary_ok))
+				{
+					continue;
+				}
+				success = run_cli(cli_path, std_err, corpus, variant, input_file, output_file, repeat, &usec, &matches, &peak_rss);
+				print_progress(std_err, ENGINE_CLI, kernel_names[LIBREPLACE_KERNELS_AUTO], corpus, variant, success);
+				if(!success)
+				{
+					goto cleanup;
+				}
+				print_result(std_out, first, ENGINE_CLI, kernel_names[LIBREPLACE_KERNELS_AUTO], corpus, variant, data_len, usec, matches, peak_rss);
+				first = FALSE;
+			}
+
+			/* I/O buffer sizes: legacy fixed size vs. default size, file (overlapped vs. synchronous) vs. pipe input */
+			for(input_mode = 0U; corpus->io_bench && (input_mode < INPUT_COUNT) && (!g_abort_requested); ++input_mode)
+			{
+				for(buffer_id = 0U; (buffer_id < IO_BUFFER_COUNT) && (!g_abort_requested); ++buffer_id)
+				{
+					const DWORD buffer_size = IO_BUFFER_SIZES[buffer_id];
+					success = run_io(cli_path, std_err, corpus, input_mode, buffer_size, input_file, output_file, data, data_len, repeat, &usec, &io_counters);
+					print_text_fmt(std_err, "[Bench] %-6s %-7s %-12s %-9s %-7s %s\n", ENGINE_NAMES[ENGINE_IO], kernel_names[LIBREPLACE_KERNELS_AUTO], corpus->name, INPUT_NAMES[input_mode], buffer_size ? "legacy" : "default", success ? "done" : "FAILED");
+					if(!success)
+					{
+						goto cleanup;
+					}
+					print_io_result(std_out, first, kernel_names[LIBREPLACE_KERNELS_AUTO], corpus, input_mode, buffer_size, data_len, usec, &io_counters);
+					first = FALSE;
+				}
+			}
+
+			LocalFree((HLOCAL)data);
+			data = NULL;
+			delete_file(input_file);
+			delete_file(output_file);
+			LocalFree((HLOCAL)input_file);
+			LocalFree((HLOCAL)output_file);
+			input_file = output_file = NULL;
+		}
+	}
+
+	print_text(std_out, "\n  ]\n}\n");
+	result = g_abort_requested ? EXIT_ABORTED : EXIT_SUCCESS;
+
+cleanup:
+
+	if(handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(handle);
+	}
+
+	if(input_file)
+	{
+		delete_file(input_file);
+		LocalFree((HLOCAL)input_file);
+	}
+
+	if(output_file)
+	{
+		delete_file(output_file);
+		LocalFree((HLOCAL)output_file);
+	}
+
+	if(data)
+	{
+		LocalFree((HLOCAL)data);
+	}
+
+	return result;
+}
+
+/* ======================================================================= */
+/* Main                                                                    */
+/* ======================================================================= */
+
+static BOOL parse_arg(const int argc, const LPCWSTR *const argv, const int index, const ULONGLONG min_value, const ULONGLONG max_value, DWORD *const value)
+{
+	ULONGLONG temp;
+	if((index < argc) && decode_number(argv[index], &temp) && (temp >= min_value) && (temp <= max_value))
+	{
+		*value = (DWORD)temp;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static UINT bench_main(const int argc, const LPCWSTR *const argv)
+{
+	const HANDLE std_out = GetStdHandle(STD_OUTPUT_HANDLE), std_err = GetStdHandle(STD_ERROR_HANDLE);
+	DWORD size_mib = DEFAULT_SIZE_MIB, repeat = DEFAULT_REPEAT, values[6U];
+	const WCHAR *cli_path = NULL;
+	int index;
+
+	/* child mode: --run <engine> <kernels> <corpus> <variant> <size_mib> <repeat> */
+	if((argc > 1) && (!lstrcmpW(argv[1U], L"--run")))
+	{
+		if(!(parse_arg(argc, argv, 2, ENGINE_MEMORY, ENGINE_STREAM, &values[0U]) && parse_arg(argc, argv, 3, LIBREPLACE_KERNELS_AUTO, LIBREPLACE_KERNELS_AVX512, &values[1U])
+			&& parse_arg(argc, argv, 4, 0U, CORPUS_COUNT - 1U, &values[2U]) && parse_arg(argc, argv, 5, 0U, VARIANT_COUNT - 1U, &values[3U])
+			&& parse_arg(argc, argv, 6, 1U, MAX_SIZE_MIB, &values[4U]) && parse_arg(argc, argv, 7, 1U, MAX_REPEAT, &values[5U])))
+		{
+			print_text(std_err, "Error: Invalid child process arguments!\n");
+			return EXIT_FAILURE;
+		}
+		return run_case(std_out, std_err, values[0U], values[1U], values[2U], values[3U], values[4U] << 20U, values[5U]);
+	}
+
+	for(index = 1; index < argc; ++index)
+	{
+		if(!lstrcmpW(argv[index], L"--size"))
+		{
+			if(!parse_arg(argc, argv, ++index, 1U, MAX_SIZE_MIB, &size_mib))
+			{
+				print_text_fmt(std_err, "Error: Option '--size' requires a number between 1 and %lu (MiB)!\n", MAX_SIZE_MIB);
+				return EXIT_FAILURE;
+			}
+		}
+		else if(!lstrcmpW(argv[index], L"--repeat"))
+		{
+			if(!parse_arg(argc, argv, ++index, 1U, MAX_REPEAT, &repeat))
+			{
+				print_text_fmt(std_err, "Error: Option '--repeat' requires a number between 1 and %lu!\n", MAX_REPEAT);
+				return EXIT_FAILURE;
+			}
+		}
+		else if((argv[index][0U] == L'-') || cli_path)
+		{
+			print_text(std_err, "Usage:\n  replace-bench.exe [--size <MiB>] [--repeat <n>] [<path_to_replace.exe>]\n\n");
+			print_text(std_err, "Writes the results as JSON to STDOUT; the CLI engine is skipped if no path is given.\n");
+			return EXIT_FAILURE;
+		}
+		else
+		{
+			cli_path = argv[index];
+		}
+	}
+
+	return run_benchmark(std_out, std_err, cli_path, size_mib, repeat);
+}
+
+/* ======================================================================= */
+/* Ctrl+C handler routine                                                  */
+/* ======================================================================= */
+
+BOOL WINAPI ctrl_handler_routine(const DWORD type)
+{
+	switch(type)
+	{
+	case CTRL_C_EVENT:
+	case CTRL_BREAK_EVENT:
+	case CTRL_CLOSE_EVENT:
+		g_abort_requested = TRUE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* ======================================================================= */
+/* Entry point                                                             */
+/* ======================================================================= */
+
+void _entryPoint(void)
+{
+	int argc;
+	UINT result = (UINT)(-1);
+	LPWSTR *argv;
+
+	SetErrorMode(SetErrorMode(0x3) | 0x3);
+	SetConsoleCtrlHandler(ctrl_handler_routine, TRUE);
+
+	if(argv = CommandLineToArgvW(GetCommandLineW(), &argc))
+	{
+		result = bench_main(argc, (const LPCWSTR*)argv);
+		LocalFree(argv);
+	}
+
+	ExitProcess(result);
+}
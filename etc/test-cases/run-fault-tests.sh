@@ -0,0 +1,80 @@
+#!/bin/bash
+cd "$(dirname "${BASH_SOURCE[0]}")"
+
+# the fault points (REPLACE_FAULT_SYNC and REPLACE_FAULT_RENAME) exist in debug builds only
+replace_exe="${REPLACE_EXE:-../../bin/Win32/Debug/replace.exe}"
+exit_fault=99
+
+rm -rf "out/fault"
+mkdir -p "out/fault"
+
+printf 'kokos %06d\n' $(seq 1 250000) > "out/fault/original.txt"
+sed 's|kokos|XJbf4|g' "out/fault/original.txt" > "out/fault/expected.txt"
+
+fail() {
+	echo -e "\033[1;31mFAILURE! ($1)\033[0m"
+	exit 1
+}
+
+prepare() {
+	rm -f out/fault/~*.tmp "out/fault/undo.patch"
+	cp "out/fault/original.txt" "out/fault/input.txt"
+}
+
+check_intact() {
+	if ! cmp -s "out/fault/input.txt" "out/fault/original.txt"; then
+		fail "$1: the original file was modified"
+	fi
+}
+
+run_test() {
+	local title="$1" expected_syncs="$2"
+	shift 2
+
+	echo "${title}"
+
+	# count the syncs of a complete run
+	prepare
+	syncs="$(env -u REPLACE_FAULT_SYNC -u REPLACE_FAULT_RENAME "${replace_exe}" -v "$@" "kokos" "XJbf4" "out/fault/input.txt" 2>&1 | sed -n 's|^File buffers were synced \([0-9]*\) time(s)\.\r\?$|\1|p')"
+	if ! cmp -s "out/fault/input.txt" "out/fault/expected.txt"; then
+		fail "${title}: wrong output"
+	fi
+	if [ -z "${syncs}" ] || { [ -n "${expected_syncs}" ] && [ "${syncs}" -ne "${expected_syncs}" ]; }; then
+		fail "${title}: synced ${syncs:-?} time(s), expected ${expected_syncs:-any}"
+	fi
+	echo "synced ${syncs} time(s)"
+
+	# crash at each sync, then at the rename
+	for ((sync = 1; sync <= syncs; ++sync)); do
+		prepare
+		REPLACE_FAULT_SYNC=${sync} "${replace_exe}" "$@" "kokos" "XJbf4" "out/fault/input.txt" 2> /dev/null
+		if [ $? -ne ${exit_fault} ]; then
+			fail "${title}: no crash at sync #${sync}"
+		fi
+		check_intact "${title}: crash at sync #${sync}"
+	done
+
+	prepare
+	REPLACE_FAULT_RENAME=1 "${replace_exe}" "$@" "kokos" "XJbf4" "out/fault/input.txt" 2> /dev/null
+	if [ $? -ne ${exit_fault} ]; then
+		fail "${title}: no crash at the rename"
+	fi
+	check_intact "${title}: crash at the rename"
+
+	echo -e "\033[1;32mSUCCESS\033[0m"
+	echo "------------------------------------------------------------------------------"
+}
+
+# the output is synced only once, when complete
+run_test "--group-commit" 1 --group-commit
+run_test "--group-commit --sync-io" 1 --group-commit --sync-io
+run_test "--group-commit --buffer-size 4096" 1 --group-commit --buffer-size 4096
+
+# the undo journal is synced first
+run_test "--group-commit --undo-journal" 2 --group-commit --undo-journal "out/fault/undo.patch"
+
+# every buffer is synced
+run_test "-f" "" -f --buffer-size 65536
+
+rm -rf "out/fault"
+echo -e "\033[1;32mALL FAULT TESTS PASSED\033[0m"
@@ -0,0 +1,317 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#ifndef INC_CHECKPOINT_H
+#define INC_CHECKPOINT_H
+
+#include "libreplace/replace.h"
+#include "utils.h"
+#include "gzip.h"
+#include "patch.h"
+
+/*
+ * Checkpoints, so that an interrupted run can be resumed. The checkpoint file
+ * has two slots, which are written alternately, so that a torn write leaves
+ * the previous checkpoint intact. Each slot holds:
+ *
+ *   signature, sequence number, fingerprint of the search parameters, length of the file name,
+ *   size and time of the input file, input offset, output offset, replacement count,
+ *   name of the temporary file (UTF-16), CRC-32 of all the preceding data
+ *
+ * The output is synced before each checkpoint, so the output up to the recorded
+ * offset is durable. The input offset excludes a pending partial match, which
+ * is simply read again when the run is resumed.
+ */
+
+#define CHECKPOINT_SLOT_SIZE 0x10000U
+#define CHECKPOINT_HEADER_LEN 64U
+#define CHECKPOINT_MAX_NAME ((CHECKPOINT_SLOT_SIZE - CHECKPOINT_HEADER_LEN - 4U) / sizeof(WCHAR))
+#define CHECKPOINT_INTERVAL 64U /*in I/O buffers*/
+
+static const BYTE CHECKPOINT_SIGNATURE[8U] = { 'R', 'P', 'L', 'R', 'E', 'S', 'U', 'M' };
+
+typedef struct checkpoint_t
+{
+	HANDLE handle;
+	ULONGLONG sequence;
+	DWORD fingerprint;
+	ULONGLONG input_size, input_time;
+	ULONGLONG input_offset, output_offset;
+	DWORD replacement_count;
+	DWORD crc_table[256U];
+	WCHAR *temp_file; /*CHECKPOINT_MAX_NAME + 1 characters*/
+	BYTE *slot;       /*CHECKPOINT_SLOT_SIZE bytes*/
+}
+checkpoint_t;
+
+static checkpoint_t *checkpoint_alloc(void)
+{
+	checkpoint_t *const checkpoint = (checkpoint_t*) LocalAlloc(LPTR, sizeof(checkpoint_t) + CHECKPOINT_SLOT_SIZE + (sizeof(WCHAR) * (CHECKPOINT_MAX_NAME + 1U)));
+	if(checkpoint)
+	{
+		checkpoint->handle = INVALID_HANDLE_VALUE;
+		checkpoint->slot = ((BYTE*)checkpoint) + sizeof(checkpoint_t);
+		checkpoint->temp_file = (WCHAR*)(checkpoint->slot + CHECKPOINT_SLOT_SIZE);
+		gzip_crc32_init(checkpoint->crc_table);
+	}
+	return checkpoint;
+}
+
+static void checkpoint_free(checkpoint_t *const checkpoint)
+{
+	if(checkpoint)
+	{
+		if(checkpoint->handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(checkpoint->handle);
+		}
+		LocalFree((HLOCAL)checkpoint);
+	}
+}
+
+/* the checkpoint is only valid for the same search parameters */
+static DWORD checkpoint_fingerprint(const checkpoint_t *const checkpoint, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len, const libreplace_flags_t *const flags)
+{
+	BYTE buffer[40U];
+	DWORD pos, crc = 0U;
+	for(pos = 0U; pos < needle_len; ++pos)
+	{
+		patch_store_number(buffer, needle[pos], 2U);
+		crc = gzip_crc32_update(checkpoint->crc_table, crc, buffer, 2U);
+	}
+	patch_store_number(buffer, MAXWORD, 2U); /*separator*/
+	crc = gzip_crc32_update(checkpoint->crc_table, crc, buffer, 2U);
+	for(pos = 0U; pos < replacement_len; ++pos)
+	{
+		patch_store_number(buffer, replacement[pos], 2U);
+		crc = gzip_crc32_update(checkpoint->crc_table, crc, buffer, 2U);
+	}
+	buffer[0U] = flags->case_insensitive ? 1U : 0U;
+	buffer[1U] = flags->match_crlf ? 1U : 0U;
+	buffer[2U] = flags->replace_once ? 1U : 0U;
+	buffer[3U] = flags->dry_run ? 1U : 0U;
+	patch_store_number(buffer + 4U, flags->max_replacements, 4U);
+	patch_store_number(buffer + 8U, flags->window_offset, 8U);
+	patch_store_number(buffer + 16U, flags->window_length, 8U);
+	return gzip_crc32_update(checkpoint->crc_table, crc, buffer, 24U);
+}
+
+/* the checkpoint is only valid for the same input file, too */
+static BOOL checkpoint_identify(const HANDLE input, ULONGLONG *const size, ULONGLONG *const time)
+{
+	BY_HANDLE_FILE_INFORMATION file_info;
+	SecureZeroMemory(&file_info, sizeof(BY_HANDLE_FILE_INFORMATION));
+	if(GetFileInformationByHandle(input, &file_info))
+	{
+		*size = (((ULONGLONG)file_info.nFileSizeHigh) << 32) | file_info.nFileSizeLow;
+		*time = (((ULONGLONG)file_info.ftLastWriteTime.dwHighDateTime) << 32) | file_info.ftLastWriteTime.dwLowDateTime;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* ======================================================================= */
+/* Load & Save                                                             */
+/* ======================================================================= */
+
+static BOOL checkpoint_parse_slot(checkpoint_t *const checkpoint, const BYTE *const slot, const DWORD slot_len)
+{
+	DWORD pos, name_len;
+	if(slot_len < CHECKPOINT_HEADER_LEN + 4U)
+	{
+		return FALSE;
+	}
+	for(pos = 0U; pos < sizeof(CHECKPOINT_SIGNATURE); ++pos)
+	{
+		if(slot[pos] != CHECKPOINT_SIGNATURE[pos])
+		{
+			return FALSE;
+		}
+	}
+	name_len = (DWORD) patch_load_number(slot + 20U, 4U);
+	if((name_len > CHECKPOINT_MAX_NAME) || (CHECKPOINT_HEADER_LEN + (sizeof(WCHAR) * name_len) + 4U > slot_len))
+	{
+		return FALSE;
+	}
+	pos = CHECKPOINT_HEADER_LEN + (sizeof(WCHAR) * name_len);
+	if(patch_load_number(slot + pos, 4U) != gzip_crc32_update(checkpoint->crc_table, 0U, slot, pos))
+	{
+		return FALSE; /*torn write*/
+	}
+	if(checkpoint->sequence && (patch_load_number(slot + 8U, 8U) < checkpoint->sequence))
+	{
+		return TRUE; /*the other slot is more recent*/
+	}
+	checkpoint->sequence = patch_load_number(slot + 8U, 8U);
+	checkpoint->fingerprint = (DWORD) patch_load_number(slot + 16U, 4U);
+	checkpoint->input_size = patch_load_number(slot + 24U, 8U);
+	checkpoint->input_time = patch_load_number(slot + 32U, 8U);
+	checkpoint->input_offset = patch_load_number(slot + 40U, 8U);
+	checkpoint->output_offset = patch_load_number(slot + 48U, 8U);
+	checkpoint->replacement_count = (DWORD) patch_load_number(slot + 56U, 4U);
+	for(pos = 0U; pos < name_len; ++pos)
+	{
+		checkpoint->temp_file[pos] = (WCHAR) patch_load_number(slot + CHECKPOINT_HEADER_LEN + (sizeof(WCHAR) * pos), 2U);
+	}
+	checkpoint->temp_file[name_len] = L'\0';
+	return TRUE;
+}
+
+/* loads the most recent valid slot; returns FALSE, if there is no valid checkpoint */
+static BOOL checkpoint_load(checkpoint_t *const checkpoint, const WCHAR *const file_name)
+{
+	DWORD slot_index, bytes_read;
+	BOOL valid = FALSE;
+	OVERLAPPED overlapped;
+	const HANDLE handle = open_file(file_name, FALSE, 0U);
+
+	checkpoint->sequence = 0U;
+	if(handle == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	for(slot_index = 0U; slot_index < 2U; ++slot_index)
+	{
+		SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+		overlapped.Offset = slot_index * CHECKPOINT_SLOT_SIZE;
+		if(ReadFile(handle, checkpoint->slot, CHECKPOINT_SLOT_SIZE, &bytes_read, &overlapped) && checkpoint_parse_slot(checkpoint, checkpoint->slot, bytes_read))
+		{
+			valid = TRUE;
+		}
+	}
+
+	CloseHandle(handle);
+	return valid;
+}
+
+/* opens the checkpoint file for writing, the existing slots are kept until they are overwritten */
+static BOOL checkpoint_open(checkpoint_t *const checkpoint, const WCHAR *const file_name)
+{
+	if(checkpoint->handle == INVALID_HANDLE_VALUE)
+	{
+		checkpoint->handle = CreateFileW(file_name, GENERIC_WRITE, 0U, NULL, OPEN_ALWAYS, 0U, NULL);
+	}
+	return (checkpoint->handle != INVALID_HANDLE_VALUE);
+}
+
+static BOOL checkpoint_save(checkpoint_t *const checkpoint)
+{
+	DWORD pos, name_len, bytes_written;
+	OVERLAPPED overlapped;
+
+	for(name_len = 0U; checkpoint->temp_file[name_len]; ++name_len);
+
+	checkpoint->sequence++;
+	SecureZeroMemory(checkpoint->slot, CHECKPOINT_HEADER_LEN);
+	for(pos = 0U; pos < sizeof(CHECKPOINT_SIGNATURE); ++pos)
+	{
+		checkpoint->slot[pos] = CHECKPOINT_SIGNATURE[pos];
+	}
+	patch_store_number(checkpoint->slot + 8U, checkpoint->sequence, 8U);
+	patch_store_number(checkpoint->slot + 16U, checkpoint->fingerprint, 4U);
+	patch_store_number(checkpoint->slot + 20U, name_len, 4U);
+	patch_store_number(checkpoint->slot + 24U, checkpoint->input_size, 8U);
+	patch_store_number(checkpoint->slot + 32U, checkpoint->input_time, 8U);
+	patch_store_number(checkpoint->slot + 40U, checkpoint->input_offset, 8U);
+	patch_store_number(checkpoint->slot + 48U, checkpoint->output_offset, 8U);
+	patch_store_number(checkpoint->slot + 56U, checkpoint->replacement_count, 4U);
+	for(pos = 0U; pos < name_len; ++pos)
+	{
+		patch_store_number(checkpoint->slot + CHECKPOINT_HEADER_LEN + (sizeof(WCHAR) * pos), checkpoint->temp_file[pos], 2U);
+	}
+	pos = CHECKPOINT_HEADER_LEN + (sizeof(WCHAR) * name_len);
+	patch_store_number(checkpoint->slot + pos, gzip_crc32_update(checkpoint->crc_table, 0U, checkpoint->slot, pos), 4U);
+
+	/* write the older slot, so that the previous checkpoint remains valid until this one is durable */
+	SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = (DWORD)(checkpoint->sequence & 1U) * CHECKPOINT_SLOT_SIZE;
+	return WriteFile(checkpoint->handle, checkpoint->slot, pos + 4U, &bytes_written, &overlapped) && (bytes_written == pos + 4U) && sync_file(checkpoint->handle);
+}
+
+/* ======================================================================= */
+/* Processing                                                              */
+/* ======================================================================= */
+
+/* re-opens the partial output of the interrupted run, without truncating it */
+static HANDLE checkpoint_reopen(const WCHAR *const file_name, const BOOL async)
+{
+	return CreateFileW(file_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, async ? FILE_FLAG_OVERLAPPED : 0U, NULL);
+}
+
+/* continues at the recorded offsets, any output behind the checkpoint is discarded */
+static BOOL checkpoint_seek(const checkpoint_t *const checkpoint, file_input_t *const input, file_output_t *const output)
+{
+	LARGE_INTEGER offset, size;
+	if(!(GetFileSizeEx(output->handle_out, &size) && (((ULONGLONG)size.QuadPart) >= checkpoint->output_offset)))
+	{
+		return FALSE;
+	}
+	offset.QuadPart = (LONGLONG)checkpoint->output_offset;
+	if(!(SetFilePointerEx(output->handle_out, offset, NULL, FILE_BEGIN) && SetEndOfFile(output->handle_out)))
+	{
+		return FALSE;
+	}
+	output->written = checkpoint->output_offset;
+	if(input->async)
+	{
+		input->async->offset = checkpoint->input_offset;
+		return TRUE;
+	}
+	offset.QuadPart = (LONGLONG)checkpoint->input_offset;
+	return SetFilePointerEx(input->handle_in, offset, NULL, FILE_BEGIN);
+}
+
+/* streams the input through the library, recording a checkpoint after every CHECKPOINT_INTERVAL buffers */
+static BOOL checkpoint_process(checkpoint_t *const checkpoint, libreplace_context_t *const context, file_input_t *const input, file_output_t *const output, const libreplace_logger_t *const logger, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	BOOL success = FALSE, error_flag = FALSE;
+	DWORD bytes_read, buffer_count = 0U;
+	libreplace_sink_t sink;
+	BYTE *buffer = NULL;
+
+	sink.func_write = file_write_bulk;
+	sink.context = (DWORD_PTR)output;
+
+	if(!(libreplace_resume(context, checkpoint->input_offset, checkpoint->replacement_count) && (buffer = (BYTE*) LocalAlloc(LPTR, input->buffer_size))))
+	{
+		goto cleanup;
+	}
+
+	while(file_read_bulk(buffer, input->buffer_size, &bytes_read, (DWORD_PTR)input, &error_flag))
+	{
+		if(*abort_flag || (!libreplace_feed(context, buffer, bytes_read, &sink, logger)))
+		{
+			goto cleanup;
+		}
+		if(++buffer_count >= CHECKPOINT_INTERVAL)
+		{
+			/* the output must be durable, before the checkpoint refers to it */
+			if(!(libreplace_progress(context, &checkpoint->input_offset, &checkpoint->replacement_count) && file_write_byte(LIBREPLACE_FLUSH, (DWORD_PTR)output) && sync_file(output->handle_out)))
+			{
+				goto cleanup;
+			}
+			checkpoint->output_offset = output->written;
+			if(!checkpoint_save(checkpoint))
+			{
+				goto cleanup;
+			}
+			buffer_count = 0U;
+		}
+	}
+
+	success = (!error_flag) && libreplace_finish(context, &sink, logger, replacement_count) && file_write_byte(LIBREPLACE_FLUSH, (DWORD_PTR)output);
+
+cleanup:
+
+	if(buffer)
+	{
+		LocalFree((HLOCAL)buffer);
+	}
+
+	return success;
+}
+
+#endif /*INC_CHECKPOINT_H*/
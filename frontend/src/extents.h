@@ -0,0 +1,384 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#ifndef INC_EXTENTS_H
+#define INC_EXTENTS_H
+
+#include "libreplace/replace.h"
+#include "utils.h"
+#include "patch.h"
+
+#include <winioctl.h> /*FSCTL_xyz*/
+
+/*
+ * Extent-aware processing of files, so that huge sparse files (e.g. disk
+ * images) are not densified, and are not scanned in full:
+ *
+ * - The holes of a sparse input are skipped. Only the bytes next to the edges
+ *   of a hole are scanned, because a match can not lie entirely within zeros,
+ *   as long as the needle contains at least one non-zero literal byte. The
+ *   holes are preserved in the output, which is a sparse file too.
+ *
+ * - If the file system supports block cloning (ReFS), the temporary file of
+ *   the in-place mode is created as a clone of the original file, and only
+ *   the blocks that contain a match are rewritten. This requires that the
+ *   replacement has the same length as the needle.
+ */
+
+#define EXTENTS_CLONE_CHUNK 0x80000000ULL /*multiple of any cluster size*/
+
+#ifndef FSCTL_GET_INTEGRITY_INFORMATION
+#define FSCTL_GET_INTEGRITY_INFORMATION CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 159, METHOD_BUFFERED, FILE_ANY_ACCESS)
+#endif
+#ifndef FSCTL_SET_INTEGRITY_INFORMATION
+#define FSCTL_SET_INTEGRITY_INFORMATION CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 160, METHOD_BUFFERED, FILE_READ_DATA | FILE_WRITE_DATA)
+#endif
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_DATA)
+#endif
+
+/* same layout as the structures in newer SDK versions */
+typedef struct extents_integrity_t
+{
+	WORD checksum_algorithm;
+	WORD reserved;
+	DWORD flags;
+	DWORD checksum_chunk_size;
+	DWORD cluster_size;
+}
+extents_integrity_t;
+
+typedef struct extents_duplicate_t
+{
+	HANDLE source_handle;
+	LARGE_INTEGER source_offset;
+	LARGE_INTEGER target_offset;
+	LARGE_INTEGER byte_count;
+}
+extents_duplicate_t;
+
+typedef BOOL (*extents_gap_t)(const ULONGLONG length, const DWORD_PTR context);
+typedef BOOL (*extents_write_at_t)(const BYTE *const data, const DWORD data_len, const ULONGLONG offset, const DWORD_PTR context);
+
+typedef struct extents_rewriter_t
+{
+	patch_writer_t writer;
+	extents_write_at_t write_func;
+	DWORD_PTR write_context;
+}
+extents_rewriter_t;
+
+/* ======================================================================= */
+/* File System                                                             */
+/* ======================================================================= */
+
+/* the handle may have been opened for overlapped I/O, so each call waits on its own event */
+static BOOL extents_control(const HANDLE handle, const DWORD code, void *const input, const DWORD input_len, void *const output, const DWORD output_len, DWORD *const bytes_returned)
+{
+	OVERLAPPED overlapped;
+	BOOL success;
+	SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	*bytes_returned = 0U;
+	if(!(overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)))
+	{
+		return FALSE;
+	}
+	success = DeviceIoControl(handle, code, input, input_len, output, output_len, bytes_returned, &overlapped) || ((GetLastError() == ERROR_IO_PENDING) && GetOverlappedResult(handle, &overlapped, bytes_returned, TRUE));
+	CloseHandle(overlapped.hEvent);
+	return success;
+}
+
+static BOOL extents_write_at(const BYTE *const data, const DWORD data_len, const ULONGLONG offset, const DWORD_PTR context)
+{
+	const HANDLE handle = (HANDLE) context;
+	OVERLAPPED overlapped;
+	DWORD bytes_written = 0U;
+	BOOL success;
+	SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = (DWORD)(offset & MAXDWORD);
+	overlapped.OffsetHigh = (DWORD)(offset >> 32U);
+	if(!(overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)))
+	{
+		return FALSE;
+	}
+	success = (WriteFile(handle, data, data_len, &bytes_written, &overlapped) || ((GetLastError() == ERROR_IO_PENDING) && GetOverlappedResult(handle, &overlapped, &bytes_written, TRUE))) && (bytes_written == data_len);
+	CloseHandle(overlapped.hEvent);
+	return success;
+}
+
+static BOOL extents_is_sparse(const HANDLE handle)
+{
+	BY_HANDLE_FILE_INFORMATION file_info;
+	SecureZeroMemory(&file_info, sizeof(BY_HANDLE_FILE_INFORMATION));
+	return GetFileInformationByHandle(handle, &file_info) && (file_info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE);
+}
+
+static BOOL extents_set_sparse(const HANDLE handle)
+{
+	DWORD bytes_returned;
+	return extents_control(handle, FSCTL_SET_SPARSE, NULL, 0U, NULL, 0U, &bytes_returned);
+}
+
+/* find the next range of the file, at or after '<offset>', that holds any data; returns an empty range at the end of the file */
+static BOOL extents_next_range(const HANDLE handle, const ULONGLONG offset, const ULONGLONG size, ULONGLONG *const data_start, ULONGLONG *const data_end)
+{
+	FILE_ALLOCATED_RANGE_BUFFER query, range;
+	DWORD bytes_returned;
+	query.FileOffset.QuadPart = (LONGLONG)offset;
+	query.Length.QuadPart = (LONGLONG)(size - offset);
+	if(!(extents_control(handle, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(FILE_ALLOCATED_RANGE_BUFFER), &range, sizeof(FILE_ALLOCATED_RANGE_BUFFER), &bytes_returned) || (GetLastError() == ERROR_MORE_DATA)))
+	{
+		return FALSE;
+	}
+	if(bytes_returned < sizeof(FILE_ALLOCATED_RANGE_BUFFER))
+	{
+		*data_start = *data_end = size; /*only holes left*/
+		return TRUE;
+	}
+	*data_start = (((ULONGLONG)range.FileOffset.QuadPart) > offset) ? min((ULONGLONG)range.FileOffset.QuadPart, size) : offset;
+	*data_end = min((ULONGLONG)(range.FileOffset.QuadPart + range.Length.QuadPart), size);
+	return (*data_end > *data_start);
+}
+
+/* turn the (empty) target file into a clone of the source file, sharing all of its blocks; fails, unless the file system supports block cloning */
+static BOOL extents_clone(const HANDLE source, const HANDLE target, const ULONGLONG size)
+{
+	extents_integrity_t source_integrity, target_integrity;
+	extents_duplicate_t duplicate;
+	LARGE_INTEGER position;
+	ULONGLONG offset, chunk_len;
+	DWORD bytes_returned;
+
+	if(!(extents_control(source, FSCTL_GET_INTEGRITY_INFORMATION, NULL, 0U, &source_integrity, sizeof(extents_integrity_t), &bytes_returned) && (source_integrity.cluster_size > 0U)))
+	{
+		return FALSE; /*not supported by the file system*/
+	}
+
+	/* the integrity streams and the sparse flags have to match */
+	if(!extents_control(target, FSCTL_GET_INTEGRITY_INFORMATION, NULL, 0U, &target_integrity, sizeof(extents_integrity_t), &bytes_returned))
+	{
+		return FALSE;
+	}
+	if((target_integrity.checksum_algorithm != source_integrity.checksum_algorithm) || (target_integrity.flags != source_integrity.flags))
+	{
+		if(!extents_control(target, FSCTL_SET_INTEGRITY_INFORMATION, &source_integrity, 8U, NULL, 0U, &bytes_returned))
+		{
+			return FALSE;
+		}
+	}
+	if(extents_is_sparse(source) && (!extents_set_sparse(target)))
+	{
+		return FALSE;
+	}
+
+	position.QuadPart = (LONGLONG)size;
+	if(!(SetFilePointerEx(target, position, NULL, FILE_BEGIN) && SetEndOfFile(target)))
+	{
+		return FALSE;
+	}
+
+	/* the last range is rounded up to a whole cluster, which is allowed at the end of the file */
+	for(offset = 0U; offset < size; offset += chunk_len)
+	{
+		chunk_len = min(size - offset, EXTENTS_CLONE_CHUNK);
+		duplicate.source_handle = source;
+		duplicate.source_offset.QuadPart = duplicate.target_offset.QuadPart = (LONGLONG)offset;
+		duplicate.byte_count.QuadPart = (LONGLONG)(((chunk_len + source_integrity.cluster_size - 1U) / source_integrity.cluster_size) * source_integrity.cluster_size);
+		if(!extents_control(target, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &duplicate, sizeof(extents_duplicate_t), NULL, 0U, &bytes_returned))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* undo a failed clone, so that the target can be written from scratch */
+static BOOL extents_clone_revert(const HANDLE target)
+{
+	LARGE_INTEGER position;
+	position.QuadPart = 0LL;
+	return SetFilePointerEx(target, position, NULL, FILE_BEGIN) && SetEndOfFile(target);
+}
+
+/* ======================================================================= */
+/* Processing                                                              */
+/* ======================================================================= */
+
+/* the hole edges need to be scanned, unless the needle contains a non-zero literal byte */
+static BOOL extents_can_skip_holes(const WORD *const needle, const DWORD needle_len)
+{
+	DWORD pos;
+	for(pos = 0U; pos < needle_len; ++pos)
+	{
+		if((needle[pos] != LIBREPLACE_WILDCARD) && ((BYTE)needle[pos]))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static BOOL extents_feed_zeros(libreplace_context_t *const context, ULONGLONG length, const BYTE *const zeros, const DWORD zeros_len, const libreplace_sink_t *const sink, const libreplace_logger_t *const logger)
+{
+	DWORD chunk_len;
+	for(; length > 0U; length -= chunk_len)
+	{
+		chunk_len = (DWORD) min(length, zeros_len);
+		if(!libreplace_feed(context, zeros, chunk_len, sink, logger))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* a match may overlap the first or the last '<edge_len>' bytes of the hole, but nothing in between; that part is passed to '<gap_func>', instead of being scanned */
+static BOOL extents_feed_hole(libreplace_context_t *const context, const ULONGLONG offset, const ULONGLONG length, const DWORD edge_len, const BYTE *const zeros, const DWORD zeros_len, const libreplace_sink_t *const sink, const extents_gap_t gap_func, const DWORD_PTR gap_context, const libreplace_logger_t *const logger)
+{
+	const ULONGLONG resume_offset = offset + length - edge_len;
+	ULONGLONG input_offset;
+	DWORD replacement_count;
+
+	if(length <= 2U * ((ULONGLONG)edge_len))
+	{
+		return extents_feed_zeros(context, length, zeros, zeros_len, sink, logger);
+	}
+
+	/* the pending partial match (if any) lies within the hole, so it can not become a match */
+	if(!(extents_feed_zeros(context, edge_len, zeros, zeros_len, sink, logger) && libreplace_progress(context, &input_offset, &replacement_count)))
+	{
+		return FALSE;
+	}
+
+	if((gap_func && (!gap_func(resume_offset - input_offset, gap_context))) || (!libreplace_resume(context, resume_offset, replacement_count)))
+	{
+		return FALSE;
+	}
+
+	return extents_feed_zeros(context, edge_len, zeros, zeros_len, sink, logger);
+}
+
+static BOOL extents_output_gap(const ULONGLONG length, const DWORD_PTR context)
+{
+	return file_output_skip((file_output_t*) context, length);
+}
+
+static BOOL extents_discard(const BYTE *const data, const DWORD data_len, const DWORD_PTR context)
+{
+	UNUSED_PARAM(data);
+	UNUSED_PARAM(data_len);
+	UNUSED_PARAM(context);
+	return TRUE;
+}
+
+/* the matches are rewritten by '<write_func>', which is extents_write_at() for the cloned file */
+static BOOL extents_rewriter_init(extents_rewriter_t *const ctx, const extents_write_at_t write_func, const DWORD_PTR write_context, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len)
+{
+	ctx->write_func = write_func;
+	ctx->write_context = write_context;
+	return patch_writer_setup(&ctx->writer, needle, needle_len, replacement, replacement_len);
+}
+
+/* match callback: the replacement has the same length as the match, so it is written at the same offset of the clone */
+static BOOL extents_rewriter_match(const BYTE *const match, const DWORD match_len, const ULONGLONG offset, const DWORD ordinal, const libreplace_sink_t *const output, const DWORD_PTR context)
+{
+	extents_rewriter_t *const ctx = (extents_rewriter_t*) context;
+	UNUSED_PARAM(match_len);
+	UNUSED_PARAM(ordinal);
+	UNUSED_PARAM(output);
+	patch_writer_expand(&ctx->writer, match);
+	return (ctx->writer.replacement_len < 1U) || ctx->write_func(ctx->writer.buffer, ctx->writer.replacement_len, offset, ctx->write_context);
+}
+
+/* streams the data ranges of the input through the library; without an '<output>', only the matches are rewritten (by the callback) */
+static BOOL extents_process(libreplace_context_t *const context, file_input_t *const input, file_output_t *const output, const BOOL skip_holes, const DWORD edge_len, const libreplace_logger_t *const logger, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	BOOL success = FALSE, error_flag = FALSE;
+	ULONGLONG offset = 0U, data_start, data_end;
+	LARGE_INTEGER file_size;
+	DWORD bytes_read;
+	libreplace_sink_t sink;
+	BYTE *buffer = NULL, *zeros = NULL;
+
+	sink.func_write = output ? file_write_bulk : extents_discard;
+	sink.context = (DWORD_PTR)output;
+
+	if(!(GetFileSizeEx(input->handle_in, &file_size) && (buffer = (BYTE*) LocalAlloc(LPTR, input->buffer_size)) && (zeros = (BYTE*) LocalAlloc(LPTR, input->buffer_size))))
+	{
+		goto cleanup;
+	}
+
+	while(offset < (ULONGLONG)file_size.QuadPart)
+	{
+		if(skip_holes)
+		{
+			if(!extents_next_range(input->handle_in, offset, (ULONGLONG)file_size.QuadPart, &data_start, &data_end))
+			{
+				goto cleanup;
+			}
+		}
+		else
+		{
+			data_start = offset;
+			data_end = (ULONGLONG)file_size.QuadPart;
+		}
+		if(data_start > offset)
+		{
+			if(*abort_flag || (!(extents_feed_hole(context, offset, data_start - offset, edge_len, zeros, input->buffer_size, &sink, output ? extents_output_gap : NULL, (DWORD_PTR)output, logger) && file_input_seek(input, data_start))))
+			{
+				goto cleanup;
+			}
+		}
+		for(offset = data_start; offset < data_end; offset += bytes_read)
+		{
+			if(!file_read_bulk(buffer, (DWORD) min(data_end - offset, input->buffer_size), &bytes_read, (DWORD_PTR)input, &error_flag))
+			{
+				goto cleanup; /*the file has been truncated*/
+			}
+			if(*abort_flag || (!libreplace_feed(context, buffer, bytes_read, &sink, logger)))
+			{
+				goto cleanup;
+			}
+		}
+	}
+
+	if(!libreplace_finish(context, &sink, logger, replacement_count))
+	{
+		goto cleanup;
+	}
+
+	/* a trailing hole is not written, so the output has to be extended */
+	if(output)
+	{
+		if(!file_write_byte(LIBREPLACE_FLUSH, (DWORD_PTR)output))
+		{
+			goto cleanup;
+		}
+		file_size.QuadPart = (LONGLONG)output->written;
+		if(!(SetFilePointerEx(output->handle_out, file_size, NULL, FILE_BEGIN) && SetEndOfFile(output->handle_out)))
+		{
+			goto cleanup;
+		}
+	}
+
+	success = TRUE;
+
+cleanup:
+
+	if(buffer)
+	{
+		LocalFree((HLOCAL)buffer);
+	}
+
+	if(zeros)
+	{
+		LocalFree((HLOCAL)zeros);
+	}
+
+	return success;
+}
+
+#endif /*INC_EXTENTS_H*/
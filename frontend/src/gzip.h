@@ -0,0 +1,1001 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#ifndef INC_GZIP_H
+#define INC_GZIP_H
+
+#include "libreplace/replace.h"
+#include "utils.h"
+
+/*
+ * Streaming gzip (RFC 1952) codec for transparent compression. The decoder
+ * supports all deflate (RFC 1951) block types as well as multi-member files.
+ * The encoder uses greedy LZ77 matching on hash chains and the fixed Huffman
+ * codes, which is fast and keeps the state small. Both sides read and write
+ * through the bulk I/O functions of a libreplace_io_t, so that each of them
+ * can run on a thread of its own, connected to the main thread by a pipe.
+ */
+
+#define COMPRESSION_NONE 0U
+#define COMPRESSION_GZIP 1U
+#define COMPRESSION_ZSTD 2U
+#define COMPRESSION_XZ   3U
+
+#define GZIP_MAGIC_LEN 6U /*enough to tell the formats apart*/
+
+#define GZIP_WSIZE 32768U
+#define GZIP_WMASK (GZIP_WSIZE - 1U)
+#define GZIP_MIN_MATCH 3U
+#define GZIP_MAX_MATCH 258U
+#define GZIP_MIN_LOOKAHEAD (GZIP_MAX_MATCH + GZIP_MIN_MATCH + 1U)
+#define GZIP_TOO_FAR 4096U /*minimum-length matches at a larger distance do not pay off*/
+#define GZIP_MAX_INSERT 16U /*longer matches are not added to the hash chains*/
+#define GZIP_MAX_CHAIN 32U
+#define GZIP_HASH_BITS 15U
+#define GZIP_HASH_SIZE (1U << GZIP_HASH_BITS)
+#define GZIP_MAX_BITS 15U
+#define GZIP_FAST_BITS 10U
+#define GZIP_FAST_SIZE (1U << GZIP_FAST_BITS)
+#define GZIP_IO_SIZE 0x10000U
+
+#define GZIP_FLAG_FHCRC    0x02U
+#define GZIP_FLAG_FEXTRA   0x04U
+#define GZIP_FLAG_FNAME    0x08U
+#define GZIP_FLAG_FCOMMENT 0x10U
+#define GZIP_FLAG_RESERVED 0xE0U
+
+static const WORD GZIP_LENGTH_BASE[29U] = { 3U, 4U, 5U, 6U, 7U, 8U, 9U, 10U, 11U, 13U, 15U, 17U, 19U, 23U, 27U, 31U, 35U, 43U, 51U, 59U, 67U, 83U, 99U, 115U, 131U, 163U, 195U, 227U, 258U };
+static const BYTE GZIP_LENGTH_EXTRA[29U] = { 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 1U, 1U, 1U, 1U, 2U, 2U, 2U, 2U, 3U, 3U, 3U, 3U, 4U, 4U, 4U, 4U, 5U, 5U, 5U, 5U, 0U };
+static const WORD GZIP_DIST_BASE[30U] = { 1U, 2U, 3U, 4U, 5U, 7U, 9U, 13U, 17U, 25U, 33U, 49U, 65U, 97U, 129U, 193U, 257U, 385U, 513U, 769U, 1025U, 1537U, 2049U, 3073U, 4097U, 6145U, 8193U, 12289U, 16385U, 24577U };
+static const BYTE GZIP_DIST_EXTRA[30U] = { 0U, 0U, 0U, 0U, 1U, 1U, 2U, 2U, 3U, 3U, 4U, 4U, 5U, 5U, 6U, 6U, 7U, 7U, 8U, 8U, 9U, 9U, 10U, 10U, 11U, 11U, 12U, 12U, 13U, 13U };
+static const BYTE GZIP_CLEN_ORDER[19U] = { 16U, 17U, 18U, 0U, 8U, 7U, 9U, 6U, 10U, 5U, 11U, 4U, 12U, 3U, 13U, 2U, 14U, 1U, 15U };
+
+/* ======================================================================= */
+/* Common                                                                  */
+/* ======================================================================= */
+
+static DWORD detect_compression(const BYTE *const data, const DWORD data_len)
+{
+	if((data_len >= 2U) && (data[0U] == 0x1FU) && (data[1U] == 0x8BU))
+	{
+		return COMPRESSION_GZIP;
+	}
+	if((data_len >= 4U) && (data[0U] == 0x28U) && (data[1U] == 0xB5U) && (data[2U] == 0x2FU) && (data[3U] == 0xFDU))
+	{
+		return COMPRESSION_ZSTD;
+	}
+	if((data_len >= 6U) && (data[0U] == 0xFDU) && (data[1U] == 0x37U) && (data[2U] == 0x7AU) && (data[3U] == 0x58U) && (data[4U] == 0x5AU) && (data[5U] == 0x00U))
+	{
+		return COMPRESSION_XZ;
+	}
+	return COMPRESSION_NONE;
+}
+
+static void gzip_crc32_init(DWORD *const table)
+{
+	DWORD value, index, bit;
+	for(index = 0U; index < 256U; ++index)
+	{
+		for(value = index, bit = 0U; bit < 8U; ++bit)
+		{
+			value = (value & 1U) ? (0xEDB88320U ^ (value >> 1)) : (value >> 1);
+		}
+		table[index] = value;
+	}
+}
+
+static DWORD gzip_crc32_update(const DWORD *const table, DWORD crc, const BYTE *const data, const DWORD data_len)
+{
+	DWORD pos;
+	crc = ~crc;
+	for(pos = 0U; pos < data_len; ++pos)
+	{
+		crc = table[(crc ^ data[pos]) & 0xFFU] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static __inline DWORD gzip_reverse_bits(DWORD code, const DWORD length)
+{
+	DWORD result = 0U, bit;
+	for(bit = 0U; bit < length; ++bit, code >>= 1)
+	{
+		result = (result << 1) | (code & 1U);
+	}
+	return result;
+}
+
+/* ======================================================================= */
+/* Decoder                                                                 */
+/* ======================================================================= */
+
+typedef struct gzip_huffman_t
+{
+	WORD count[GZIP_MAX_BITS + 1U];
+	WORD symbol[288U];
+	WORD fast[GZIP_FAST_SIZE]; /*(length << 9) | symbol, indexed by the next GZIP_FAST_BITS input bits*/
+}
+gzip_huffman_t;
+
+typedef struct gzip_inflate_t
+{
+	const libreplace_io_t *io_functions;
+	BYTE input[GZIP_IO_SIZE];
+	DWORD input_pos, input_len;
+	BOOL input_eof, read_error;
+	DWORD bit_buf, bit_count;
+	BYTE window[2U * GZIP_WSIZE]; /*each half is written out as soon as it is complete*/
+	DWORD window_pos;
+	ULONGLONG flushed;
+	DWORD crc, crc_table[256U];
+	gzip_huffman_t lencode, distcode, fixed_lencode, fixed_distcode;
+}
+gzip_inflate_t;
+
+static BOOL gzip_inflate_fill(gzip_inflate_t *const ctx)
+{
+	ctx->input_pos = ctx->input_len = 0U;
+	if(ctx->input_eof || (!ctx->io_functions->func_rd_bulk(ctx->input, GZIP_IO_SIZE, &ctx->input_len, ctx->io_functions->context_rd, &ctx->read_error)))
+	{
+		ctx->input_eof = TRUE;
+		return FALSE;
+	}
+	return (ctx->input_len > 0U);
+}
+
+/* buffer as many bits as possible, up to 24; fails only if not a single bit could be added */
+static __inline BOOL gzip_inflate_peek(gzip_inflate_t *const ctx, const DWORD min_bits)
+{
+	while(ctx->bit_count <= 16U)
+	{
+		if((ctx->input_pos >= ctx->input_len) && (!gzip_inflate_fill(ctx)))
+		{
+			break;
+		}
+		ctx->bit_buf |= ((DWORD)ctx->input[ctx->input_pos++]) << ctx->bit_count;
+		ctx->bit_count += 8U;
+	}
+	return (ctx->bit_count >= min_bits);
+}
+
+static __inline BOOL gzip_inflate_bits(gzip_inflate_t *const ctx, const DWORD count, DWORD *const value)
+{
+	if((ctx->bit_count < count) && (!gzip_inflate_peek(ctx, count)))
+	{
+		return FALSE;
+	}
+	*value = ctx->bit_buf & ((1U << count) - 1U);
+	ctx->bit_buf >>= count;
+	ctx->bit_count -= count;
+	return TRUE;
+}
+
+/* byte-aligned access, any whole bytes left in the bit buffer come first */
+static BOOL gzip_inflate_byte(gzip_inflate_t *const ctx, BYTE *const value)
+{
+	DWORD bits;
+	ctx->bit_buf >>= (ctx->bit_count & 7U);
+	ctx->bit_count &= ~7U;
+	if(!gzip_inflate_bits(ctx, 8U, &bits))
+	{
+		return FALSE;
+	}
+	*value = (BYTE)bits;
+	return TRUE;
+}
+
+static BOOL gzip_inflate_dword(gzip_inflate_t *const ctx, DWORD *const value)
+{
+	DWORD pos;
+	BYTE byte_value;
+	for(*value = pos = 0U; pos < 4U; ++pos)
+	{
+		if(!gzip_inflate_byte(ctx, &byte_value))
+		{
+			return FALSE;
+		}
+		*value |= ((DWORD)byte_value) << (8U * pos);
+	}
+	return TRUE;
+}
+
+static BOOL gzip_inflate_flush(gzip_inflate_t *const ctx, const DWORD offset, const DWORD length)
+{
+	if(length > 0U)
+	{
+		ctx->crc = gzip_crc32_update(ctx->crc_table, ctx->crc, ctx->window + offset, length);
+		ctx->flushed += length;
+		return ctx->io_functions->func_wr_bulk(ctx->window + offset, length, ctx->io_functions->context_wr);
+	}
+	return TRUE;
+}
+
+static __inline BOOL gzip_inflate_put(gzip_inflate_t *const ctx, const BYTE value)
+{
+	ctx->window[ctx->window_pos] = value;
+	ctx->window_pos = (ctx->window_pos + 1U) & ((2U * GZIP_WSIZE) - 1U);
+	if(!(ctx->window_pos & GZIP_WMASK))
+	{
+		return gzip_inflate_flush(ctx, ctx->window_pos ^ GZIP_WSIZE, GZIP_WSIZE);
+	}
+	return TRUE;
+}
+
+static BOOL gzip_huffman_build(gzip_huffman_t *const huffman, const BYTE *const lengths, const DWORD count)
+{
+	WORD offset[GZIP_MAX_BITS + 1U], next_code[GZIP_MAX_BITS + 1U];
+	DWORD symbol, length, code, index;
+	LONG left = 1L;
+
+	SecureZeroMemory(huffman, sizeof(gzip_huffman_t));
+	for(symbol = 0U; symbol < count; ++symbol)
+	{
+		huffman->count[lengths[symbol]]++;
+	}
+	huffman->count[0U] = 0U;
+
+	/* over-subscribed codes are invalid, incomplete codes fail on decoding */
+	for(length = 1U; length <= GZIP_MAX_BITS; ++length)
+	{
+		left = (left << 1) - huffman->count[length];
+		if(left < 0L)
+		{
+			return FALSE;
+		}
+	}
+
+	offset[1U] = next_code[1U] = 0U;
+	for(length = 1U; length < GZIP_MAX_BITS; ++length)
+	{
+		offset[length + 1U] = offset[length] + huffman->count[length];
+		next_code[length + 1U] = (next_code[length] + huffman->count[length]) << 1;
+	}
+
+	for(symbol = 0U; symbol < count; ++symbol)
+	{
+		if((length = lengths[symbol]) > 0U)
+		{
+			huffman->symbol[offset[length]++] = (WORD)symbol;
+			code = next_code[length]++;
+			if(length <= GZIP_FAST_BITS)
+			{
+				for(index = gzip_reverse_bits(code, length); index < GZIP_FAST_SIZE; index += (1U << length))
+				{
+					huffman->fast[index] = (WORD)((length << 9) | symbol);
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static __inline BOOL gzip_huffman_decode(gzip_inflate_t *const ctx, const gzip_huffman_t *const huffman, DWORD *const symbol)
+{
+	DWORD entry, length, code = 0U, first = 0U, index = 0U;
+	gzip_inflate_peek(ctx, GZIP_MAX_BITS);
+	entry = huffman->fast[ctx->bit_buf & (GZIP_FAST_SIZE - 1U)];
+	if(entry && ((entry >> 9) <= ctx->bit_count))
+	{
+		*symbol = entry & 0x1FFU;
+		ctx->bit_buf >>= (entry >> 9);
+		ctx->bit_count -= (entry >> 9);
+		return TRUE;
+	}
+
+	/* canonical decoding, one bit at a time, for the longer codes */
+	for(length = 1U; (length <= GZIP_MAX_BITS) && (length <= ctx->bit_count); ++length)
+	{
+		code |= (ctx->bit_buf >> (length - 1U)) & 1U;
+		if(code - first < huffman->count[length])
+		{
+			*symbol = huffman->symbol[index + (code - first)];
+			ctx->bit_buf >>= length;
+			ctx->bit_count -= length;
+			return TRUE;
+		}
+		index += huffman->count[length];
+		first = (first + huffman->count[length]) << 1;
+		code <<= 1;
+	}
+
+	return FALSE; /*invalid or truncated*/
+}
+
+static BOOL gzip_inflate_stored(gzip_inflate_t *const ctx)
+{
+	DWORD length, pos;
+	BYTE header[4U], value;
+	for(pos = 0U; pos < 4U; ++pos)
+	{
+		if(!gzip_inflate_byte(ctx, &header[pos]))
+		{
+			return FALSE;
+		}
+	}
+	length = header[0U] | (((DWORD)header[1U]) << 8);
+	if((length ^ 0xFFFFU) != (header[2U] | (((DWORD)header[3U]) << 8)))
+	{
+		return FALSE;
+	}
+	for(pos = 0U; pos < length; ++pos)
+	{
+		if(!(gzip_inflate_byte(ctx, &value) && gzip_inflate_put(ctx, value)))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL gzip_inflate_codes(gzip_inflate_t *const ctx, const gzip_huffman_t *const lencode, const gzip_huffman_t *const distcode)
+{
+	DWORD symbol, length, distance, extra;
+	for(;;)
+	{
+		if(!gzip_huffman_decode(ctx, lencode, &symbol))
+		{
+			return FALSE;
+		}
+		if(symbol < 256U)
+		{
+			if(!gzip_inflate_put(ctx, (BYTE)symbol))
+			{
+				return FALSE;
+			}
+			continue;
+		}
+		if(symbol == 256U)
+		{
+			return TRUE; /*end of block*/
+		}
+		if((symbol -= 257U) >= 29U)
+		{
+			return FALSE;
+		}
+		if(!gzip_inflate_bits(ctx, GZIP_LENGTH_EXTRA[symbol], &extra))
+		{
+			return FALSE;
+		}
+		length = GZIP_LENGTH_BASE[symbol] + extra;
+		if(!(gzip_huffman_decode(ctx, distcode, &symbol) && (symbol < 30U) && gzip_inflate_bits(ctx, GZIP_DIST_EXTRA[symbol], &extra)))
+		{
+			return FALSE;
+		}
+		distance = GZIP_DIST_BASE[symbol] + extra;
+		if((ctx->flushed < GZIP_WSIZE) && (distance > ctx->flushed + (ctx->window_pos & GZIP_WMASK)))
+		{
+			return FALSE; /*too far back*/
+		}
+		while(length-- > 0U)
+		{
+			if(!gzip_inflate_put(ctx, ctx->window[(ctx->window_pos - distance) & ((2U * GZIP_WSIZE) - 1U)]))
+			{
+				return FALSE;
+			}
+		}
+	}
+}
+
+static BOOL gzip_inflate_dynamic(gzip_inflate_t *const ctx)
+{
+	BYTE lengths[320U];
+	DWORD nlen, ndist, ncode, index, symbol, repeat, value;
+	BYTE previous;
+
+	if(!(gzip_inflate_bits(ctx, 5U, &nlen) && gzip_inflate_bits(ctx, 5U, &ndist) && gzip_inflate_bits(ctx, 4U, &ncode)))
+	{
+		return FALSE;
+	}
+	if(((nlen += 257U) > 286U) || ((ndist += 1U) > 30U))
+	{
+		return FALSE;
+	}
+
+	/* code length code */
+	SecureZeroMemory(lengths, sizeof(lengths));
+	for(index = 0U; index < ncode + 4U; ++index)
+	{
+		if(!gzip_inflate_bits(ctx, 3U, &value))
+		{
+			return FALSE;
+		}
+		lengths[GZIP_CLEN_ORDER[index]] = (BYTE)value;
+	}
+	if(!gzip_huffman_build(&ctx->lencode, lengths, 19U))
+	{
+		return FALSE;
+	}
+
+	/* literal/length and distance code lengths, which may run from one into the other */
+	for(index = 0U; index < nlen + ndist;)
+	{
+		if(!gzip_huffman_decode(ctx, &ctx->lencode, &symbol))
+		{
+			return FALSE;
+		}
+		if(symbol < 16U)
+		{
+			lengths[index++] = (BYTE)symbol;
+			continue;
+		}
+		previous = 0U;
+		if(symbol == 16U)
+		{
+			if(index < 1U)
+			{
+				return FALSE;
+			}
+			previous = lengths[index - 1U];
+			if(!gzip_inflate_bits(ctx, 2U, &repeat))
+			{
+				return FALSE;
+			}
+			repeat += 3U;
+		}
+		else if(symbol == 17U)
+		{
+			if(!gzip_inflate_bits(ctx, 3U, &repeat))
+			{
+				return FALSE;
+			}
+			repeat += 3U;
+		}
+		else
+		{
+			if(!gzip_inflate_bits(ctx, 7U, &repeat))
+			{
+				return FALSE;
+			}
+			repeat += 11U;
+		}
+		if(index + repeat > nlen + ndist)
+		{
+			return FALSE;
+		}
+		while(repeat-- > 0U)
+		{
+			lengths[index++] = previous;
+		}
+	}
+
+	if(lengths[256U] == 0U)
+	{
+		return FALSE; /*no end-of-block code*/
+	}
+
+	return gzip_huffman_build(&ctx->lencode, lengths, nlen) && gzip_huffman_build(&ctx->distcode, lengths + nlen, ndist) && gzip_inflate_codes(ctx, &ctx->lencode, &ctx->distcode);
+}
+
+static BOOL gzip_inflate_header(gzip_inflate_t *const ctx)
+{
+	BYTE header[10U], value;
+	DWORD pos, extra_len;
+	for(pos = 0U; pos < 10U; ++pos)
+	{
+		if(!gzip_inflate_byte(ctx, &header[pos]))
+		{
+			return FALSE;
+		}
+	}
+	if((header[0U] != 0x1FU) || (header[1U] != 0x8BU) || (header[2U] != 8U) || (header[3U] & GZIP_FLAG_RESERVED))
+	{
+		return FALSE;
+	}
+	if(header[3U] & GZIP_FLAG_FEXTRA)
+	{
+		if(!(gzip_inflate_byte(ctx, &value) && gzip_inflate_byte(ctx, &header[0U])))
+		{
+			return FALSE;
+		}
+		for(extra_len = value | (((DWORD)header[0U]) << 8); extra_len > 0U; --extra_len)
+		{
+			if(!gzip_inflate_byte(ctx, &value))
+			{
+				return FALSE;
+			}
+		}
+	}
+	for(pos = 0U; pos < 2U; ++pos)
+	{
+		if(header[3U] & (pos ? GZIP_FLAG_FCOMMENT : GZIP_FLAG_FNAME))
+		{
+			do
+			{
+				if(!gzip_inflate_byte(ctx, &value))
+				{
+					return FALSE;
+				}
+			}
+			while(value);
+		}
+	}
+	if(header[3U] & GZIP_FLAG_FHCRC)
+	{
+		return gzip_inflate_byte(ctx, &value) && gzip_inflate_byte(ctx, &value);
+	}
+	return TRUE;
+}
+
+static BOOL gzip_inflate_member(gzip_inflate_t *const ctx, volatile BOOL *const abort_flag)
+{
+	DWORD last = 0U, type, crc, size;
+
+	ctx->window_pos = 0U;
+	ctx->flushed = 0U;
+	ctx->crc = 0U;
+
+	if(!gzip_inflate_header(ctx))
+	{
+		return FALSE;
+	}
+
+	while(!last)
+	{
+		if(*abort_flag || (!(gzip_inflate_bits(ctx, 1U, &last) && gzip_inflate_bits(ctx, 2U, &type))))
+		{
+			return FALSE;
+		}
+		switch(type)
+		{
+		case 0U:
+			if(!gzip_inflate_stored(ctx))
+			{
+				return FALSE;
+			}
+			break;
+		case 1U:
+			if(!gzip_inflate_codes(ctx, &ctx->fixed_lencode, &ctx->fixed_distcode))
+			{
+				return FALSE;
+			}
+			break;
+		case 2U:
+			if(!gzip_inflate_dynamic(ctx))
+			{
+				return FALSE;
+			}
+			break;
+		default:
+			return FALSE;
+		}
+	}
+
+	if(!gzip_inflate_flush(ctx, ctx->window_pos & GZIP_WSIZE, ctx->window_pos & GZIP_WMASK))
+	{
+		return FALSE;
+	}
+
+	return gzip_inflate_dword(ctx, &crc) && gzip_inflate_dword(ctx, &size) && (crc == ctx->crc) && (size == (DWORD)(ctx->flushed & MAXDWORD));
+}
+
+static BOOL gzip_inflate(const libreplace_io_t *const io_functions, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	BYTE lengths[320U];
+	DWORD index;
+	BOOL success = FALSE;
+
+	gzip_inflate_t *const ctx = (gzip_inflate_t*) LocalAlloc(LPTR, sizeof(gzip_inflate_t));
+	if(!ctx)
+	{
+		*error_message = "Failed to allocate the gzip decoder!";
+		return FALSE;
+	}
+
+	ctx->io_functions = io_functions;
+	gzip_crc32_init(ctx->crc_table);
+
+	for(index = 0U; index < 288U; ++index)
+	{
+		lengths[index] = (index < 144U) ? 8U : ((index < 256U) ? 9U : ((index < 280U) ? 7U : 8U));
+	}
+	for(index = 0U; index < 30U; ++index)
+	{
+		lengths[288U + index] = 5U;
+	}
+	gzip_huffman_build(&ctx->fixed_lencode, lengths, 288U);
+	gzip_huffman_build(&ctx->fixed_distcode, lengths + 288U, 30U);
+
+	/* concatenated members are decompressed one after another */
+	do
+	{
+		if(!gzip_inflate_member(ctx, abort_flag))
+		{
+			*error_message = ctx->read_error ? "Failed to read the compressed input!" : "The compressed input is corrupt or truncated!";
+			goto cleanup;
+		}
+		ctx->bit_buf >>= (ctx->bit_count & 7U);
+		ctx->bit_count &= ~7U;
+		if(!gzip_inflate_peek(ctx, 8U))
+		{
+			break;
+		}
+		if((ctx->bit_buf & 0xFFU) != 0x1FU)
+		{
+			*error_message = "Unexpected data after the end of the compressed input!";
+			goto cleanup;
+		}
+	}
+	while(!*abort_flag);
+
+	if(ctx->read_error)
+	{
+		*error_message = "Failed to read the compressed input!";
+		goto cleanup;
+	}
+
+	success = ctx->io_functions->func_wr(LIBREPLACE_FLUSH, ctx->io_functions->context_wr);
+	if(!success)
+	{
+		*error_message = "Failed to write the decompressed data!";
+	}
+
+cleanup:
+
+	LocalFree((HLOCAL)ctx);
+	return success;
+}
+
+/* ======================================================================= */
+/* Encoder                                                                 */
+/* ======================================================================= */
+
+typedef struct gzip_deflate_t
+{
+	const libreplace_io_t *io_functions;
+	BYTE window[2U * GZIP_WSIZE];
+	const BYTE *upper; /*window + GZIP_WSIZE, stored so that the compiler can not turn the slide into a memcpy() call*/
+	DWORD head[GZIP_HASH_SIZE]; /*absolute position + 1 of the latest occurrence, zero if none*/
+	DWORD prev[GZIP_WSIZE];
+	DWORD base; /*absolute position of window[0]*/
+	DWORD strstart, lookahead;
+	BOOL input_eof, read_error;
+	BYTE output[GZIP_IO_SIZE];
+	DWORD output_pos;
+	DWORD bit_buf, bit_count;
+	DWORD crc, size, crc_table[256U];
+	WORD lit_code[288U];
+	BYTE lit_bits[288U];
+	BYTE length_symbol[GZIP_MAX_MATCH + 1U];
+	BYTE dist_symbol[512U];
+	BYTE dist_code[30U];
+}
+gzip_deflate_t;
+
+static BOOL gzip_deflate_write(gzip_deflate_t *const ctx)
+{
+	const DWORD length = ctx->output_pos;
+	ctx->output_pos = 0U;
+	return (length > 0U) ? ctx->io_functions->func_wr_bulk(ctx->output, length, ctx->io_functions->context_wr) : TRUE;
+}
+
+static __inline BOOL gzip_deflate_bits(gzip_deflate_t *const ctx, const DWORD value, const DWORD count)
+{
+	ctx->bit_buf |= value << ctx->bit_count;
+	ctx->bit_count += count;
+	while(ctx->bit_count >= 8U)
+	{
+		ctx->output[ctx->output_pos++] = (BYTE)(ctx->bit_buf & 0xFFU);
+		ctx->bit_buf >>= 8;
+		ctx->bit_count -= 8U;
+		if((ctx->output_pos >= GZIP_IO_SIZE) && (!gzip_deflate_write(ctx)))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL gzip_deflate_bytes(gzip_deflate_t *const ctx, const BYTE *const data, const DWORD data_len)
+{
+	DWORD pos;
+	for(pos = 0U; pos < data_len; ++pos)
+	{
+		if(!gzip_deflate_bits(ctx, data[pos], 8U))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void gzip_deflate_init(gzip_deflate_t *const ctx)
+{
+	DWORD symbol, length, distance, bits;
+	gzip_crc32_init(ctx->crc_table);
+
+	/* fixed literal/length code, bit-reversed for output */
+	for(symbol = 0U; symbol < 288U; ++symbol)
+	{
+		if(symbol < 144U)
+		{
+			ctx->lit_code[symbol] = (WORD)gzip_reverse_bits(0x30U + symbol, bits = 8U);
+		}
+		else if(symbol < 256U)
+		{
+			ctx->lit_code[symbol] = (WORD)gzip_reverse_bits(0x190U + (symbol - 144U), bits = 9U);
+		}
+		else if(symbol < 280U)
+		{
+			ctx->lit_code[symbol] = (WORD)gzip_reverse_bits(symbol - 256U, bits = 7U);
+		}
+		else
+		{
+			ctx->lit_code[symbol] = (WORD)gzip_reverse_bits(0xC0U + (symbol - 280U), bits = 8U);
+		}
+		ctx->lit_bits[symbol] = (BYTE)bits;
+	}
+
+	for(symbol = 0U; symbol < 29U; ++symbol)
+	{
+		for(length = GZIP_LENGTH_BASE[symbol]; (length < GZIP_LENGTH_BASE[symbol] + (1U << GZIP_LENGTH_EXTRA[symbol])) && (length <= GZIP_MAX_MATCH); ++length)
+		{
+			ctx->length_symbol[length] = (BYTE)symbol;
+		}
+	}
+	ctx->length_symbol[GZIP_MAX_MATCH] = 28U;
+
+	/* distances up to 256 are looked up directly, larger ones in steps of 128 */
+	for(symbol = 0U; symbol < 30U; ++symbol)
+	{
+		ctx->dist_code[symbol] = (BYTE)gzip_reverse_bits(symbol, 5U);
+		for(distance = GZIP_DIST_BASE[symbol]; distance < GZIP_DIST_BASE[symbol] + (1U << GZIP_DIST_EXTRA[symbol]); ++distance)
+		{
+			ctx->dist_symbol[(distance <= 256U) ? (distance - 1U) : (256U + ((distance - 1U) >> 7))] = (BYTE)symbol;
+		}
+	}
+}
+
+/* slide the window once the lookahead gets close to its end, then top up the lookahead */
+static BOOL gzip_deflate_fill(gzip_deflate_t *const ctx)
+{
+	DWORD bytes_read;
+	if(ctx->strstart >= (2U * GZIP_WSIZE) - GZIP_MIN_LOOKAHEAD)
+	{
+		copy_bytes(ctx->window, ctx->upper, GZIP_WSIZE);
+		ctx->strstart -= GZIP_WSIZE;
+		ctx->base += GZIP_WSIZE;
+	}
+	while((!ctx->input_eof) && (ctx->lookahead < GZIP_MIN_LOOKAHEAD))
+	{
+		const DWORD offset = ctx->strstart + ctx->lookahead;
+		if(!(ctx->io_functions->func_rd_bulk(ctx->window + offset, (2U * GZIP_WSIZE) - offset, &bytes_read, ctx->io_functions->context_rd, &ctx->read_error) && (bytes_read > 0U)))
+		{
+			ctx->input_eof = TRUE;
+			break;
+		}
+		ctx->crc = gzip_crc32_update(ctx->crc_table, ctx->crc, ctx->window + offset, bytes_read);
+		ctx->size += bytes_read;
+		ctx->lookahead += bytes_read;
+	}
+	return (!ctx->read_error);
+}
+
+static __inline DWORD gzip_deflate_hash(const BYTE *const data)
+{
+	return ((data[0U] | (((DWORD)data[1U]) << 8) | (((DWORD)data[2U]) << 16)) * 2654435761U) >> (32U - GZIP_HASH_BITS);
+}
+
+static __inline void gzip_deflate_insert(gzip_deflate_t *const ctx, const DWORD position, DWORD *const candidate)
+{
+	const DWORD hash = gzip_deflate_hash(ctx->window + position), absolute = ctx->base + position;
+	*candidate = ctx->head[hash];
+	ctx->prev[absolute & GZIP_WMASK] = *candidate;
+	ctx->head[hash] = absolute + 1U;
+}
+
+static DWORD gzip_deflate_match(const gzip_deflate_t *const ctx, DWORD candidate, DWORD *const best_distance)
+{
+	const BYTE *const scan = ctx->window + ctx->strstart;
+	const BYTE *match;
+	const DWORD absolute = ctx->base + ctx->strstart, limit = (ctx->lookahead < GZIP_MAX_MATCH) ? ctx->lookahead : GZIP_MAX_MATCH;
+	DWORD chain, length, distance, last_distance = 0U, best_len = 0U;
+
+	for(chain = 0U; candidate && (chain < GZIP_MAX_CHAIN); ++chain)
+	{
+		distance = absolute - (candidate - 1U);
+		if((distance <= last_distance) || (distance > GZIP_WSIZE) || (distance > ctx->strstart))
+		{
+			break; /*outdated or no longer in the window*/
+		}
+		match = scan - distance;
+		if(scan[best_len] == match[best_len])
+		{
+			for(length = 0U; (length < limit) && (scan[length] == match[length]); ++length);
+			if((length > best_len) && ((length > GZIP_MIN_MATCH) || (distance <= GZIP_TOO_FAR)))
+			{
+				best_len = length;
+				*best_distance = distance;
+				if(length >= limit)
+				{
+					break;
+				}
+			}
+		}
+		last_distance = distance;
+		candidate = ctx->prev[(candidate - 1U) & GZIP_WMASK];
+	}
+
+	return best_len;
+}
+
+static BOOL gzip_deflate_compress(gzip_deflate_t *const ctx, volatile BOOL *const abort_flag)
+{
+	DWORD candidate, length, distance = 0U, symbol, pos;
+
+	for(;;)
+	{
+		if((ctx->lookahead < GZIP_MIN_LOOKAHEAD) && (!gzip_deflate_fill(ctx)))
+		{
+			return FALSE;
+		}
+		if(ctx->lookahead < 1U)
+		{
+			return TRUE;
+		}
+		if(*abort_flag)
+		{
+			return FALSE;
+		}
+
+		length = 0U;
+		if(ctx->lookahead >= GZIP_MIN_MATCH)
+		{
+			gzip_deflate_insert(ctx, ctx->strstart, &candidate);
+			length = gzip_deflate_match(ctx, candidate, &distance);
+		}
+
+		if(length >= GZIP_MIN_MATCH)
+		{
+			symbol = ctx->length_symbol[length];
+			if(!(gzip_deflate_bits(ctx, ctx->lit_code[257U + symbol], ctx->lit_bits[257U + symbol]) && gzip_deflate_bits(ctx, length - GZIP_LENGTH_BASE[symbol], GZIP_LENGTH_EXTRA[symbol])))
+			{
+				return FALSE;
+			}
+			symbol = ctx->dist_symbol[(distance <= 256U) ? (distance - 1U) : (256U + ((distance - 1U) >> 7))];
+			if(!(gzip_deflate_bits(ctx, ctx->dist_code[symbol], 5U) && gzip_deflate_bits(ctx, distance - GZIP_DIST_BASE[symbol], GZIP_DIST_EXTRA[symbol])))
+			{
+				return FALSE;
+			}
+			if((length <= GZIP_MAX_INSERT) && (ctx->lookahead - length >= GZIP_MIN_MATCH))
+			{
+				for(pos = 1U; pos < length; ++pos)
+				{
+					gzip_deflate_insert(ctx, ctx->strstart + pos, &candidate);
+				}
+			}
+			ctx->strstart += length;
+			ctx->lookahead -= length;
+		}
+		else
+		{
+			symbol = ctx->window[ctx->strstart];
+			if(!gzip_deflate_bits(ctx, ctx->lit_code[symbol], ctx->lit_bits[symbol]))
+			{
+				return FALSE;
+			}
+			ctx->strstart++;
+			ctx->lookahead--;
+		}
+	}
+}
+
+static BOOL gzip_deflate(const libreplace_io_t *const io_functions, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	static const BYTE GZIP_HEADER[10U] = { 0x1FU, 0x8BU, 8U, 0U, 0U, 0U, 0U, 0U, 0U, 0xFFU };
+	BYTE trailer[8U];
+	DWORD pos;
+	BOOL success = FALSE;
+
+	gzip_deflate_t *const ctx = (gzip_deflate_t*) LocalAlloc(LPTR, sizeof(gzip_deflate_t));
+	if(!ctx)
+	{
+		*error_message = "Failed to allocate the gzip encoder!";
+		return FALSE;
+	}
+
+	ctx->io_functions = io_functions;
+	ctx->upper = ctx->window + GZIP_WSIZE;
+	gzip_deflate_init(ctx);
+
+	/* a single member, with a non-final fixed Huffman block that holds all the data, followed by an empty final block */
+	if(!(gzip_deflate_bytes(ctx, GZIP_HEADER, 10U) && gzip_deflate_bits(ctx, 0U, 1U) && gzip_deflate_bits(ctx, 1U, 2U)))
+	{
+		goto write_failed;
+	}
+
+	if(!gzip_deflate_compress(ctx, abort_flag))
+	{
+		if(ctx->read_error || (*abort_flag))
+		{
+			*error_message = "Failed to read the data to be compressed!";
+			goto cleanup;
+		}
+		goto write_failed;
+	}
+
+	for(pos = 0U; pos < 4U; ++pos)
+	{
+		trailer[pos] = (BYTE)((ctx->crc >> (8U * pos)) & 0xFFU);
+		trailer[4U + pos] = (BYTE)((ctx->size >> (8U * pos)) & 0xFFU);
+	}
+
+	if(!(gzip_deflate_bits(ctx, ctx->lit_code[256U], ctx->lit_bits[256U]) && gzip_deflate_bits(ctx, 1U, 1U) && gzip_deflate_bits(ctx, 1U, 2U) && gzip_deflate_bits(ctx, ctx->lit_code[256U], ctx->lit_bits[256U]) && gzip_deflate_bits(ctx, 0U, 7U)))
+	{
+		goto write_failed;
+	}
+
+	ctx->bit_buf = ctx->bit_count = 0U; /*drop the padding bits*/
+	if(!(gzip_deflate_bytes(ctx, trailer, 8U) && gzip_deflate_write(ctx) && ctx->io_functions->func_wr(LIBREPLACE_FLUSH, ctx->io_functions->context_wr)))
+	{
+		goto write_failed;
+	}
+
+	success = TRUE;
+	goto cleanup;
+
+write_failed:
+
+	*error_message = "Failed to write the compressed output!";
+
+cleanup:
+
+	LocalFree((HLOCAL)ctx);
+	return success;
+}
+
+/* ======================================================================= */
+/* Pipeline                                                                */
+/* ======================================================================= */
+
+typedef struct gzip_thread_t
+{
+	BOOL compress;
+	libreplace_io_t io_functions;
+	const CHAR *error_message;
+	HANDLE close_on_exit;
+	HANDLE thread;
+}
+gzip_thread_t;
+
+static DWORD WINAPI gzip_thread_main(LPVOID param)
+{
+	gzip_thread_t *const ctx = (gzip_thread_t*) param;
+	const BOOL success = ctx->compress ? gzip_deflate(&ctx->io_functions, &ctx->error_message, &g_abort_requested) : gzip_inflate(&ctx->io_functions, &ctx->error_message, &g_abort_requested);
+	if(ctx->close_on_exit)
+	{
+		CloseHandle(ctx->close_on_exit); /*signals EOF to the other end of a pipe*/
+	}
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* the codec reads from '<input>' and writes to '<output>' on a thread of its own, '<close_on_exit>' is closed when it is done */
+static BOOL gzip_thread_start(gzip_thread_t *const ctx, const BOOL compress, file_input_t *const input, file_output_t *const output, const HANDLE close_on_exit)
+{
+	SecureZeroMemory(ctx, sizeof(gzip_thread_t));
+	ctx->compress = compress;
+	ctx->close_on_exit = close_on_exit;
+	init_io_functions(&ctx->io_functions, file_read_byte, file_write_byte, (DWORD_PTR)input, (DWORD_PTR)output);
+	init_io_bulk_functions(&ctx->io_functions, file_read_bulk, file_write_bulk);
+	return ((ctx->thread = CreateThread(NULL, 0U, gzip_thread_main, (LPVOID)ctx, 0U, NULL)) != NULL);
+}
+
+static BOOL gzip_thread_join(gzip_thread_t *const ctx)
+{
+	DWORD exit_code = EXIT_FAILURE;
+	if(ctx->thread)
+	{
+		WaitForSingleObject(ctx->thread, INFINITE);
+		if(!GetExitCodeThread(ctx->thread, &exit_code))
+		{
+			exit_code = EXIT_FAILURE;
+		}
+		CloseHandle(ctx->thread);
+		ctx->thread = NULL;
+	}
+	return (exit_code == EXIT_SUCCESS);
+}
+
+#endif /*INC_GZIP_H*/
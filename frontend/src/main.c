@@ -5,6 +5,11 @@
 
 #include "libreplace/replace.h"
 #include "utils.h"
+#include "gzip.h"
+#include "tar.h"
+#include "patch.h"
+#include "checkpoint.h"
+#include "extents.h"
 #include "selftest.h"
 
 #include <ShellAPI.h> /*CommandLineToArgvW*/
@@ -47,23 +52,71 @@ static void print_manpage(const HANDLE std_err)
 	print_text(std_err, "Replaces any occurrence of '<needle>' in '<input_file>' with '<replacement>'.\n");
 	print_text(std_err, "The modified contents are then written to '<output_file>'.\n\n");
 	print_text(std_err, "Usage:\n");
-	print_text(std_err, "  replace.exe [options] <needle> <replacement> [<input_file>] [<output_file>]\n\n");
+	print_text(std_err, "  replace.exe [options] <needle> <replacement> [<input_file>] [<output_file>]\n");
+	print_text(std_err, "  replace.exe [options] --apply-patch <patch_file> <input_file> [<output_file>]\n\n");
 	print_text(std_err, "Options:\n");
 	print_text(std_err, "  -i  Perform case-insensitive matching for the characters 'A' to 'Z'\n");
 	print_text(std_err, "  -s  Single replacement; replace only the *first* occurrence instead of all\n");
+	print_text(std_err, "  -r  Reverse mode; scan a seekable input backwards, e.g. to replace the *last*\n");
+	print_text(std_err, "      occurrence when combined with '-s' or '--max-replacements'\n");
 	print_text(std_err, "  -a  Process input using ANSI codepage (CP-1252) instead of UTF-8\n");
 	print_text(std_err, "  -e  Enable interpretation of backslash escape sequences in all parameters\n");
 	print_text(std_err, "  -f  Force immediate flushing of file buffers (may degrade performance)\n");
 	print_text(std_err, "  -b  Binary mode; parameters '<needle>' and '<replacement>' are Hex strings\n");
+	print_text(std_err, "  -c  Translate mode; each byte in '<needle>' is replaced by the byte at the\n");
+	print_text(std_err, "      same position in '<replacement>', or deleted if there is no such byte\n");
 	print_text(std_err, "  -n  Normalize CR+LF (Windows) and CR (MacOS) line-breaks to LF (Unix)\n");
 	print_text(std_err, "  -g  Enable globbing; the wildcard '?' matches any character except CR/LF\n");
 	print_text(std_err, "  -l  With globbing enabled, make the wildcard character match CR and LF too\n");
+	print_text(std_err, "  -z  Transparent compression; gzip input (detected by its magic bytes) is\n");
+	print_text(std_err, "      decompressed on the fly, and the output is compressed with gzip again\n");
 	print_text(std_err, "  -y  Try to overwrite read-only files; i.e. clears the read-only flag\n");
 	print_text(std_err, "  -d  Dry run; do not actually replace occurrences of '<needle>'\n");
 	print_text(std_err, "  -v  Enable verbose mode; print additional diagnostic information to STDERR\n");
 	print_text(std_err, "  -x  Exit code equals number of replacements; value '-1' indicates error\n");
 	print_text(std_err, "  -t  Run self-test and exit\n");
-	print_text(std_err, "  -h  Display this help text and exit\n\n");
+	print_text(std_err, "  -h  Display this help text and exit\n");
+	print_text(std_err, "  --max-replacements <n>\n");
+	print_text(std_err, "      Replace at most '<n>' occurrences, then copy the remaining input as-is\n");
+	print_text(std_err, "  --offset <n>\n");
+	print_text(std_err, "      Skip the first '<n>' bytes of the input; they are copied unmodified\n");
+	print_text(std_err, "  --length <n>\n");
+	print_text(std_err, "      Process at most '<n>' bytes; the remaining input is copied unmodified\n");
+	print_text(std_err, "  --tar\n");
+	print_text(std_err, "      Process the input as a tar archive; the data of each regular member is\n");
+	print_text(std_err, "      processed separately, and the member sizes in the headers are updated\n");
+	print_text(std_err, "  --tar-filter <glob>\n");
+	print_text(std_err, "      Process only the tar members whose name matches '<glob>', all others are\n");
+	print_text(std_err, "      copied as-is; supports the wildcards '*' and '?'. Implies '--tar'\n");
+	print_text(std_err, "  --emit-patch\n");
+	print_text(std_err, "      Write an edit list (offset, removed length and inserted bytes of each\n");
+	print_text(std_err, "      match) to '<output_file>', instead of the complete modified data\n");
+	print_text(std_err, "  --apply-patch <patch_file>\n");
+	print_text(std_err, "      Apply an edit list that was created with '--emit-patch'; the unmodified\n");
+	print_text(std_err, "      ranges are copied in bulk, or left untouched when modifying in-place\n");
+	print_text(std_err, "      (the input must match the size and the CRC-32 recorded in the patch)\n");
+	print_text(std_err, "  --undo-journal <journal_file>\n");
+	print_text(std_err, "      When modifying a file in-place, record the original bytes of each match\n");
+	print_text(std_err, "      in '<journal_file>'; apply this journal with '--apply-patch' to undo;\n");
+	print_text(std_err, "      an existing journal file is never overwritten\n");
+	print_text(std_err, "  --checkpoint <checkpoint_file>\n");
+	print_text(std_err, "      Record the progress in '<checkpoint_file>' after every 64 I/O buffers;\n");
+	print_text(std_err, "      an interrupted run is resumed from there, if restarted the same way\n");
+	print_text(std_err, "  --buffer-size <n>\n");
+	print_text(std_err, "      Size of the file I/O buffers, in bytes; by default, the size is chosen\n");
+	print_text(std_err, "      by file type (1 MiB for files, 64 KiB for pipes, 4 KiB for terminals)\n");
+	print_text(std_err, "  --direct-io\n");
+	print_text(std_err, "      Bypass the file system cache for files, and preallocate the output file;\n");
+	print_text(std_err, "      intended for huge files. The input of reverse mode is still cached\n");
+	print_text(std_err, "  --gzip\n");
+	print_text(std_err, "      Compress the output with gzip, even if the input was not compressed\n");
+	print_text(std_err, "  --sync-io\n");
+	print_text(std_err, "      Use synchronous I/O only; by default, regular files are accessed with\n");
+	print_text(std_err, "      overlapped I/O, so that reading and writing overlap with the processing\n");
+	print_text(std_err, "  --group-commit\n");
+	print_text(std_err, "      Durable like '-f', but the output is synced only once, when complete;\n");
+	print_text(std_err, "      the original file is replaced afterwards, with a write-through rename.\n");
+	print_text(std_err, "      That is one sync per run; multiple files are *not* batched together\n\n");
 	print_text(std_err, "ExitCode:\n");
 	print_text(std_err, "  By default, returns '0' in case of success, or '1' if anything went wrong\n");
 	print_text(std_err, "  If '<needle>' could not be found, this is *not* considered an error.\n\n");
@@ -71,12 +124,33 @@ static void print_manpage(const HANDLE std_err)
 	print_text(std_err, "  1. If *only* an '<input_file>' is specified, the file is modified in-place!\n");
 	print_text(std_err, "  2. If file names are omitted, reads from STDIN and writes to STDOUT.\n");
 	print_text(std_err, "  3. File name can be specified as \"-\" to read from STDIN or write to STDOUT.\n");
-	print_text(std_err, "  4. The length of a Hex string must be *even*, with optional '0x' prefix.\n\n");
+	print_text(std_err, "  4. The length of a Hex string must be *even*, with optional '0x' prefix.\n");
+	print_text(std_err, "  5. In translate mode, '<replacement>' must not be longer than '<needle>'.\n");
+	print_text(std_err, "  6. With '-e' and '-g', the escape sequences '\\1' to '\\9' in '<replacement>'\n");
+	print_text(std_err, "     insert the character matched by the first to ninth wildcard.\n");
+	print_text(std_err, "  7. With '-z', input compressed with zstd or xz is detected, but rejected.\n");
+	print_text(std_err, "  8. In tar mode, '-s' and '--max-replacements' apply to each member.\n");
+	print_text(std_err, "  9. A patch where no edit changes the length is applied in-place directly.\n");
+	print_text(std_err, " 10. The undo journal is synced to disk before the original file is replaced.\n");
+	print_text(std_err, " 11. With '--checkpoint', the partial output of an aborted run is *not* deleted.\n");
+	print_text(std_err, " 12. The holes of sparse files are skipped, and are preserved in the output.\n");
+	print_text(std_err, " 13. On ReFS, in-place mode clones the file and rewrites the matches only,\n");
+	print_text(std_err, "     provided that '<needle>' and '<replacement>' have the same length.\n\n");
 	print_text(std_err, "Examples:\n");
 	print_text(std_err, "  replace.exe \"foobar\" \"quux\" \"input.txt\" \"output.txt\"\n");
 	print_text(std_err, "  replace.exe -e \"foo\\nbar\" \"qu\\tux\" \"input.txt\" \"output.txt\"\n");
 	print_text(std_err, "  replace.exe \"foobar\" \"quux\" \"modified.txt\"\n");
 	print_text(std_err, "  replace.exe -b 0xDEADBEEF 0xCAFEBABE \"input.bin\" \"output.bin\"\n");
+	print_text(std_err, "  replace.exe -bc 0x3B00 0x2C \"input.bin\" \"output.bin\"\n");
+	print_text(std_err, "  replace.exe -rs \"[END]\" \"[DONE]\" \"logfile.txt\"\n");
+	print_text(std_err, "  replace.exe -eg \"id=??;\" \"id=\\2\\1;\" \"input.txt\" \"output.txt\"\n");
+	print_text(std_err, "  replace.exe -z \"foo\" \"bar\" \"logfile.txt.gz\"\n");
+	print_text(std_err, "  replace.exe --tar-filter \"*.conf\" \"foo\" \"bar\" \"input.tar\" \"output.tar\"\n");
+	print_text(std_err, "  replace.exe --emit-patch \"foo\" \"bar\" \"input.bin\" \"changes.patch\"\n");
+	print_text(std_err, "  replace.exe --apply-patch \"changes.patch\" \"input.bin\"\n");
+	print_text(std_err, "  replace.exe --undo-journal \"undo.patch\" \"foo\" \"bar\" \"modified.txt\"\n");
+	print_text(std_err, "  replace.exe --apply-patch \"undo.patch\" \"modified.txt\"\n");
+	print_text(std_err, "  replace.exe --checkpoint \"huge.chk\" \"foo\" \"bar\" \"huge.bin\"\n");
 	print_text(std_err, "  type \"from.txt\" | replace.exe \"foo\" \"bar\" > \"to.txt\"\n\n");
 }
 
@@ -103,6 +177,121 @@ BOOL WINAPI ctrl_handler_routine(const DWORD type)
 /* Command-line Options                                                    */
 /* ======================================================================= */
 
+static BOOL parse_long_value(const HANDLE std_err, const int argc, const LPCWSTR *const argv, int *const index, const CHAR *const name, const ULONGLONG min_value, const ULONGLONG max_value, ULONGLONG *const value)
+{
+	if(!((*index < argc) && decode_number(argv[*index], value) && (*value >= min_value) && (*value <= max_value)))
+	{
+		print_text_fmt(std_err, "Error: Option '--%s' requires a valid number as argument!\n", name);
+		return FALSE;
+	}
+	*index += 1U;
+	return TRUE;
+}
+
+static BOOL parse_long_option(const HANDLE std_err, const int argc, const LPCWSTR *const argv, int *const index, const WCHAR *const name, options_t *const options)
+{
+	ULONGLONG value;
+	if(lstrcmpW(name, L"max-replacements") == 0)
+	{
+		if(!parse_long_value(std_err, argc, argv, index, "max-replacements", 1U, MAXDWORD, &value))
+		{
+			return FALSE;
+		}
+		options->flags.max_replacements = (DWORD)value;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"offset") == 0)
+	{
+		return parse_long_value(std_err, argc, argv, index, "offset", 0U, (ULONGLONG)MAXLONGLONG, &options->flags.window_offset);
+	}
+	if(lstrcmpW(name, L"length") == 0)
+	{
+		return parse_long_value(std_err, argc, argv, index, "length", 1U, (ULONGLONG)MAXLONGLONG, &options->flags.window_length);
+	}
+	if(lstrcmpW(name, L"direct-io") == 0)
+	{
+		options->direct_io = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"tar") == 0)
+	{
+		options->tar_mode = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"tar-filter") == 0)
+	{
+		if(!((*index < argc) && argv[*index][0U]))
+		{
+			print_text(std_err, "Error: Option '--tar-filter' requires a non-empty pattern as argument!\n");
+			return FALSE;
+		}
+		options->tar_filter = argv[(*index)++];
+		options->tar_mode = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"emit-patch") == 0)
+	{
+		options->emit_patch = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"apply-patch") == 0)
+	{
+		if(!((*index < argc) && argv[*index][0U]))
+		{
+			print_text(std_err, "Error: Option '--apply-patch' requires a patch file as argument!\n");
+			return FALSE;
+		}
+		options->apply_patch = argv[(*index)++];
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"undo-journal") == 0)
+	{
+		if(!((*index < argc) && argv[*index][0U]))
+		{
+			print_text(std_err, "Error: Option '--undo-journal' requires a file name as argument!\n");
+			return FALSE;
+		}
+		options->undo_journal = argv[(*index)++];
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"checkpoint") == 0)
+	{
+		if(!((*index < argc) && argv[*index][0U]))
+		{
+			print_text(std_err, "Error: Option '--checkpoint' requires a file name as argument!\n");
+			return FALSE;
+		}
+		options->checkpoint = argv[(*index)++];
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"gzip") == 0)
+	{
+		options->compress = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"sync-io") == 0)
+	{
+		options->sync_io = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"group-commit") == 0)
+	{
+		options->group_commit = TRUE;
+		return TRUE;
+	}
+	if(lstrcmpW(name, L"buffer-size") == 0)
+	{
+		if(!parse_long_value(std_err, argc, argv, index, "buffer-size", IO_BUFF_SIZE_MIN, IO_BUFF_SIZE_MAX, &value))
+		{
+			return FALSE;
+		}
+		options->buffer_size = (DWORD)value;
+		return TRUE;
+	}
+	print_text(std_err, "Error: Invalid command-line option encountered!\n");
+	return FALSE;
+}
+
 static int parse_options(const HANDLE std_err, const int argc, const LPCWSTR *const argv, int *const index, options_t *const options)
 {
 	DWORD flag_pos;
@@ -113,9 +302,17 @@ static int parse_options(const HANDLE std_err, const int argc, const LPCWSTR *co
 		if((value[0U] == L'-') && (value[1U] != L'\0'))
 		{
 			*index += 1U;
-			if((value[1U] == L'-') && (value[2U] == L'\0'))
+			if(value[1U] == L'-')
 			{
-				return TRUE; /*stop here!*/
+				if(value[2U] == L'\0')
+				{
+					return TRUE; /*stop here!*/
+				}
+				if(!parse_long_option(std_err, argc, argv, index, value + 2U, options))
+				{
+					return FALSE;
+				}
+				continue;
 			}
 			for(flag_pos = 1U; value[flag_pos]; ++flag_pos)
 			{
@@ -128,6 +325,9 @@ static int parse_options(const HANDLE std_err, const int argc, const LPCWSTR *co
 				case L'b':
 					options->binary_mode = TRUE;
 					break;
+				case L'c':
+					options->translate = TRUE;
+					break;
 				case L'd':
 					options->flags.dry_run = TRUE;
 					break;
@@ -152,6 +352,9 @@ static int parse_options(const HANDLE std_err, const int argc, const LPCWSTR *co
 				case L'n':
 					options->flags.normalize = TRUE;
 					break;
+				case L'r':
+					options->flags.reverse = TRUE;
+					break;
 				case L's':
 					options->flags.replace_once = TRUE;
 					break;
@@ -167,6 +370,9 @@ static int parse_options(const HANDLE std_err, const int argc, const LPCWSTR *co
 				case L'y':
 					options->force_overwrite = TRUE;
 					break;
+				case L'z':
+					options->decompress = TRUE;
+					break;
 				default:
 					print_text(std_err, "Error: Invalid command-line option encountered!\n");
 					return FALSE;
@@ -181,6 +387,225 @@ static int parse_options(const HANDLE std_err, const int argc, const LPCWSTR *co
 	return TRUE;
 }
 
+/* ======================================================================= */
+/* Patch mode                                                              */
+/* ======================================================================= */
+
+static BOOL apply_patch_file(const HANDLE std_err, const HANDLE std_out, const options_t *const options, const WCHAR *const source_file, const WCHAR *const output_file, DWORD *const edit_count)
+{
+	BOOL success = FALSE, async_output = FALSE;
+	BYTE *patch_data = NULL;
+	DWORD patch_len = 0U;
+	patch_t patch;
+	HANDLE input = INVALID_HANDLE_VALUE, output = INVALID_HANDLE_VALUE;
+	libreplace_io_t io_functions;
+	file_input_t *file_input_context = NULL;
+	file_output_t *file_output_context = NULL;
+	const WCHAR *temp_path = NULL, *temp_file = NULL;
+	const CHAR *error_message = NULL;
+
+	if(!(patch_data = patch_load(options->apply_patch, &patch_len)))
+	{
+		print_text(std_err, "Error: Failed to read the patch file!\n");
+		goto cleanup;
+	}
+
+	if(!patch_parse(&patch, patch_data, patch_len))
+	{
+		print_text(std_err, "Error: The patch file is invalid or corrupted!\n");
+		goto cleanup;
+	}
+
+	if(options->flags.verbose)
+	{
+		print_text_fmt(std_err, "Patch contains %lu edit(s)%s.\n", patch.edit_count, patch.same_length ? ", none of which changes the length" : "");
+	}
+
+	if((input = open_file(source_file, FALSE, 0U)) == INVALID_HANDLE_VALUE)
+	{
+		print_text(std_err, "Error: Failed to open input file for reading!\n");
+		goto cleanup;
+	}
+
+	if(GetFileType(input) != FILE_TYPE_DISK)
+	{
+		print_text(std_err, "Error: Applying a patch requires the input to be a seekable file!\n");
+		goto cleanup;
+	}
+
+	if(EMPTY(output_file))
+	{
+		if((!options->force_overwrite) && has_readonly_attribute(input))
+		{
+			print_text(std_err, "Error: Sorry, the write-protected file cannot be modified in-place!\n");
+			goto cleanup;
+		}
+		if(patch.same_length)
+		{
+			/* only the edited ranges are overwritten, the rest of the file is never touched */
+			if(options->flags.verbose)
+			{
+				print_text(std_err, "Applying the patch in-place, by overwriting the edited ranges.\n");
+			}
+			CloseHandle(input);
+			if(options->force_overwrite)
+			{
+				clear_readonly_attribute(source_file);
+			}
+			if((input = CreateFileW(source_file, GENERIC_READ | GENERIC_WRITE, 0U, NULL, OPEN_EXISTING, 0U, NULL)) == INVALID_HANDLE_VALUE)
+			{
+				print_text(std_err, "Error: Failed to open the file for writing!\n");
+				goto cleanup;
+			}
+			if(!(file_input_context = alloc_file_input(input, options->buffer_size, FALSE, FALSE, FALSE)))
+			{
+				print_text(std_err, "Error: Failed to allocate file input context!\n");
+				goto cleanup;
+			}
+			if(!(patch_apply_in_place(&patch, input, file_input_context->buffer, file_input_context->buffer_size, &error_message, &g_abort_requested) && ((!(options->force_sync || options->group_commit)) || sync_file(input))))
+			{
+				if(!g_abort_requested)
+				{
+					print_text_fmt(std_err, "Error: %s\n", error_message ? error_message : "Failed to flush the file buffers!");
+				}
+				goto cleanup;
+			}
+			*edit_count = patch.edit_count;
+			success = TRUE;
+			goto cleanup;
+		}
+		if(options->flags.verbose)
+		{
+			print_text(std_err, "Using in-place file processing mode this time.\n");
+		}
+		temp_file = generate_temp_file(temp_path = get_directory_part(source_file), &output, 0U);
+		if(EMPTY(temp_file))
+		{
+			print_text(std_err, "Error: Failed to create temporary file!\n");
+			goto cleanup;
+		}
+	}
+	else if(lstrcmpiW(output_file, L"-") != 0)
+	{
+		if(options->force_overwrite)
+		{
+			clear_readonly_attribute(output_file);
+		}
+		async_output = (!options->sync_io) && (!options->force_sync);
+		output = open_file_async(output_file, TRUE, 0U, &async_output);
+	}
+	else
+	{
+		output = std_out;
+	}
+
+	if(output == INVALID_HANDLE_VALUE)
+	{
+		print_text(std_err, "Error: Failed to open output file for writing!\n");
+		goto cleanup;
+	}
+
+	if(!(file_input_context = alloc_file_input(input, options->buffer_size, FALSE, FALSE, FALSE)))
+	{
+		print_text(std_err, "Error: Failed to allocate file input context!\n");
+		goto cleanup;
+	}
+
+	if(!(file_output_context = alloc_file_output(output, options->force_sync, options->buffer_size, FALSE, async_output, FALSE)))
+	{
+		print_text(std_err, "Error: Failed to allocate file output context!\n");
+		goto cleanup;
+	}
+
+	/* the unmodified ranges are copied in bulk, using the (otherwise unused) input buffer */
+	init_io_functions(&io_functions, file_read_byte, file_write_byte, (DWORD_PTR)file_input_context, (DWORD_PTR)file_output_context);
+	init_io_bulk_functions(&io_functions, file_read_bulk, file_write_bulk);
+	init_io_seek_functions(&io_functions, file_read_at, file_get_size);
+
+	if(!patch_apply_copy(&patch, &io_functions, file_input_context->buffer, file_input_context->buffer_size, &error_message, &g_abort_requested))
+	{
+		if(!g_abort_requested)
+		{
+			print_text_fmt(std_err, "Error: %s\n", error_message ? error_message : "Something went wrong. Output probably is incomplete!");
+		}
+		goto cleanup;
+	}
+
+	if(options->group_commit && (!commit_file(output)))
+	{
+		print_text(std_err, "Error: Failed to flush the file buffers!\n");
+		goto cleanup;
+	}
+
+	free_file_input(file_input_context);
+	file_input_context = NULL;
+
+	free_file_output(file_output_context);
+	file_output_context = NULL;
+
+	CloseHandle(input);
+	input = INVALID_HANDLE_VALUE;
+
+	if(output != std_out)
+	{
+		CloseHandle(output);
+		output = INVALID_HANDLE_VALUE;
+	}
+
+	if(NOT_EMPTY(temp_file))
+	{
+		if(options->force_overwrite)
+		{
+			clear_readonly_attribute(source_file);
+		}
+		if(!move_file(temp_file, source_file))
+		{
+			print_text(std_err, "Error: Failed to replace the original file with modified one!\n");
+			goto cleanup;
+		}
+	}
+
+	*edit_count = patch.edit_count;
+	success = TRUE;
+
+cleanup:
+
+	free_file_input(file_input_context);
+	free_file_output(file_output_context);
+
+	if(input != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(input);
+	}
+
+	if((output != INVALID_HANDLE_VALUE) && (output != std_out))
+	{
+		CloseHandle(output);
+	}
+
+	if(NOT_EMPTY(temp_file) && file_exists(temp_file))
+	{
+		delete_file(temp_file);
+	}
+
+	if(temp_file)
+	{
+		LocalFree((HLOCAL)temp_file);
+	}
+
+	if(temp_path)
+	{
+		LocalFree((HLOCAL)temp_path);
+	}
+
+	if(patch_data)
+	{
+		LocalFree((HLOCAL)patch_data);
+	}
+
+	return success;
+}
+
 /* ======================================================================= */
 /* Main                                                                    */
 /* ======================================================================= */
@@ -189,15 +614,27 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 {
 	UINT result = EXIT_FAILURE, previous_output_cp = 0U;
 	int param_offset = 1;
-	BYTE *needle = NULL, *replacement = NULL;
-	WORD *needle_expanded = NULL;
-	DWORD needle_len = 0U, replacement_len = 0U, replacement_count = 0U;
+	BYTE *needle = NULL, *replacement = NULL, *tar_filter = NULL;
+	WORD *needle_expanded = NULL, *replacement_expanded = NULL, translation_table[256U];
+	DWORD needle_len = 0U, replacement_len = 0U, replacement_count = 0U, wildcard_count = 0U, char_pos, compression = COMPRESSION_NONE, tar_filter_len = 0U, fingerprint;
+	BOOL large_pages = FALSE, async_input = FALSE, async_output = FALSE, read_error = FALSE, journal_committed = FALSE, resume = FALSE, skip_holes = FALSE, cloned = FALSE, sparse = FALSE;
+	LARGE_INTEGER input_size;
 	options_t options;
-	HANDLE input = INVALID_HANDLE_VALUE, output = INVALID_HANDLE_VALUE;
+	HANDLE input = INVALID_HANDLE_VALUE, output = INVALID_HANDLE_VALUE, journal = INVALID_HANDLE_VALUE, inflate_rd = NULL, inflate_wr = NULL, deflate_rd = NULL, deflate_wr = NULL;
 	libreplace_logger_t logger;
 	libreplace_io_t io_functions;
-	file_input_t *file_input_context = NULL;
-	file_output_t *file_output_context = NULL;
+	libreplace_pattern_t *pattern = NULL;
+	libreplace_context_t *context = NULL;
+	tar_replace_t tar_params;
+	patch_writer_t patch_writer;
+	extents_rewriter_t rewriter;
+	libreplace_sink_t patch_output;
+	const CHAR *error_message = NULL;
+	gzip_thread_t inflate_thread, deflate_thread;
+	checkpoint_t *checkpoint = NULL;
+	struct { ULONGLONG size, time; } input_id;
+	file_input_t *file_input_context = NULL, *pipe_input_context = NULL, *deflate_input_context = NULL;
+	file_output_t *file_output_context = NULL, *inflate_output_context = NULL, *pipe_output_context = NULL, *journal_output_context = NULL;
 	const WCHAR *source_file = NULL, *output_file = NULL, *temp_path = NULL, *temp_file = NULL;
 
 	/* -------------------------------------------------------- */
@@ -208,6 +645,11 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 	const HANDLE std_out = GetStdHandle(STD_OUTPUT_HANDLE);
 	const HANDLE std_err = GetStdHandle(STD_ERROR_HANDLE);
 
+	SecureZeroMemory(&inflate_thread, sizeof(gzip_thread_t));
+	SecureZeroMemory(&deflate_thread, sizeof(gzip_thread_t));
+	SecureZeroMemory(&patch_writer, sizeof(patch_writer_t));
+	SecureZeroMemory(&rewriter, sizeof(extents_rewriter_t));
+
 	/* -------------------------------------------------------- */
 	/* Parse options                                            */
 	/* -------------------------------------------------------- */
@@ -239,12 +681,96 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 		goto cleanup;
 	}
 
+	if(options.translate && (options.globbing || options.flags.replace_once || options.flags.max_replacements))
+	{
+		print_text(std_err, "Error: Options '-g', '-s' and '--max-replacements' are incompatible with translate mode!\n");
+		goto cleanup;
+	}
+
+	if(options.flags.replace_once && options.flags.max_replacements)
+	{
+		print_text(std_err, "Error: Options '-s' and '--max-replacements' are mutually exclusive!\n");
+		goto cleanup;
+	}
+
+	if(options.force_sync && options.group_commit)
+	{
+		print_text(std_err, "Error: Options '-f' and '--group-commit' are mutually exclusive!\n");
+		goto cleanup;
+	}
+
+	if(options.flags.reverse && (options.translate || options.flags.normalize))
+	{
+		print_text(std_err, "Error: Options '-c' and '-n' are incompatible with reverse mode!\n");
+		goto cleanup;
+	}
+
+	if(options.tar_mode && (options.flags.reverse || options.flags.window_offset || options.flags.window_length))
+	{
+		print_text(std_err, "Error: Options '-r', '--offset' and '--length' are incompatible with tar mode!\n");
+		goto cleanup;
+	}
+
+	if(options.emit_patch && (options.translate || options.flags.dry_run || options.flags.normalize || options.flags.reverse || options.decompress || options.compress || options.tar_mode))
+	{
+		print_text(std_err, "Error: Options '-c', '-d', '-n', '-r', '-z', '--gzip' and '--tar' are incompatible with '--emit-patch'!\n");
+		goto cleanup;
+	}
+
+	if(options.apply_patch && (options.emit_patch || options.undo_journal || options.flags.dry_run || options.flags.reverse || options.decompress || options.compress || options.tar_mode))
+	{
+		print_text(std_err, "Error: Options '-d', '-r', '-z', '--gzip', '--tar', '--emit-patch' and '--undo-journal' are incompatible with '--apply-patch'!\n");
+		goto cleanup;
+	}
+
+	if(options.undo_journal && (options.translate || options.flags.dry_run || options.flags.normalize || options.flags.reverse || options.decompress || options.compress || options.tar_mode || options.emit_patch))
+	{
+		print_text(std_err, "Error: Options '-c', '-d', '-n', '-r', '-z', '--gzip', '--tar' and '--emit-patch' are incompatible with '--undo-journal'!\n");
+		goto cleanup;
+	}
+
+	if(options.checkpoint && (options.translate || options.flags.dry_run || options.flags.normalize || options.flags.reverse || options.decompress || options.compress || options.tar_mode || options.direct_io || options.emit_patch || options.undo_journal || options.apply_patch))
+	{
+		print_text(std_err, "Error: Options '-c', '-d', '-n', '-r', '-z', '--gzip', '--tar', '--direct-io', '--emit-patch', '--undo-journal' and '--apply-patch' are incompatible with '--checkpoint'!\n");
+		goto cleanup;
+	}
+
 	if(options.flags.match_crlf && (!options.globbing))
 	{
 		print_text(std_err, "Error: Options '-l' only makes sense when globbing is enabled!\n");
 		goto cleanup;
 	}
 
+	/* -------------------------------------------------------- */
+	/* Patch-apply mode                                         */
+	/* -------------------------------------------------------- */
+
+	if(options.apply_patch && (!options.self_test))
+	{
+		if(!((argc - param_offset >= 1) && argv[param_offset][0U] && (lstrcmpiW(argv[param_offset], L"-") != 0)))
+		{
+			print_text(std_err, "Error: Applying a patch requires an input file. Type \"replace -h\" for details!\n");
+			goto cleanup;
+		}
+		if((argc - param_offset > 1) && (!argv[param_offset + 1L][0U]))
+		{
+			print_text(std_err, "Error: If output file is specified, it must not be an empty string!\n");
+			goto cleanup;
+		}
+		if((argc - param_offset > 1) && (lstrcmpW(argv[param_offset], argv[param_offset + 1L]) == 0))
+		{
+			print_text(std_err, "Error: Input and output file must not be the same!\n");
+			goto cleanup;
+		}
+		if(!apply_patch_file(std_err, std_out, &options, argv[param_offset], (argc - param_offset > 1) ? argv[param_offset + 1L] : NULL, &replacement_count))
+		{
+			CHECK_ABORT_REQUEST();
+			goto cleanup;
+		}
+		result = options.return_replace_count ? ((replacement_count <= ((DWORD)MAXINT32)) ? replacement_count : MAXINT32) : EXIT_SUCCESS;
+		goto cleanup;
+	}
+
 	if((!options.self_test) && (argc - param_offset < 2U))
 	{
 		print_text(std_err, "Error: Required parameter is missing. Type \"replace -h\" for details!\n");
@@ -298,6 +824,12 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 		goto cleanup;
 	}
 
+	if(needle_len < 1U)
+	{
+		print_text(std_err, "Error: Search string (needle) must not be empty!\n");
+		goto cleanup;
+	}
+
 	if(needle_len > LIBREPLACE_MAXLEN)
 	{
 		print_text_fmt(std_err, "Error: Search string (needle) must not exceed %ld characters!\n", LIBREPLACE_MAXLEN);
@@ -319,13 +851,22 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 
 	if(options.escpae_chars)
 	{
-		if(!(expand_escape_chars(needle, &needle_len) && expand_escape_chars(replacement, &replacement_len)))
+		if(!(expand_escape_chars(needle, &needle_len) && (options.globbing || expand_escape_chars(replacement, &replacement_len))))
 		{
 			print_text(std_err, "Error: Parameter contains an invalid escape sequence!\n");
 			goto cleanup;
 		}
 	}
 
+	if(options.translate)
+	{
+		if(!build_translation_table(translation_table, needle, needle_len, replacement, replacement_len))
+		{
+			print_text(std_err, "Error: In translate mode, the replacement must not be longer than the needle!\n");
+			goto cleanup;
+		}
+	}
+
 	needle_expanded = expand_wildcards(needle, needle_len, options.globbing ? &MY_WILDCARD : NULL);
 	if(!needle_expanded)
 	{
@@ -333,6 +874,38 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 		goto cleanup;
 	}
 
+	if(!(replacement_expanded = (WORD*) LocalAlloc(LPTR, sizeof(WORD) * (replacement_len + 1U))))
+	{
+		print_text(std_err, "Error: Failed to expand replacement string!\n");
+		goto cleanup;
+	}
+
+	if(options.escpae_chars && options.globbing)
+	{
+		for(char_pos = 0U; char_pos < needle_len; ++char_pos)
+		{
+			wildcard_count += (needle_expanded[char_pos] == LIBREPLACE_WILDCARD) ? 1U : 0U;
+		}
+		if(!expand_back_references(replacement, &replacement_len, replacement_expanded, wildcard_count))
+		{
+			print_text(std_err, "Error: Parameter contains an invalid escape sequence!\n");
+			goto cleanup;
+		}
+	}
+	else
+	{
+		for(char_pos = 0U; char_pos < replacement_len; ++char_pos)
+		{
+			replacement_expanded[char_pos] = replacement[char_pos];
+		}
+	}
+
+	if(options.tar_filter && (!(tar_filter = utf16_to_bytes(options.tar_filter, &tar_filter_len, CP_UTF8))))
+	{
+		print_text(std_err, "Error: Failed to decode the tar member filter!\n");
+		goto cleanup;
+	}
+
 	source_file = (argc - param_offset > 2U) ? argv[param_offset + 2U] : NULL;
 	output_file = (argc - param_offset > 3U) ? argv[param_offset + 3U] : NULL;
 
@@ -345,34 +918,166 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 		}
 	}
 
+	if(options.emit_patch && EMPTY(output_file) && NOT_EMPTY(source_file) && (lstrcmpiW(source_file, L"-") != 0))
+	{
+		print_text(std_err, "Error: With '--emit-patch', the output file must be specified!\n");
+		goto cleanup;
+	}
+
+	if(options.checkpoint)
+	{
+		if(!(NOT_EMPTY(source_file) && (lstrcmpiW(source_file, L"-") != 0) && (EMPTY(output_file) || (lstrcmpiW(output_file, L"-") != 0))))
+		{
+			print_text(std_err, "Error: Checkpoints require the input and the output to be files!\n");
+			goto cleanup;
+		}
+		if((lstrcmpW(source_file, options.checkpoint) == 0) || (NOT_EMPTY(output_file) && (lstrcmpW(output_file, options.checkpoint) == 0)))
+		{
+			print_text(std_err, "Error: The checkpoint file must not be the input or the output file!\n");
+			goto cleanup;
+		}
+	}
+
+	if(options.undo_journal)
+	{
+		if(!(EMPTY(output_file) && NOT_EMPTY(source_file) && (lstrcmpiW(source_file, L"-") != 0)))
+		{
+			print_text(std_err, "Error: The undo journal requires in-place file processing mode!\n");
+			goto cleanup;
+		}
+		if(lstrcmpW(source_file, options.undo_journal) == 0)
+		{
+			print_text(std_err, "Error: Input file and undo journal must not be the same!\n");
+			goto cleanup;
+		}
+	}
+
+	if(options.flags.verbose)
+	{
+		print_text_fmt(std_err, "Using %s processing kernels.\n", libreplace_kernels_name());
+	}
+
 	/* -------------------------------------------------------- */
 	/* Open input and output files                              */
 	/* -------------------------------------------------------- */
 
-	if(NOT_EMPTY(source_file) && (lstrcmpiW(source_file, L"-") != 0))
+	if(NOT_EMPTY(source_file) && (lstrcmpiW(source_file, L"-") != 0))
+	{
+		async_input = (!options.sync_io) && (!options.flags.reverse);
+		input = open_file_async(source_file, FALSE, (options.direct_io && (!options.flags.reverse)) ? IO_FLAGS_DIRECT_INPUT : 0U, &async_input);
+	}
+	else
+	{
+		if(options.flags.verbose)
+		{
+			print_text(std_err, "Reading input from STDIN stream.\n");
+		}
+		input = std_inp;
+	}
+
+	if(input == INVALID_HANDLE_VALUE)
+	{
+		CHECK_ABORT_REQUEST();
+		print_text(std_err, "Error: Failed to open input file for reading!\n");
+		goto cleanup;
+	}
+
+	if(options.direct_io)
+	{
+		large_pages = enable_large_pages();
+	}
+
+	if(!(file_input_context = alloc_file_input(input, options.buffer_size, options.direct_io && (!options.flags.reverse) && (input != std_inp) && (GetFileType(input) == FILE_TYPE_DISK), async_input, large_pages)))
+	{
+		print_text(std_err, "Error: Failed to allocate file input context!\n");
+		goto cleanup;
+	}
+
+	if(options.flags.reverse && (GetFileType(input) != FILE_TYPE_DISK))
 	{
-		input = open_file(source_file, FALSE);
+		print_text(std_err, "Error: Reverse mode requires the input to be a seekable file!\n");
+		goto cleanup;
 	}
-	else
+
+	if(options.checkpoint)
 	{
-		if(options.flags.verbose)
+		if(GetFileType(input) != FILE_TYPE_DISK)
 		{
-			print_text(std_err, "Reading input from STDIN stream.\n");
+			print_text(std_err, "Error: Checkpoints require the input and the output to be files!\n");
+			goto cleanup;
 		}
-		input = std_inp;
+		if(!((checkpoint = checkpoint_alloc()) && checkpoint_identify(input, &input_id.size, &input_id.time)))
+		{
+			print_text(std_err, "Error: Failed to initialize the checkpoint!\n");
+			goto cleanup;
+		}
+		fingerprint = checkpoint_fingerprint(checkpoint, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags);
+		if(checkpoint_load(checkpoint, options.checkpoint))
+		{
+			resume = (checkpoint->fingerprint == fingerprint) && (checkpoint->input_size == input_id.size) && (checkpoint->input_time == input_id.time) && (checkpoint->input_offset <= input_id.size)
+				&& (EMPTY(output_file) ? (checkpoint->temp_file[0U] && file_exists(checkpoint->temp_file)) : (!checkpoint->temp_file[0U]));
+			if(options.flags.verbose)
+			{
+				print_text(std_err, resume ? "Resuming the interrupted run from the checkpoint.\n" : "Ignoring the checkpoint, because it does not match the input or the options.\n");
+			}
+		}
+		if(!resume)
+		{
+			if(EMPTY(output_file) && checkpoint->temp_file[0U] && file_exists(checkpoint->temp_file))
+			{
+				delete_file(checkpoint->temp_file); /*stale partial output*/
+			}
+			checkpoint->input_offset = checkpoint->output_offset = 0U;
+			checkpoint->replacement_count = 0U;
+			checkpoint->temp_file[0U] = L'\0';
+		}
+		checkpoint->fingerprint = fingerprint;
+		checkpoint->input_size = input_id.size;
+		checkpoint->input_time = input_id.time;
 	}
 
-	if(input == INVALID_HANDLE_VALUE)
+	if(options.decompress)
 	{
-		CHECK_ABORT_REQUEST();
-		print_text(std_err, "Error: Failed to open input file for reading!\n");
-		goto cleanup;
+		if(file_peek_input(file_input_context, GZIP_MAGIC_LEN, &read_error))
+		{
+			compression = detect_compression(file_input_context->buffer + file_input_context->pos, file_input_context->avail - file_input_context->pos);
+		}
+		if(read_error)
+		{
+			CHECK_ABORT_REQUEST();
+			print_text(std_err, "Error: Failed to read from the input file!\n");
+			goto cleanup;
+		}
+		if((compression == COMPRESSION_ZSTD) || (compression == COMPRESSION_XZ))
+		{
+			print_text_fmt(std_err, "Error: Input is compressed with %s, but only gzip is supported!\n", (compression == COMPRESSION_ZSTD) ? "zstd" : "xz");
+			goto cleanup;
+		}
+		if((compression == COMPRESSION_GZIP) && options.flags.reverse)
+		{
+			print_text(std_err, "Error: Reverse mode can not be used with gzip-compressed input!\n");
+			goto cleanup;
+		}
 	}
 
-	if(!(file_input_context = alloc_file_input(input)))
+	if(compression == COMPRESSION_GZIP)
 	{
-		print_text(std_err, "Error: Failed to allocate file input context!\n");
-		goto cleanup;
+		if(!CreatePipe(&inflate_rd, &inflate_wr, NULL, IO_BUFF_SIZE_DISK))
+		{
+			print_text(std_err, "Error: Failed to create the decompression pipe!\n");
+			goto cleanup;
+		}
+		if(!((inflate_output_context = alloc_file_output(inflate_wr, FALSE, 0U, FALSE, FALSE, FALSE)) && (pipe_input_context = alloc_file_input(inflate_rd, options.buffer_size, FALSE, FALSE, FALSE))))
+		{
+			print_text(std_err, "Error: Failed to allocate file input context!\n");
+			goto cleanup;
+		}
+		if(!gzip_thread_start(&inflate_thread, FALSE, file_input_context, inflate_output_context, inflate_wr))
+		{
+			print_text(std_err, "Error: Failed to create the decompression thread!\n");
+			goto cleanup;
+		}
+		inflate_wr = NULL; /*owned by the thread now*/
 	}
 
 	if(EMPTY(output_file) && NOT_EMPTY(source_file) && (lstrcmpiW(source_file, L"-") != 0))
@@ -386,13 +1091,49 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 			print_text(std_err, "Error: Sorry, the write-protected file cannot be modified in-place!\n");
 			goto cleanup;
 		}
-		temp_file = generate_temp_file(temp_path = get_directory_part(source_file), &output);
+		async_output = (!options.sync_io) && (!options.force_sync);
+		if(resume)
+		{
+			if(temp_file = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR) * (lstrlenW(checkpoint->temp_file) + 1U)))
+			{
+				lstrcpyW((WCHAR*)temp_file, checkpoint->temp_file);
+				output = checkpoint_reopen(temp_file, async_output);
+			}
+		}
+		else
+		{
+			temp_file = generate_temp_file(temp_path = get_directory_part(source_file), &output, (options.direct_io ? IO_FLAGS_DIRECT_OUTPUT : 0U) | (async_output ? FILE_FLAG_OVERLAPPED : 0U));
+		}
 		if(EMPTY(temp_file))
 		{
 			CHECK_ABORT_REQUEST();
 			print_text(std_err, "Error: Failed to create temporary file!\n");
 			goto cleanup;
 		}
+		if(checkpoint)
+		{
+			lstrcpynW(checkpoint->temp_file, temp_file, CHECKPOINT_MAX_NAME + 1U);
+		}
+	}
+
+	if(options.undo_journal)
+	{
+		if(GetFileType(input) != FILE_TYPE_DISK)
+		{
+			print_text(std_err, "Error: The undo journal requires the input to be a regular file!\n");
+			goto cleanup;
+		}
+		if((journal = create_new_file(options.undo_journal)) == INVALID_HANDLE_VALUE)
+		{
+			/* an existing journal may be the only record of an earlier modification */
+			print_text(std_err, (GetLastError() == ERROR_FILE_EXISTS) ? "Error: The undo journal already exists and will not be overwritten!\n" : "Error: Failed to create the undo journal!\n");
+			goto cleanup;
+		}
+		if(!(journal_output_context = alloc_file_output(journal, FALSE, 0U, FALSE, FALSE, FALSE)))
+		{
+			print_text(std_err, "Error: Failed to allocate file output context!\n");
+			goto cleanup;
+		}
 	}
 
 	if(EMPTY(temp_file))
@@ -403,7 +1144,8 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 			{
 				clear_readonly_attribute(output_file);
 			}
-			output = open_file(output_file, TRUE);
+			async_output = (!options.sync_io) && (!options.force_sync);
+			output = resume ? checkpoint_reopen(output_file, async_output) : open_file_async(output_file, TRUE, options.direct_io ? IO_FLAGS_DIRECT_OUTPUT : 0U, &async_output);
 		}
 		else
 		{
@@ -422,12 +1164,73 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 		goto cleanup;
 	}
 
-	if(!(file_output_context = alloc_file_output(output, options.force_sync)))
+	if(!(file_output_context = alloc_file_output(output, options.force_sync, options.buffer_size, options.direct_io && (output != std_out) && (GetFileType(output) == FILE_TYPE_DISK), async_output, large_pages)))
 	{
 		print_text(std_err, "Error: Failed to allocate file output context!\n");
 		goto cleanup;
 	}
 
+	if(checkpoint)
+	{
+		if(resume && (!checkpoint_seek(checkpoint, file_input_context, file_output_context)))
+		{
+			print_text(std_err, "Error: Failed to resume the output file from the checkpoint!\n");
+			goto cleanup;
+		}
+		if(!(checkpoint_open(checkpoint, options.checkpoint) && checkpoint_save(checkpoint)))
+		{
+			print_text(std_err, "Error: Failed to write the checkpoint file!\n");
+			goto cleanup;
+		}
+	}
+
+	if((!(options.translate || options.flags.reverse || options.flags.normalize || options.decompress || options.compress || options.tar_mode || options.emit_patch || options.undo_journal || options.direct_io || checkpoint)) && (GetFileType(input) == FILE_TYPE_DISK) && (GetFileType(output) == FILE_TYPE_DISK))
+	{
+		skip_holes = extents_is_sparse(input) && extents_can_skip_holes(needle_expanded, needle_len);
+		if(NOT_EMPTY(temp_file) && (replacement_len == needle_len) && (!options.flags.dry_run) && GetFileSizeEx(input, &input_size))
+		{
+			if(!(cloned = extents_clone(input, output, (ULONGLONG)input_size.QuadPart)))
+			{
+				if(!extents_clone_revert(output))
+				{
+					print_text(std_err, "Error: Failed to truncate the temporary file!\n");
+					goto cleanup;
+				}
+			}
+		}
+		sparse = (!cloned) && skip_holes && extents_set_sparse(output);
+	}
+
+	if(options.compress || (compression == COMPRESSION_GZIP))
+	{
+		if(!CreatePipe(&deflate_rd, &deflate_wr, NULL, IO_BUFF_SIZE_DISK))
+		{
+			print_text(std_err, "Error: Failed to create the compression pipe!\n");
+			goto cleanup;
+		}
+		if(!((deflate_input_context = alloc_file_input(deflate_rd, 0U, FALSE, FALSE, FALSE)) && (pipe_output_context = alloc_file_output(deflate_wr, FALSE, options.buffer_size, FALSE, FALSE, FALSE))))
+		{
+			print_text(std_err, "Error: Failed to allocate file output context!\n");
+			goto cleanup;
+		}
+		if(!gzip_thread_start(&deflate_thread, TRUE, deflate_input_context, file_output_context, NULL))
+		{
+			print_text(std_err, "Error: Failed to create the compression thread!\n");
+			goto cleanup;
+		}
+	}
+
+	if(options.direct_io && (!options.flags.dry_run) && (!options.emit_patch) && (!deflate_thread.thread) && (GetFileType(input) == FILE_TYPE_DISK) && (GetFileType(output) == FILE_TYPE_DISK))
+	{
+		if(!(GetFileSizeEx(input, &input_size) && (input_size.QuadPart > 0LL) && preallocate_file_output(file_output_context, (ULONGLONG)input_size.QuadPart)))
+		{
+			if(options.flags.verbose)
+			{
+				print_text(std_err, "Failed to preallocate the output file, continuing anyway.\n");
+			}
+		}
+	}
+
 	/* -------------------------------------------------------- */
 	/* Set up terminal                                          */
 	/* -------------------------------------------------------- */
@@ -448,12 +1251,182 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 	/* Search & replace!                                        */
 	/* -------------------------------------------------------- */
 
+	if(options.flags.verbose)
+	{
+		print_text_fmt(std_err, "Using I/O buffers of %lu KiB (input) and %lu KiB (output).\n", file_input_context->buffer_size >> 10U, file_output_context->buffer_size >> 10U);
+		if(options.direct_io)
+		{
+			print_text_fmt(std_err, "Direct I/O: input is %s, output is %s%s, large pages are %s.\n", file_input_context->unbuffered ? "unbuffered" : "buffered", file_output_context->unbuffered ? "unbuffered" : "buffered",
+				file_output_context->preallocated ? " (preallocated)" : "", large_pages ? "enabled" : "not available");
+		}
+		print_text_fmt(std_err, "Asynchronous I/O: input is %s, output is %s.\n", file_input_context->async ? "overlapped" : "synchronous", file_output_context->async ? "overlapped" : "synchronous");
+		if(options.group_commit)
+		{
+			print_text(std_err, "Group commit: the output is synced once, after it has been completed.\n");
+		}
+		if(cloned)
+		{
+			print_text(std_err, "The temporary file is a block clone, only the blocks with matches are rewritten.\n");
+		}
+		if(skip_holes)
+		{
+			print_text_fmt(std_err, "The input is a sparse file, holes are skipped%s.\n", sparse ? " and preserved in the output" : "");
+		}
+		if(inflate_thread.thread)
+		{
+			print_text(std_err, "Decompressing gzip input on a worker thread.\n");
+		}
+		if(deflate_thread.thread)
+		{
+			print_text(std_err, "Compressing output with gzip on a worker thread.\n");
+		}
+		if(options.emit_patch)
+		{
+			print_text(std_err, "Writing an edit list (patch) instead of the modified data.\n");
+		}
+		if(options.undo_journal)
+		{
+			print_text(std_err, "Recording the original bytes of each match in the undo journal.\n");
+		}
+		if(checkpoint)
+		{
+			print_text_fmt(std_err, "Recording a checkpoint after every %lu KiB of input.\n", (file_input_context->buffer_size >> 10U) * CHECKPOINT_INTERVAL);
+		}
+	}
+
 	init_logging_functions(&logger, print_text_ptr, (DWORD_PTR)std_err);
-	init_io_functions(&io_functions, file_read_byte, file_write_byte, (DWORD_PTR)file_input_context, (DWORD_PTR)file_output_context);
+	init_io_functions(&io_functions, file_read_byte, file_write_byte, (DWORD_PTR)(pipe_input_context ? pipe_input_context : file_input_context), (DWORD_PTR)(pipe_output_context ? pipe_output_context : file_output_context));
+	init_io_bulk_functions(&io_functions, file_read_bulk, file_write_bulk);
+	init_io_gather_function(&io_functions, file_write_gather);
+	init_io_view_function(&io_functions, file_read_view);
+	if((!pipe_input_context) && (GetFileType(input) == FILE_TYPE_DISK))
+	{
+		init_io_seek_functions(&io_functions, file_read_at, file_get_size);
+	}
 
 	CHECK_ABORT_REQUEST();
 
-	if(!libreplace_search_and_replace(&io_functions, &logger, needle_expanded, needle_len, replacement, replacement_len, &options.flags, &replacement_count, &g_abort_requested))
+	if(options.tar_mode)
+	{
+		SecureZeroMemory(&tar_params, sizeof(tar_replace_t));
+		tar_params.flags = &options.flags;
+		tar_params.filter = tar_filter;
+		tar_params.same_size = (needle_len == replacement_len) && (!options.flags.normalize);
+		if(options.translate)
+		{
+			tar_params.translation_table = translation_table;
+		}
+		else if(!((pattern = libreplace_pattern_compile_template(&logger, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags)) && (tar_params.context = context = libreplace_context_create(pattern))))
+		{
+			print_text(std_err, "Error: Failed to compile the search pattern!\n");
+			goto cleanup;
+		}
+		if(!tar_process(&io_functions, &logger, &tar_params, &replacement_count, &error_message, &g_abort_requested))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text_fmt(std_err, "Error: %s\n", error_message ? error_message : "Something went wrong. Output probably is incomplete!");
+			goto cleanup;
+		}
+	}
+	else if(cloned || sparse)
+	{
+		if(!((pattern = libreplace_pattern_compile_template(&logger, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags)) && (context = libreplace_context_create(pattern))))
+		{
+			print_text(std_err, "Error: Failed to compile the search pattern!\n");
+			goto cleanup;
+		}
+		if(cloned)
+		{
+			if(!extents_rewriter_init(&rewriter, extents_write_at, (DWORD_PTR)output, needle_expanded, needle_len, replacement_expanded, replacement_len))
+			{
+				print_text(std_err, "Error: Failed to allocate the replacement buffer!\n");
+				goto cleanup;
+			}
+			libreplace_context_set_callback(context, extents_rewriter_match, (DWORD_PTR)&rewriter);
+		}
+		if(!extents_process(context, file_input_context, cloned ? NULL : file_output_context, skip_holes, needle_len - 1U, &logger, &replacement_count, &g_abort_requested))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text(std_err, "Error: Something went wrong. Output probably is incomplete!\n");
+			goto cleanup;
+		}
+	}
+	else if(checkpoint)
+	{
+		if(!((pattern = libreplace_pattern_compile_template(&logger, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags)) && (context = libreplace_context_create(pattern))))
+		{
+			print_text(std_err, "Error: Failed to compile the search pattern!\n");
+			goto cleanup;
+		}
+		if(!checkpoint_process(checkpoint, context, file_input_context, file_output_context, &logger, &replacement_count, &g_abort_requested))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text(std_err, "Error: Something went wrong. Output probably is incomplete!\n");
+			goto cleanup;
+		}
+	}
+	else if(options.emit_patch)
+	{
+		patch_output.func_write = file_write_bulk;
+		patch_output.context = (DWORD_PTR)file_output_context;
+		if(!((pattern = libreplace_pattern_compile_template(&logger, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags)) && (context = libreplace_context_create(pattern))))
+		{
+			print_text(std_err, "Error: Failed to compile the search pattern!\n");
+			goto cleanup;
+		}
+		if(!patch_writer_init(&patch_writer, &patch_output, needle_expanded, needle_len, replacement_expanded, replacement_len))
+		{
+			print_text(std_err, "Error: Failed to write to the output file!\n");
+			goto cleanup;
+		}
+		/* the unmodified data is only counted, the matches are recorded by the callback */
+		libreplace_context_set_callback(context, patch_writer_match, (DWORD_PTR)&patch_writer);
+		io_functions.func_wr = patch_writer_skip_byte;
+		io_functions.func_wr_bulk = patch_writer_skip_bulk;
+		io_functions.func_wr_gather = NULL;
+		io_functions.context_wr = (DWORD_PTR)&patch_writer;
+		if(!libreplace_context_run(context, &io_functions, &logger, &replacement_count, &g_abort_requested))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text(std_err, "Error: Something went wrong. Output probably is incomplete!\n");
+			goto cleanup;
+		}
+		if(!(patch_writer_finish(&patch_writer) && file_write_byte(LIBREPLACE_FLUSH, (DWORD_PTR)file_output_context)))
+		{
+			print_text(std_err, "Error: Failed to write to the output file!\n");
+			goto cleanup;
+		}
+	}
+	else if(options.undo_journal)
+	{
+		patch_output.func_write = file_write_bulk;
+		patch_output.context = (DWORD_PTR)journal_output_context;
+		if(!((pattern = libreplace_pattern_compile_template(&logger, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags)) && (context = libreplace_context_create(pattern))))
+		{
+			print_text(std_err, "Error: Failed to compile the search pattern!\n");
+			goto cleanup;
+		}
+		if(!patch_journal_init(&patch_writer, &patch_output, &io_functions, needle_expanded, needle_len, replacement_expanded, replacement_len))
+		{
+			print_text(std_err, "Error: Failed to write to the undo journal!\n");
+			goto cleanup;
+		}
+		/* the callback writes the replacement, and records the original bytes in the journal; the modified data is checksummed on its way to the output */
+		libreplace_context_set_callback(context, patch_writer_match, (DWORD_PTR)&patch_writer);
+		if(!libreplace_context_run(context, &io_functions, &logger, &replacement_count, &g_abort_requested))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text(std_err, "Error: Something went wrong. Output probably is incomplete!\n");
+			goto cleanup;
+		}
+		/* the journal must be durable before the original file is replaced */
+		if(!(GetFileSizeEx(input, &input_size) && patch_journal_finish(&patch_writer, (ULONGLONG)input_size.QuadPart) && file_write_byte(LIBREPLACE_FLUSH, (DWORD_PTR)journal_output_context) && sync_file(journal)))
+		{
+			print_text(std_err, "Error: Failed to write to the undo journal!\n");
+			goto cleanup;
+		}
+	}
+	else if(!(options.translate ? libreplace_translate(&io_functions, &logger, translation_table, &options.flags, &replacement_count, &g_abort_requested) : libreplace_search_and_replace_template(&io_functions, &logger, needle_expanded, needle_len, replacement_expanded, replacement_len, &options.flags, &replacement_count, &g_abort_requested)))
 	{
 		CHECK_ABORT_REQUEST();
 		print_text(std_err, "Error: Something went wrong. Output probably is incomplete!\n");
@@ -462,10 +1435,47 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 
 	CHECK_ABORT_REQUEST();
 
+	if(deflate_thread.thread)
+	{
+		free_file_output(pipe_output_context); /*already flushed by the library*/
+		pipe_output_context = NULL;
+		CloseHandle(deflate_wr);
+		deflate_wr = NULL;
+		if(!gzip_thread_join(&deflate_thread))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text_fmt(std_err, "Error: %s\n", deflate_thread.error_message ? deflate_thread.error_message : "Failed to compress the output!");
+			goto cleanup;
+		}
+	}
+
+	if(inflate_thread.thread)
+	{
+		if(!gzip_thread_join(&inflate_thread))
+		{
+			CHECK_ABORT_REQUEST();
+			print_text_fmt(std_err, "Error: %s\n", inflate_thread.error_message ? inflate_thread.error_message : "Failed to decompress the input!");
+			goto cleanup;
+		}
+	}
+
+	/* the output must be durable, before the original file is replaced */
+	if((options.group_commit || (cloned && options.force_sync)) && (!commit_file(output)))
+	{
+		print_text(std_err, "Error: Failed to flush the file buffers!\n");
+		goto cleanup;
+	}
+
 	/* -------------------------------------------------------- */
 	/* Finishing touch                                          */
 	/* -------------------------------------------------------- */
 
+	free_file_input(file_input_context);
+	file_input_context = NULL;
+
+	free_file_output(file_output_context);
+	file_output_context = NULL;
+
 	if(input != std_inp)
 	{
 		CloseHandle(input);
@@ -490,6 +1500,14 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 			print_text(std_err, "Error: Failed to replace the original file with modified one!\n");
 			goto cleanup;
 		}
+		journal_committed = TRUE;
+	}
+
+	if(checkpoint)
+	{
+		checkpoint_free(checkpoint); /*the run is complete*/
+		checkpoint = NULL;
+		delete_file(options.checkpoint);
 	}
 
 	result = options.return_replace_count ? ((replacement_count <= ((DWORD)MAXINT32)) ? replacement_count : MAXINT32) : EXIT_SUCCESS;
@@ -500,6 +1518,43 @@ REPLACE_MAIN(UINT, const int argc, LPCWSTR *const argv)
 
 cleanup:
 
+	if(options.flags.verbose && (g_sync_count > 0L))
+	{
+		print_text_fmt(std_err, "File buffers were synced %ld time(s).\n", g_sync_count);
+	}
+
+	if(inflate_rd)
+	{
+		CloseHandle(inflate_rd); /*unblocks the decompression thread*/
+		inflate_rd = NULL;
+	}
+
+	free_file_output(pipe_output_context);
+
+	if(deflate_wr)
+	{
+		CloseHandle(deflate_wr); /*unblocks the compression thread*/
+	}
+
+	gzip_thread_join(&inflate_thread);
+	gzip_thread_join(&deflate_thread);
+
+	free_file_input(pipe_input_context);
+	free_file_output(inflate_output_context);
+	free_file_input(deflate_input_context);
+	free_file_input(file_input_context);
+	free_file_output(file_output_context);
+
+	if(inflate_wr)
+	{
+		CloseHandle(inflate_wr);
+	}
+
+	if(deflate_rd)
+	{
+		CloseHandle(deflate_rd);
+	}
+
 	if((input != INVALID_HANDLE_VALUE) && (input != std_inp))
 	{
 		CloseHandle(input);
@@ -510,11 +1565,37 @@ cleanup:
 		CloseHandle(output);
 	}
 
-	if(NOT_EMPTY(temp_file) && file_exists(temp_file))
+	if(checkpoint && (checkpoint->handle != INVALID_HANDLE_VALUE))
+	{
+		print_text(std_err, "The partial output was kept, the run can be resumed from the checkpoint.\n");
+	}
+	else if(NOT_EMPTY(temp_file) && file_exists(temp_file))
 	{
 		delete_file(temp_file);
 	}
 
+	checkpoint_free(checkpoint);
+	free_file_output(journal_output_context);
+
+	if(journal != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(journal);
+		if(!journal_committed)
+		{
+			delete_file(options.undo_journal); /*the original file was not modified*/
+		}
+	}
+
+	patch_writer_free(&patch_writer);
+	patch_writer_free(&rewriter.writer);
+	libreplace_context_free(context);
+	libreplace_pattern_free(pattern);
+
+	if(tar_filter)
+	{
+		LocalFree((HLOCAL)tar_filter);
+	}
+
 	if(needle)
 	{
 		LocalFree((HLOCAL)needle);
@@ -525,6 +1606,11 @@ cleanup:
 		LocalFree((HLOCAL)needle_expanded);
 	}
 
+	if(replacement_expanded)
+	{
+		LocalFree((HLOCAL)replacement_expanded);
+	}
+
 	if(replacement)
 	{
 		LocalFree((HLOCAL)replacement);
@@ -540,16 +1626,6 @@ cleanup:
 		LocalFree((HLOCAL)temp_path);
 	}
 
-	if(file_input_context)
-	{
-		LocalFree((HLOCAL)file_input_context);
-	}
-
-	if(file_output_context)
-	{
-		LocalFree((HLOCAL)file_output_context);
-	}
-
 	if(previous_output_cp)
 	{
 		SetConsoleOutputCP(previous_output_cp);
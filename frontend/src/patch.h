@@ -0,0 +1,536 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#ifndef INC_PATCH_H
+#define INC_PATCH_H
+
+#include "libreplace/replace.h"
+#include "utils.h"
+#include "gzip.h"
+
+/*
+ * Edit lists ("patches"), so that the changes to a huge file can be shipped
+ * and applied with O(matches) writes. A patch starts with an 8-byte signature,
+ * followed by one record per match, in ascending order of the offsets:
+ *
+ *   offset (64-Bit), removed length (32-Bit), inserted length (32-Bit), inserted bytes
+ *
+ * The last record has the offset 0xFFFFFFFFFFFFFFFF and no data, followed by
+ * the sizes of the source and of the target file (64-Bit each) and the CRC-32
+ * of the source file (32-Bit). All numbers are stored in little-endian byte
+ * order. The source is verified before anything is written, as a different
+ * (or an already patched) file of the same size would be silently corrupted.
+ *
+ * An undo journal is an edit list in the opposite direction: it is written
+ * while the file is modified, and records the original bytes of each match
+ * at its offset in the modified file.
+ */
+
+#define PATCH_SIGNATURE_LEN 8U
+#define PATCH_RECORD_LEN 16U
+#define PATCH_TRAILER_LEN 20U
+#define PATCH_END_OFFSET MAXULONGLONG
+#define PATCH_MAX_CAPTURES 9U
+
+static const BYTE PATCH_SIGNATURE[PATCH_SIGNATURE_LEN] = { 'R', 'P', 'L', 'P', 'A', 'T', 'C', 'H' };
+
+typedef struct patch_writer_t
+{
+	libreplace_sink_t output;
+	const WORD *replacement;
+	DWORD replacement_len;
+	DWORD captures[PATCH_MAX_CAPTURES]; /*needle position of each wildcard*/
+	BYTE *buffer;
+	ULONGLONG copied, removed, inserted;
+	DWORD edit_count;
+	BOOL journal;
+	DWORD source_crc; /*of the input, or of the modified output when writing an undo journal*/
+	libreplace_io_t forward; /*the output of the modified file, when writing an undo journal*/
+	DWORD crc_table[256U];
+}
+patch_writer_t;
+
+typedef struct patch_t
+{
+	const BYTE *data;
+	DWORD length;
+	ULONGLONG source_size, target_size;
+	DWORD source_crc;
+	DWORD edit_count;
+	BOOL same_length; /*no edit changes the length, so the patch can be applied in-place*/
+}
+patch_t;
+
+/* ======================================================================= */
+/* Encoding                                                                */
+/* ======================================================================= */
+
+static void patch_store_number(BYTE *const buffer, ULONGLONG value, const DWORD length)
+{
+	DWORD pos;
+	for(pos = 0U; pos < length; ++pos)
+	{
+		buffer[pos] = (BYTE)(value & 0xFFU);
+		value >>= 8;
+	}
+}
+
+static ULONGLONG patch_load_number(const BYTE *const buffer, const DWORD length)
+{
+	ULONGLONG value = 0U;
+	DWORD pos;
+	for(pos = length; pos > 0U; --pos)
+	{
+		value = (value << 8) | buffer[pos - 1U];
+	}
+	return value;
+}
+
+static BOOL patch_write_record(patch_writer_t *const ctx, const ULONGLONG offset, const DWORD removed, const DWORD inserted)
+{
+	BYTE record[PATCH_RECORD_LEN];
+	patch_store_number(record, offset, 8U);
+	patch_store_number(record + 8U, removed, 4U);
+	patch_store_number(record + 12U, inserted, 4U);
+	return ctx->output.func_write(record, PATCH_RECORD_LEN, ctx->output.context);
+}
+
+/* ======================================================================= */
+/* Writer                                                                  */
+/* ======================================================================= */
+
+/* prepares the expansion of the replacement, without writing anything yet */
+static BOOL patch_writer_setup(patch_writer_t *const ctx, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len)
+{
+	DWORD pos, capture_count = 0U;
+	SecureZeroMemory(ctx, sizeof(patch_writer_t));
+
+	for(pos = 0U; (pos < needle_len) && (capture_count < PATCH_MAX_CAPTURES); ++pos)
+	{
+		if(needle[pos] == LIBREPLACE_WILDCARD)
+		{
+			ctx->captures[capture_count++] = pos;
+		}
+	}
+
+	if(!(ctx->buffer = (BYTE*) LocalAlloc(LPTR, replacement_len + 1U)))
+	{
+		return FALSE;
+	}
+
+	gzip_crc32_init(ctx->crc_table);
+	ctx->replacement = replacement;
+	ctx->replacement_len = replacement_len;
+	return TRUE;
+}
+
+static BOOL patch_writer_init(patch_writer_t *const ctx, const libreplace_sink_t *const output, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len)
+{
+	if(!patch_writer_setup(ctx, needle, needle_len, replacement, replacement_len))
+	{
+		return FALSE;
+	}
+	ctx->output = *output;
+	return ctx->output.func_write(PATCH_SIGNATURE, PATCH_SIGNATURE_LEN, ctx->output.context);
+}
+
+/* the modified data is passed through the writer on its way to the output, so that the checksum of the modified file can be computed */
+static __inline BOOL patch_journal_write_byte(const WORD input, const DWORD_PTR output)
+{
+	patch_writer_t *const ctx = (patch_writer_t*) output;
+	if(input != LIBREPLACE_FLUSH)
+	{
+		const BYTE value = (BYTE)input;
+		ctx->source_crc = gzip_crc32_update(ctx->crc_table, ctx->source_crc, &value, 1U);
+	}
+	return ctx->forward.func_wr(input, ctx->forward.context_wr);
+}
+
+static BOOL patch_journal_write_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR output)
+{
+	patch_writer_t *const ctx = (patch_writer_t*) output;
+	ctx->source_crc = gzip_crc32_update(ctx->crc_table, ctx->source_crc, data, data_len);
+	return ctx->forward.func_wr_bulk(data, data_len, ctx->forward.context_wr);
+}
+
+static BOOL patch_journal_write_gather(const libreplace_span_t *const spans, const DWORD span_count, const DWORD_PTR output)
+{
+	patch_writer_t *const ctx = (patch_writer_t*) output;
+	DWORD pos;
+	for(pos = 0U; pos < span_count; ++pos)
+	{
+		ctx->source_crc = gzip_crc32_update(ctx->crc_table, ctx->source_crc, spans[pos].data, spans[pos].length);
+	}
+	return ctx->forward.func_wr_gather(spans, span_count, ctx->forward.context_wr);
+}
+
+/* redirects the output functions of '<io_functions>' through the writer */
+static BOOL patch_journal_init(patch_writer_t *const ctx, const libreplace_sink_t *const output, libreplace_io_t *const io_functions, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len)
+{
+	if(!patch_writer_init(ctx, output, needle, needle_len, replacement, replacement_len))
+	{
+		return FALSE;
+	}
+	ctx->journal = TRUE;
+	ctx->forward = *io_functions;
+	io_functions->func_wr = patch_journal_write_byte;
+	io_functions->func_wr_bulk = io_functions->func_wr_bulk ? patch_journal_write_bulk : NULL;
+	io_functions->func_wr_gather = io_functions->func_wr_gather ? patch_journal_write_gather : NULL;
+	io_functions->context_wr = (DWORD_PTR)ctx;
+	return TRUE;
+}
+
+static void patch_writer_free(patch_writer_t *const ctx)
+{
+	if(ctx->buffer)
+	{
+		LocalFree((HLOCAL)ctx->buffer);
+		ctx->buffer = NULL;
+	}
+}
+
+/* fills in the captured bytes of the match, the expanded replacement is stored in the buffer */
+static void patch_writer_expand(patch_writer_t *const ctx, const BYTE *const match)
+{
+	DWORD pos;
+	for(pos = 0U; pos < ctx->replacement_len; ++pos)
+	{
+		const WORD value = ctx->replacement[pos];
+		ctx->buffer[pos] = (value >= LIBREPLACE_CAPTURE(0U)) ? match[ctx->captures[value - LIBREPLACE_CAPTURE(0U)]] : ((BYTE)value);
+	}
+}
+
+/* match callback: records the edit, instead of writing the replacement (unless writing an undo journal) */
+static BOOL patch_writer_match(const BYTE *const match, const DWORD match_len, const ULONGLONG offset, const DWORD ordinal, const libreplace_sink_t *const output, const DWORD_PTR context)
+{
+	patch_writer_t *const ctx = (patch_writer_t*) context;
+	patch_writer_expand(ctx, match);
+	UNUSED_PARAM(ordinal);
+	if(ctx->journal)
+	{
+		if(!(((ctx->replacement_len < 1U) || output->func_write(ctx->buffer, ctx->replacement_len, output->context)) && patch_write_record(ctx, (offset - ctx->inserted) + ctx->removed, ctx->replacement_len, match_len)))
+		{
+			return FALSE;
+		}
+		ctx->removed += ctx->replacement_len;
+		ctx->inserted += match_len;
+		ctx->edit_count++;
+		return ctx->output.func_write(match, match_len, ctx->output.context);
+	}
+	ctx->source_crc = gzip_crc32_update(ctx->crc_table, ctx->source_crc, match, match_len);
+	ctx->removed += match_len;
+	ctx->inserted += ctx->replacement_len;
+	ctx->edit_count++;
+	return patch_write_record(ctx, offset, match_len, ctx->replacement_len) && ((ctx->replacement_len < 1U) || ctx->output.func_write(ctx->buffer, ctx->replacement_len, ctx->output.context));
+}
+
+/* the unmodified data is not written, only counted and checksummed */
+static __inline BOOL patch_writer_skip_byte(const WORD input, const DWORD_PTR output)
+{
+	patch_writer_t *const ctx = (patch_writer_t*) output;
+	if(input != LIBREPLACE_FLUSH)
+	{
+		const BYTE value = (BYTE)input;
+		ctx->source_crc = gzip_crc32_update(ctx->crc_table, ctx->source_crc, &value, 1U);
+		ctx->copied++;
+	}
+	return TRUE;
+}
+
+static BOOL patch_writer_skip_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR output)
+{
+	patch_writer_t *const ctx = (patch_writer_t*) output;
+	ctx->source_crc = gzip_crc32_update(ctx->crc_table, ctx->source_crc, data, data_len);
+	ctx->copied += data_len;
+	return TRUE;
+}
+
+static BOOL patch_writer_finish(patch_writer_t *const ctx)
+{
+	BYTE trailer[PATCH_TRAILER_LEN];
+	patch_store_number(trailer, ctx->copied + ctx->removed, 8U);
+	patch_store_number(trailer + 8U, ctx->copied + ctx->inserted, 8U);
+	patch_store_number(trailer + 16U, ctx->source_crc, 4U);
+	return patch_write_record(ctx, PATCH_END_OFFSET, 0U, 0U) && ctx->output.func_write(trailer, PATCH_TRAILER_LEN, ctx->output.context);
+}
+
+/* the unmodified data of an undo journal is not counted, so it is derived from the size of the original file */
+static BOOL patch_journal_finish(patch_writer_t *const ctx, const ULONGLONG original_size)
+{
+	if(original_size < ctx->inserted)
+	{
+		return FALSE;
+	}
+	ctx->copied = original_size - ctx->inserted;
+	return patch_writer_finish(ctx);
+}
+
+/* ======================================================================= */
+/* Reader                                                                  */
+/* ======================================================================= */
+
+/* loads the whole patch into memory; the edit list is small compared to the file it applies to */
+static BYTE *patch_load(const WCHAR *const file_name, DWORD *const length)
+{
+	BYTE *data = NULL;
+	DWORD offset, bytes_read = 0U;
+	LARGE_INTEGER file_size;
+	const HANDLE handle = open_file(file_name, FALSE, 0U);
+
+	if(handle == INVALID_HANDLE_VALUE)
+	{
+		return NULL;
+	}
+
+	if(!(GetFileSizeEx(handle, &file_size) && (file_size.QuadPart > 0LL) && (file_size.QuadPart < ((LONGLONG)MAXDWORD))))
+	{
+		goto cleanup;
+	}
+
+	if(!(data = (BYTE*) LocalAlloc(LPTR, (DWORD)file_size.QuadPart)))
+	{
+		goto cleanup;
+	}
+
+	for(offset = 0U; offset < (DWORD)file_size.QuadPart; offset += bytes_read)
+	{
+		if(!(ReadFile(handle, data + offset, ((DWORD)file_size.QuadPart) - offset, &bytes_read, NULL) && (bytes_read > 0U)))
+		{
+			LocalFree((HLOCAL)data);
+			data = NULL;
+			goto cleanup;
+		}
+	}
+
+	*length = (DWORD)file_size.QuadPart;
+
+cleanup:
+	CloseHandle(handle);
+	return data;
+}
+
+/* reads the edit at '<pos>' and advances '<pos>'; returns FALSE after the last edit */
+static BOOL patch_next(const patch_t *const patch, DWORD *const pos, ULONGLONG *const offset, DWORD *const removed, DWORD *const inserted, const BYTE **const data)
+{
+	*offset = patch_load_number(patch->data + *pos, 8U);
+	if(*offset == PATCH_END_OFFSET)
+	{
+		return FALSE;
+	}
+	*removed = (DWORD) patch_load_number(patch->data + *pos + 8U, 4U);
+	*inserted = (DWORD) patch_load_number(patch->data + *pos + 12U, 4U);
+	*data = patch->data + *pos + PATCH_RECORD_LEN;
+	*pos += PATCH_RECORD_LEN + *inserted;
+	return TRUE;
+}
+
+/* checks the whole patch up-front, so that an invalid patch is never applied partially */
+static BOOL patch_parse(patch_t *const patch, const BYTE *const data, const DWORD length)
+{
+	DWORD pos = PATCH_SIGNATURE_LEN, removed, inserted;
+	ULONGLONG offset, end = 0U, removed_total = 0U, inserted_total = 0U;
+	const BYTE *inserted_data;
+
+	SecureZeroMemory(patch, sizeof(patch_t));
+	patch->data = data;
+	patch->length = length;
+	patch->same_length = TRUE;
+
+	if(length < PATCH_SIGNATURE_LEN + PATCH_RECORD_LEN + PATCH_TRAILER_LEN)
+	{
+		return FALSE;
+	}
+	for(pos = 0U; pos < PATCH_SIGNATURE_LEN; ++pos)
+	{
+		if(data[pos] != PATCH_SIGNATURE[pos])
+		{
+			return FALSE;
+		}
+	}
+
+	for(;;)
+	{
+		if(PATCH_RECORD_LEN > length - pos)
+		{
+			return FALSE;
+		}
+		if(patch_load_number(data + pos, 8U) != PATCH_END_OFFSET)
+		{
+			inserted = (DWORD) patch_load_number(data + pos + 12U, 4U);
+			if(inserted > length - pos - PATCH_RECORD_LEN)
+			{
+				return FALSE;
+			}
+		}
+		if(!patch_next(patch, &pos, &offset, &removed, &inserted, &inserted_data))
+		{
+			break;
+		}
+		if((offset < end) || (removed > PATCH_END_OFFSET - offset))
+		{
+			return FALSE; /*edits must not overlap*/
+		}
+		end = offset + removed;
+		removed_total += removed;
+		inserted_total += inserted;
+		patch->same_length = patch->same_length && (removed == inserted);
+		patch->edit_count++;
+	}
+
+	if((patch_load_number(data + pos + 8U, 8U) != 0U) || (length - pos != PATCH_RECORD_LEN + PATCH_TRAILER_LEN))
+	{
+		return FALSE;
+	}
+	patch->source_size = patch_load_number(data + pos + PATCH_RECORD_LEN, 8U);
+	patch->target_size = patch_load_number(data + pos + PATCH_RECORD_LEN + 8U, 8U);
+	patch->source_crc = (DWORD) patch_load_number(data + pos + PATCH_RECORD_LEN + 16U, 4U);
+	return (end <= patch->source_size) && (patch->target_size == (patch->source_size - removed_total) + inserted_total);
+}
+
+/* ======================================================================= */
+/* Apply                                                                   */
+/* ======================================================================= */
+
+/* reads the whole source once, before the first write; a file of the same size may still be a different (or an already patched) file */
+static BOOL patch_check_source(const patch_t *const patch, const libreplace_rd_at_func_t read_at, const DWORD_PTR context, BYTE *const buffer, const DWORD buffer_size, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	DWORD bytes_read, crc = 0U, crc_table[256U];
+	ULONGLONG source_pos;
+
+	gzip_crc32_init(crc_table);
+	for(source_pos = 0U; source_pos < patch->source_size; source_pos += bytes_read)
+	{
+		if(*abort_flag)
+		{
+			return FALSE;
+		}
+		if(!(read_at(buffer, (patch->source_size - source_pos < buffer_size) ? ((DWORD)(patch->source_size - source_pos)) : buffer_size, source_pos, &bytes_read, context) && (bytes_read > 0U)))
+		{
+			*error_message = "Failed to read from the input file!";
+			return FALSE;
+		}
+		crc = gzip_crc32_update(crc_table, crc, buffer, bytes_read);
+	}
+
+	if(crc != patch->source_crc)
+	{
+		*error_message = "The content of the input file does not match the patch!";
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL patch_file_read_at(BYTE *const buffer, const DWORD buffer_size, const ULONGLONG offset, DWORD *const bytes_read, const DWORD_PTR context)
+{
+	OVERLAPPED overlapped;
+	SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = (DWORD)(offset & MAXDWORD);
+	overlapped.OffsetHigh = (DWORD)(offset >> 32U);
+	return ReadFile((HANDLE)context, buffer, buffer_size, bytes_read, &overlapped);
+}
+
+/* writes the target by copying the unmodified ranges of the source in bulk, using positioned reads */
+static BOOL patch_apply_copy(const patch_t *const patch, const libreplace_io_t *const io_functions, BYTE *const buffer, const DWORD buffer_size, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	DWORD pos = PATCH_SIGNATURE_LEN, removed, inserted, bytes_read;
+	ULONGLONG offset, source_pos = 0U, limit, source_size;
+	const BYTE *inserted_data;
+	BOOL more = TRUE;
+
+	if(!(io_functions->func_get_size(&source_size, io_functions->context_rd) && (source_size == patch->source_size)))
+	{
+		*error_message = "The size of the input file does not match the patch!";
+		return FALSE;
+	}
+
+	if(!patch_check_source(patch, io_functions->func_rd_at, io_functions->context_rd, buffer, buffer_size, error_message, abort_flag))
+	{
+		return FALSE;
+	}
+
+	while(more)
+	{
+		if(!(more = patch_next(patch, &pos, &offset, &removed, &inserted, &inserted_data)))
+		{
+			offset = patch->source_size;
+			removed = inserted = 0U;
+		}
+		for(limit = offset; source_pos < limit; source_pos += bytes_read)
+		{
+			if(*abort_flag)
+			{
+				return FALSE;
+			}
+			if(!(io_functions->func_rd_at(buffer, (limit - source_pos < buffer_size) ? ((DWORD)(limit - source_pos)) : buffer_size, source_pos, &bytes_read, io_functions->context_rd) && (bytes_read > 0U)))
+			{
+				*error_message = "Failed to read from the input file!";
+				return FALSE;
+			}
+			if(!io_functions->func_wr_bulk(buffer, bytes_read, io_functions->context_wr))
+			{
+				*error_message = "Failed to write to the output file!";
+				return FALSE;
+			}
+		}
+		if((inserted > 0U) && (!io_functions->func_wr_bulk(inserted_data, inserted, io_functions->context_wr)))
+		{
+			*error_message = "Failed to write to the output file!";
+			return FALSE;
+		}
+		source_pos += removed;
+	}
+
+	if(!io_functions->func_wr(LIBREPLACE_FLUSH, io_functions->context_wr))
+	{
+		*error_message = "Failed to write to the output file!";
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* overwrites the changed ranges of the file, requires a patch where no edit changes the length; '<buffer>' is only used to verify the file */
+static BOOL patch_apply_in_place(const patch_t *const patch, const HANDLE file, BYTE *const buffer, const DWORD buffer_size, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	DWORD pos = PATCH_SIGNATURE_LEN, removed, inserted, bytes_written;
+	ULONGLONG offset;
+	LARGE_INTEGER file_size;
+	OVERLAPPED overlapped;
+	const BYTE *inserted_data;
+
+	if(!(GetFileSizeEx(file, &file_size) && (((ULONGLONG)file_size.QuadPart) == patch->source_size)))
+	{
+		*error_message = "The size of the input file does not match the patch!";
+		return FALSE;
+	}
+
+	if(!patch_check_source(patch, patch_file_read_at, (DWORD_PTR)file, buffer, buffer_size, error_message, abort_flag))
+	{
+		return FALSE;
+	}
+
+	while(patch_next(patch, &pos, &offset, &removed, &inserted, &inserted_data))
+	{
+		if(*abort_flag)
+		{
+			return FALSE;
+		}
+		if(inserted < 1U)
+		{
+			continue;
+		}
+		SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+		overlapped.Offset = (DWORD)(offset & MAXDWORD);
+		overlapped.OffsetHigh = (DWORD)(offset >> 32U);
+		if(!(WriteFile(file, inserted_data, inserted, &bytes_written, &overlapped) && (bytes_written == inserted)))
+		{
+			*error_message = "Failed to write to the file!";
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+#endif /*INC_PATCH_H*/
@@ -8,14 +8,20 @@
 
 #include "libreplace/replace.h"
 #include "utils.h"
+#include "gzip.h"
+#include "tar.h"
+#include "patch.h"
+#include "extents.h"
 
 /* ======================================================================= */
 /* Run a single test                                                       */
 /* ======================================================================= */
 
-#define RUN_TEST(X, ...) do \
+#define RUN_TEST(X, ...) RUN_TEST_EX(X, run_test, __VA_ARGS__)
+
+#define RUN_TEST_EX(X, FUNC, ...) do \
 { \
-	if(run_test(__VA_ARGS__)) \
+	if(FUNC(__VA_ARGS__)) \
 	{ \
 		print_text_fmt(log_output, "[Self-Test] Test case #%02ld succeeded.\n", (LONG)(X)); \
 	} \
@@ -31,44 +37,1385 @@
 } \
 while(0)
 
-static BOOL run_test(const BOOL dry_run, const BOOL case_insensitive, const BOOL globbing, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected)
+#define TEST_IO_BYTE   0U
+#define TEST_IO_BULK   1U
+#define TEST_IO_GATHER 2U
+#define TEST_IO_VIEW   3U
+#define TEST_IO_COUNT  4U
+
+/* hands out the input in pieces of varying length, so that matches span several views, and some views are shorter than the needle */
+static BOOL test_read_view(const BYTE **const data, const DWORD max_len, DWORD *const bytes_read, const DWORD_PTR input, BOOL *const error_flag)
+{
+	memory_input_t *const ctx = (memory_input_t*) input;
+	*data = ctx->data_in + ctx->pos;
+	*bytes_read = min(min(max_len, ctx->len - ctx->pos), (ctx->pos % 7U) + 1U);
+	ctx->pos += *bytes_read;
+	UNUSED_PARAM(error_flag);
+	return (*bytes_read > 0U);
+}
+
+/* byte-wise, bulk, gathered or in-place (view) I/O in pull mode */
+static void test_init_io(libreplace_io_t *const io_functions, const DWORD io_mode, memory_input_t *const input_context, memory_output_t *const output_context)
+{
+	init_io_functions(io_functions, memory_read_byte, memory_write_byte, (DWORD_PTR)input_context, (DWORD_PTR)output_context);
+	init_io_seek_functions(io_functions, memory_read_at, memory_get_size);
+	if(io_mode >= TEST_IO_BULK)
+	{
+		init_io_bulk_functions(io_functions, memory_read_bulk, memory_write_bulk);
+	}
+	if(io_mode >= TEST_IO_GATHER)
+	{
+		init_io_gather_function(io_functions, memory_write_gather);
+	}
+	if(io_mode >= TEST_IO_VIEW)
+	{
+		init_io_view_function(io_functions, test_read_view);
+	}
+}
+
+static BOOL compare_bytes(const BYTE *const output, const SIZE_T output_len, const BYTE *const expected, const SIZE_T expected_len)
+{
+	SIZE_T pos;
+	if(output_len != expected_len)
+	{
+		return FALSE;
+	}
+	for(pos = 0U; pos < output_len; ++pos)
+	{
+		if(output[pos] != expected[pos])
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL compare_output(const BYTE *const output, const SIZE_T output_len, const CHAR *const expected)
+{
+	return compare_bytes(output, output_len, (const BYTE*)expected, lstrlenA(expected));
+}
+
+static BOOL run_test_pass(const BOOL dry_run, const BOOL case_insensitive, const BOOL globbing, const BOOL normalize, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected, const BOOL reverse, const DWORD max_replacements, const ULONGLONG window_offset, const ULONGLONG window_length, const DWORD io_mode)
+{
+	BOOL success = FALSE;
+	memory_input_t input_context;
+	memory_output_t *output_context = NULL;
+	libreplace_io_t io_functions;
+	libreplace_flags_t options;
+	WORD *needle_expanded = NULL;
+	DWORD replacement_count = 0U;
+
+	const DWORD needle_len      = lstrlenA(needle);
+	const DWORD replacement_len = lstrlenA(replacement);
+	const DWORD expected_len    = lstrlenA(expected);
+
+	init_memory_input(&input_context, (const BYTE*)haystack, lstrlenA(haystack));
+	SecureZeroMemory(&options, sizeof(libreplace_flags_t));
+
+	options.dry_run = dry_run;
+	options.case_insensitive = case_insensitive;
+	options.normalize = normalize;
+	options.reverse = reverse;
+	options.max_replacements = max_replacements;
+	options.window_offset = window_offset;
+	options.window_length = window_length;
+
+	if(!(output_context = alloc_memory_output(expected_len + 2U)))
+	{
+		goto cleanup;
+	}
+
+	needle_expanded = expand_wildcards((BYTE*)needle, needle_len, globbing ? &MY_WILDCARD : NULL);
+	if(!needle_expanded)
+	{
+		goto cleanup;
+	}
+
+	test_init_io(&io_functions, io_mode, &input_context, output_context);
+
+	if(!libreplace_search_and_replace(&io_functions, NULL, needle_expanded, needle_len, (const BYTE*)replacement, replacement_len, &options, &replacement_count, &g_abort_requested))
+	{
+		goto cleanup;
+	}
+	
+	success = compare_output(output_context->buffer, output_context->flushed, expected);
+
+cleanup:
+
+	if(output_context)
+	{
+		LocalFree((HLOCAL)output_context);
+	}
+
+	if(needle_expanded)
+	{
+		LocalFree((HLOCAL)needle_expanded);
+	}
+
+	return success;
+}
+
+static BOOL run_test(const BOOL dry_run, const BOOL case_insensitive, const BOOL globbing, const BOOL normalize, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected)
+{
+	DWORD io_mode;
+	for(io_mode = 0U; io_mode < TEST_IO_COUNT; ++io_mode)
+	{
+		if(!run_test_pass(dry_run, case_insensitive, globbing, normalize, needle, replacement, haystack, expected, FALSE, 0U, 0U, 0U, io_mode))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL run_restricted_test(const BOOL reverse, const DWORD max_replacements, const ULONGLONG window_offset, const ULONGLONG window_length, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected)
+{
+	DWORD io_mode;
+	for(io_mode = 0U; io_mode < TEST_IO_COUNT; ++io_mode)
+	{
+		if(!run_test_pass(FALSE, FALSE, FALSE, FALSE, needle, replacement, haystack, expected, reverse, max_replacements, window_offset, window_length, io_mode))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* ======================================================================= */
+/* Compiled pattern                                                        */
+/* ======================================================================= */
+
+#define TEST_REVERSE   0x1U
+#define TEST_NORMALIZE 0x2U
+#define TEST_NOCASE    0x4U
+#define TEST_CALLBACK  0x8U
+#define TEST_VERBOSE   0x10U
+
+typedef struct test_pattern_t
+{
+	libreplace_flags_t options;
+	WORD *needle, *replacement;
+	DWORD needle_len, replacement_len;
+	libreplace_pattern_t *pattern;
+	libreplace_context_t *context;
+}
+test_pattern_t;
+
+/* replaces each match by "<ordinal match>" */
+static BOOL tag_match(const BYTE *const match, const DWORD match_len, const ULONGLONG offset, const DWORD ordinal, const libreplace_sink_t *const output, const DWORD_PTR context)
+{
+	const BYTE prefix[2U] = { '<', (BYTE)('0' + (ordinal % 10U)) }, suffix = '>';
+	UNUSED_PARAM(offset);
+	UNUSED_PARAM(context);
+	return output->func_write(prefix, 2U, output->context) && output->func_write(match, match_len, output->context) && output->func_write(&suffix, 1U, output->context);
+}
+
+/* compiles the pattern, with '?' as the wildcard character and back-references in the replacement, and creates a context for it */
+static BOOL test_pattern_create(test_pattern_t *const test, const DWORD test_flags, const DWORD max_replacements, const CHAR *const needle, const CHAR *const replacement)
+{
+	DWORD char_pos, wildcard_count = 0U;
+
+	SecureZeroMemory(test, sizeof(test_pattern_t));
+	test->options.reverse = (test_flags & TEST_REVERSE) ? TRUE : FALSE;
+	test->options.normalize = (test_flags & TEST_NORMALIZE) ? TRUE : FALSE;
+	test->options.case_insensitive = (test_flags & TEST_NOCASE) ? TRUE : FALSE;
+	test->options.verbose = (test_flags & TEST_VERBOSE) ? TRUE : FALSE;
+	test->options.max_replacements = max_replacements;
+	test->needle_len = lstrlenA(needle);
+	test->replacement_len = lstrlenA(replacement);
+
+	if((test->needle = expand_wildcards((const BYTE*)needle, test->needle_len, &MY_WILDCARD)) && (test->replacement = (WORD*) LocalAlloc(LPTR, sizeof(WORD) * (test->replacement_len + 1U))))
+	{
+		for(char_pos = 0U; char_pos < test->needle_len; ++char_pos)
+		{
+			wildcard_count += (test->needle[char_pos] == LIBREPLACE_WILDCARD) ? 1U : 0U;
+		}
+		if(expand_back_references((const BYTE*)replacement, &test->replacement_len, test->replacement, wildcard_count))
+		{
+			test->pattern = libreplace_pattern_compile_template(NULL, test->needle, test->needle_len, test->replacement, test->replacement_len, &test->options);
+		}
+	}
+
+	if(!(test->pattern && (test->context = libreplace_context_create(test->pattern))))
+	{
+		return FALSE;
+	}
+
+	if(test_flags & TEST_CALLBACK)
+	{
+		libreplace_context_set_callback(test->context, tag_match, 0U);
+	}
+
+	return TRUE;
+}
+
+static void test_pattern_free(test_pattern_t *const test)
+{
+	libreplace_context_free(test->context);
+	libreplace_pattern_free(test->pattern);
+
+	if(test->needle)
+	{
+		LocalFree((HLOCAL)test->needle);
+	}
+
+	if(test->replacement)
+	{
+		LocalFree((HLOCAL)test->replacement);
+	}
+}
+
+/* runs every API that supports the given options, and reuses the same context for all of them */
+static BOOL run_api_test(const DWORD test_flags, const DWORD max_replacements, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected)
+{
+	BOOL success = FALSE;
+	DWORD round, haystack_pos, chunk_len, output_offset, replacement_count = 0U;
+	SIZE_T output_len;
+	ULONGLONG input_offset;
+	BYTE *output = NULL;
+	memory_input_t input_context;
+	memory_output_t *output_context = NULL;
+	libreplace_io_t io_functions;
+	libreplace_sink_t sink;
+	test_pattern_t test;
+
+	const DWORD haystack_len = lstrlenA(haystack);
+
+	if(!(test_pattern_create(&test, test_flags, max_replacements, needle, replacement) && (output_context = alloc_memory_output(lstrlenA(expected) + 2U))))
+	{
+		goto cleanup;
+	}
+
+	/* pull mode, each kind of I/O twice */
+	for(round = 0U; round < 2U * TEST_IO_COUNT; ++round)
+	{
+		output_context->pos = output_context->flushed = 0U;
+		init_memory_input(&input_context, (const BYTE*)haystack, haystack_len);
+		test_init_io(&io_functions, round % TEST_IO_COUNT, &input_context, output_context);
+		if(!(libreplace_context_run(test.context, &io_functions, NULL, &replacement_count, &g_abort_requested) && compare_output(output_context->buffer, output_context->flushed, expected)))
+		{
+			goto cleanup;
+		}
+	}
+
+	/* push mode, in chunks of varying length; reverse scanning requires random access */
+	sink.func_write = memory_write_bulk;
+	sink.context = (DWORD_PTR)output_context;
+	libreplace_context_reset(test.context);
+	for(round = 1U; (round <= 8U) && (!test.options.reverse); ++round)
+	{
+		output_context->pos = 0U;
+		for(haystack_pos = 0U; haystack_pos < haystack_len; haystack_pos += chunk_len)
+		{
+			chunk_len = min((haystack_pos % round) + 1U, haystack_len - haystack_pos);
+			if(!libreplace_feed(test.context, (const BYTE*)haystack + haystack_pos, chunk_len, &sink, NULL))
+			{
+				goto cleanup;
+			}
+		}
+		if(!(libreplace_finish(test.context, &sink, NULL, &replacement_count) && compare_output(output_context->buffer, output_context->pos, expected)))
+		{
+			goto cleanup;
+		}
+	}
+
+	/* interrupted after every position in push mode, then resumed from the recorded progress; forward only */
+	for(haystack_pos = 0U; (haystack_pos <= haystack_len) && (!(test.options.reverse || test.options.normalize)); ++haystack_pos)
+	{
+		output_context->pos = 0U;
+		libreplace_context_reset(test.context);
+		for(round = 0U; round < haystack_pos; ++round)
+		{
+			if(!libreplace_feed(test.context, (const BYTE*)haystack + round, 1U, &sink, NULL))
+			{
+				goto cleanup;
+			}
+		}
+		if(!libreplace_progress(test.context, &input_offset, &replacement_count))
+		{
+			goto cleanup;
+		}
+		output_offset = output_context->pos;
+		if(!libreplace_feed(test.context, (const BYTE*)haystack + haystack_pos, haystack_len - haystack_pos, &sink, NULL))
+		{
+			goto cleanup; /*this output is discarded*/
+		}
+		output_context->pos = output_offset;
+		if(!(libreplace_resume(test.context, input_offset, replacement_count) && libreplace_feed(test.context, (const BYTE*)haystack + input_offset, haystack_len - (DWORD)input_offset, &sink, NULL)))
+		{
+			goto cleanup;
+		}
+		if(!(libreplace_finish(test.context, &sink, NULL, &replacement_count) && compare_output(output_context->buffer, output_context->pos, expected)))
+		{
+			goto cleanup;
+		}
+	}
+
+	/* in-memory, with an exact-size result; line-break normalization changes the length, callbacks are not supported */
+	for(round = 0U; (round < 2U) && (!(test.options.normalize || (test_flags & TEST_CALLBACK))); ++round)
+	{
+		if(!(libreplace_replace_memory(test.context, (const BYTE*)haystack, haystack_len, &output, &output_len, NULL, &replacement_count) && compare_output(output, output_len, expected)))
+		{
+			goto cleanup;
+		}
+		libreplace_memory_free(output);
+		output = NULL;
+	}
+
+	success = TRUE;
+
+cleanup:
+
+	if(output_context)
+	{
+		LocalFree((HLOCAL)output_context);
+	}
+
+	libreplace_memory_free(output);
+	test_pattern_free(&test);
+	return success;
+}
+
+/* walks the matches with a cursor; the second round resumes from the position of the second match */
+static BOOL run_cursor_test(const DWORD test_flags, const CHAR *const needle, const CHAR *const haystack, const DWORD *const expected)
+{
+	BOOL success = FALSE;
+	DWORD round, index;
+	SIZE_T match_offset;
+	libreplace_cursor_t cursor;
+	test_pattern_t test;
+
+	if(!test_pattern_create(&test, test_flags, 0U, needle, ""))
+	{
+		goto cleanup;
+	}
+
+	for(round = 0U; round < 2U; ++round)
+	{
+		if(!libreplace_cursor_init(&cursor, test.pattern, (const BYTE*)haystack, lstrlenA(haystack), NULL))
+		{
+			goto cleanup;
+		}
+		if(round > 0U)
+		{
+			libreplace_cursor_seek(&cursor, test.options.reverse ? (expected[1U] + lstrlenA(needle)) : expected[1U]);
+		}
+		for(index = round; expected[index] != MAXDWORD; ++index)
+		{
+			if(!(libreplace_cursor_next(&cursor, &match_offset) && (match_offset == expected[index])))
+			{
+				goto cleanup;
+			}
+		}
+		if(libreplace_cursor_next(&cursor, &match_offset))
+		{
+			goto cleanup;
+		}
+	}
+
+	success = TRUE;
+
+cleanup:
+
+	test_pattern_free(&test);
+	return success;
+}
+
+typedef struct matcher_log_t
+{
+	const CHAR *expected;
+	BOOL selected;
+	BOOL switched;
+}
+matcher_log_t;
+
+static BOOL text_starts_with(const CHAR *text, const CHAR *prefix)
+{
+	for(; *prefix; ++text, ++prefix)
+	{
+		if(*text != *prefix)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL matcher_log_func(const DWORD_PTR context, const CHAR *const text)
+{
+	matcher_log_t *const matcher_log = (matcher_log_t*)context;
+	if(text_starts_with(text, "Selected matcher: "))
+	{
+		matcher_log->selected = text_starts_with(text + 18U, matcher_log->expected);
+	}
+	else if(text_starts_with(text, "Switching matcher: "))
+	{
+		matcher_log->switched = TRUE;
+	}
+	return TRUE;
+}
+
+static BOOL matcher_reference_match(const BOOL case_insensitive, const CHAR *const needle, const BYTE *const data)
+{
+	DWORD pos;
+	for(pos = 0U; needle[pos]; ++pos)
+	{
+		if(needle[pos] != '?')
+		{
+			const BYTE value = (case_insensitive && (data[pos] >= 'a') && (data[pos] <= 'z')) ? (data[pos] - 0x20U) : data[pos];
+			const BYTE expected = (case_insensitive && (needle[pos] >= 'a') && (needle[pos] <= 'z')) ? (needle[pos] - 0x20U) : needle[pos];
+			if(value != expected)
+			{
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/* random input, where the second half may have different statistics than the first half, with the needle planted every 1009 bytes */
+static BYTE *build_kernel_input(const CHAR *const alphabet_head, const CHAR *const alphabet_tail, const CHAR *const needle, const DWORD haystack_len)
+{
+	DWORD pos, char_pos, seed = 0x9E3779B9U;
+	BYTE *const haystack = (BYTE*) LocalAlloc(LPTR, haystack_len);
+	const DWORD head_len = lstrlenA(alphabet_head), tail_len = lstrlenA(alphabet_tail), needle_len = lstrlenA(needle);
+
+	if(haystack)
+	{
+		for(pos = 0U; pos < haystack_len; ++pos)
+		{
+			seed = (seed * 1103515245U) + 12345U;
+			haystack[pos] = (pos < (haystack_len / 2U)) ? alphabet_head[((seed >> 16) & 0x7FFFU) % head_len] : alphabet_tail[((seed >> 16) & 0x7FFFU) % tail_len];
+		}
+		for(pos = 0U; pos + needle_len <= haystack_len; pos += 1009U)
+		{
+			for(char_pos = 0U; char_pos < needle_len; ++char_pos)
+			{
+				if(needle[char_pos] != '?')
+				{
+					haystack[pos + char_pos] = needle[char_pos];
+				}
+			}
+		}
+	}
+
+	return haystack;
+}
+
+/* straightforward reference implementation: leftmost, non-overlapping matches */
+static memory_output_t *build_kernel_reference(const BOOL case_insensitive, const CHAR *const needle, const CHAR *const replacement, const BYTE *const haystack, const DWORD haystack_len)
+{
+	DWORD pos, char_pos;
+	const DWORD needle_len = lstrlenA(needle), replacement_len = lstrlenA(replacement);
+	memory_output_t *const reference = alloc_memory_output(haystack_len + (haystack_len / needle_len) * replacement_len);
+
+	if(reference)
+	{
+		for(pos = 0U; pos < haystack_len;)
+		{
+			if((pos + needle_len <= haystack_len) && matcher_reference_match(case_insensitive, needle, haystack + pos))
+			{
+				for(char_pos = 0U; char_pos < replacement_len; ++char_pos)
+				{
+					reference->buffer[reference->pos++] = replacement[char_pos];
+				}
+				pos += needle_len;
+				continue;
+			}
+			reference->buffer[reference->pos++] = haystack[pos++];
+		}
+	}
+
+	return reference;
+}
+
+/* every kernel set must produce the same output, fed in chunks, as the reference (or as the scalar kernels, if normalizing); the matcher choice is reported via the logger */
+static BOOL run_kernel_test(const DWORD test_flags, const CHAR *const alphabet_head, const CHAR *const alphabet_tail, const CHAR *const needle, const CHAR *const replacement, const CHAR *const expected_matcher, const BOOL expect_switch)
+{
+	BOOL success = FALSE;
+	DWORD kernels, pos, chunk_len, replacement_count = 0U;
+	SIZE_T output_len;
+	memory_output_t *reference = NULL, *output_context = NULL;
+	libreplace_sink_t sink;
+	libreplace_logger_t logger;
+	matcher_log_t matcher_log;
+	test_pattern_t test;
+	BYTE *haystack = NULL, *output = NULL;
+
+	const DWORD haystack_len = 160000U;
+
+	SecureZeroMemory(&test, sizeof(test_pattern_t));
+	logger.logging_func = matcher_log_func;
+	logger.context = (DWORD_PTR)&matcher_log;
+
+	if(!(haystack = build_kernel_input(alphabet_head, alphabet_tail, needle, haystack_len)))
+	{
+		goto cleanup;
+	}
+
+	if(!(test_flags & TEST_NORMALIZE))
+	{
+		if(!(reference = build_kernel_reference((test_flags & TEST_NOCASE) ? TRUE : FALSE, needle, replacement, haystack, haystack_len)))
+		{
+			goto cleanup;
+		}
+	}
+
+	for(kernels = LIBREPLACE_KERNELS_SCALAR; kernels <= LIBREPLACE_KERNELS_AVX512; ++kernels)
+	{
+		if(!libreplace_select_kernels(kernels))
+		{
+			break; /*not supported by this CPU*/
+		}
+		SecureZeroMemory(&matcher_log, sizeof(matcher_log_t));
+		matcher_log.expected = expected_matcher;
+		if(!(test_pattern_create(&test, test_flags | (expected_matcher ? TEST_VERBOSE : 0U), 0U, needle, replacement) && (output_context = alloc_memory_output(2U * haystack_len))))
+		{
+			goto cleanup;
+		}
+		sink.func_write = memory_write_bulk;
+		sink.context = (DWORD_PTR)output_context;
+		for(pos = 0U; pos < haystack_len; pos += chunk_len)
+		{
+			chunk_len = min(4096U, haystack_len - pos); /*large enough for a representative matcher sample*/
+			if(!libreplace_feed(test.context, haystack + pos, chunk_len, &sink, &logger))
+			{
+				goto cleanup;
+			}
+		}
+		if(!libreplace_finish(test.context, &sink, &logger, &replacement_count))
+		{
+			goto cleanup;
+		}
+		if(expected_matcher && ((!matcher_log.selected) || (matcher_log.switched != expect_switch)))
+		{
+			goto cleanup;
+		}
+		if(!reference)
+		{
+			reference = output_context;
+			output_context = NULL;
+		}
+		else
+		{
+			if(!compare_bytes(output_context->buffer, output_context->pos, reference->buffer, reference->pos))
+			{
+				goto cleanup;
+			}
+			LocalFree((HLOCAL)output_context);
+			output_context = NULL;
+		}
+		/* in-memory engine, uses a match cursor internally */
+		if(!test.options.normalize)
+		{
+			if(!(libreplace_replace_memory(test.context, haystack, haystack_len, &output, &output_len, NULL, &replacement_count) && compare_bytes(output, output_len, reference->buffer, reference->pos)))
+			{
+				goto cleanup;
+			}
+			libreplace_memory_free(output);
+			output = NULL;
+		}
+		test_pattern_free(&test);
+		SecureZeroMemory(&test, sizeof(test_pattern_t));
+	}
+
+	success = TRUE;
+
+cleanup:
+
+	libreplace_select_kernels(LIBREPLACE_KERNELS_AUTO);
+	libreplace_memory_free(output);
+	test_pattern_free(&test);
+
+	if(output_context)
+	{
+		LocalFree((HLOCAL)output_context);
+	}
+
+	if(reference)
+	{
+		LocalFree((HLOCAL)reference);
+	}
+
+	if(haystack)
+	{
+		LocalFree((HLOCAL)haystack);
+	}
+
+	return success;
+}
+
+static CHAR *repeat_text(const CHAR *const unit, const DWORD repeat_count)
+{
+	DWORD repeat;
+	const DWORD unit_len = lstrlenA(unit);
+	CHAR *const text = (CHAR*) LocalAlloc(LPTR, (unit_len * repeat_count) + 1U);
+
+	if(text)
+	{
+		for(repeat = 0U; repeat < repeat_count; ++repeat)
+		{
+			copy_bytes((BYTE*)text + (repeat * unit_len), (const BYTE*)unit, unit_len);
+		}
+	}
+
+	return text;
+}
+
+/* dense matches, so that there are more output spans per block than can be gathered at once */
+static BOOL run_gather_test(const BOOL reverse, const CHAR *const unit, const CHAR *const needle, const CHAR *const replacement, const CHAR *const expected_unit)
+{
+	BOOL success = FALSE;
+	CHAR *const haystack = repeat_text(unit, 50000U), *const expected = repeat_text(expected_unit, 50000U);
+
+	if(haystack && expected)
+	{
+		success = run_restricted_test(reverse, 0U, 0U, 0U, needle, replacement, haystack, expected);
+	}
+
+	if(haystack)
+	{
+		LocalFree((HLOCAL)haystack);
+	}
+
+	if(expected)
+	{
+		LocalFree((HLOCAL)expected);
+	}
+
+	return success;
+}
+
+/* decompresses the given stream, or else compresses each half of the input as a gzip member of its own first, to cover concatenated streams */
+static BOOL run_gzip_test(const BYTE *const compressed_data, const DWORD compressed_len, const CHAR *const unit, const DWORD repeat_count)
+{
+	BOOL success = FALSE;
+	DWORD member, expected_len;
+	CHAR *expected = NULL;
+	memory_input_t input_context;
+	memory_output_t *compressed = NULL, *output = NULL;
+	libreplace_io_t io_functions;
+	const CHAR *error_message = NULL;
+
+	if(!(expected = repeat_text(unit, repeat_count)))
+	{
+		goto cleanup;
+	}
+
+	expected_len = lstrlenA(expected);
+	if(!((compressed = alloc_memory_output(compressed_data ? 1U : ((2U * (expected_len + (expected_len >> 3U))) + 1024U))) && (output = alloc_memory_output(expected_len + 2U))))
+	{
+		goto cleanup;
+	}
+
+	for(member = 0U; (member < 2U) && (!compressed_data); ++member)
+	{
+		init_memory_input(&input_context, (const BYTE*)expected + (member * (expected_len / 2U)), member ? (expected_len - (expected_len / 2U)) : (expected_len / 2U));
+		test_init_io(&io_functions, TEST_IO_BULK, &input_context, compressed);
+		if(!gzip_deflate(&io_functions, &error_message, &g_abort_requested))
+		{
+			goto cleanup;
+		}
+	}
+
+	init_memory_input(&input_context, compressed_data ? compressed_data : compressed->buffer, compressed_data ? compressed_len : compressed->flushed);
+	test_init_io(&io_functions, TEST_IO_BULK, &input_context, output);
+	if(!gzip_inflate(&io_functions, &error_message, &g_abort_requested))
+	{
+		goto cleanup;
+	}
+
+	success = compare_output(output->buffer, output->flushed, expected);
+
+cleanup:
+
+	if(expected)
+	{
+		LocalFree((HLOCAL)expected);
+	}
+
+	if(compressed)
+	{
+		LocalFree((HLOCAL)compressed);
+	}
+
+	if(output)
+	{
+		LocalFree((HLOCAL)output);
+	}
+
+	return success;
+}
+
+static void init_tar_test_header(BYTE *const header, const CHAR *const name, const DWORD size)
+{
+	static const CHAR *const MAGIC = "ustar\0" "00";
+	DWORD pos;
+	SecureZeroMemory(header, TAR_BLOCK_SIZE);
+	for(pos = 0U; name[pos]; ++pos)
+	{
+		header[TAR_OFFSET_NAME + pos] = (BYTE)name[pos];
+	}
+	for(pos = 0U; pos < 8U; ++pos)
+	{
+		header[TAR_OFFSET_MAGIC + pos] = (BYTE)MAGIC[pos];
+	}
+	header[TAR_OFFSET_TYPE] = '0';
+	tar_format_size(header, size);
+	tar_update_checksum(header);
+}
+
+static BOOL run_tar_test(const CHAR *const filter, const CHAR *const needle, const CHAR *const replacement, const CHAR *const data, const CHAR *const expected)
+{
+	static const CHAR *const NAMES[3U] = { "a.conf", "b.txt", "dir/c.conf" };
+	BOOL success = FALSE;
+	DWORD member, pos, data_pos, replacement_count = 0U, archive_len = 0U;
+	BYTE *archive = NULL;
+	memory_input_t input_context;
+	memory_output_t *output = NULL;
+	libreplace_io_t io_functions;
+	test_pattern_t test;
+	tar_replace_t params;
+	const CHAR *error_message = NULL;
+	ULONGLONG value;
+	LONG signed_sum;
+
+	const DWORD data_len = lstrlenA(data), expected_len = lstrlenA(expected);
+
+	/* three members, followed by the end-of-archive marker */
+	if(!(test_pattern_create(&test, 0U, 0U, needle, replacement) && (archive = (BYTE*) LocalAlloc(LPTR, 3U * (TAR_BLOCK_SIZE + (DWORD)tar_round_up(data_len)) + (2U * TAR_BLOCK_SIZE))) && (output = alloc_memory_output(3U * (TAR_BLOCK_SIZE + (DWORD)tar_round_up(expected_len)) + (2U * TAR_BLOCK_SIZE)))))
+	{
+		goto cleanup;
+	}
+	for(member = 0U; member < 3U; ++member)
+	{
+		init_tar_test_header(archive + archive_len, NAMES[member], data_len);
+		archive_len += TAR_BLOCK_SIZE;
+		copy_bytes(archive + archive_len, (const BYTE*)data, data_len);
+		archive_len += (DWORD)tar_round_up(data_len);
+	}
+	archive_len += 2U * TAR_BLOCK_SIZE;
+
+	SecureZeroMemory(&params, sizeof(tar_replace_t));
+	params.context = test.context;
+	params.flags = &test.options;
+	params.filter = (const BYTE*)filter;
+	params.same_size = (test.needle_len == test.replacement_len);
+
+	init_memory_input(&input_context, archive, archive_len);
+	test_init_io(&io_functions, TEST_IO_BULK, &input_context, output);
+	if(!tar_process(&io_functions, NULL, &params, &replacement_count, &error_message, &g_abort_requested))
+	{
+		goto cleanup;
+	}
+
+	/* members that do not match the filter must be unchanged, the others must have a valid header for the new size */
+	for(member = 0U, pos = 0U; member < 3U; ++member)
+	{
+		const BOOL selected = (!filter) || tar_match_name((const BYTE*)filter, (const BYTE*)NAMES[member]);
+		const CHAR *const member_data = selected ? expected : data;
+		const DWORD member_len = selected ? expected_len : data_len;
+		if((pos + TAR_BLOCK_SIZE > output->flushed) || (!tar_parse_number(output->buffer + pos + TAR_OFFSET_CHKSUM, 8U, &value)) || (value != tar_checksum(output->buffer + pos, &signed_sum)))
+		{
+			goto cleanup;
+		}
+		if((!tar_parse_number(output->buffer + pos + TAR_OFFSET_SIZE, 12U, &value)) || (value != member_len))
+		{
+			goto cleanup;
+		}
+		pos += TAR_BLOCK_SIZE;
+		if((pos + (DWORD)tar_round_up(member_len) > output->flushed) || (!compare_output(output->buffer + pos, member_len, member_data)))
+		{
+			goto cleanup;
+		}
+		for(data_pos = member_len; data_pos < (DWORD)tar_round_up(member_len); ++data_pos)
+		{
+			if(output->buffer[pos + data_pos] != 0x00U)
+			{
+				goto cleanup;
+			}
+		}
+		pos += (DWORD)tar_round_up(member_len);
+	}
+
+	success = (output->flushed == pos + (2U * TAR_BLOCK_SIZE)) && tar_is_zero_block(output->buffer + pos) && tar_is_zero_block(output->buffer + pos + TAR_BLOCK_SIZE);
+
+cleanup:
+
+	test_pattern_free(&test);
+
+	if(archive)
+	{
+		LocalFree((HLOCAL)archive);
+	}
+
+	if(output)
+	{
+		LocalFree((HLOCAL)output);
+	}
+
+	return success;
+}
+
+/* emits an edit list, or else modifies the data while recording the undo journal, and then applies it to the source of the patch */
+static BOOL run_patch_test(const BOOL journal, const DWORD max_replacements, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected)
+{
+	BOOL success = FALSE;
+	DWORD replacement_count = 0U;
+	memory_input_t input_context;
+	memory_output_t *patch_output = NULL, *output = NULL, *patched = NULL;
+	libreplace_io_t io_functions;
+	libreplace_sink_t sink;
+	test_pattern_t test;
+	patch_writer_t writer;
+	patch_t patch;
+	BYTE buffer[7U], *altered = NULL;
+	DWORD crc_table[256U];
+	const CHAR *error_message = NULL;
+
+	const DWORD haystack_len = lstrlenA(haystack), expected_len = lstrlenA(expected);
+	const CHAR *const source = journal ? expected : haystack, *const target = journal ? haystack : expected;
+
+	SecureZeroMemory(&writer, sizeof(patch_writer_t));
+
+	/* each match is at least '<needle_len>' bytes long, the journal holds the original bytes of each match */
+	if(!(test_pattern_create(&test, 0U, max_replacements, needle, replacement) && (patch_output = alloc_memory_output(PATCH_SIGNATURE_LEN + PATCH_RECORD_LEN + PATCH_TRAILER_LEN + (((haystack_len / test.needle_len) + 1U) * (PATCH_RECORD_LEN + (journal ? test.needle_len : test.replacement_len))))) && ((!journal) || (output = alloc_memory_output(expected_len + 1U))) && (patched = alloc_memory_output(lstrlenA(target) + 1U)) && (altered = (BYTE*) LocalAlloc(LPTR, lstrlenA(source) + 1U))))
+	{
+		goto cleanup;
+	}
+
+	sink.func_write = memory_write_bulk;
+	sink.context = (DWORD_PTR)patch_output;
+	libreplace_context_set_callback(test.context, patch_writer_match, (DWORD_PTR)&writer);
+	init_memory_input(&input_context, (const BYTE*)haystack, haystack_len);
+	if(journal)
+	{
+		test_init_io(&io_functions, TEST_IO_BULK, &input_context, output);
+		if(!patch_journal_init(&writer, &sink, &io_functions, test.needle, test.needle_len, test.replacement, test.replacement_len))
+		{
+			goto cleanup;
+		}
+	}
+	else
+	{
+		init_io_functions(&io_functions, memory_read_byte, patch_writer_skip_byte, (DWORD_PTR)&input_context, (DWORD_PTR)&writer);
+		init_io_bulk_functions(&io_functions, memory_read_bulk, patch_writer_skip_bulk);
+		if(!patch_writer_init(&writer, &sink, test.needle, test.needle_len, test.replacement, test.replacement_len))
+		{
+			goto cleanup;
+		}
+	}
+	if(!(libreplace_context_run(test.context, &io_functions, NULL, &replacement_count, &g_abort_requested) && (journal ? patch_journal_finish(&writer, haystack_len) : patch_writer_finish(&writer)) && memory_write_byte(LIBREPLACE_FLUSH, (DWORD_PTR)patch_output)))
+	{
+		goto cleanup;
+	}
+
+	if(journal && (!compare_output(output->buffer, output->flushed, expected)))
+	{
+		goto cleanup;
+	}
+
+	/* a truncated patch must be rejected as a whole */
+	if(patch_parse(&patch, patch_output->buffer, patch_output->flushed - 1U) || (!patch_parse(&patch, patch_output->buffer, patch_output->flushed)))
+	{
+		goto cleanup;
+	}
+
+	gzip_crc32_init(crc_table);
+	if((patch.edit_count != replacement_count) || (patch.source_size != (DWORD)lstrlenA(source)) || (patch.target_size != (DWORD)lstrlenA(target)) || (patch.source_crc != gzip_crc32_update(crc_table, 0U, (const BYTE*)source, lstrlenA(source))) || (patch.same_length != (test.needle_len == test.replacement_len)))
+	{
+		goto cleanup;
+	}
+
+	/* a different source of the same size must be rejected before the first write */
+	copy_bytes(altered, (const BYTE*)source, lstrlenA(source));
+	altered[lstrlenA(source) / 2U] ^= 0x20U;
+	init_memory_input(&input_context, altered, lstrlenA(source));
+	test_init_io(&io_functions, TEST_IO_BULK, &input_context, patched);
+	if(patch_apply_copy(&patch, &io_functions, buffer, sizeof(buffer), &error_message, &g_abort_requested) || (patched->pos > 0U))
+	{
+		goto cleanup;
+	}
+
+	/* apply the patch, with a small buffer to split the copied ranges */
+	init_memory_input(&input_context, (const BYTE*)source, lstrlenA(source));
+	test_init_io(&io_functions, TEST_IO_BULK, &input_context, patched);
+	if(!patch_apply_copy(&patch, &io_functions, buffer, sizeof(buffer), &error_message, &g_abort_requested))
+	{
+		goto cleanup;
+	}
+
+	success = compare_output(patched->buffer, patched->flushed, target);
+
+cleanup:
+
+	patch_writer_free(&writer);
+	test_pattern_free(&test);
+
+	if(patch_output)
+	{
+		LocalFree((HLOCAL)patch_output);
+	}
+
+	if(output)
+	{
+		LocalFree((HLOCAL)output);
+	}
+
+	if(patched)
+	{
+		LocalFree((HLOCAL)patched);
+	}
+
+	if(altered)
+	{
+		LocalFree((HLOCAL)altered);
+	}
+
+	return success;
+}
+
+/* the temporary directory, without a trailing backslash */
+static BOOL get_test_directory(WCHAR *const directory)
+{
+	const DWORD directory_len = GetTempPathW(MAX_PATH + 1U, directory);
+	if((directory_len < 1U) || (directory_len > MAX_PATH))
+	{
+		return FALSE;
+	}
+	if(directory[directory_len - 1U] == L'\\')
+	{
+		directory[directory_len - 1U] = L'\0';
+	}
+	return TRUE;
+}
+
+/* reads back up to '<buffer_size>' bytes of the file, so that a file that is too long can be detected */
+static BOOL read_back_file(const WCHAR *const file_name, BYTE *const buffer, const DWORD buffer_size, DWORD *const data_len)
+{
+	BOOL success = FALSE, error_flag = FALSE;
+	DWORD bytes_read;
+	file_input_t *input_context;
+	const HANDLE input = open_file(file_name, FALSE, 0U);
+
+	*data_len = 0U;
+	if(input == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	if((input_context = alloc_file_input(input, 0U, FALSE, FALSE, FALSE)))
+	{
+		while((*data_len < buffer_size) && file_read_bulk(buffer + (*data_len), buffer_size - (*data_len), &bytes_read, (DWORD_PTR)input_context, &error_flag))
+		{
+			*data_len += bytes_read;
+		}
+		success = (!error_flag);
+		free_file_input(input_context);
+	}
+
+	CloseHandle(input);
+	return success;
+}
+
+static BOOL run_commit_test(const CHAR *const needle, const CHAR *const replacement, const CHAR *const unit, const CHAR *const expected_unit, const DWORD repeat_count)
+{
+	BOOL success = FALSE;
+	WCHAR directory[MAX_PATH + 1U];
+	DWORD bytes_written, replacement_count = 0U, output_len = 0U;
+	LONG sync_count;
+	HANDLE input = INVALID_HANDLE_VALUE, output = INVALID_HANDLE_VALUE;
+	const WCHAR *source_file = NULL, *temp_file = NULL;
+	file_input_t *input_context = NULL;
+	file_output_t *output_context = NULL;
+	libreplace_io_t io_functions;
+	test_pattern_t test;
+	CHAR *haystack = NULL, *expected = NULL;
+	BYTE *result = NULL;
+
+	const DWORD haystack_len = lstrlenA(unit) * repeat_count;
+	const DWORD expected_len = lstrlenA(expected_unit) * repeat_count;
+
+	if(!(test_pattern_create(&test, 0U, 0U, needle, replacement) && (haystack = repeat_text(unit, repeat_count)) && (expected = repeat_text(expected_unit, repeat_count)) && (result = (BYTE*) LocalAlloc(LPTR, expected_len + 1U)) && get_test_directory(directory)))
+	{
+		goto cleanup;
+	}
+
+	if(!(source_file = generate_temp_file(directory, &input, 0U)))
+	{
+		goto cleanup;
+	}
+	if(!(WriteFile(input, haystack, haystack_len, &bytes_written, NULL) && (bytes_written == haystack_len)))
+	{
+		goto cleanup;
+	}
+	CloseHandle(input);
+	input = INVALID_HANDLE_VALUE;
+
+	/* modify the file like '--group-commit' does, with small buffers, so that the output takes many writes */
+	if(!(((input = open_file(source_file, FALSE, 0U)) != INVALID_HANDLE_VALUE) && (temp_file = generate_temp_file(directory, &output, 0U)) && (input_context = alloc_file_input(input, 4096U, FALSE, FALSE, FALSE)) && (output_context = alloc_file_output(output, FALSE, 4096U, FALSE, FALSE, FALSE))))
+	{
+		goto cleanup;
+	}
+	sync_count = g_sync_count;
+	init_io_functions(&io_functions, file_read_byte, file_write_byte, (DWORD_PTR)input_context, (DWORD_PTR)output_context);
+	init_io_bulk_functions(&io_functions, file_read_bulk, file_write_bulk);
+	if(!(libreplace_context_run(test.context, &io_functions, NULL, &replacement_count, &g_abort_requested) && commit_file(output)))
+	{
+		goto cleanup;
+	}
+
+	free_file_output(output_context);
+	free_file_input(input_context);
+	output_context = NULL;
+	input_context = NULL;
+	CloseHandle(output);
+	CloseHandle(input);
+	output = input = INVALID_HANDLE_VALUE;
+
+	/* the complete output was synced exactly once, before the original file is replaced */
+	if(!((g_sync_count - sync_count == 1L) && move_file(temp_file, source_file) && (!file_exists(temp_file))))
+	{
+		goto cleanup;
+	}
+
+	success = read_back_file(source_file, result, expected_len + 1U, &output_len) && (replacement_count == repeat_count) && compare_output(result, output_len, expected);
+
+cleanup:
+
+	free_file_input(input_context);
+	free_file_output(output_context);
+
+	if(input != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(input);
+	}
+
+	if(output != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(output);
+	}
+
+	if(source_file)
+	{
+		delete_file(source_file);
+		LocalFree((HLOCAL)source_file);
+	}
+
+	if(temp_file)
+	{
+		delete_file(temp_file);
+		LocalFree((HLOCAL)temp_file);
+	}
+
+	test_pattern_free(&test);
+
+	if(haystack)
+	{
+		LocalFree((HLOCAL)haystack);
+	}
+
+	if(expected)
+	{
+		LocalFree((HLOCAL)expected);
+	}
+
+	if(result)
+	{
+		LocalFree((HLOCAL)result);
+	}
+
+	return success;
+}
+
+static BOOL memory_write_gap(const ULONGLONG length, const DWORD_PTR output)
+{
+	static const BYTE zero = 0U;
+	ULONGLONG pos;
+	for(pos = 0U; pos < length; ++pos)
+	{
+		if(!memory_write_bulk(&zero, 1U, output))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL memory_write_at(const BYTE *const data, const DWORD data_len, const ULONGLONG offset, const DWORD_PTR output)
+{
+	memory_output_t *const ctx = (memory_output_t*) output;
+	if((offset > ctx->pos) || (data_len > ctx->pos - (DWORD)offset))
+	{
+		return FALSE; /*a clone is never extended*/
+	}
+	copy_bytes(ctx->buffer + (DWORD)offset, data, data_len);
+	return TRUE;
+}
+
+/* scans the data ranges, but only the edges of the holes in between, like extents_process() does */
+static BOOL feed_data_ranges(libreplace_context_t *const context, const BYTE *const haystack, const DWORD haystack_len, const DWORD *const ranges, const DWORD edge_len, const BOOL skip_holes, const libreplace_sink_t *const sink)
+{
+	static const BYTE zeros[3U] = { 0U, 0U, 0U };
+	DWORD range, offset = 0U, hole_end;
+	for(range = 0U; offset < haystack_len; range += 2U)
+	{
+		hole_end = (ranges[range] != MAXDWORD) ? ranges[range] : haystack_len;
+		if(!(skip_holes ? extents_feed_hole(context, offset, hole_end - offset, edge_len, zeros, sizeof(zeros), sink, memory_write_gap, sink->context, NULL) : extents_feed_zeros(context, hole_end - offset, zeros, sizeof(zeros), sink, NULL)))
+		{
+			return FALSE;
+		}
+		if(ranges[range] == MAXDWORD)
+		{
+			break;
+		}
+		if(!libreplace_feed(context, haystack + ranges[range], ranges[range + 1U] - ranges[range], sink, NULL))
+		{
+			return FALSE;
+		}
+		offset = ranges[range + 1U];
+	}
+	return TRUE;
+}
+
+/* a (sparse) temporary file that holds '<data>', the unwritten ranges are holes */
+static const WCHAR *create_sparse_file(const WCHAR *const directory, const BYTE *const data, const DWORD data_len, const DWORD *const ranges)
+{
+	HANDLE handle = INVALID_HANDLE_VALUE;
+	LARGE_INTEGER position;
+	BOOL success = TRUE;
+	DWORD range;
+	const WCHAR *const file_name = generate_temp_file(directory, &handle, 0U);
+	if(!file_name)
+	{
+		return NULL;
+	}
+	extents_set_sparse(handle); /*not supported by every file system*/
+	for(range = 0U; success && (ranges[range] != MAXDWORD); range += 2U)
+	{
+		success = extents_write_at(data + ranges[range], ranges[range + 1U] - ranges[range], ranges[range], (DWORD_PTR)handle);
+	}
+	position.QuadPart = (LONGLONG)data_len;
+	success = success && SetFilePointerEx(handle, position, NULL, FILE_BEGIN) && SetEndOfFile(handle);
+	CloseHandle(handle);
+	if(!success)
+	{
+		delete_file(file_name);
+		LocalFree((HLOCAL)file_name);
+		return NULL;
+	}
+	return file_name;
+}
+
+/* a data range, a hole, a second data range and a trailing hole; every way of skipping the holes must give the same result as scanning all of the input */
+static BOOL run_hole_test(const CHAR *const needle, const CHAR *const replacement, const CHAR *const prefix, const DWORD hole_len, const CHAR *const suffix, const DWORD tail_len)
+{
+	BOOL success = FALSE, skip_holes;
+	WCHAR directory[MAX_PATH + 1U];
+	DWORD haystack_pos, chunk_len, replacement_count = 0U, expected_count = 0U, output_len = 0U, ranges[5U];
+	SIZE_T expected_len = 0U;
+	HANDLE input = INVALID_HANDLE_VALUE, output = INVALID_HANDLE_VALUE;
+	const WCHAR *input_file = NULL, *output_file = NULL;
+	file_input_t *input_context = NULL;
+	file_output_t *output_context = NULL;
+	memory_output_t *output_memory = NULL;
+	libreplace_sink_t sink;
+	extents_rewriter_t rewriter;
+	test_pattern_t test;
+	BYTE *haystack = NULL, *expected = NULL, *result = NULL;
+
+	const DWORD prefix_len = lstrlenA(prefix);
+	const DWORD suffix_len = lstrlenA(suffix);
+	const DWORD haystack_len = prefix_len + hole_len + suffix_len + tail_len;
+
+	SecureZeroMemory(&rewriter, sizeof(extents_rewriter_t));
+
+	if(!(test_pattern_create(&test, 0U, 0U, needle, replacement) && (haystack = (BYTE*) LocalAlloc(LPTR, haystack_len + 1U)) && get_test_directory(directory)))
+	{
+		goto cleanup;
+	}
+
+	/* the holes are zero-initialized */
+	copy_bytes(haystack, (const BYTE*)prefix, prefix_len);
+	copy_bytes(haystack + prefix_len + hole_len, (const BYTE*)suffix, suffix_len);
+	ranges[0U] = 0U;
+	ranges[1U] = prefix_len;
+	ranges[2U] = prefix_len + hole_len;
+	ranges[3U] = prefix_len + hole_len + suffix_len;
+	ranges[4U] = MAXDWORD;
+	skip_holes = extents_can_skip_holes(test.needle, test.needle_len);
+
+	/* the reference output, the whole input is scanned */
+	if(!(libreplace_replace_memory(test.context, haystack, haystack_len, &expected, &expected_len, NULL, &expected_count) && (result = (BYTE*) LocalAlloc(LPTR, expected_len + 1U)) && (output_memory = alloc_memory_output((DWORD)expected_len + 1U))))
+	{
+		goto cleanup;
+	}
+
+	/* in memory, the skipped part of each hole is passed through as zeros */
+	libreplace_context_reset(test.context);
+	sink.func_write = memory_write_bulk;
+	sink.context = (DWORD_PTR)output_memory;
+	if(!(feed_data_ranges(test.context, haystack, haystack_len, ranges, test.needle_len - 1U, skip_holes, &sink) && libreplace_finish(test.context, &sink, NULL, &replacement_count)))
+	{
+		goto cleanup;
+	}
+	if(!((replacement_count == expected_count) && compare_bytes(output_memory->buffer, output_memory->pos, expected, expected_len)))
+	{
+		goto cleanup;
+	}
+
+	/* the clone starts out as a copy of the input, only the matches are rewritten in place, and the output of the engine is discarded */
+	if(test.needle_len == test.replacement_len)
+	{
+		output_memory->pos = copy_bytes(output_memory->buffer, haystack, haystack_len);
+		if(!extents_rewriter_init(&rewriter, memory_write_at, (DWORD_PTR)output_memory, test.needle, test.needle_len, test.replacement, test.replacement_len))
+		{
+			goto cleanup;
+		}
+		libreplace_context_set_callback(test.context, extents_rewriter_match, (DWORD_PTR)&rewriter);
+		sink.func_write = extents_discard;
+		sink.context = 0U;
+		for(haystack_pos = 0U; haystack_pos < haystack_len; haystack_pos += chunk_len)
+		{
+			chunk_len = min(5U, haystack_len - haystack_pos);
+			if(!libreplace_feed(test.context, haystack + haystack_pos, chunk_len, &sink, NULL))
+			{
+				goto cleanup;
+			}
+		}
+		if(!(libreplace_finish(test.context, &sink, NULL, &replacement_count) && (replacement_count == expected_count) && compare_bytes(output_memory->buffer, output_memory->pos, expected, expected_len)))
+		{
+			goto cleanup;
+		}
+		libreplace_context_set_callback(test.context, NULL, 0U);
+	}
+
+	/* a sparse file, processed with small buffers, so that each range takes several reads */
+	if(!((input_file = create_sparse_file(directory, haystack, haystack_len, ranges)) && (output_file = generate_temp_file(directory, &output, 0U))))
+	{
+		goto cleanup;
+	}
+	extents_set_sparse(output);
+	if(!(((input = open_file(input_file, FALSE, 0U)) != INVALID_HANDLE_VALUE) && (input_context = alloc_file_input(input, 4096U, FALSE, FALSE, FALSE)) && (output_context = alloc_file_output(output, FALSE, 4096U, FALSE, FALSE, FALSE))))
+	{
+		goto cleanup;
+	}
+	if(!extents_process(test.context, input_context, output_context, skip_holes, test.needle_len - 1U, NULL, &replacement_count, &g_abort_requested))
+	{
+		goto cleanup;
+	}
+
+	free_file_output(output_context);
+	free_file_input(input_context);
+	output_context = NULL;
+	input_context = NULL;
+	CloseHandle(output);
+	CloseHandle(input);
+	output = input = INVALID_HANDLE_VALUE;
+
+	/* read back the output, including the trailing hole */
+	success = read_back_file(output_file, result, (DWORD)expected_len + 1U, &output_len) && (replacement_count == expected_count) && compare_bytes(result, output_len, expected, expected_len);
+
+cleanup:
+
+	free_file_input(input_context);
+	free_file_output(output_context);
+
+	if(input != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(input);
+	}
+
+	if(output != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(output);
+	}
+
+	if(input_file)
+	{
+		delete_file(input_file);
+		LocalFree((HLOCAL)input_file);
+	}
+
+	if(output_file)
+	{
+		delete_file(output_file);
+		LocalFree((HLOCAL)output_file);
+	}
+
+	patch_writer_free(&rewriter.writer);
+	libreplace_memory_free(expected);
+	test_pattern_free(&test);
+
+	if(output_memory)
+	{
+		LocalFree((HLOCAL)output_memory);
+	}
+
+	if(haystack)
+	{
+		LocalFree((HLOCAL)haystack);
+	}
+
+	if(result)
+	{
+		LocalFree((HLOCAL)result);
+	}
+
+	return success;
+}
+
+/* the needle has to contain a non-zero literal byte, otherwise a match could lie entirely within a hole */
+static BOOL run_skip_holes_test(const BYTE *const needle, const DWORD needle_len, const BOOL expected)
+{
+	BOOL success = FALSE;
+	WORD *const needle_expanded = expand_wildcards(needle, needle_len, &MY_WILDCARD);
+	if(needle_expanded)
+	{
+		success = (extents_can_skip_holes(needle_expanded, needle_len) == expected);
+		LocalFree((HLOCAL)needle_expanded);
+	}
+	return success;
+}
+
+static BOOL run_translation_test_pass(const BOOL case_insensitive, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected, const BOOL bulk_io)
 {
 	BOOL success = FALSE;
 	memory_input_t input_context;
 	memory_output_t *output_context = NULL;
 	libreplace_io_t io_functions;
 	libreplace_flags_t options;
-	WORD *needle_expanded = NULL;
+	WORD table[256U];
 	DWORD replacement_count = 0U;
 
-	const DWORD needle_len      = lstrlenA(needle);
-	const DWORD replacement_len = lstrlenA(replacement);
-	const DWORD expected_len    = lstrlenA(expected);
+	const DWORD expected_len = lstrlenA(expected);
 
 	init_memory_input(&input_context, (const BYTE*)haystack, lstrlenA(haystack));
 	SecureZeroMemory(&options, sizeof(libreplace_flags_t));
 
-	options.dry_run = dry_run;
 	options.case_insensitive = case_insensitive;
 
-	if(!(output_context = alloc_memory_output(expected_len + 2U)))
+	if(!build_translation_table(table, (const BYTE*)needle, lstrlenA(needle), (const BYTE*)replacement, lstrlenA(replacement)))
 	{
 		goto cleanup;
 	}
 
-	needle_expanded = expand_wildcards((BYTE*)needle, needle_len, globbing ? &MY_WILDCARD : NULL);
-	if(!needle_expanded)
+	if(!(output_context = alloc_memory_output(expected_len + 2U)))
 	{
 		goto cleanup;
 	}
 
 	init_io_functions(&io_functions, memory_read_byte, memory_write_byte, (DWORD_PTR)&input_context, (DWORD_PTR)output_context);
+	if(bulk_io)
+	{
+		init_io_bulk_functions(&io_functions, memory_read_bulk, memory_write_bulk);
+	}
 
-	if(!libreplace_search_and_replace(&io_functions, NULL, needle_expanded, needle_len, (const BYTE*)replacement, replacement_len, &options, &replacement_count, &g_abort_requested))
+	if(!libreplace_translate(&io_functions, NULL, table, &options, &replacement_count, &g_abort_requested))
 	{
 		goto cleanup;
 	}
-	
+
 	if(output_context->flushed == expected_len)
 	{
 		success = (lstrcmpA((LPCSTR)output_context->buffer, expected) == 0L);
@@ -81,9 +1428,90 @@ cleanup:
 		LocalFree((HLOCAL)output_context);
 	}
 
-	if(needle_expanded)
+	return success;
+}
+
+static BOOL run_translation_test(const BOOL case_insensitive, const CHAR *const needle, const CHAR *const replacement, const CHAR *const haystack, const CHAR *const expected)
+{
+	return run_translation_test_pass(case_insensitive, needle, replacement, haystack, expected, FALSE) && run_translation_test_pass(case_insensitive, needle, replacement, haystack, expected, TRUE);
+}
+
+/* every kernel set must translate random input just like the scalar kernels, with few (compared) or many (nibble-split) translated bytes */
+static BOOL run_translation_kernel_test(const BOOL case_insensitive, const CHAR *const alphabet, const CHAR *const needle, const CHAR *const replacement)
+{
+	BOOL success = FALSE;
+	DWORD kernels, replacement_count, reference_count = 0U;
+	memory_input_t input_context;
+	memory_output_t *reference = NULL, *output_context = NULL;
+	libreplace_io_t io_functions;
+	libreplace_flags_t options;
+	WORD table[256U];
+	BYTE *haystack = NULL;
+
+	const DWORD haystack_len = 100003U;
+
+	SecureZeroMemory(&options, sizeof(libreplace_flags_t));
+	options.case_insensitive = case_insensitive;
+
+	if(!(build_translation_table(table, (const BYTE*)needle, lstrlenA(needle), (const BYTE*)replacement, lstrlenA(replacement)) && (haystack = build_kernel_input(alphabet, alphabet, "", haystack_len))))
 	{
-		LocalFree((HLOCAL)needle_expanded);
+		goto cleanup;
+	}
+
+	for(kernels = LIBREPLACE_KERNELS_SCALAR; kernels <= LIBREPLACE_KERNELS_AVX512; ++kernels)
+	{
+		if(!libreplace_select_kernels(kernels))
+		{
+			break; /*not supported by this CPU*/
+		}
+		if(!(output_context = alloc_memory_output(haystack_len)))
+		{
+			goto cleanup;
+		}
+		init_memory_input(&input_context, haystack, haystack_len);
+		init_io_functions(&io_functions, memory_read_byte, memory_write_byte, (DWORD_PTR)&input_context, (DWORD_PTR)output_context);
+		init_io_bulk_functions(&io_functions, memory_read_bulk, memory_write_bulk);
+		replacement_count = 0U;
+		if(!libreplace_translate(&io_functions, NULL, table, &options, &replacement_count, &g_abort_requested))
+		{
+			goto cleanup;
+		}
+		if(!reference)
+		{
+			reference = output_context;
+			reference_count = replacement_count;
+			output_context = NULL;
+		}
+		else
+		{
+			if(!((replacement_count == reference_count) && compare_bytes(output_context->buffer, output_context->pos, reference->buffer, reference->pos)))
+			{
+				goto cleanup;
+			}
+			LocalFree((HLOCAL)output_context);
+			output_context = NULL;
+		}
+	}
+
+	success = (reference_count > 0U);
+
+cleanup:
+
+	libreplace_select_kernels(LIBREPLACE_KERNELS_AUTO);
+
+	if(output_context)
+	{
+		LocalFree((HLOCAL)output_context);
+	}
+
+	if(reference)
+	{
+		LocalFree((HLOCAL)reference);
+	}
+
+	if(haystack)
+	{
+		LocalFree((HLOCAL)haystack);
 	}
 
 	return success;
@@ -93,66 +1521,275 @@ cleanup:
 /* Self-test                                                               */
 /* ======================================================================= */
 
+static const DWORD CURSOR_EXPECTED_1[] = { 11U, 43U, 75U, 107U, MAXDWORD };
+static const DWORD CURSOR_EXPECTED_2[] = { 3U, 11U, 23U, 35U, 43U, 55U, 67U, 75U, 87U, 99U, 107U, 119U, MAXDWORD };
+static const DWORD CURSOR_EXPECTED_3[] = { 121U, 107U, 99U, 89U, 75U, 67U, 57U, 43U, 35U, 25U, 11U, 3U, MAXDWORD };
+
+/* dynamic Huffman codes, as written by zlib at level 9 */
+static const BYTE GZIP_TEST_DATA[] =
+{
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x35, 0x90, 0xC1, 0x6D, 0x05, 0x31,
+	0x08, 0x44, 0x5B, 0x99, 0x02, 0xBE, 0xB6, 0x8A, 0x1C, 0x73, 0x4D, 0x01, 0xC4, 0x26, 0x9B, 0x91,
+	0x8C, 0xED, 0x6F, 0xC3, 0x57, 0xCA, 0x0F, 0x9B, 0x55, 0x6E, 0x80, 0xE1, 0xCD, 0x8C, 0xDF, 0xC7,
+	0x52, 0x03, 0xE7, 0x0E, 0x43, 0x1D, 0x6D, 0x2C, 0x6C, 0x3A, 0xC4, 0xD4, 0x1F, 0x28, 0xA3, 0x6F,
+	0x2D, 0xAE, 0x1E, 0x0B, 0x52, 0x39, 0xB9, 0x0B, 0xFB, 0x09, 0x6D, 0xCC, 0xC7, 0xAD, 0x35, 0x0F,
+	0xA0, 0x8C, 0x6D, 0xA3, 0xC2, 0xD5, 0x66, 0x1E, 0xB3, 0x17, 0x56, 0xD6, 0xE8, 0x8E, 0x70, 0x34,
+	0xF9, 0x4C, 0x3C, 0xD4, 0x6F, 0xB4, 0xC2, 0xE4, 0xEC, 0x02, 0x69, 0x7C, 0x86, 0x1C, 0xF8, 0x70,
+	0x68, 0xA7, 0x25, 0x1B, 0xC6, 0xAB, 0x78, 0x65, 0x2B, 0xF6, 0xC0, 0x33, 0xB8, 0xD1, 0xC7, 0xF6,
+	0x15, 0x15, 0xFA, 0xA3, 0xAB, 0xD0, 0xC5, 0x39, 0x3A, 0xA2, 0x35, 0xB1, 0x32, 0x6E, 0xF2, 0xB5,
+	0xC4, 0xCD, 0x4B, 0xE9, 0x0F, 0xC9, 0x99, 0xCB, 0x50, 0x49, 0xE3, 0x96, 0x9E, 0xC6, 0x1D, 0x20,
+	0xA5, 0xFC, 0xC0, 0xDB, 0x85, 0x94, 0x70, 0x05, 0x57, 0xA4, 0x93, 0x3B, 0x2B, 0x3B, 0x96, 0xCE,
+	0xA5, 0xDF, 0xDA, 0xAB, 0xAE, 0x0C, 0x9E, 0x83, 0xD7, 0x68, 0x31, 0x53, 0x4E, 0xD3, 0x4E, 0x26,
+	0x85, 0xEE, 0xAD, 0x28, 0x6C, 0xED, 0xFF, 0x87, 0x32, 0x50, 0xE0, 0x2B, 0x4E, 0x8A, 0xA3, 0x5F,
+	0x86, 0x30, 0x65, 0x65, 0x13, 0xEB, 0xF8, 0x05, 0xD5, 0xA1, 0x0B, 0x82, 0x4E, 0x01, 0x00, 0x00
+};
+
 static BOOL self_test(const HANDLE log_output)
 {
 	BOOL success = TRUE;
 
-	RUN_TEST( 1, FALSE, FALSE, FALSE, "LTs3kx", "XJbf4A", "",       ""      );
-	RUN_TEST( 2, FALSE, FALSE, FALSE, "LTs3kx", "XJbf4A", "LTs3k",  "LTs3k" );
-	RUN_TEST( 3, FALSE, FALSE, FALSE, "LTs3kx", "XJbf4A", "LTs3kx", "XJbf4A");
+	RUN_TEST( 1, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "XJbf4A", "",       ""      );
+	RUN_TEST( 2, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "XJbf4A", "LTs3k",  "LTs3k" );
+	RUN_TEST( 3, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "XJbf4A", "LTs3kx", "XJbf4A");
 
-	RUN_TEST( 4, FALSE, FALSE, FALSE, "LTs3kx", "XJbf3A",
+	RUN_TEST( 4, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "XJbf3A",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHptv7toJhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHptv7toJhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay");
 
-	RUN_TEST( 5, FALSE, FALSE, FALSE, "LTs3kx", "XJbf3B",
+	RUN_TEST( 5, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "XJbf3B",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHpLTs3kxhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHpXJbf3BhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay");
 
-	RUN_TEST( 6, FALSE, FALSE, FALSE, "LTs3kx", "",
+	RUN_TEST( 6, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHpLTs3kxhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHphdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay");
 
-	RUN_TEST( 7, FALSE, FALSE, FALSE, "LTs3kx", "H4n3zWoHKfbX",
+	RUN_TEST( 7, FALSE, FALSE, FALSE, FALSE, "LTs3kx", "H4n3zWoHKfbX",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHpLTs3kxhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay",
 		"KJnsbsniWReHocwWghHKmtwue7zLXvT9Ai3twkgmHRahFxTV3EggbHpH4n3zWoHKfbXhdKWCyJ93vPmUqXVtwCuJvpvY9Avu4cojuRwknv7HCYpyNvzJWtdwvEEpsNNyq9JAay");
 
-	RUN_TEST( 8, FALSE, FALSE, FALSE, "ababaa", "YJbg3A",
+	RUN_TEST( 8, FALSE, FALSE, FALSE, FALSE, "ababaa", "YJbg3A",
 		"aaabaaaabbbaaabbaaaabaaaaabbabbaaaa3aabbbabbaabbbbabbabbbbbbbaabaaaabbaaabbbaaabbbaaaaababaaaaabaaabababaabbabbbabaabaAabaaabbaa",
 		"aaabaaaabbbaaabbaaaabaaaaabbabbaaaa3aabbbabbaabbbbabbabbbbbbbaabaaaabbaaabbbaaabbbaaaaYJbg3AaaabaaabYJbg3AbbabbbabaabaAabaaabbaa");
 
-	RUN_TEST( 9, FALSE, FALSE, FALSE, "abcabd", "XJcf3A",
+	RUN_TEST( 9, FALSE, FALSE, FALSE, FALSE, "abcabd", "XJcf3A",
 		"abbaccddbcccacbddabcabcdacdbcabcdcccbcdcadbdddcabbcadcdccbabaabacccccabcababcabddbcbbcaadccab4dbaddbdccbdcdbcXccbbbcabbaabdcadccd",
 		"abbaccddbcccacbddabcabcdacdbcabcdcccbcdcadbdddcabbcadcdccbabaabacccccabcabXJcf3Adbcbbcaadccab4dbaddbdccbdcdbcXccbbbcabbaabdcadccd");
 	
-	RUN_TEST(10, FALSE, FALSE, FALSE, "bcbbab", "XIbf3A",
+	RUN_TEST(10, FALSE, FALSE, FALSE, FALSE, "bcbbab", "XIbf3A",
 		"cbcaccbcaaaacccbaacaaccc3cbccbbbcaacbbcbabEaabaacccccbccbcbabacabbbcbbcbacccbabcabaccaabaaabbabcaababaabacbccbbccbaccccaccbcbbab",
 		"cbcaccbcaaaacccbaacaaccc3cbccbbbcaacbbcbabEaabaacccccbccbcbabacabbbcbbcbacccbabcabaccaabaaabbabcaababaabacbccbbccbaccccaccXIbf3A");
 
-	RUN_TEST(11, FALSE, FALSE, FALSE, "bcbbab", "WJbf3A",
+	RUN_TEST(11, FALSE, FALSE, FALSE, FALSE, "bcbbab", "WJbf3A",
 		"cbcaccbcaaaacccbaacaaccc3cbccbbbcaacbbcbabEaabaacccccbccbcbabacabbbcbbcbacccbabcabaccaabaaabbabcaababaabacbccbbccbaccccaccbbcbba",
 		"cbcaccbcaaaacccbaacaaccc3cbccbbbcaacbbcbabEaabaacccccbccbcbabacabbbcbbcbacccbabcabaccaabaaabbabcaababaabacbccbbccbaccccaccbbcbba");
 
-	RUN_TEST(12, FALSE, FALSE, FALSE, "bcbbab", "XJbf2A",
+	RUN_TEST(12, FALSE, FALSE, FALSE, FALSE, "bcbbab", "XJbf2A",
 		"bcbbacbcaccbcaaaacccbaacaaccc3cbccbbbcaacbbcbabEaabaacccccbccbcbabacabbbcbbcbacccbabcabaccaabaaabbabcaababaabacbccbbccbaccccaccb",
 		"bcbbacbcaccbcaaaacccbaacaaccc3cbccbbbcaacbbcbabEaabaacccccbccbcbabacabbbcbbcbacccbabcabaccaabaaabbabcaababaabacbccbbccbaccccaccb");
 
-	RUN_TEST(13, FALSE, FALSE, FALSE, "kokos", "XJbf4",
+	RUN_TEST(13, FALSE, FALSE, FALSE, FALSE, "kokos", "XJbf4",
 		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
 		"xxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxx");
 
-	RUN_TEST(14, TRUE, TRUE, FALSE, "caa", "XjQ",
+	RUN_TEST(14, TRUE, TRUE, FALSE, FALSE, "caa", "XjQ",
 		"7ccCAbbCACcAbAcbcbAbCbaCAbbbcAAbcWCibcCaACabCabCcCAbacAcAAcaCCbCbCcCCccbaaAaCAaaAcbCCCcAbaAcccAaAAbCcCCCAabbCACccCCCAcCacAAcCccC",
 		"7ccCAbbCACcAbAcbcbAbCbaCAbbbcAAbcWCibcCaACabCabCcCAbacAcAAcaCCbCbCcCCccbaaAaCAaaAcbCCCcAbaAcccAaAAbCcCCCAabbCACccCCCAcCacAAcCccC");
 
-	RUN_TEST(15, FALSE, TRUE, FALSE, "caa", "XjQ",
+	RUN_TEST(15, FALSE, TRUE, FALSE, FALSE, "caa", "XjQ",
 		"7ccCAbbCACcAbAcbcbAbCbaCAbbbcAAbcWCibcCaACabCabCcCAbacAcAAcaCCbCbCcCCccbaaAaCAaaAcbCCCcAbaAcccAaAAbCcCCCAabbCACccCCCAcCacAAcCccC",
 		"7ccCAbbCACcAbAcbcbAbCbaCAbbbXjQbcWCibcXjQCabCabCcCAbacAXjQcaCCbCbCcCCccbaaAaXjQaAcbCCCcAbaAccXjQAAbCcCCXjQbbCACccCCCAcCaXjQcCccC");
 
-	RUN_TEST(16, FALSE, FALSE, TRUE, "a?c", "Jbf",
+	RUN_TEST(16, FALSE, FALSE, TRUE, FALSE, "a?c", "Jbf",
 		"cabbababbbbcabcacacbabbbbbbccaacabbbcbccbabcbbbccaabbcbbccbcccbbabccaabbbbbbbcbabcaccabcbaccbaaccbcbacbabbbcacaccaccaaacacaabaac",
 		"cabbababbbbcJbfacacbabbbbbbccJbfabbbcbccbJbfbbbccaabbcbbccbcccbbJbfcaabbbbbbbcbJbfJbfJbfbJbfbJbfcbcbacbabbbcacJbfJbfaJbfacaabJbf");
 
+	RUN_TEST(17, FALSE, FALSE, FALSE, TRUE, "b\nc", "X",
+		"a\r\nb\rc\n\rd\r\r\ne\n\nf\r\n\r\ng\rh\n\ri\r\njklmnopqrstuvwxyz\r\nb\r\nc0123456789abcdef\r\r\r\n\n\n\r\r",
+		"a\nX\nd\n\ne\n\nf\n\ng\nh\ni\njklmnopqrstuvwxyz\nX0123456789abcdef\n\n\n\n\n\n");
+
+	RUN_TEST(18, FALSE, FALSE, FALSE, TRUE, "\n\n", "\n",
+		"0123456789abcde\r\n0123456789abcdef\r\n\r\n0123456789abcd\r\r0123456789abcdefghijklmnopqrstu\n\n\n",
+		"0123456789abcde\n0123456789abcdef\n0123456789abcd\n0123456789abcdefghijklmnopqrstu\n\n");
+
+	RUN_TEST(19, FALSE, TRUE, FALSE, FALSE, "b", "X",
+		"cabbababbbbcabcacacbabbbbbbccaacabbbcbccbabcbbbccaaBbcbbccbcccbbabccaabbbbbbbcbabcaccabcbaccbaaccbcbacbabbbcacaccaccaaacacaabaac",
+		"caXXaXaXXXXcaXcacacXaXXXXXXccaacaXXXcXccXaXcXXXccaaXXcXXccXcccXXaXccaaXXXXXXXcXaXcaccaXcXaccXaaccXcXacXaXXXcacaccaccaaacacaaXaac");
+
+	RUN_TEST(20, FALSE, FALSE, FALSE, FALSE, "c", "",
+		"cabbababbbbcabcacacbabbbbbbccaacabbbcbccbabcbbbccaabbcbbccbcccbbabccaabbbbbbbcbabcaccabcbaccbaaccbcbacbabbbcacaccaccaaacacaabaac",
+		"abbababbbbabaababbbbbbaaabbbbbabbbbaabbbbbbbabaabbbbbbbbabaabbabaabbababbbaaaaaaaaabaa");
+
+	RUN_TEST_EX(21, run_translation_test, FALSE, "abc", "ba",
+		"cabbababbbbcabcacacbabbbbbbccaacabbbcbccbabcbbbccaabbcbbccbcccbbabccaabbbbbbbcbabcaccabcbaccbaaccbcbacbabbbcacaccaccaaacacaabaac",
+		"baababaaaababbabaaaaaabbbaaaaabaaaabbaaaaaaababbaaaaaaaababbaababbaababaaabbbbbbbbbabb");
+
+	RUN_TEST_EX(22, run_translation_test, TRUE, "\\a\r", "/Z",
+		"C:\\Windows\\System32\\drivers\\etc\\hosts\r\nC:\\Program Files (x86)\\AVI-Mux_GUI\\AVIMux_GUI.exe\r\n",
+		"C:/Windows/System32/drivers/etc/hosts\nC:/ProgrZm Files (x86)/ZVI-Mux_GUI/ZVIMux_GUI.exe\n");
+
+	RUN_TEST_EX(23, run_restricted_test, FALSE, 2U, 0U, 0U, "kokos", "XJbf4",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx");
+
+	RUN_TEST_EX(24, run_restricted_test, FALSE, 0U, 12U, 80U, "kokos", "XJbf4",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx");
+
+	RUN_TEST_EX(25, run_restricted_test, TRUE, 2U, 0U, 0U, "kokos", "XJbf4",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxx");
+
+	RUN_TEST_EX(26, run_api_test, 0U, 1U, "kokos", "XJbf4",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx");
+
+	RUN_TEST_EX(27, run_api_test, TEST_REVERSE, 2U, "kokos", "XJbf4",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxx");
+
+	RUN_TEST_EX(28, run_api_test, TEST_NORMALIZE, 0U, "b\nc", "X",
+		"a\r\nb\rc\n\rd\r\r\ne\n\nf\r\n\r\ng\rh\n\ri\r\njklmnopqrstuvwxyz\r\nb\r\nc0123456789abcdef\r\r\r\n\n\n\r\r",
+		"a\nX\nd\n\ne\n\nf\n\ng\nh\ni\njklmnopqrstuvwxyz\nX0123456789abcdef\n\n\n\n\n\n");
+
+	RUN_TEST_EX(29, run_api_test, TEST_NORMALIZE, 1U, "b\nc", "X",
+		"a\r\nb\rc\n\rd\r\r\ne\n\nf\r\n\r\ng\rh\n\ri\r\njklmnopqrstuvwxyz\r\nb\r\nc0123456789abcdef\r\r\r\n\n\n\r\r",
+		"a\nX\n\rd\r\r\ne\n\nf\r\n\r\ng\rh\n\ri\r\njklmnopqrstuvwxyz\r\nb\r\nc0123456789abcdef\r\r\r\n\n\n\r\r");
+
+	RUN_TEST_EX(30, run_api_test, 0U, 0U, "kokos", "XJbf4",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxxxxxkokofxxxXJbf4nussxxxkokokoxxx");
+
+	RUN_TEST_EX(31, run_api_test, TEST_REVERSE, 2U, "kokos", "XJ",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxXJnussxxxkokokoxxxxxxkokofxxxXJnussxxxkokokoxxx");
+
+	RUN_TEST_EX(32, run_api_test, 0U, 0U, "?b", "",
+		"abcabcabc",
+		"ccc");
+
+	RUN_TEST_EX(33, run_cursor_test, 0U, "kokos",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx", CURSOR_EXPECTED_1);
+
+	RUN_TEST_EX(34, run_cursor_test, TEST_NOCASE, "k?K",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx", CURSOR_EXPECTED_2);
+
+	RUN_TEST_EX(35, run_cursor_test, TEST_REVERSE | TEST_NOCASE, "K?k",
+		"xxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxxxxxkokofxxxkokosnussxxxkokokoxxx", CURSOR_EXPECTED_3);
+
+	RUN_TEST_EX(36, run_api_test, TEST_CALLBACK, 0U, "k?k", "", "xkokxkakkikx",
+		"x<1kok>x<2kak><3kik>x");
+
+	RUN_TEST_EX(37, run_api_test, TEST_REVERSE | TEST_CALLBACK, 0U, "k?k", "", "xkokokx",
+		"xko<1kok>x");
+
+	RUN_TEST_EX(38, run_api_test, TEST_CALLBACK, 0U, "a", "", "banana",
+		"b<1a>n<2a>n<3a>");
+
+	RUN_TEST_EX(39, run_api_test, 0U, 0U, "id=??;", "id=\\2\\1;",
+		"id=12; id=ab;id=x;id=yz;",
+		"id=21; id=ba;id=x;id=zy;");
+
+	RUN_TEST_EX(40, run_api_test, TEST_REVERSE, 0U, "k?k", "[\\1\\1\\t]",
+		"xkokokxkak",
+		"xko[oo\t]x[aa\t]");
+
+	RUN_TEST_EX(41, run_api_test, 0U, 0U, "<?>", "\\1",
+		"a<b>c<>d<e><f>",
+		"abc<>def");
+
+	RUN_TEST_EX(42, run_kernel_test, 0U, "abAx\r\nyz", "abAx\r\nyz", "ab", "XYZ", NULL, FALSE);
+
+	RUN_TEST_EX(43, run_kernel_test, TEST_NOCASE | TEST_NORMALIZE, "abAx\r\nyz", "abAx\r\nyz", "a?\nz", "-", NULL, FALSE);
+
+	RUN_TEST_EX(44, run_kernel_test, TEST_NOCASE, "abAx\r\nyz", "abAx\r\nyz", "a", "", NULL, FALSE);
+
+	RUN_TEST_EX(45, run_kernel_test, TEST_NORMALIZE, "abAx\r\nyz", "abAx\r\nyz", "\n", "\r", NULL, FALSE);
+
+	RUN_TEST_EX(46, run_kernel_test, 0U, "abcdefgh", "abcdefgh", "abcz", "XY", "rare-byte prefilter", FALSE);
+
+	RUN_TEST_EX(47, run_kernel_test, 0U, "abcdefgh", "abcdefgh", "zabc", "XY", "first-byte prefilter", FALSE);
+
+	RUN_TEST_EX(48, run_kernel_test, TEST_NOCASE, "abcdefgh", "abcdefgh", "abCZ", "", "rare-byte prefilter", FALSE);
+
+	RUN_TEST_EX(49, run_kernel_test, 0U, "abcdefghijklmnopqrstuvwxyz", "abcdefghijklmnopqrstuvwxyz", "zyxwvutsrqponmlkjihgfedcba", "-", "skip table", FALSE);
+
+	RUN_TEST_EX(50, run_kernel_test, 0U, "ab", "ab", "abab?b", "XYZ", "bit-parallel", FALSE);
+
+	RUN_TEST_EX(51, run_kernel_test, TEST_NOCASE, "aAbB", "aAbB", "ABbA", "x", "bit-parallel", FALSE);
+
+	RUN_TEST_EX(52, run_kernel_test, 0U, "cdefgh", "ab", "aab", "X", "rare-byte prefilter", TRUE);
+
+	RUN_TEST_EX(53, run_kernel_test, 0U, "abcdefghijklmnopqrstuvwxyz", "bc", "zyxwvutsrqponmlkjihgfedcba", "-", "skip table", TRUE);
+
+	RUN_TEST_EX(54, run_gather_test, FALSE, "ab-", "ab", "XYZ", "XYZ-");
+
+	RUN_TEST_EX(55, run_gather_test, TRUE, "kokos", "ko", "", "s");
+
+	RUN_TEST_EX(56, run_gzip_test, NULL, 0U, "kokos banana \xA7\xFE\r\n", 80000U);
+
+	RUN_TEST_EX(57, run_gzip_test, GZIP_TEST_DATA, sizeof(GZIP_TEST_DATA),
+		"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+		"exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur.", 1U);
+
+	RUN_TEST_EX(58, run_tar_test, NULL, "kokos", "XJbf4",
+		"Ringo kokos hopsa kokos!",
+		"Ringo XJbf4 hopsa XJbf4!");
+
+	RUN_TEST_EX(59, run_tar_test, "*.conf", "kokos", "Babylon",
+		"kokoskokos\nkokos ko kokos\n",
+		"BabylonBabylon\nBabylon ko Babylon\n");
+
+	RUN_TEST_EX(60, run_patch_test, FALSE, 0U, "k?k", "[\\1\\1]",
+		"xkokxkakkikxxxxxxxxxxxxxkuk",
+		"x[oo]x[aa][ii]xxxxxxxxxxxxx[uu]");
+
+	RUN_TEST_EX(61, run_patch_test, FALSE, 2U, "kokos", "XJbf4",
+		"kokoskokos hopsa kokos!",
+		"XJbf4XJbf4 hopsa kokos!");
+
+	RUN_TEST_EX(62, run_patch_test, TRUE, 0U, "k?k", "<>",
+		"xkokxkakkikxxxxxxxxxxxxxkuk",
+		"x<>x<><>xxxxxxxxxxxxx<>");
+
+	RUN_TEST_EX(63, run_api_test, 0U, 0U, "k?k", "[\\1]",
+		"xkokxkakkikxxxxxxxxxxxxxkuk",
+		"x[o]x[a][i]xxxxxxxxxxxxx[u]");
+
+	RUN_TEST_EX(64, run_api_test, 0U, 2U, "kokos", "XJbf4",
+		"kokoskokos hopsa kokos!",
+		"XJbf4XJbf4 hopsa kokos!");
+
+	RUN_TEST_EX(65, run_commit_test, "k?k", "[\\1]", "xkokx ", "x[o]x ", 4000U);
+
+	RUN_TEST_EX(66, run_hole_test, "k??", "[\\1\\2]", "xkokxk", 100U, "kxxk", 0U);
+
+	RUN_TEST_EX(67, run_hole_test, "??k", "-", "kkk", 7U, "k?k", 0U);
+
+	RUN_TEST_EX(68, run_hole_test, "k", "XY", "", 4097U, "", 0U);
+
+	RUN_TEST_EX(69, run_hole_test, "k?k", "[\\1]", "xkokxkakk", 5U, "ikx kokos", 0U);
+
+	RUN_TEST_EX(70, run_hole_test, "kokos", "XJbf4", "kokoskokos", 0x10000U, " hopsa kokos!", 1U);
+
+	RUN_TEST_EX(71, run_hole_test, "k??", "[\\1\\2]", "xkokxk", 0x30000U, "kxxk", 0x20000U);
+
+	RUN_TEST_EX(72, run_hole_test, "kokos", "", "kokos kokos", 0x10001U, "kokos", 1U);
+
+	RUN_TEST_EX(73, run_hole_test, "??", "-", "kk", 0x10000U, "k", 0x10000U);
+
+	RUN_TEST_EX(74, run_skip_holes_test, (const BYTE*)"\0\0\0", 3U, FALSE);
+
+	RUN_TEST_EX(75, run_skip_holes_test, (const BYTE*)"???", 3U, FALSE);
+
+	RUN_TEST_EX(76, run_skip_holes_test, (const BYTE*)"?\0k", 3U, TRUE);
+
+	RUN_TEST_EX(77, run_translation_kernel_test, TRUE, "abcdefghijklmnopqrstuvwxyz\r\n", "abx\r", "AB-");
+
+	RUN_TEST_EX(78, run_translation_kernel_test, FALSE, "abcdefghijklmnopqrstuvwxyz\r\n", "abcdefghijklmnop\r", "ABCDEFGHIJKL");
+
+	RUN_TEST_EX(79, run_translation_kernel_test, TRUE, "abcdefghijklmnopqrstuvwxyzABC0123456789\r\n", "acegikmoqsuwy13579", "bdfhjlnprtvxz");
+
 	return success;
 }
 
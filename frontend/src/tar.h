@@ -0,0 +1,783 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#ifndef INC_TAR_H
+#define INC_TAR_H
+
+#include "libreplace/replace.h"
+#include "utils.h"
+
+/*
+ * Search & replace inside of a tar archive, in a single sequential pass. The
+ * data of each regular member whose name matches the filter is run through
+ * the library, all other members (and the headers) are copied in bulk. When
+ * the replacement can change the size of the data, the modified data of the
+ * member is buffered in memory, because the header that precedes it has to
+ * be written first; its size field and checksum are updated accordingly, as
+ * well as the "size" record of a preceding pax extended header, if any.
+ */
+
+#define TAR_BLOCK_SIZE 512U
+#define TAR_COPY_SIZE 0x10000U
+#define TAR_NAME_MAX 4096U
+#define TAR_EXT_MAX 0x100000U /*limit for the extended headers that precede a member*/
+
+#define TAR_OFFSET_NAME 0U
+#define TAR_OFFSET_SIZE 124U
+#define TAR_OFFSET_CHKSUM 148U
+#define TAR_OFFSET_TYPE 156U
+#define TAR_OFFSET_MAGIC 257U
+#define TAR_OFFSET_PREFIX 345U
+
+typedef struct tar_replace_t
+{
+	libreplace_context_t *context; /*search & replace mode*/
+	const WORD *translation_table; /*translate mode, if not NULL*/
+	const libreplace_flags_t *flags;
+	const BYTE *filter; /*glob for the member names, NULL to process all members*/
+	BOOL same_size; /*the replacement never changes the size of the data*/
+}
+tar_replace_t;
+
+typedef struct tar_state_t
+{
+	const libreplace_io_t *io_functions;
+	const libreplace_logger_t *logger;
+	const tar_replace_t *params;
+	BOOL read_error, write_error, spool_error;
+	BYTE header[TAR_BLOCK_SIZE];
+	BYTE copy_buffer[TAR_COPY_SIZE];
+	BYTE name[TAR_NAME_MAX];
+	BOOL long_name;
+	BYTE *ext; /*raw extended headers (including their data) that precede the current member*/
+	DWORD ext_len;
+	BOOL pax_size; /*the pax extended header has a "size" record*/
+	DWORD pax_offset, pax_data_len, pax_record, pax_record_len; /*position of the pax header and its "size" record*/
+	ULONGLONG pax_size_value;
+	BYTE *spool;
+	DWORD spool_len, spool_capacity;
+}
+tar_state_t;
+
+typedef struct tar_member_t
+{
+	tar_state_t *state;
+	ULONGLONG remaining;
+	ULONGLONG written;
+}
+tar_member_t;
+
+/* ======================================================================= */
+/* Helper functions                                                        */
+/* ======================================================================= */
+
+static BOOL tar_read(tar_state_t *const ctx, BYTE *const buffer, const DWORD length)
+{
+	DWORD pos = 0U, bytes_read;
+	while(pos < length)
+	{
+		if(!ctx->io_functions->func_rd_bulk(buffer + pos, length - pos, &bytes_read, ctx->io_functions->context_rd, &ctx->read_error))
+		{
+			break;
+		}
+		pos += bytes_read;
+	}
+	return (pos >= length);
+}
+
+static BOOL tar_write(tar_state_t *const ctx, const BYTE *const data, const DWORD length)
+{
+	if(length < 1U)
+	{
+		return TRUE;
+	}
+	if(!ctx->io_functions->func_wr_bulk(data, length, ctx->io_functions->context_wr))
+	{
+		ctx->write_error = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static const CHAR *tar_io_error(const tar_state_t *const ctx)
+{
+	return ctx->read_error ? "Failed to read the input archive!" : (ctx->write_error ? "Failed to write the output archive!" : "The tar archive is truncated!");
+}
+
+static BOOL tar_write_padding(tar_state_t *const ctx, const ULONGLONG size)
+{
+	static const BYTE ZERO_BLOCK[TAR_BLOCK_SIZE] = { 0U };
+	const DWORD remainder = (DWORD)(size % TAR_BLOCK_SIZE);
+	return (remainder > 0U) ? tar_write(ctx, ZERO_BLOCK, TAR_BLOCK_SIZE - remainder) : TRUE;
+}
+
+/* copies '<length>' bytes from the input to the output, or skips them with '<discard>' set */
+static BOOL tar_copy(tar_state_t *const ctx, ULONGLONG length, const BOOL discard)
+{
+	while(length > 0U)
+	{
+		const DWORD chunk = (length > TAR_COPY_SIZE) ? TAR_COPY_SIZE : ((DWORD)length);
+		if(!tar_read(ctx, ctx->copy_buffer, chunk))
+		{
+			return FALSE;
+		}
+		if((!discard) && (!tar_write(ctx, ctx->copy_buffer, chunk)))
+		{
+			return FALSE;
+		}
+		length -= chunk;
+	}
+	return TRUE;
+}
+
+/* copies the remaining input, i.e. whatever follows the end-of-archive marker */
+static BOOL tar_copy_rest(tar_state_t *const ctx)
+{
+	DWORD bytes_read;
+	while(ctx->io_functions->func_rd_bulk(ctx->copy_buffer, TAR_COPY_SIZE, &bytes_read, ctx->io_functions->context_rd, &ctx->read_error))
+	{
+		if(!tar_write(ctx, ctx->copy_buffer, bytes_read))
+		{
+			return FALSE;
+		}
+	}
+	return (!ctx->read_error);
+}
+
+static __inline ULONGLONG tar_round_up(const ULONGLONG size)
+{
+	return ((size + (TAR_BLOCK_SIZE - 1U)) / TAR_BLOCK_SIZE) * TAR_BLOCK_SIZE;
+}
+
+static void tar_log(const tar_state_t *const ctx, const CHAR *const text)
+{
+	if(ctx->params->flags->verbose && ctx->logger && ctx->logger->logging_func)
+	{
+		ctx->logger->logging_func(ctx->logger->context, text);
+	}
+}
+
+/* ======================================================================= */
+/* Header fields                                                           */
+/* ======================================================================= */
+
+static BOOL tar_is_zero_block(const BYTE *const block)
+{
+	DWORD pos;
+	for(pos = 0U; pos < TAR_BLOCK_SIZE; ++pos)
+	{
+		if(block[pos])
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static DWORD tar_checksum(const BYTE *const block, LONG *const signed_sum)
+{
+	DWORD pos, sum = 0U;
+	*signed_sum = 0L;
+	for(pos = 0U; pos < TAR_BLOCK_SIZE; ++pos)
+	{
+		const BYTE value = ((pos >= TAR_OFFSET_CHKSUM) && (pos < TAR_OFFSET_CHKSUM + 8U)) ? 0x20U : block[pos];
+		sum += value;
+		*signed_sum += (LONG)((CHAR)value);
+	}
+	return sum;
+}
+
+static BOOL tar_parse_number(const BYTE *const field, const DWORD field_len, ULONGLONG *const value)
+{
+	DWORD pos = 0U;
+	*value = 0U;
+	if(field[0U] & 0x80U)
+	{
+		/* GNU base-256 encoding, for values that do not fit into the octal field */
+		if(field[0U] & 0x40U)
+		{
+			return FALSE; /*negative*/
+		}
+		for(pos = 0U; pos < field_len; ++pos)
+		{
+			if(*value >> 56)
+			{
+				return FALSE;
+			}
+			*value = (*value << 8) | (pos ? field[pos] : (field[0U] & 0x3FU));
+		}
+		return TRUE;
+	}
+	while((pos < field_len) && (field[pos] == 0x20U))
+	{
+		++pos;
+	}
+	for(; (pos < field_len) && (field[pos] >= '0') && (field[pos] <= '7'); ++pos)
+	{
+		if(*value >> 60)
+		{
+			return FALSE;
+		}
+		*value = (*value << 3) | (field[pos] - '0');
+	}
+	return ((pos >= field_len) || (field[pos] == 0x00U) || (field[pos] == 0x20U));
+}
+
+static void tar_format_octal(BYTE *const field, const DWORD digits, ULONGLONG value)
+{
+	DWORD pos;
+	for(pos = digits; pos > 0U; --pos)
+	{
+		field[pos - 1U] = (BYTE)('0' + (value & 7U));
+		value >>= 3;
+	}
+}
+
+/* buffered members are smaller than 4 GiB, so the size always fits into the octal field */
+static void tar_format_size(BYTE *const header, const DWORD size)
+{
+	tar_format_octal(header + TAR_OFFSET_SIZE, 11U, size);
+	header[TAR_OFFSET_SIZE + 11U] = 0x00U;
+}
+
+static void tar_update_checksum(BYTE *const header)
+{
+	LONG signed_sum;
+	tar_format_octal(header + TAR_OFFSET_CHKSUM, 6U, tar_checksum(header, &signed_sum));
+	header[TAR_OFFSET_CHKSUM + 6U] = 0x00U;
+	header[TAR_OFFSET_CHKSUM + 7U] = 0x20U;
+}
+
+/* ======================================================================= */
+/* Member names                                                            */
+/* ======================================================================= */
+
+static void tar_set_name(tar_state_t *const ctx, const BYTE *const name, const DWORD name_len, const BOOL long_name)
+{
+	DWORD pos;
+	for(pos = 0U; (pos < name_len) && (pos < TAR_NAME_MAX - 1U) && name[pos]; ++pos)
+	{
+		ctx->name[pos] = name[pos];
+	}
+	ctx->name[pos] = 0x00U;
+	ctx->long_name = long_name;
+}
+
+static void tar_header_name(tar_state_t *const ctx)
+{
+	DWORD pos, len = 0U;
+	const BYTE *const header = ctx->header;
+	if((header[TAR_OFFSET_MAGIC] == 'u') && (header[TAR_OFFSET_MAGIC + 1U] == 's') && (header[TAR_OFFSET_MAGIC + 2U] == 't') && (header[TAR_OFFSET_MAGIC + 3U] == 'a') && (header[TAR_OFFSET_MAGIC + 4U] == 'r') && (header[TAR_OFFSET_MAGIC + 5U] == 0x00U))
+	{
+		for(pos = 0U; (pos < 155U) && header[TAR_OFFSET_PREFIX + pos]; ++pos)
+		{
+			ctx->name[len++] = header[TAR_OFFSET_PREFIX + pos];
+		}
+		if(len > 0U)
+		{
+			ctx->name[len++] = '/';
+		}
+	}
+	for(pos = 0U; (pos < 100U) && header[TAR_OFFSET_NAME + pos]; ++pos)
+	{
+		ctx->name[len++] = header[TAR_OFFSET_NAME + pos];
+	}
+	ctx->name[len] = 0x00U;
+}
+
+/* '*' matches any sequence of characters (including '/'), '?' matches any single character */
+static BOOL tar_match_name(const BYTE *const pattern, const BYTE *const name)
+{
+	const BYTE *pat = pattern, *str = name, *star_pat = NULL, *star_str = NULL;
+	while(*str)
+	{
+		if(*pat == '*')
+		{
+			star_pat = ++pat;
+			star_str = str;
+		}
+		else if((*pat == '?') || (*pat == *str))
+		{
+			++pat;
+			++str;
+		}
+		else if(star_pat)
+		{
+			pat = star_pat;
+			str = ++star_str;
+		}
+		else
+		{
+			return FALSE;
+		}
+	}
+	while(*pat == '*')
+	{
+		++pat;
+	}
+	return (*pat == 0x00U);
+}
+
+/* ======================================================================= */
+/* Extended headers                                                        */
+/* ======================================================================= */
+
+static BOOL tar_ext_append(tar_state_t *const ctx, const BYTE *const data, const DWORD length)
+{
+	DWORD pos;
+	if(length > TAR_EXT_MAX - ctx->ext_len)
+	{
+		return FALSE;
+	}
+	for(pos = 0U; pos < length; ++pos)
+	{
+		ctx->ext[ctx->ext_len++] = data[pos];
+	}
+	return TRUE;
+}
+
+/* pax records have the form "<length> <keyword>=<value>\n", the length includes the record itself */
+static void tar_parse_pax(tar_state_t *const ctx, const DWORD data_offset, const DWORD data_len)
+{
+	const BYTE *const data = ctx->ext + data_offset;
+	DWORD pos = 0U, record_len, key_pos, value_len;
+	ULONGLONG value;
+	while(pos < data_len)
+	{
+		for(record_len = 0U, key_pos = pos; (key_pos < data_len) && (data[key_pos] >= '0') && (data[key_pos] <= '9') && (record_len < data_len); ++key_pos)
+		{
+			record_len = (record_len * 10U) + (data[key_pos] - '0');
+		}
+		if((key_pos >= data_len) || (data[key_pos] != 0x20U) || (record_len < 1U) || (record_len > data_len - pos) || (data[pos + record_len - 1U] != '\n'))
+		{
+			return; /*malformed, the remaining records are copied as-is*/
+		}
+		++key_pos;
+		value_len = (pos + record_len) - (key_pos + 6U);
+		if((record_len > (key_pos - pos) + 6U) && (data[key_pos] == 'p') && (data[key_pos + 1U] == 'a') && (data[key_pos + 2U] == 't') && (data[key_pos + 3U] == 'h') && (data[key_pos + 4U] == '='))
+		{
+			tar_set_name(ctx, data + key_pos + 5U, value_len, TRUE);
+		}
+		else if((record_len > (key_pos - pos) + 6U) && (data[key_pos] == 's') && (data[key_pos + 1U] == 'i') && (data[key_pos + 2U] == 'z') && (data[key_pos + 3U] == 'e') && (data[key_pos + 4U] == '='))
+		{
+			for(value = 0U, key_pos += 5U; (key_pos < pos + record_len - 1U) && (data[key_pos] >= '0') && (data[key_pos] <= '9'); ++key_pos)
+			{
+				value = (value * 10U) + (data[key_pos] - '0');
+			}
+			ctx->pax_size = TRUE;
+			ctx->pax_size_value = value;
+			ctx->pax_record = data_offset + pos;
+			ctx->pax_record_len = record_len;
+		}
+		pos += record_len;
+	}
+}
+
+static BOOL tar_read_ext(tar_state_t *const ctx, const BYTE type, const ULONGLONG size)
+{
+	const DWORD header_offset = ctx->ext_len;
+	const ULONGLONG padded_size = tar_round_up(size);
+
+	if((padded_size > TAR_EXT_MAX) || (!tar_ext_append(ctx, ctx->header, TAR_BLOCK_SIZE)) || ((DWORD)padded_size > TAR_EXT_MAX - ctx->ext_len))
+	{
+		return FALSE;
+	}
+	if(!tar_read(ctx, ctx->ext + ctx->ext_len, (DWORD)padded_size))
+	{
+		return FALSE;
+	}
+	ctx->ext_len += (DWORD)padded_size;
+
+	switch(type)
+	{
+	case 'L':
+		tar_set_name(ctx, ctx->ext + header_offset + TAR_BLOCK_SIZE, (DWORD)size, TRUE);
+		break;
+	case 'x':
+		ctx->pax_size = FALSE;
+		ctx->pax_offset = header_offset;
+		ctx->pax_data_len = (DWORD)size;
+		tar_parse_pax(ctx, header_offset + TAR_BLOCK_SIZE, (DWORD)size);
+		break;
+	}
+	return TRUE;
+}
+
+static DWORD tar_format_decimal(BYTE *const buffer, ULONGLONG value)
+{
+	BYTE digits[20U];
+	DWORD count = 0U, pos;
+	do
+	{
+		digits[count++] = (BYTE)('0' + (value % 10U));
+		value /= 10U;
+	}
+	while(value > 0U);
+	for(pos = 0U; pos < count; ++pos)
+	{
+		buffer[pos] = digits[count - pos - 1U];
+	}
+	return count;
+}
+
+/* writes the pending extended headers, with the "size" record of the pax header set to '<size>' */
+static BOOL tar_write_ext(tar_state_t *const ctx, const ULONGLONG size)
+{
+	BYTE record[48U], header[TAR_BLOCK_SIZE];
+	DWORD record_len, total_len, pos, data_len;
+	const BYTE *data;
+
+	if((!ctx->pax_size) || (size == ctx->pax_size_value))
+	{
+		return tar_write(ctx, ctx->ext, ctx->ext_len);
+	}
+
+	/* the length prefix counts its own digits, so iterate until it is stable */
+	record_len = 0U;
+	do
+	{
+		total_len = record_len;
+		record_len = tar_format_decimal(record, total_len);
+		record[record_len++] = 0x20U;
+		record[record_len++] = 's'; record[record_len++] = 'i'; record[record_len++] = 'z'; record[record_len++] = 'e'; record[record_len++] = '=';
+		record_len += tar_format_decimal(record + record_len, size);
+		record[record_len++] = '\n';
+	}
+	while(record_len != total_len);
+
+	data = ctx->ext + ctx->pax_offset + TAR_BLOCK_SIZE;
+	data_len = (ctx->pax_data_len - ctx->pax_record_len) + record_len;
+	for(pos = 0U; pos < TAR_BLOCK_SIZE; ++pos)
+	{
+		header[pos] = ctx->ext[ctx->pax_offset + pos];
+	}
+	tar_format_size(header, data_len);
+	tar_update_checksum(header);
+
+	pos = ctx->pax_record - (ctx->pax_offset + TAR_BLOCK_SIZE);
+	if(!(tar_write(ctx, ctx->ext, ctx->pax_offset) && tar_write(ctx, header, TAR_BLOCK_SIZE) && tar_write(ctx, data, pos) && tar_write(ctx, record, record_len)
+		&& tar_write(ctx, data + pos + ctx->pax_record_len, ctx->pax_data_len - (pos + ctx->pax_record_len)) && tar_write_padding(ctx, data_len)))
+	{
+		return FALSE;
+	}
+
+	pos = ctx->pax_offset + TAR_BLOCK_SIZE + (DWORD)tar_round_up(ctx->pax_data_len);
+	return tar_write(ctx, ctx->ext + pos, ctx->ext_len - pos);
+}
+
+/* ======================================================================= */
+/* Member I/O                                                              */
+/* ======================================================================= */
+
+static __inline BOOL tar_member_read_byte(BYTE *const output, const DWORD_PTR input, BOOL *const error_flag)
+{
+	tar_member_t *const ctx = (tar_member_t*) input;
+	const libreplace_io_t *const io_functions = ctx->state->io_functions;
+	if((ctx->remaining > 0U) && io_functions->func_rd(output, io_functions->context_rd, error_flag))
+	{
+		--ctx->remaining;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static BOOL tar_member_read_bulk(BYTE *const output, const DWORD output_size, DWORD *const bytes_read, const DWORD_PTR input, BOOL *const error_flag)
+{
+	tar_member_t *const ctx = (tar_member_t*) input;
+	const libreplace_io_t *const io_functions = ctx->state->io_functions;
+	*bytes_read = 0U;
+	if((ctx->remaining > 0U) && io_functions->func_rd_bulk(output, (ctx->remaining < output_size) ? ((DWORD)ctx->remaining) : output_size, bytes_read, io_functions->context_rd, error_flag))
+	{
+		ctx->remaining -= *bytes_read;
+		return (*bytes_read > 0U);
+	}
+	return FALSE;
+}
+
+/* the data of a member whose size does not change is passed through to the output */
+static __inline BOOL tar_member_write_byte(const WORD input, const DWORD_PTR output)
+{
+	tar_member_t *const ctx = (tar_member_t*) output;
+	const libreplace_io_t *const io_functions = ctx->state->io_functions;
+	if(input == LIBREPLACE_FLUSH)
+	{
+		return TRUE; /*the archive is flushed once, at the end*/
+	}
+	++ctx->written;
+	return io_functions->func_wr(input, io_functions->context_wr);
+}
+
+static BOOL tar_member_write_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR output)
+{
+	tar_member_t *const ctx = (tar_member_t*) output;
+	const libreplace_io_t *const io_functions = ctx->state->io_functions;
+	ctx->written += data_len;
+	return io_functions->func_wr_bulk(data, data_len, io_functions->context_wr);
+}
+
+static BOOL tar_member_write_gather(const libreplace_span_t *const spans, const DWORD span_count, const DWORD_PTR output)
+{
+	tar_member_t *const ctx = (tar_member_t*) output;
+	const libreplace_io_t *const io_functions = ctx->state->io_functions;
+	DWORD span_id;
+	for(span_id = 0U; span_id < span_count; ++span_id)
+	{
+		ctx->written += spans[span_id].length;
+	}
+	return io_functions->func_wr_gather(spans, span_count, io_functions->context_wr);
+}
+
+/* otherwise, it is buffered, because the new size must be known before the header is written */
+static BOOL tar_spool_write_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR output)
+{
+	tar_state_t *const ctx = ((tar_member_t*) output)->state;
+	DWORD pos;
+	if(data_len > ctx->spool_capacity - ctx->spool_len)
+	{
+		DWORD capacity = ctx->spool_capacity;
+		BYTE *buffer;
+		while(data_len > capacity - ctx->spool_len)
+		{
+			if(capacity > (MAXDWORD >> 2))
+			{
+				ctx->spool_error = TRUE;
+				return FALSE;
+			}
+			capacity = capacity ? (capacity << 1) : TAR_COPY_SIZE;
+		}
+		if(!(buffer = (BYTE*)(ctx->spool ? LocalReAlloc((HLOCAL)ctx->spool, capacity, LMEM_MOVEABLE) : LocalAlloc(LMEM_FIXED, capacity))))
+		{
+			ctx->spool_error = TRUE;
+			return FALSE;
+		}
+		ctx->spool = buffer;
+		ctx->spool_capacity = capacity;
+	}
+	for(pos = 0U; pos < data_len; ++pos)
+	{
+		ctx->spool[ctx->spool_len++] = data[pos];
+	}
+	return TRUE;
+}
+
+static __inline BOOL tar_spool_write_byte(const WORD input, const DWORD_PTR output)
+{
+	tar_state_t *const ctx = ((tar_member_t*) output)->state;
+	BYTE value;
+	if(input == LIBREPLACE_FLUSH)
+	{
+		return TRUE;
+	}
+	if(ctx->spool_len < ctx->spool_capacity)
+	{
+		ctx->spool[ctx->spool_len++] = (BYTE)input;
+		return TRUE;
+	}
+	value = (BYTE)input;
+	return tar_spool_write_bulk(&value, 1U, output);
+}
+
+/* ======================================================================= */
+/* Archive processing                                                      */
+/* ======================================================================= */
+
+static BOOL tar_replace_member(tar_state_t *const ctx, const ULONGLONG size, DWORD *const replacement_count, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	const tar_replace_t *const params = ctx->params;
+	const BOOL stream = params->same_size || params->flags->dry_run; /*a dry run leaves the data unmodified*/
+	tar_member_t member;
+	libreplace_io_t io_functions;
+	DWORD count = 0U;
+	BOOL success;
+
+	member.state = ctx;
+	member.remaining = size;
+	member.written = 0U;
+	ctx->spool_len = 0U;
+
+	if(stream && (!(tar_write_ext(ctx, size) && tar_write(ctx, ctx->header, TAR_BLOCK_SIZE))))
+	{
+		*error_message = tar_io_error(ctx);
+		return FALSE;
+	}
+
+	init_io_functions(&io_functions, tar_member_read_byte, stream ? tar_member_write_byte : tar_spool_write_byte, (DWORD_PTR)&member, (DWORD_PTR)&member);
+	init_io_bulk_functions(&io_functions, tar_member_read_bulk, stream ? tar_member_write_bulk : tar_spool_write_bulk);
+	if(stream && ctx->io_functions->func_wr_gather)
+	{
+		init_io_gather_function(&io_functions, tar_member_write_gather);
+	}
+
+	success = params->translation_table ? libreplace_translate(&io_functions, ctx->logger, params->translation_table, params->flags, &count, abort_flag) : libreplace_context_run(params->context, &io_functions, ctx->logger, &count, abort_flag);
+	*replacement_count += count;
+
+	if(!success)
+	{
+		*error_message = ctx->spool_error ? "A member is too large to be buffered in memory!" : (ctx->read_error ? "Failed to read the input archive!" : "Failed to process the data of a member!");
+		return FALSE;
+	}
+	if((member.remaining > 0U) && (!tar_copy(ctx, member.remaining, TRUE)))
+	{
+		*error_message = tar_io_error(ctx);
+		return FALSE;
+	}
+
+	if(stream)
+	{
+		if(member.written != size)
+		{
+			*error_message = "The size of a member has changed unexpectedly!";
+			return FALSE;
+		}
+	}
+	else
+	{
+		tar_format_size(ctx->header, ctx->spool_len);
+		tar_update_checksum(ctx->header);
+		if(!(tar_write_ext(ctx, ctx->spool_len) && tar_write(ctx, ctx->header, TAR_BLOCK_SIZE) && tar_write(ctx, ctx->spool, ctx->spool_len)))
+		{
+			*error_message = tar_io_error(ctx);
+			return FALSE;
+		}
+	}
+
+	if(!(tar_copy(ctx, tar_round_up(size) - size, TRUE) && tar_write_padding(ctx, stream ? size : ctx->spool_len)))
+	{
+		*error_message = tar_io_error(ctx);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL tar_process(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const tar_replace_t *const params, DWORD *const replacement_count, const CHAR **const error_message, volatile BOOL *const abort_flag)
+{
+	BOOL success = FALSE;
+	LONG signed_sum;
+	ULONGLONG size;
+	DWORD checksum;
+	BYTE type;
+
+	tar_state_t *const ctx = (tar_state_t*) LocalAlloc(LPTR, sizeof(tar_state_t));
+	*replacement_count = 0U;
+	if(!(ctx && (ctx->ext = (BYTE*) LocalAlloc(LPTR, TAR_EXT_MAX))))
+	{
+		*error_message = "Failed to allocate the tar context!";
+		goto cleanup;
+	}
+
+	ctx->io_functions = io_functions;
+	ctx->logger = logger;
+	ctx->params = params;
+
+	for(;;)
+	{
+		if(*abort_flag)
+		{
+			goto cleanup;
+		}
+		if(!tar_read(ctx, ctx->header, TAR_BLOCK_SIZE))
+		{
+			if(ctx->read_error || (ctx->ext_len > 0U))
+			{
+				*error_message = tar_io_error(ctx);
+				goto cleanup;
+			}
+			break; /*archive without end-of-archive marker*/
+		}
+
+		/* end-of-archive marker, everything from here on is copied as-is */
+		if(tar_is_zero_block(ctx->header))
+		{
+			if(!(tar_write(ctx, ctx->header, TAR_BLOCK_SIZE) && tar_copy_rest(ctx)))
+			{
+				*error_message = tar_io_error(ctx);
+				goto cleanup;
+			}
+			break;
+		}
+
+		checksum = tar_checksum(ctx->header, &signed_sum);
+		if(!(tar_parse_number(ctx->header + TAR_OFFSET_CHKSUM, 8U, &size) && ((size == checksum) || (size == (ULONGLONG)((DWORD)signed_sum)))))
+		{
+			*error_message = "The tar archive is corrupt (header checksum mismatch)!";
+			goto cleanup;
+		}
+		if(!tar_parse_number(ctx->header + TAR_OFFSET_SIZE, 12U, &size))
+		{
+			*error_message = "The tar archive is corrupt (invalid member size)!";
+			goto cleanup;
+		}
+
+		type = ctx->header[TAR_OFFSET_TYPE];
+		if((type == 'x') || (type == 'g') || (type == 'L') || (type == 'K'))
+		{
+			if(!tar_read_ext(ctx, type, size))
+			{
+				*error_message = (ctx->read_error || (size <= TAR_EXT_MAX)) ? tar_io_error(ctx) : "The extended headers of a member are too large!";
+				goto cleanup;
+			}
+			continue;
+		}
+
+		if(ctx->pax_size)
+		{
+			size = ctx->pax_size_value;
+		}
+		if(!ctx->long_name)
+		{
+			tar_header_name(ctx);
+		}
+
+		if(((type == '0') || (type == '\0') || (type == '7')) && ((!params->filter) || tar_match_name(params->filter, ctx->name)))
+		{
+			tar_log(ctx, "Processing tar member: ");
+			tar_log(ctx, (const CHAR*)ctx->name);
+			tar_log(ctx, "\n");
+			if(!tar_replace_member(ctx, size, replacement_count, error_message, abort_flag))
+			{
+				goto cleanup;
+			}
+		}
+		else
+		{
+			if(!(tar_write(ctx, ctx->ext, ctx->ext_len) && tar_write(ctx, ctx->header, TAR_BLOCK_SIZE) && tar_copy(ctx, tar_round_up(size), FALSE)))
+			{
+				*error_message = tar_io_error(ctx);
+				goto cleanup;
+			}
+		}
+
+		ctx->ext_len = 0U;
+		ctx->pax_size = ctx->long_name = FALSE;
+	}
+
+	if(!io_functions->func_wr(LIBREPLACE_FLUSH, io_functions->context_wr))
+	{
+		*error_message = "Failed to write the output archive!";
+		goto cleanup;
+	}
+
+	success = TRUE;
+
+cleanup:
+
+	if(ctx)
+	{
+		if(ctx->spool)
+		{
+			LocalFree((HLOCAL)ctx->spool);
+		}
+		if(ctx->ext)
+		{
+			LocalFree((HLOCAL)ctx->ext);
+		}
+		LocalFree((HLOCAL)ctx);
+	}
+
+	return success;
+}
+
+#endif /*INC_TAR_H*/
@@ -17,10 +17,23 @@ typedef struct options_t
 	BOOL escpae_chars;
 	BOOL globbing;
 	BOOL binary_mode;
+	BOOL translate;
 	BOOL force_sync;
 	BOOL force_overwrite;
 	BOOL return_replace_count;
 	BOOL self_test;
+	BOOL direct_io;
+	BOOL sync_io;
+	BOOL group_commit;
+	BOOL decompress;
+	BOOL compress;
+	BOOL tar_mode;
+	const WCHAR *tar_filter;
+	BOOL emit_patch;
+	const WCHAR *apply_patch;
+	const WCHAR *undo_journal;
+	const WCHAR *checkpoint;
+	DWORD buffer_size;
 }
 options_t;
 
@@ -40,6 +53,9 @@ static const BYTE MY_WILDCARD = '?';
 #ifndef EXIT_ABORTED
 #define EXIT_ABORTED 130U
 #endif
+#ifndef EXIT_FAULT
+#define EXIT_FAULT 99U
+#endif
 
 /* Limits */
 #ifndef MAXUINT32
@@ -48,6 +64,9 @@ static const BYTE MY_WILDCARD = '?';
 #ifndef MAXINT32
 #define MAXINT32 ((INT32)(MAXUINT32 >> 1))
 #endif
+#ifndef MAXULONGLONG
+#define MAXULONGLONG ((ULONGLONG)~((ULONGLONG)0))
+#endif
 
 /* Unused parameter */
 #define UNUSED_PARAM(X) ((void)(X))
@@ -123,12 +142,12 @@ static BYTE *decode_hex_string(const WCHAR *input, DWORD *const length_out)
 	}
 
 	len = lstrlenW(input);
-	if((len < 1U) || ((len % 2U) != 0U))
+	if((len % 2U) != 0U)
 	{
 		return NULL;
 	}
 
-	if(!(result = (BYTE*) LocalAlloc(LPTR, sizeof(BYTE) * (len /= 2U))))
+	if(!(result = (BYTE*) LocalAlloc(LPTR, sizeof(BYTE) * ((len /= 2U) + 1U))))
 	{
 		return NULL;
 	}
@@ -148,6 +167,70 @@ static BYTE *decode_hex_string(const WCHAR *input, DWORD *const length_out)
 	return result;
 }
 
+static BOOL decode_number(const WCHAR *input, ULONGLONG *const value_out)
+{
+	ULONGLONG value = 0U;
+
+	if(!input[0U])
+	{
+		return FALSE;
+	}
+
+	for(; input[0U]; ++input)
+	{
+		const BYTE digit = (BYTE)(input[0U] - L'0');
+		if((input[0U] < L'0') || (input[0U] > L'9') || (value > (MAXULONGLONG / 10U)))
+		{
+			return FALSE;
+		}
+		value = (value << 3U) + (value << 1U); /*avoid CRT helpers for 64-Bit math*/
+		if(value > (MAXULONGLONG - digit))
+		{
+			return FALSE;
+		}
+		value += digit;
+	}
+
+	*value_out = value;
+	return TRUE;
+}
+
+static BOOL decode_escape_char(const BYTE c, BYTE *const output)
+{
+	switch(c)
+	{
+	case '0':
+		*output = '\0';
+		return TRUE;
+	case 'a':
+		*output = '\a';
+		return TRUE;
+	case 'b':
+		*output = '\b';
+		return TRUE;
+	case 't':
+		*output = '\t';
+		return TRUE;
+	case 'n':
+		*output = '\n';
+		return TRUE;
+	case 'v':
+		*output = '\v';
+		return TRUE;
+	case 'f':
+		*output = '\f';
+		return TRUE;
+	case 'r':
+		*output = '\r';
+		return TRUE;
+	case '\\':
+		*output = '\\';
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 static BOOL expand_escape_chars(BYTE *const string, DWORD *const len)
 {
 	DWORD pos_in, pos_out;
@@ -157,38 +240,11 @@ static BOOL expand_escape_chars(BYTE *const string, DWORD *const len)
 		if(flag)
 		{
 			flag = FALSE;
-			switch(string[pos_in])
+			if(!decode_escape_char(string[pos_in], string + pos_out++))
 			{
-			case '0':
-				string[pos_out++] = '\0';
-				continue;
-			case 'a':
-				string[pos_out++] = '\a';
-				continue;
-			case 'b':
-				string[pos_out++] = '\b';
-				continue;
-			case 't':
-				string[pos_out++] = '\t';
-				continue;
-			case 'n':
-				string[pos_out++] = '\n';
-				continue;
-			case 'v':
-				string[pos_out++] = '\v';
-				continue;
-			case 'f':
-				string[pos_out++] = '\f';
-				continue;
-			case 'r':
-				string[pos_out++] = '\r';
-				continue;
-			case '\\':
-				string[pos_out++] = '\\';
-				continue;
-			default:
 				return FALSE;
 			}
+			continue;
 		}
 		if(!(flag = (string[pos_in] == '\\')))
 		{
@@ -213,6 +269,41 @@ static BOOL expand_escape_chars(BYTE *const string, DWORD *const len)
 	}
 }
 
+static BOOL expand_back_references(const BYTE *const string, DWORD *const len, WORD *const output, const DWORD wildcard_count)
+{
+	DWORD pos_in, pos_out;
+	BOOL flag = FALSE;
+	BYTE value;
+	for(pos_in = pos_out = 0U; pos_in < *len; ++pos_in)
+	{
+		if(flag)
+		{
+			flag = FALSE;
+			if((string[pos_in] >= '1') && (string[pos_in] <= '9'))
+			{
+				if((DWORD)(string[pos_in] - '1') >= wildcard_count)
+				{
+					return FALSE;
+				}
+				output[pos_out++] = LIBREPLACE_CAPTURE(string[pos_in] - '1');
+				continue;
+			}
+			if(!decode_escape_char(string[pos_in], &value))
+			{
+				return FALSE;
+			}
+			output[pos_out++] = value;
+			continue;
+		}
+		if(!(flag = (string[pos_in] == '\\')))
+		{
+			output[pos_out++] = string[pos_in];
+		}
+	}
+	*len = pos_out;
+	return !flag;
+}
+
 static WORD *expand_wildcards(const BYTE *const needle, const DWORD needle_len, const BYTE *const wildcard_char)
 {
 	WORD *const result = (WORD*) LocalAlloc(LPTR, sizeof(WORD) * needle_len);
@@ -228,6 +319,24 @@ static WORD *expand_wildcards(const BYTE *const needle, const DWORD needle_len,
 	return NULL;
 }
 
+static BOOL build_translation_table(WORD *const table, const BYTE *const needle, const DWORD needle_len, const BYTE *const replacement, const DWORD replacement_len)
+{
+	DWORD pos;
+	if(replacement_len > needle_len)
+	{
+		return FALSE;
+	}
+	for(pos = 0U; pos < 256U; ++pos)
+	{
+		table[pos] = (WORD)pos;
+	}
+	for(pos = 0U; pos < needle_len; ++pos)
+	{
+		table[needle[pos]] = (pos < replacement_len) ? replacement[pos] : LIBREPLACE_DISCARD;
+	}
+	return TRUE;
+}
+
 /* ======================================================================= */
 /* Random Numbers                                                          */
 /* ======================================================================= */
@@ -346,7 +455,7 @@ static const WCHAR *get_directory_part(const WCHAR *const file_path)
 	return NULL;
 }
 
-static const HANDLE open_file(const WCHAR *const file_name, const BOOL write_mode)
+static const HANDLE open_file(const WCHAR *const file_name, const BOOL write_mode, const DWORD flags)
 {
 	HANDLE handle = INVALID_HANDLE_VALUE;
 	DWORD retry;
@@ -356,7 +465,7 @@ static const HANDLE open_file(const WCHAR *const file_name, const BOOL write_mod
 		{
 			Sleep(retry); /*delay before retry*/
 		}
-		if((handle = CreateFileW(file_name, write_mode ? GENERIC_WRITE : GENERIC_READ, write_mode ? 0U: FILE_SHARE_READ, NULL, write_mode ? CREATE_ALWAYS : OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+		if((handle = CreateFileW(file_name, write_mode ? GENERIC_WRITE : GENERIC_READ, write_mode ? 0U: FILE_SHARE_READ, NULL, write_mode ? CREATE_ALWAYS : OPEN_EXISTING, flags, NULL)) == INVALID_HANDLE_VALUE)
 		{
 			const DWORD error = GetLastError();
 			if(((!write_mode) && (error == ERROR_FILE_NOT_FOUND)) || (error == ERROR_PATH_NOT_FOUND) || (error == ERROR_INVALID_NAME))
@@ -372,7 +481,29 @@ static const HANDLE open_file(const WCHAR *const file_name, const BOOL write_mod
 	return INVALID_HANDLE_VALUE;
 }
 
-static const WCHAR *generate_temp_file(const WCHAR *const directory, HANDLE *const handle)
+/* create a file that does not exist yet; an existing file is never overwritten */
+static const HANDLE create_new_file(const WCHAR *const file_name)
+{
+	return CreateFileW(file_name, GENERIC_WRITE, 0U, NULL, CREATE_NEW, 0U, NULL);
+}
+
+/* overlapped I/O is only worthwhile for regular files, so other types of files are re-opened for synchronous I/O */
+static const HANDLE open_file_async(const WCHAR *const file_name, const BOOL write_mode, const DWORD flags, BOOL *const async)
+{
+	if(*async)
+	{
+		const HANDLE handle = open_file(file_name, write_mode, flags | FILE_FLAG_OVERLAPPED);
+		if((handle == INVALID_HANDLE_VALUE) || (GetFileType(handle) == FILE_TYPE_DISK))
+		{
+			return handle;
+		}
+		CloseHandle(handle);
+		*async = FALSE;
+	}
+	return open_file(file_name, write_mode, flags);
+}
+
+static const WCHAR *generate_temp_file(const WCHAR *const directory, HANDLE *const handle, const DWORD flags)
 {
 	static const WCHAR *const RAND_TEMPLATE = L"%s\\~%07X.tmp";
 	static const DWORD RAND_MASK = 0xFFFFFFF;
@@ -387,7 +518,7 @@ static const WCHAR *generate_temp_file(const WCHAR *const directory, HANDLE *con
 		for(round = 0U; (round < 16777213U) && (!g_abort_requested); ++round)
 		{
 			wsprintfW(temp, RAND_TEMPLATE, prefix, random_next(&random_state) & RAND_MASK);
-			if((*handle = CreateFileW(temp, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, 0, NULL)) == INVALID_HANDLE_VALUE)
+			if((*handle = CreateFileW(temp, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, flags, NULL)) == INVALID_HANDLE_VALUE)
 			{
 				if(GetLastError() != ERROR_FILE_EXISTS)
 				{
@@ -408,9 +539,37 @@ static const WCHAR *generate_temp_file(const WCHAR *const directory, HANDLE *con
 	return NULL;
 }
 
+/* number of syncs performed by this process; with '--group-commit', the output is synced only once */
+static volatile LONG g_sync_count = 0L;
+
+#ifndef NDEBUG
+/* debug builds only: if the environment variable is set to 'count', the process is killed, like in a crash */
+static void fault_point(const WCHAR *const name, const ULONGLONG count)
+{
+	WCHAR value[24U];
+	ULONGLONG trigger;
+	const DWORD value_len = GetEnvironmentVariableW(name, value, 24U);
+	if((value_len > 0U) && (value_len < 24U) && decode_number(value, &trigger) && (trigger == count))
+	{
+		TerminateProcess(GetCurrentProcess(), EXIT_FAULT);
+	}
+}
+#define FAULT_POINT(NAME, COUNT) fault_point((NAME), (COUNT))
+#else
+#define FAULT_POINT(NAME, COUNT) ((void)(COUNT))
+#endif
+
+static BOOL sync_file(const HANDLE handle)
+{
+	const LONG count = InterlockedIncrement(&g_sync_count);
+	FAULT_POINT(L"REPLACE_FAULT_SYNC", (ULONGLONG)count);
+	return FlushFileBuffers(handle);
+}
+
 static const BOOL move_file(const WCHAR *const file_src, const WCHAR *const file_dst)
 {
 	DWORD retry;
+	FAULT_POINT(L"REPLACE_FAULT_RENAME", 1U);
 	for(retry = 0U; (retry < 128U) && (!g_abort_requested); ++retry)
 	{
 		if(retry > 0U)
@@ -425,6 +584,12 @@ static const BOOL move_file(const WCHAR *const file_src, const WCHAR *const file
 	return FALSE;
 }
 
+/* make the complete output durable with a single sync, instead of syncing every buffer; pipes are never synced */
+static BOOL commit_file(const HANDLE handle)
+{
+	return (GetFileType(handle) != FILE_TYPE_DISK) || sync_file(handle);
+}
+
 static const BOOL delete_file(const WCHAR *const file_path)
 {
 	DWORD retry;
@@ -501,6 +666,33 @@ static __inline BOOL memory_read_byte(BYTE *const output, const DWORD_PTR input,
 	return FALSE;
 }
 
+static BOOL memory_read_bulk(BYTE *const output, const DWORD output_size, DWORD *const bytes_read, const DWORD_PTR input, BOOL *const error_flag)
+{
+	memory_input_t *const ctx = (memory_input_t*) input;
+	for(*bytes_read = 0U; (*bytes_read < output_size) && (ctx->pos < ctx->len); ++*bytes_read)
+	{
+		output[*bytes_read] = ctx->data_in[ctx->pos++];
+	}
+	UNUSED_PARAM(error_flag);
+	return (*bytes_read > 0U);
+}
+
+static BOOL memory_read_at(BYTE *const output, const DWORD output_size, const ULONGLONG offset, DWORD *const bytes_read, const DWORD_PTR input)
+{
+	const memory_input_t *const ctx = (const memory_input_t*) input;
+	for(*bytes_read = 0U; (*bytes_read < output_size) && (offset + *bytes_read < ctx->len); ++*bytes_read)
+	{
+		output[*bytes_read] = ctx->data_in[offset + *bytes_read];
+	}
+	return TRUE;
+}
+
+static BOOL memory_get_size(ULONGLONG *const size, const DWORD_PTR input)
+{
+	*size = ((const memory_input_t*) input)->len;
+	return TRUE;
+}
+
 static __inline BOOL memory_write_byte(const WORD input, const DWORD_PTR output)
 {
 	memory_output_t *const ctx = (memory_output_t*) output;
@@ -520,19 +712,96 @@ static __inline BOOL memory_write_byte(const WORD input, const DWORD_PTR output)
 	}
 }
 
+static BOOL memory_write_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR output)
+{
+	memory_output_t *const ctx = (memory_output_t*) output;
+	DWORD data_pos;
+	if(data_len > ctx->capacity - ctx->pos)
+	{
+		return FALSE;
+	}
+	for(data_pos = 0U; data_pos < data_len; ++data_pos)
+	{
+		ctx->buffer[ctx->pos++] = data[data_pos];
+	}
+	return TRUE;
+}
+
+static BOOL memory_write_gather(const libreplace_span_t *const spans, const DWORD span_count, const DWORD_PTR output)
+{
+	DWORD span_id;
+	for(span_id = 0U; span_id < span_count; ++span_id)
+	{
+		if(!memory_write_bulk(spans[span_id].data, spans[span_id].length, output))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /* ======================================================================= */
 /* File I/O Routines                                                       */
 /* ======================================================================= */
 
-#define IO_BUFF_SIZE 4096U
+/*
+ * The I/O buffers are sized per handle type: regular files get large buffers,
+ * so that a multi-GiB file is processed with a few thousand system calls only,
+ * whereas pipes and terminals get smaller ones, because the other side rarely
+ * transfers more than a pipe buffer at once. Sizes are multiples of the page
+ * size and the buffers are allocated once, page-aligned, via VirtualAlloc().
+ *
+ * With '--direct-io', regular files are opened with FILE_FLAG_NO_BUFFERING,
+ * so that a bulk rewrite does not evict the file system cache. Unbuffered I/O
+ * requires sector-aligned buffers, sizes and offsets; all transfers then go
+ * through our own buffers, whose sizes are multiples of the page size, and
+ * the final partial block is written padded and truncated afterwards. These
+ * buffers are backed by large pages, if the process may lock memory.
+ *
+ * Regular files are accessed via overlapped I/O: a ring of IO_ASYNC_DEPTH
+ * buffers, allocated once, keeps several reads (read-ahead) and writes
+ * (write-back) in flight, while the single processing thread is matching the
+ * data of the current buffer. Other handle types use synchronous I/O.
+ *
+ * The matching engine scans the data right in the input buffer (see
+ * file_read_view), and long runs of unmodified data are written from there
+ * (see file_write_direct), so that they are not copied at all. Only the short
+ * runs and the replacements are collected in the output buffer.
+ */
+#define IO_BUFF_SIZE_DISK 0x100000U /*1 MiB*/
+#define IO_BUFF_SIZE_PIPE 0x10000U  /*64 KiB*/
+#define IO_BUFF_SIZE_CHAR 0x1000U   /*4 KiB*/
+#define IO_BUFF_SIZE_MIN  0x1000U
+#define IO_BUFF_SIZE_MAX  0x4000000U /*64 MiB*/
+
+#define IO_FLAGS_DIRECT_INPUT  (FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN)
+#define IO_FLAGS_DIRECT_OUTPUT FILE_FLAG_NO_BUFFERING
+#define IO_ASYNC_DEPTH 4U
+#define IO_DIRECT_MIN 0x10000U /*spans of this size are written without copying them*/
+
+typedef struct file_async_t
+{
+	OVERLAPPED overlapped[IO_ASYNC_DEPTH];
+	BYTE *buffer[IO_ASYNC_DEPTH];
+	DWORD length[IO_ASYNC_DEPTH];
+	BOOL pending[IO_ASYNC_DEPTH];
+	DWORD slot;
+	BOOL active;
+	BOOL eof;
+	ULONGLONG offset; /*file offset of the next request*/
+}
+file_async_t;
 
 typedef struct file_input_t
 { 
 	HANDLE handle_in;
 	BOOL pipe;
+	BOOL unbuffered;
+	file_async_t *async;
 	DWORD avail;
 	DWORD pos;
-	BYTE buffer[IO_BUFF_SIZE];
+	DWORD buffer_size;
+	BYTE *buffer;
 }
 file_input_t;
 
@@ -541,70 +810,524 @@ typedef struct file_output_t
 	HANDLE handle_out;
 	BOOL pipe;
 	BOOL force_sync;
+	BOOL unbuffered;
+	BOOL preallocated;
+	file_async_t *async;
+	ULONGLONG written; /*excluding the data still in the buffer*/
 	DWORD pos;
-	BYTE buffer[IO_BUFF_SIZE];
+	DWORD buffer_size;
+	BYTE *buffer;
 }
 file_output_t;
 
-static file_input_t *alloc_file_input(const HANDLE handle)
+static DWORD get_io_buffer_size(const DWORD file_type, const DWORD buffer_size)
+{
+	SYSTEM_INFO system_info;
+	DWORD size = buffer_size, page_size;
+	if(!size)
+	{
+		switch(file_type)
+		{
+		case FILE_TYPE_DISK:
+			size = IO_BUFF_SIZE_DISK;
+			break;
+		case FILE_TYPE_PIPE:
+			size = IO_BUFF_SIZE_PIPE;
+			break;
+		default:
+			size = IO_BUFF_SIZE_CHAR;
+		}
+	}
+	GetSystemInfo(&system_info);
+	page_size = (system_info.dwPageSize >= IO_BUFF_SIZE_MIN) ? system_info.dwPageSize : IO_BUFF_SIZE_MIN;
+	size = (size < IO_BUFF_SIZE_MIN) ? IO_BUFF_SIZE_MIN : ((size > IO_BUFF_SIZE_MAX) ? IO_BUFF_SIZE_MAX : size);
+	return ((size + page_size - 1U) / page_size) * page_size;
+}
+
+static BOOL enable_large_pages(void)
+{
+	HANDLE token;
+	TOKEN_PRIVILEGES privileges;
+	BOOL success = FALSE;
+	if(GetLargePageMinimum() && OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+	{
+		SecureZeroMemory(&privileges, sizeof(TOKEN_PRIVILEGES));
+		privileges.PrivilegeCount = 1U;
+		privileges.Privileges[0U].Attributes = SE_PRIVILEGE_ENABLED;
+		if(LookupPrivilegeValueW(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0U].Luid))
+		{
+			success = AdjustTokenPrivileges(token, FALSE, &privileges, 0U, NULL, NULL) && (GetLastError() == ERROR_SUCCESS);
+		}
+		CloseHandle(token);
+	}
+	return success;
+}
+
+static BYTE *alloc_io_buffer(DWORD *const buffer_size, const BOOL large_pages)
+{
+	BYTE *buffer;
+	if(large_pages)
+	{
+		const SIZE_T large_page_size = GetLargePageMinimum();
+		if((large_page_size > 0U) && (large_page_size <= IO_BUFF_SIZE_MAX))
+		{
+			const DWORD size = ((*buffer_size + ((DWORD)large_page_size) - 1U) / ((DWORD)large_page_size)) * ((DWORD)large_page_size);
+			if(buffer = (BYTE*) VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE))
+			{
+				*buffer_size = size;
+				return buffer;
+			}
+		}
+	}
+	return (BYTE*) VirtualAlloc(NULL, *buffer_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+static file_async_t *alloc_file_async(BYTE **const buffer, const DWORD buffer_size, const BOOL large_pages)
+{
+	DWORD slot, total_size = buffer_size * IO_ASYNC_DEPTH;
+	file_async_t *const async = (file_async_t*) LocalAlloc(LPTR, sizeof(file_async_t));
+	if(!async)
+	{
+		return NULL;
+	}
+	if(*buffer = alloc_io_buffer(&total_size, large_pages))
+	{
+		for(slot = 0U; slot < IO_ASYNC_DEPTH; ++slot)
+		{
+			async->buffer[slot] = *buffer + (slot * buffer_size);
+			if(!(async->overlapped[slot].hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)))
+			{
+				break;
+			}
+		}
+		if(slot >= IO_ASYNC_DEPTH)
+		{
+			return async;
+		}
+		while(slot > 0U)
+		{
+			CloseHandle(async->overlapped[--slot].hEvent);
+		}
+		VirtualFree(*buffer, 0U, MEM_RELEASE);
+		*buffer = NULL;
+	}
+	LocalFree((HLOCAL)async);
+	return NULL;
+}
+
+static void free_file_async(const HANDLE handle, file_async_t *const async)
+{
+	DWORD slot, bytes;
+	CancelIo(handle);
+	for(slot = 0U; slot < IO_ASYNC_DEPTH; ++slot)
+	{
+		if(async->pending[slot])
+		{
+			GetOverlappedResult(handle, &async->overlapped[slot], &bytes, TRUE); /*buffers must not be released while in use*/
+		}
+		CloseHandle(async->overlapped[slot].hEvent);
+	}
+	VirtualFree(async->buffer[0U], 0U, MEM_RELEASE);
+	LocalFree((HLOCAL)async);
+}
+
+static file_input_t *alloc_file_input(const HANDLE handle, const DWORD buffer_size, const BOOL unbuffered, const BOOL async, const BOOL large_pages)
 {
 	file_input_t *const ctx = (file_input_t*) LocalAlloc(LPTR, sizeof(file_input_t));
 	if(ctx)
 	{
+		const DWORD file_type = GetFileType(handle);
 		ctx->handle_in = handle;
-		ctx->pipe = (GetFileType(ctx->handle_in) == FILE_TYPE_PIPE);
+		ctx->pipe = (file_type == FILE_TYPE_PIPE);
+		ctx->unbuffered = unbuffered;
 		ctx->avail = ctx->pos = 0U;
+		ctx->buffer_size = get_io_buffer_size(file_type, buffer_size);
+		if(async)
+		{
+			ctx->async = alloc_file_async(&ctx->buffer, ctx->buffer_size, large_pages);
+		}
+		else
+		{
+			ctx->buffer = alloc_io_buffer(&ctx->buffer_size, large_pages);
+		}
+		if(!ctx->buffer)
+		{
+			LocalFree((HLOCAL)ctx);
+			return NULL;
+		}
 	}
 	return ctx;
 }
 
-static file_output_t *alloc_file_output(const HANDLE handle, const BOOL force_sync)
+static file_output_t *alloc_file_output(const HANDLE handle, const BOOL force_sync, const DWORD buffer_size, const BOOL unbuffered, const BOOL async, const BOOL large_pages)
 {
 	file_output_t *const ctx = (file_output_t*) LocalAlloc(LPTR, sizeof(file_output_t));
 	if(ctx)
 	{
+		const DWORD file_type = GetFileType(handle);
 		ctx->handle_out = handle;
-		ctx->pipe = (GetFileType(ctx->handle_out) == FILE_TYPE_PIPE);
+		ctx->pipe = (file_type == FILE_TYPE_PIPE);
 		ctx->force_sync = force_sync;
+		ctx->unbuffered = unbuffered;
+		ctx->preallocated = FALSE;
+		ctx->written = 0U;
 		ctx->pos = 0U;
+		ctx->buffer_size = get_io_buffer_size(file_type, buffer_size);
+		if(async)
+		{
+			ctx->async = alloc_file_async(&ctx->buffer, ctx->buffer_size, large_pages);
+		}
+		else
+		{
+			ctx->buffer = alloc_io_buffer(&ctx->buffer_size, large_pages);
+		}
+		if(!ctx->buffer)
+		{
+			LocalFree((HLOCAL)ctx);
+			return NULL;
+		}
 	}
 	return ctx;
 }
 
-static __inline BOOL file_read_byte(BYTE *const output, const DWORD_PTR input, BOOL *const error_flag)
+/* grow the output file to the expected size up-front, so that it does not get fragmented; the final flush truncates it */
+static BOOL preallocate_file_output(file_output_t *const ctx, const ULONGLONG size)
 {
-	file_input_t *const ctx = (file_input_t*) input;
-	if(ctx->pos >= ctx->avail)
+	LARGE_INTEGER offset;
+	offset.QuadPart = (LONGLONG)size;
+	if(SetFilePointerEx(ctx->handle_out, offset, NULL, FILE_BEGIN) && SetEndOfFile(ctx->handle_out))
+	{
+		offset.QuadPart = 0LL;
+		return (ctx->preallocated = SetFilePointerEx(ctx->handle_out, offset, NULL, FILE_BEGIN));
+	}
+	return FALSE;
+}
+
+/* pending requests are cancelled, so this must be called before the handle is closed */
+static void free_file_input(file_input_t *const ctx)
+{
+	if(ctx)
+	{
+		if(ctx->async)
+		{
+			free_file_async(ctx->handle_in, ctx->async);
+		}
+		else
+		{
+			VirtualFree(ctx->buffer, 0U, MEM_RELEASE);
+		}
+		LocalFree((HLOCAL)ctx);
+	}
+}
+
+static void free_file_output(file_output_t *const ctx)
+{
+	if(ctx)
 	{
-		DWORD sleep_timeout = ctx->pos = ctx->avail = 0U;
-		for(;;)
+		if(ctx->async)
 		{
-			if(ReadFile(ctx->handle_in, ctx->buffer, IO_BUFF_SIZE, &ctx->avail, NULL))
+			free_file_async(ctx->handle_out, ctx->async);
+		}
+		else
+		{
+			VirtualFree(ctx->buffer, 0U, MEM_RELEASE);
+		}
+		LocalFree((HLOCAL)ctx);
+	}
+}
+
+static DWORD copy_bytes(BYTE *const output, const BYTE *const input, const DWORD length)
+{
+	DWORD pos;
+	for(pos = 0U; pos < length; ++pos)
+	{
+		output[pos] = input[pos];
+	}
+	return length;
+}
+
+static BOOL file_read_data(file_input_t *const ctx, BYTE *const buffer, const DWORD buffer_size, DWORD *const bytes_read, BOOL *const error_flag)
+{
+	DWORD sleep_timeout = *bytes_read = 0U;
+	for(;;)
+	{
+		if(ReadFile(ctx->handle_in, buffer, buffer_size, bytes_read, NULL))
+		{
+			if(*bytes_read > 0U)
 			{
-				if(ctx->avail > 0U)
-				{
-					break; /*success*/
-				}
-				else if(!ctx->pipe)
-				{
-					return FALSE; /*EOF*/
-				}
+				return TRUE; /*success*/
 			}
-			else
+			else if(!ctx->pipe)
 			{
-				const DWORD error = GetLastError();
-				if((!ctx->pipe) || (error != ERROR_NO_DATA))
+				return FALSE; /*EOF*/
+			}
+		}
+		else
+		{
+			const DWORD error = GetLastError();
+			if((!ctx->pipe) || (error != ERROR_NO_DATA))
+			{
+				if((error != ERROR_HANDLE_EOF) && (error != ERROR_BROKEN_PIPE))
 				{
-					if((error != ERROR_HANDLE_EOF) && (error != ERROR_BROKEN_PIPE))
-					{
-						*error_flag = TRUE;
-					}
-					return FALSE; /*failed or EOF*/
+					*error_flag = TRUE;
 				}
+				return FALSE; /*failed or EOF*/
 			}
-			if(g_abort_requested)
+		}
+		if(g_abort_requested)
+		{
+			*error_flag = TRUE;
+			return FALSE; /*aborted*/
+		}
+		if(sleep_timeout++)
+		{
+			Sleep(sleep_timeout >> 8);
+		}
+	}
+}
+
+static BOOL file_async_submit(const HANDLE handle, file_async_t *const async, const DWORD slot, const DWORD length, const BOOL write_mode)
+{
+	OVERLAPPED *const overlapped = &async->overlapped[slot];
+	const HANDLE event = overlapped->hEvent;
+	SecureZeroMemory(overlapped, sizeof(OVERLAPPED));
+	overlapped->Offset = (DWORD)(async->offset & MAXDWORD);
+	overlapped->OffsetHigh = (DWORD)(async->offset >> 32U);
+	overlapped->hEvent = event;
+	if(!(write_mode ? WriteFile(handle, async->buffer[slot], length, NULL, overlapped) : ReadFile(handle, async->buffer[slot], length, NULL, overlapped)))
+	{
+		if(GetLastError() != ERROR_IO_PENDING)
+		{
+			return FALSE; /*failed or EOF*/
+		}
+	}
+	async->pending[slot] = TRUE;
+	async->length[slot] = length;
+	async->offset += length;
+	return TRUE;
+}
+
+static BOOL file_async_wait(const HANDLE handle, file_async_t *const async, const DWORD slot, DWORD *const bytes_transferred)
+{
+	*bytes_transferred = 0U;
+	if(async->pending[slot])
+	{
+		async->pending[slot] = FALSE;
+		return GetOverlappedResult(handle, &async->overlapped[slot], bytes_transferred, TRUE);
+	}
+	return TRUE;
+}
+
+static BOOL file_read_ahead(file_input_t *const ctx, const DWORD slot)
+{
+	file_async_t *const async = ctx->async;
+	if((!async->eof) && (!file_async_submit(ctx->handle_in, async, slot, ctx->buffer_size, FALSE)))
+	{
+		async->eof = TRUE;
+		return (GetLastError() == ERROR_HANDLE_EOF);
+	}
+	return TRUE;
+}
+
+/* hand out the next buffer of the ring, after the previous one has been queued up for reading again */
+static BOOL file_read_async(file_input_t *const ctx, BOOL *const error_flag)
+{
+	file_async_t *const async = ctx->async;
+	DWORD slot;
+	if(async->active)
+	{
+		if(!file_read_ahead(ctx, async->slot))
+		{
+			*error_flag = TRUE;
+			return FALSE;
+		}
+		async->slot = (async->slot + 1U) % IO_ASYNC_DEPTH;
+	}
+	else
+	{
+		for(slot = 0U; slot < IO_ASYNC_DEPTH; ++slot)
+		{
+			if(!file_read_ahead(ctx, slot))
 			{
 				*error_flag = TRUE;
+				return FALSE;
+			}
+		}
+		async->active = TRUE;
+	}
+	if(!file_async_wait(ctx->handle_in, async, async->slot, &ctx->avail))
+	{
+		if(GetLastError() != ERROR_HANDLE_EOF)
+		{
+			*error_flag = TRUE;
+		}
+		async->eof = TRUE;
+		return FALSE;
+	}
+	if(ctx->avail < ctx->buffer_size)
+	{
+		async->eof = TRUE; /*short read, reached the end of the file*/
+	}
+	ctx->buffer = async->buffer[async->slot];
+	return (ctx->avail > 0U);
+}
+
+static BOOL file_read_buffer(file_input_t *const ctx, BOOL *const error_flag)
+{
+	ctx->pos = 0U;
+	if(ctx->async)
+	{
+		return file_read_async(ctx, error_flag);
+	}
+	return file_read_data(ctx, ctx->buffer, ctx->buffer_size, &ctx->avail, error_flag);
+}
+
+static __inline BOOL file_read_byte(BYTE *const output, const DWORD_PTR input, BOOL *const error_flag)
+{
+	file_input_t *const ctx = (file_input_t*) input;
+	if(ctx->pos >= ctx->avail)
+	{
+		if(!file_read_buffer(ctx, error_flag))
+		{
+			return FALSE;
+		}
+	}
+	*output = ctx->buffer[ctx->pos++];
+	return TRUE;
+}
+
+static BOOL file_read_bulk(BYTE *const output, const DWORD output_size, DWORD *const bytes_read, const DWORD_PTR input, BOOL *const error_flag)
+{
+	file_input_t *const ctx = (file_input_t*) input;
+	if(ctx->pos >= ctx->avail)
+	{
+		if((output_size >= ctx->buffer_size) && (!ctx->unbuffered) && (!ctx->async))
+		{
+			return file_read_data(ctx, output, output_size, bytes_read, error_flag); /*read directly into caller's buffer*/
+		}
+		if(!file_read_buffer(ctx, error_flag))
+		{
+			return FALSE;
+		}
+	}
+	*bytes_read = copy_bytes(output, ctx->buffer + ctx->pos, min(output_size, ctx->avail - ctx->pos));
+	ctx->pos += *bytes_read;
+	return TRUE;
+}
+
+/* hand out the buffered data without copying it; the data remains valid until the next read */
+static BOOL file_read_view(const BYTE **const data, const DWORD max_len, DWORD *const bytes_read, const DWORD_PTR input, BOOL *const error_flag)
+{
+	file_input_t *const ctx = (file_input_t*) input;
+	*bytes_read = 0U;
+	if(ctx->pos >= ctx->avail)
+	{
+		if(!file_read_buffer(ctx, error_flag))
+		{
+			return FALSE;
+		}
+	}
+	*data = ctx->buffer + ctx->pos;
+	ctx->pos += *bytes_read = min(max_len, ctx->avail - ctx->pos);
+	return TRUE;
+}
+
+/* make sure that at least '<min_len>' bytes are buffered, without consuming them; the buffer is refilled in place, unless it holds whole sectors or ring slots only */
+static BOOL file_peek_input(file_input_t *const ctx, const DWORD min_len, BOOL *const error_flag)
+{
+	DWORD bytes_read;
+	if(ctx->unbuffered || ctx->async)
+	{
+		if((ctx->pos >= ctx->avail) && (!file_read_buffer(ctx, error_flag)))
+		{
+			return FALSE;
+		}
+		return (ctx->avail - ctx->pos >= min_len);
+	}
+	while((ctx->avail - ctx->pos < min_len) && (ctx->avail < ctx->buffer_size))
+	{
+		if(!file_read_data(ctx, ctx->buffer + ctx->avail, ctx->buffer_size - ctx->avail, &bytes_read, error_flag))
+		{
+			break;
+		}
+		ctx->avail += bytes_read;
+	}
+	return (ctx->avail - ctx->pos >= min_len);
+}
+
+/* continue reading at another offset; any data that has been read ahead is discarded */
+static BOOL file_input_seek(file_input_t *const ctx, const ULONGLONG offset)
+{
+	file_async_t *const async = ctx->async;
+	LARGE_INTEGER position;
+	DWORD slot, bytes_read;
+	ctx->pos = ctx->avail = 0U;
+	if(async)
+	{
+		for(slot = 0U; slot < IO_ASYNC_DEPTH; ++slot)
+		{
+			file_async_wait(ctx->handle_in, async, slot, &bytes_read);
+		}
+		async->slot = 0U;
+		async->active = async->eof = FALSE;
+		async->offset = offset;
+		return TRUE;
+	}
+	position.QuadPart = (LONGLONG)offset;
+	return SetFilePointerEx(ctx->handle_in, position, NULL, FILE_BEGIN);
+}
+
+static BOOL file_read_at(BYTE *const output, const DWORD output_size, const ULONGLONG offset, DWORD *const bytes_read, const DWORD_PTR input)
+{
+	const file_input_t *const ctx = (const file_input_t*) input;
+	OVERLAPPED overlapped;
+	BOOL success;
+	SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = (DWORD)(offset & MAXDWORD);
+	overlapped.OffsetHigh = (DWORD)(offset >> 32U);
+	*bytes_read = 0U;
+	if(!(overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)))
+	{
+		return FALSE;
+	}
+	if(!(success = ReadFile(ctx->handle_in, output, output_size, bytes_read, &overlapped) || ((GetLastError() == ERROR_IO_PENDING) && GetOverlappedResult(ctx->handle_in, &overlapped, bytes_read, TRUE))))
+	{
+		*bytes_read = 0U;
+		success = (GetLastError() == ERROR_HANDLE_EOF);
+	}
+	CloseHandle(overlapped.hEvent);
+	return success;
+}
+
+static BOOL file_get_size(ULONGLONG *const size, const DWORD_PTR input)
+{
+	const file_input_t *const ctx = (const file_input_t*) input;
+	LARGE_INTEGER file_size;
+	if(GetFileSizeEx(ctx->handle_in, &file_size) && (file_size.QuadPart >= 0LL))
+	{
+		*size = (ULONGLONG)file_size.QuadPart;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static BOOL file_write_data(file_output_t *const ctx, const BYTE *const data, const DWORD data_len)
+{
+	DWORD offset, bytes_written = 0U, sleep_timeout = 0U;
+	for(offset = 0U; offset < data_len; offset += bytes_written)
+	{
+		if(!WriteFile(ctx->handle_out, data + offset, data_len - offset, &bytes_written, NULL))
+		{
+			return FALSE; /*failed*/
+		}
+		if(bytes_written < 1U)
+		{
+			if(!ctx->pipe)
+			{
+				return FALSE; /*failed*/
+			}
+			if(g_abort_requested)
+			{
 				return FALSE; /*aborted*/
 			}
 			if(sleep_timeout++)
@@ -613,47 +1336,197 @@ static __inline BOOL file_read_byte(BYTE *const output, const DWORD_PTR input, B
 			}
 		}
 	}
-	*output = ctx->buffer[ctx->pos++];
+	ctx->written += data_len;
+	if(ctx->force_sync)
+	{
+		sync_file(ctx->handle_out);
+	}
 	return TRUE;
 }
 
-static __inline BOOL file_write_byte(const WORD input, const DWORD_PTR output)
+/* queue up the current buffer for writing and switch to the next buffer of the ring, once its previous write has completed */
+static BOOL file_write_buffer(file_output_t *const ctx, const DWORD length)
 {
-	file_output_t *const ctx = (file_output_t*) output;
-	if(input != LIBREPLACE_FLUSH)
+	file_async_t *const async = ctx->async;
+	DWORD expected, bytes_written;
+	if(!async)
+	{
+		return file_write_data(ctx, ctx->buffer, length);
+	}
+	if(length > 0U)
+	{
+		async->offset = ctx->written;
+		if(!file_async_submit(ctx->handle_out, async, async->slot, length, TRUE))
+		{
+			return FALSE;
+		}
+		ctx->written += length;
+		async->slot = (async->slot + 1U) % IO_ASYNC_DEPTH;
+	}
+	expected = async->pending[async->slot] ? async->length[async->slot] : 0U;
+	if(!(file_async_wait(ctx->handle_out, async, async->slot, &bytes_written) && (bytes_written == expected)))
+	{
+		return FALSE;
+	}
+	ctx->buffer = async->buffer[async->slot];
+	return TRUE;
+}
+
+/* write straight from the caller's buffer, after the buffered data; with overlapped I/O, the write is positioned, and has to complete before the caller's buffer may change */
+static BOOL file_write_direct(file_output_t *const ctx, const BYTE *const data, const DWORD data_len)
+{
+	OVERLAPPED overlapped;
+	DWORD bytes_written = 0U;
+	BOOL success;
+	if(ctx->pos > 0U)
+	{
+		if(!file_write_buffer(ctx, ctx->pos))
+		{
+			return FALSE;
+		}
+		ctx->pos = 0U;
+	}
+	if(!ctx->async)
 	{
-		ctx->buffer[ctx->pos++] = (BYTE)(input & 0xFFU);
+		return file_write_data(ctx, data, data_len);
 	}
-	if((ctx->pos >= IO_BUFF_SIZE) || (input == LIBREPLACE_FLUSH))
+	SecureZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = (DWORD)(ctx->written & MAXDWORD);
+	overlapped.OffsetHigh = (DWORD)(ctx->written >> 32U);
+	if(!(overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)))
 	{
-		DWORD offset, bytes_written = 0U, sleep_timeout = 0U;
-		for(offset = 0U; offset < ctx->pos; offset += bytes_written)
+		return FALSE;
+	}
+	success = (WriteFile(ctx->handle_out, data, data_len, NULL, &overlapped) || (GetLastError() == ERROR_IO_PENDING)) && GetOverlappedResult(ctx->handle_out, &overlapped, &bytes_written, TRUE) && (bytes_written == data_len);
+	CloseHandle(overlapped.hEvent);
+	if(success)
+	{
+		ctx->written += data_len;
+		if(ctx->force_sync)
 		{
-			if(!WriteFile(ctx->handle_out, ctx->buffer + offset, ctx->pos - offset, &bytes_written, NULL))
+			sync_file(ctx->handle_out);
+		}
+	}
+	return success;
+}
+
+/* wait until all queued up writes have completed */
+static BOOL file_write_drain(file_output_t *const ctx)
+{
+	file_async_t *const async = ctx->async;
+	DWORD slot, bytes_written;
+	BOOL success = TRUE;
+	if(async)
+	{
+		for(slot = 0U; slot < IO_ASYNC_DEPTH; ++slot)
+		{
+			const DWORD length = async->pending[slot] ? async->length[slot] : 0U;
+			if(!(file_async_wait(ctx->handle_out, async, slot, &bytes_written) && (bytes_written == length)))
 			{
-				return FALSE; /*failed*/
+				success = FALSE;
 			}
-			if(bytes_written < 1U)
+		}
+	}
+	return success;
+}
+
+/* write out the buffered data; unbuffered I/O can only write whole sectors, so the file is truncated to the actual length afterwards */
+static BOOL file_flush_output(file_output_t *const ctx)
+{
+	LARGE_INTEGER length;
+	length.QuadPart = (LONGLONG)(ctx->written + ctx->pos);
+	if(!file_write_buffer(ctx, ctx->unbuffered ? (((ctx->pos + IO_BUFF_SIZE_MIN - 1U) / IO_BUFF_SIZE_MIN) * IO_BUFF_SIZE_MIN) : ctx->pos))
+	{
+		return FALSE;
+	}
+	ctx->pos = 0U;
+	if(!file_write_drain(ctx))
+	{
+		return FALSE;
+	}
+	if(ctx->unbuffered || ctx->preallocated)
+	{
+		if(!(SetFilePointerEx(ctx->handle_out, length, NULL, FILE_BEGIN) && SetEndOfFile(ctx->handle_out)))
+		{
+			return FALSE;
+		}
+		ctx->written = (ULONGLONG)length.QuadPart;
+		ctx->preallocated = FALSE;
+	}
+	return TRUE;
+}
+
+/* leave a gap of '<length>' bytes in the output, which reads as zeros; in a sparse file, the gap becomes a hole */
+static BOOL file_output_skip(file_output_t *const ctx, const ULONGLONG length)
+{
+	LARGE_INTEGER position;
+	if(!file_flush_output(ctx))
+	{
+		return FALSE;
+	}
+	ctx->written += length;
+	position.QuadPart = (LONGLONG)ctx->written;
+	return SetFilePointerEx(ctx->handle_out, position, NULL, FILE_BEGIN);
+}
+
+static __inline BOOL file_write_byte(const WORD input, const DWORD_PTR output)
+{
+	file_output_t *const ctx = (file_output_t*) output;
+	if(input == LIBREPLACE_FLUSH)
+	{
+		return file_flush_output(ctx);
+	}
+	ctx->buffer[ctx->pos++] = (BYTE)(input & 0xFFU);
+	if(ctx->pos >= ctx->buffer_size)
+	{
+		if(!file_write_buffer(ctx, ctx->pos))
+		{
+			return FALSE;
+		}
+		ctx->pos = 0U;
+	}
+	return TRUE;
+}
+
+static BOOL file_write_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR output)
+{
+	file_output_t *const ctx = (file_output_t*) output;
+	DWORD data_pos = 0U, chunk_len;
+	while(data_pos < data_len)
+	{
+		if((data_len - data_pos >= IO_DIRECT_MIN) && (!ctx->unbuffered))
+		{
+			return file_write_direct(ctx, data + data_pos, data_len - data_pos); /*write directly from caller's buffer*/
+		}
+		ctx->pos += chunk_len = copy_bytes(ctx->buffer + ctx->pos, data + data_pos, min(data_len - data_pos, ctx->buffer_size - ctx->pos));
+		data_pos += chunk_len;
+		if(ctx->pos >= ctx->buffer_size)
+		{
+			if(!file_write_buffer(ctx, ctx->pos))
 			{
-				if(!ctx->pipe)
-				{
-					return FALSE; /*failed*/
-				}
-				if(g_abort_requested)
-				{
-					return FALSE; /*aborted*/
-				}
-				if(sleep_timeout++)
-				{
-					Sleep(sleep_timeout >> 8);
-				}
+				return FALSE;
 			}
+			ctx->pos = 0U;
 		}
-		if(ctx->force_sync)
+	}
+	return TRUE;
+}
+
+/* the short spans of a block are coalesced into the output buffer, the long spans are written without copying them (see file_write_bulk) */
+static BOOL file_write_gather(const libreplace_span_t *const spans, const DWORD span_count, const DWORD_PTR output)
+{
+	file_output_t *const ctx = (file_output_t*) output;
+	DWORD span_id;
+	for(span_id = 0U; span_id < span_count; ++span_id)
+	{
+		if((spans[span_id].length < IO_DIRECT_MIN) && (spans[span_id].length < ctx->buffer_size - ctx->pos))
 		{
-			FlushFileBuffers(ctx->handle_out);
+			ctx->pos += copy_bytes(ctx->buffer + ctx->pos, spans[span_id].data, spans[span_id].length);
+		}
+		else if(!file_write_bulk(spans[span_id].data, spans[span_id].length, output))
+		{
+			return FALSE;
 		}
-		ctx->pos = 0U;
 	}
 	return TRUE;
 }
@@ -711,4 +1584,26 @@ static __inline void init_io_functions(libreplace_io_t *const io_functions, cons
 	io_functions->context_wr = context_wr;
 }
 
+static __inline void init_io_bulk_functions(libreplace_io_t *const io_functions, const libreplace_rd_bulk_func_t rd_bulk_func, const libreplace_wr_bulk_func_t wr_bulk_func)
+{
+	io_functions->func_rd_bulk = rd_bulk_func;
+	io_functions->func_wr_bulk = wr_bulk_func;
+}
+
+static __inline void init_io_gather_function(libreplace_io_t *const io_functions, const libreplace_wr_gather_func_t wr_gather_func)
+{
+	io_functions->func_wr_gather = wr_gather_func;
+}
+
+static __inline void init_io_view_function(libreplace_io_t *const io_functions, const libreplace_rd_view_func_t rd_view_func)
+{
+	io_functions->func_rd_view = rd_view_func;
+}
+
+static __inline void init_io_seek_functions(libreplace_io_t *const io_functions, const libreplace_rd_at_func_t rd_at_func, const libreplace_size_func_t size_func)
+{
+	io_functions->func_rd_at = rd_at_func;
+	io_functions->func_get_size = size_func;
+}
+
 #endif /*INC_UTILS_H*/
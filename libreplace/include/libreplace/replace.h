@@ -17,10 +17,37 @@
 
 #define LIBREPLACE_FLUSH    ((WORD)-1)
 #define LIBREPLACE_WILDCARD ((WORD)MAXWORD)
+#define LIBREPLACE_DISCARD  ((WORD)0x100)
 #define LIBREPLACE_MAXLEN   ((DWORD)(MAXDWORD >> 1))
 
+#define LIBREPLACE_CAPTURE(N) ((WORD)(0x200U + (N)))
+
+#define LIBREPLACE_KERNELS_AUTO   0U
+#define LIBREPLACE_KERNELS_SCALAR 1U
+#define LIBREPLACE_KERNELS_SSE2   2U
+#define LIBREPLACE_KERNELS_AVX2   3U
+#define LIBREPLACE_KERNELS_AVX512 4U
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef BOOL (*libreplace_rd_func_t)(BYTE *const data, const DWORD_PTR context, BOOL *const error_flag);
 typedef BOOL (*libreplace_wr_func_t)(const WORD data, const DWORD_PTR context);
+typedef BOOL (*libreplace_rd_bulk_func_t)(BYTE *const buffer, const DWORD buffer_size, DWORD *const bytes_read, const DWORD_PTR context, BOOL *const error_flag);
+typedef BOOL (*libreplace_wr_bulk_func_t)(const BYTE *const data, const DWORD data_len, const DWORD_PTR context);
+typedef BOOL (*libreplace_rd_at_func_t)(BYTE *const buffer, const DWORD buffer_size, const ULONGLONG offset, DWORD *const bytes_read, const DWORD_PTR context);
+typedef BOOL (*libreplace_size_func_t)(ULONGLONG *const size, const DWORD_PTR context);
+typedef BOOL (*libreplace_rd_view_func_t)(const BYTE **const data, const DWORD max_len, DWORD *const bytes_read, const DWORD_PTR context, BOOL *const error_flag);
+
+typedef struct libreplace_span_t
+{
+	const BYTE *data;
+	DWORD length;
+}
+libreplace_span_t;
+
+typedef BOOL (*libreplace_wr_gather_func_t)(const libreplace_span_t *const spans, const DWORD span_count, const DWORD_PTR context);
 
 typedef struct libreplace_io_t
 {
@@ -28,9 +55,24 @@ typedef struct libreplace_io_t
 	libreplace_wr_func_t func_wr;
 	DWORD_PTR context_rd;
 	DWORD_PTR context_wr;
+	libreplace_rd_bulk_func_t func_rd_bulk; /*optional*/
+	libreplace_wr_bulk_func_t func_wr_bulk; /*optional*/
+	libreplace_rd_at_func_t func_rd_at; /*optional*/
+	libreplace_size_func_t func_get_size; /*optional*/
+	libreplace_wr_gather_func_t func_wr_gather; /*optional, used for the output of the replacements*/
+	libreplace_rd_view_func_t func_rd_view; /*optional, the data is scanned in the reader's buffer, until the next read*/
 }
 libreplace_io_t;
 
+typedef struct libreplace_sink_t
+{
+	libreplace_wr_bulk_func_t func_write;
+	DWORD_PTR context;
+}
+libreplace_sink_t;
+
+typedef BOOL (*libreplace_match_func_t)(const BYTE *const match, const DWORD match_len, const ULONGLONG offset, const DWORD ordinal, const libreplace_sink_t *const output, const DWORD_PTR context);
+
 typedef BOOL (*libreplace_logging_func_t)(const DWORD_PTR context, const CHAR *const text);
 
 typedef struct libreplace_logger_t
@@ -48,9 +90,69 @@ typedef struct libreplace_flags_t
 	BOOL dry_run;
 	BOOL match_crlf;
 	BOOL verbose;
+	BOOL reverse;
+	DWORD max_replacements; /*0 = unlimited*/
+	ULONGLONG window_offset;
+	ULONGLONG window_length; /*0 = until end of input*/
 }
 libreplace_flags_t;
 
+typedef struct libreplace_pattern_t libreplace_pattern_t;
+typedef struct libreplace_context_t libreplace_context_t;
+
+typedef struct libreplace_matcher_t /*managed by the library, do not modify*/
+{
+	DWORD engine;
+	DWORD rare_pos;
+	BYTE rare_lo, rare_hi;
+	DWORD scan_bytes;
+	DWORD scan_steps;
+}
+libreplace_matcher_t;
+
+typedef struct libreplace_cursor_t /*caller-owned, do not modify*/
+{
+	const libreplace_pattern_t *pattern;
+	const BYTE *data;
+	SIZE_T range_lo;
+	SIZE_T range_hi;
+	SIZE_T position;
+	DWORD match_count;
+	libreplace_matcher_t matcher;
+}
+libreplace_cursor_t;
+
+libreplace_pattern_t *libreplace_pattern_compile(const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options);
+libreplace_pattern_t *libreplace_pattern_compile_template(const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options);
+void libreplace_pattern_free(libreplace_pattern_t *const pattern);
+
+libreplace_context_t *libreplace_context_create(const libreplace_pattern_t *const pattern);
+void libreplace_context_set_callback(libreplace_context_t *const context, const libreplace_match_func_t match_func, const DWORD_PTR match_context);
+void libreplace_context_reset(libreplace_context_t *const context);
+void libreplace_context_free(libreplace_context_t *const context);
+BOOL libreplace_context_run(libreplace_context_t *const context, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, volatile BOOL *const abort_flag);
+
+BOOL libreplace_feed(libreplace_context_t *const context, const BYTE *data, DWORD data_len, const libreplace_sink_t *const sink, const libreplace_logger_t *const logger);
+BOOL libreplace_finish(libreplace_context_t *const context, const libreplace_sink_t *const sink, const libreplace_logger_t *const logger, DWORD *const replacement_count);
+BOOL libreplace_progress(const libreplace_context_t *const context, ULONGLONG *const input_offset, DWORD *const replacement_count);
+BOOL libreplace_resume(libreplace_context_t *const context, const ULONGLONG input_offset, const DWORD replacement_count);
+
+BOOL libreplace_cursor_init(libreplace_cursor_t *const cursor, const libreplace_pattern_t *const pattern, const BYTE *const data, const SIZE_T data_len, const libreplace_logger_t *const logger);
+void libreplace_cursor_seek(libreplace_cursor_t *const cursor, const SIZE_T offset);
+BOOL libreplace_cursor_next(libreplace_cursor_t *const cursor, SIZE_T *const match_offset);
+
+BOOL libreplace_replace_memory(libreplace_context_t *const context, const BYTE *const input, const SIZE_T input_len, BYTE **const output, SIZE_T *const output_len, const libreplace_logger_t *const logger, DWORD *const replacement_count);
+void libreplace_memory_free(BYTE *const buffer);
+
+BOOL libreplace_select_kernels(const DWORD kernels);
+const CHAR *libreplace_kernels_name(void);
+
 BOOL libreplace_search_and_replace(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag);
+BOOL libreplace_search_and_replace_template(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag);
+BOOL libreplace_translate(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const table, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /*INC_LIBREPLACE_H*/
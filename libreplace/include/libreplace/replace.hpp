@@ -0,0 +1,238 @@
+/******************************************************************************/
+/* Replace, by LoRd_MuldeR <MuldeR2@GMX.de>                                   */
+/* This work has been released under the CC0 1.0 Universal license!           */
+/******************************************************************************/
+
+#ifndef INC_LIBREPLACE_HPP
+#define INC_LIBREPLACE_HPP
+
+#include "replace.h"
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#if (__cplusplus >= 202002L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 202002L))
+#include <span>
+#define LIBREPLACE_HAVE_SPAN 1
+#endif
+
+namespace libreplace
+{
+	/* Owned output buffer, released via libreplace_memory_free() */
+	class buffer
+	{
+	public:
+		buffer() noexcept : m_data(nullptr), m_size(0U) { }
+		buffer(buffer &&other) noexcept : m_data(other.m_data), m_size(other.m_size) { other.m_data = nullptr; other.m_size = 0U; }
+		~buffer() { libreplace_memory_free(m_data); }
+
+		buffer &operator=(buffer &&other) noexcept
+		{
+			if(this != &other)
+			{
+				libreplace_memory_free(m_data);
+				m_data = other.m_data;
+				m_size = other.m_size;
+				other.m_data = nullptr;
+				other.m_size = 0U;
+			}
+			return *this;
+		}
+
+		buffer(const buffer&) = delete;
+		buffer &operator=(const buffer&) = delete;
+
+		const BYTE *data() const noexcept { return m_data; }
+		std::size_t size() const noexcept { return m_size; }
+		bool empty() const noexcept { return m_size < 1U; }
+		std::string_view view() const noexcept { return std::string_view(reinterpret_cast<const char*>(m_data), m_size); }
+#ifdef LIBREPLACE_HAVE_SPAN
+		std::span<const std::byte> bytes() const noexcept { return std::span<const std::byte>(reinterpret_cast<const std::byte*>(m_data), m_size); }
+#endif
+
+	private:
+		friend class context;
+		BYTE *m_data;
+		SIZE_T m_size;
+	};
+
+	/* Immutable compiled pattern, may be shared by any number of contexts */
+	class pattern
+	{
+	public:
+		pattern(const std::string_view needle, const std::string_view replacement, const libreplace_flags_t &options = libreplace_flags_t(), const libreplace_logger_t *const logger = nullptr)
+			: m_pattern(nullptr)
+		{
+			if((needle.size() > LIBREPLACE_MAXLEN) || (replacement.size() > LIBREPLACE_MAXLEN))
+			{
+				throw std::length_error("libreplace: needle or replacement too long");
+			}
+			std::vector<WORD> needle_expanded(needle.begin(), needle.end());
+			for(WORD &value : needle_expanded)
+			{
+				value &= 0xFFU; /*no wildcards*/
+			}
+			if(!(m_pattern = libreplace_pattern_compile(logger, needle_expanded.data(), static_cast<DWORD>(needle.size()), reinterpret_cast<const BYTE*>(replacement.data()), static_cast<DWORD>(replacement.size()), &options)))
+			{
+				throw std::runtime_error("libreplace: failed to compile pattern");
+			}
+		}
+
+		pattern(pattern &&other) noexcept : m_pattern(other.m_pattern) { other.m_pattern = nullptr; }
+		~pattern() { libreplace_pattern_free(m_pattern); }
+
+		pattern &operator=(pattern &&other) noexcept
+		{
+			if(this != &other)
+			{
+				libreplace_pattern_free(m_pattern);
+				m_pattern = other.m_pattern;
+				other.m_pattern = nullptr;
+			}
+			return *this;
+		}
+
+		pattern(const pattern&) = delete;
+		pattern &operator=(const pattern&) = delete;
+
+		const libreplace_pattern_t *get() const noexcept { return m_pattern; }
+
+	private:
+		libreplace_pattern_t *m_pattern;
+	};
+
+	/* Read-only range over the match offsets in a buffer, no allocations per match */
+	class matches
+	{
+	public:
+		class iterator
+		{
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef SIZE_T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const SIZE_T *pointer;
+			typedef const SIZE_T &reference;
+
+			iterator() noexcept : m_cursor(nullptr), m_offset(0U) { }
+
+			reference operator*() const noexcept { return m_offset; }
+			iterator &operator++() noexcept { advance(); return *this; }
+			void operator++(int) noexcept { advance(); }
+			bool operator==(const iterator &other) const noexcept { return m_cursor == other.m_cursor; }
+			bool operator!=(const iterator &other) const noexcept { return m_cursor != other.m_cursor; }
+
+		private:
+			friend class matches;
+			explicit iterator(libreplace_cursor_t *const cursor) noexcept : m_cursor(cursor), m_offset(0U) { advance(); }
+
+			void advance() noexcept
+			{
+				if(!libreplace_cursor_next(m_cursor, &m_offset))
+				{
+					m_cursor = nullptr;
+				}
+			}
+
+			libreplace_cursor_t *m_cursor;
+			SIZE_T m_offset;
+		};
+
+		matches(const pattern &compiled, const std::string_view data)
+		{
+			init(compiled, reinterpret_cast<const BYTE*>(data.data()), data.size());
+		}
+
+#ifdef LIBREPLACE_HAVE_SPAN
+		matches(const pattern &compiled, const std::span<const std::byte> data)
+		{
+			init(compiled, reinterpret_cast<const BYTE*>(data.data()), data.size());
+		}
+#endif
+
+		void seek(const std::size_t offset) noexcept { libreplace_cursor_seek(&m_cursor, offset); }
+		std::size_t position() const noexcept { return m_cursor.position; }
+
+		iterator begin() noexcept { return iterator(&m_cursor); }
+		iterator end() const noexcept { return iterator(); }
+
+	private:
+		void init(const pattern &compiled, const BYTE *const data, const std::size_t data_len)
+		{
+			if(!libreplace_cursor_init(&m_cursor, compiled.get(), data, data_len, nullptr))
+			{
+				throw std::runtime_error("libreplace: failed to initialize cursor");
+			}
+		}
+
+		libreplace_cursor_t m_cursor;
+	};
+
+	/* Per-thread scratch state; the pattern must outlive the context */
+	class context
+	{
+	public:
+		explicit context(const pattern &compiled) : m_context(libreplace_context_create(compiled.get()))
+		{
+			if(!m_context)
+			{
+				throw std::bad_alloc();
+			}
+		}
+
+		context(context &&other) noexcept : m_context(other.m_context) { other.m_context = nullptr; }
+		~context() { libreplace_context_free(m_context); }
+
+		context &operator=(context &&other) noexcept
+		{
+			if(this != &other)
+			{
+				libreplace_context_free(m_context);
+				m_context = other.m_context;
+				other.m_context = nullptr;
+			}
+			return *this;
+		}
+
+		context(const context&) = delete;
+		context &operator=(const context&) = delete;
+
+		buffer replace(const std::string_view input, DWORD *const replacement_count = nullptr, const libreplace_logger_t *const logger = nullptr)
+		{
+			return replace(reinterpret_cast<const BYTE*>(input.data()), input.size(), replacement_count, logger);
+		}
+
+#ifdef LIBREPLACE_HAVE_SPAN
+		buffer replace(const std::span<const std::byte> input, DWORD *const replacement_count = nullptr, const libreplace_logger_t *const logger = nullptr)
+		{
+			return replace(reinterpret_cast<const BYTE*>(input.data()), input.size(), replacement_count, logger);
+		}
+#endif
+
+		libreplace_context_t *get() const noexcept { return m_context; }
+
+	private:
+		buffer replace(const BYTE *const input, const std::size_t input_len, DWORD *const replacement_count, const libreplace_logger_t *const logger)
+		{
+			buffer output;
+			DWORD count = 0U;
+			if(!libreplace_replace_memory(m_context, input, input_len, &output.m_data, &output.m_size, logger, &count))
+			{
+				throw std::runtime_error("libreplace: in-memory replacement failed");
+			}
+			if(replacement_count)
+			{
+				*replacement_count = count;
+			}
+			return output;
+		}
+
+		libreplace_context_t *m_context;
+	};
+}
+
+#endif /*INC_LIBREPLACE_HPP*/
@@ -21,20 +21,59 @@
 #define MY_INLINE __forceinline
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define LIBREPLACE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define LIBREPLACE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(LIBREPLACE_X86) && defined(__GNUC__)
+#include <cpuid.h>
+#define TARGET_SSE2   __attribute__((target("sse2")))
+#define TARGET_AVX2   __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+#ifdef __GNUC__
+#define BIT_SCAN_FORWARD(X) ((DWORD)__builtin_ctz(X))
+#else
+#include <intrin.h>
+static __forceinline DWORD BIT_SCAN_FORWARD(const DWORD value)
+{
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (DWORD)index;
+}
+#endif
+
 #define BYTE_CAST(X) ((BYTE)((X) & 0xFFU))
+#define BIT_SCAN_FORWARD64(X) ((((DWORD)(X)) != 0U) ? BIT_SCAN_FORWARD((DWORD)(X)) : (32U + BIT_SCAN_FORWARD((DWORD)((X) >> 32))))
 
 #define CHAR_LF ((BYTE)0x0AU)
 #define CHAR_CR ((BYTE)0x0DU)
 
-#define TO_UPPER(X) ((((X) >= 0x61U) && ((X) <= 0x7AU)) ? BYTE_CAST((X) - 0x20U) : (X))
-#define IS_WILDCARD(X,Y) (((X) == LIBREPLACE_WILDCARD) && (options->match_crlf || (((Y) != CHAR_LF) && ((Y) != CHAR_CR))))
-#define COMPARE_CHAR(X,Y) (options->case_insensitive ? (TO_UPPER(X) == TO_UPPER(Y)) : ((X) == (Y)))
+#ifndef MAXULONGLONG
+#define MAXULONGLONG ((ULONGLONG)~((ULONGLONG)0))
+#endif
 
-#define INCREMENT(VALUE, LIMIT) do \
-{ \
-	if(++(VALUE) >= (LIMIT)) { (VALUE) = 0U; } \
-} \
-while (0)
+#define BLOCK_SIZE 65536U
+#define SPAN_LIMIT 256U
+#define WINDOW_LENGTH(X) (((X)->window_length > 0U) ? (X)->window_length : MAXULONGLONG)
+#define BLOCK_LIMIT(X) (((X) < BLOCK_SIZE) ? ((DWORD)(X)) : BLOCK_SIZE)
+#define VIEW_LIMIT(X) (((X) < MAXDWORD) ? ((DWORD)(X)) : MAXDWORD)
+#define XLAT_MAX_PAIRS 8U
+#define BIT_PARALLEL_MAX 64U
+
+#define TO_UPPER(X) ((((X) >= 0x61U) && ((X) <= 0x7AU)) ? BYTE_CAST((X) - 0x20U) : (X))
+#define MATCH_CHAR(P,N,C) (((N) == (P)->fold[(C)]) || (((N) == LIBREPLACE_WILDCARD) && ((P)->options.match_crlf || (((C) != CHAR_LF) && ((C) != CHAR_CR)))))
 
 #define CHECK_ABORT_REQUEST() do \
 { \
@@ -51,150 +90,222 @@ static const CHAR *const RD_ERROR_MESSAGE = "Read operation failed -> aborting!\
 static const CHAR *const ABORTING_MESSAGE = "Process cancelled by user --> aborting!\n";
 
 /* ======================================================================= */
-/* Ring buffer                                                             */
+/* Utility Functions                                                       */
 /* ======================================================================= */
 
-typedef struct ringbuffer_t
-{ 
-	DWORD capacity;
-	DWORD valid;
-	DWORD index_write;
-	DWORD index_flush;
-	BYTE buffer[];
+static __inline BOOL libreplace_print(const libreplace_logger_t *const logger, const CHAR *const text)
+{
+	return (logger) ? logger->logging_func(logger->context, text) : TRUE;
+}
+
+static __inline DWORD libreplace_popcount(DWORD value)
+{
+	value = value - ((value >> 1) & 0x55555555U);
+	value = (value & 0x33333333U) + ((value >> 2) & 0x33333333U);
+	return (((value + (value >> 4)) & 0x0F0F0F0FU) * 0x01010101U) >> 24;
+}
+
+static __inline void libreplace_add_count(DWORD *const replacement_count, const DWORD value)
+{
+	*replacement_count = (value < MAXDWORD - *replacement_count) ? (*replacement_count + value) : MAXDWORD;
 }
-ringbuffer_t;
 
-static __inline ringbuffer_t *ringbuffer_alloc(const DWORD capacity)
+static __inline BOOL libreplace_print_fmt(const libreplace_logger_t *const logger, const CHAR *const format, ...)
 {
-	if((capacity > 0U) && (capacity < MAXDWORD))
+	CHAR temp[256U];
+	BOOL result = FALSE;
+	va_list ap;
+	va_start(ap, format);
+	if(wvsprintfA(temp, format, ap) > 0L)
 	{
-		ringbuffer_t *const ringbuffer = (ringbuffer_t*) LocalAlloc(LPTR, sizeof(ringbuffer_t) + (sizeof(BYTE) * capacity));
-		if(ringbuffer)
-		{
-			ringbuffer->capacity = capacity;
-			ringbuffer->index_write = ringbuffer->valid = 0U;
-			ringbuffer->index_flush = MAXDWORD;
-			return ringbuffer;
-		}
+		result = libreplace_print(logger, temp);
 	}
-	return NULL;
+	va_end(ap);
+	return result;
 }
 
-static MY_INLINE BOOL ringbuffer_append(const BYTE in, BYTE *const ptr_out, ringbuffer_t *const ringbuffer)
+static MY_INLINE BOOL libreplace_normalize(BYTE *const char_ptr, BYTE *const last_linbreak)
 {
-	MY_ASSERT(ringbuffer->index_flush == MAXDWORD);
-	*ptr_out = ringbuffer->buffer[ringbuffer->index_write];
-	ringbuffer->buffer[ringbuffer->index_write] = in;
-	INCREMENT(ringbuffer->index_write, ringbuffer->capacity);
-	if(ringbuffer->valid < ringbuffer->capacity)
+	if((*char_ptr == CHAR_LF) || (*char_ptr == CHAR_CR))
 	{
-		++ringbuffer->valid;
-		return FALSE;
+		if((*last_linbreak != 0U) && (*char_ptr != *last_linbreak))
+		{
+			*last_linbreak = 0U;
+			return FALSE;
+		}
+		*last_linbreak = *char_ptr;
+		*char_ptr = CHAR_LF;
+	}
+	else
+	{
+		*last_linbreak = 0U; /*not a line-break*/
 	}
 	return TRUE;
 }
 
-static MY_INLINE BYTE ringbuffer_peek(const ringbuffer_t *const ringbuffer)
+static __inline DWORD libreplace_normalize_scalar(const BYTE *const input, BYTE *const output, const DWORD length, BYTE *const last_linbreak)
 {
-	return ringbuffer->buffer[ringbuffer->index_write];
+	DWORD pos_in, pos_out = 0U;
+	for(pos_in = 0U; pos_in < length; ++pos_in)
+	{
+		BYTE char_in = input[pos_in];
+		if(libreplace_normalize(&char_in, last_linbreak))
+		{
+			output[pos_out++] = char_in;
+		}
+	}
+	return pos_out;
 }
 
-static MY_INLINE BOOL ringbuffer_compare(const ringbuffer_t *const ringbuffer, const WORD *needle, const libreplace_flags_t *const options)
+#ifdef LIBREPLACE_X86
+
+static TARGET_SSE2 DWORD libreplace_normalize_sse2(const BYTE *const input, BYTE *const output, const DWORD length, BYTE *const last_linbreak)
 {
-	if(ringbuffer->index_write == 0U)
+	DWORD pos_in = 0U, pos_out = 0U;
+	const __m128i vec_cr = _mm_set1_epi8((char)CHAR_CR);
+	for(; length - pos_in >= 16U; pos_in += 16U)
 	{
-		DWORD needle_pos;
-		for(needle_pos = 1U; needle_pos < ringbuffer->valid; ++needle_pos) /*first element is skipped!*/
+		const __m128i chunk = _mm_loadu_si128((const __m128i*)(input + pos_in));
+		DWORD mask = (DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, vec_cr));
+		if((*last_linbreak == CHAR_CR) && (input[pos_in] == CHAR_LF))
+		{
+			mask |= 1U; /*LF that completes a CR+LF pair from the previous chunk*/
+		}
+		_mm_storeu_si128((__m128i*)(output + pos_out), chunk);
+		if(!mask)
+		{
+			/*no CR in this chunk -> every LF is kept, so the chunk passes unmodified*/
+			*last_linbreak = (input[pos_in + 15U] == CHAR_LF) ? CHAR_LF : 0U;
+			pos_out += 16U;
+		}
+		else
 		{
-			if((!IS_WILDCARD(needle[needle_pos], ringbuffer->buffer[needle_pos])) && (!COMPARE_CHAR(ringbuffer->buffer[needle_pos], BYTE_CAST(needle[needle_pos]))))
+			const DWORD prefix = BIT_SCAN_FORWARD(mask);
+			if(prefix > 0U)
 			{
-				return FALSE;
+				*last_linbreak = (input[pos_in + prefix - 1U] == CHAR_LF) ? CHAR_LF : 0U;
 			}
+			pos_out += prefix + libreplace_normalize_scalar(input + pos_in + prefix, output + pos_out + prefix, 16U - prefix, last_linbreak);
 		}
 	}
-	else
+	return pos_out + libreplace_normalize_scalar(input + pos_in, output + pos_out, length - pos_in, last_linbreak);
+}
+
+static TARGET_AVX2 DWORD libreplace_normalize_avx2(const BYTE *const input, BYTE *const output, const DWORD length, BYTE *const last_linbreak)
+{
+	DWORD pos_in = 0U, pos_out = 0U;
+	const __m256i vec_cr = _mm256_set1_epi8((char)CHAR_CR);
+	for(; length - pos_in >= 32U; pos_in += 32U)
 	{
-		DWORD needle_pos, buffer_pos = ringbuffer->index_write;
-		INCREMENT(buffer_pos, ringbuffer->capacity);
-		for(needle_pos = 1U; needle_pos < ringbuffer->valid; ++needle_pos) /*first element is skipped!*/
+		const __m256i chunk = _mm256_loadu_si256((const __m256i*)(input + pos_in));
+		DWORD mask = (DWORD)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, vec_cr));
+		if((*last_linbreak == CHAR_CR) && (input[pos_in] == CHAR_LF))
+		{
+			mask |= 1U;
+		}
+		_mm256_storeu_si256((__m256i*)(output + pos_out), chunk);
+		if(!mask)
+		{
+			*last_linbreak = (input[pos_in + 31U] == CHAR_LF) ? CHAR_LF : 0U;
+			pos_out += 32U;
+		}
+		else
 		{
-			if((!IS_WILDCARD(needle[needle_pos], ringbuffer->buffer[buffer_pos])) && (!COMPARE_CHAR(ringbuffer->buffer[buffer_pos], BYTE_CAST(needle[needle_pos]))))
+			const DWORD prefix = BIT_SCAN_FORWARD(mask);
+			if(prefix > 0U)
 			{
-				return FALSE;
+				*last_linbreak = (input[pos_in + prefix - 1U] == CHAR_LF) ? CHAR_LF : 0U;
 			}
-			INCREMENT(buffer_pos, ringbuffer->capacity);
+			pos_out += prefix + libreplace_normalize_scalar(input + pos_in + prefix, output + pos_out + prefix, 32U - prefix, last_linbreak);
 		}
 	}
-	return TRUE;
+	return pos_out + libreplace_normalize_scalar(input + pos_in, output + pos_out, length - pos_in, last_linbreak);
 }
 
-static MY_INLINE BOOL ringbuffer_flush(BYTE *const out, ringbuffer_t *const ringbuffer)
+static TARGET_AVX512 DWORD libreplace_normalize_avx512(const BYTE *const input, BYTE *const output, const DWORD length, BYTE *const last_linbreak)
 {
-	if(ringbuffer->index_flush == MAXDWORD)
-	{
-		ringbuffer->index_flush = (ringbuffer->valid >= ringbuffer->capacity) ? ringbuffer->index_write : 0U;
-	}
-	if(ringbuffer->valid > 0U)
+	DWORD pos_in = 0U, pos_out = 0U;
+	const __m512i vec_cr = _mm512_set1_epi8((char)CHAR_CR);
+	for(; length - pos_in >= 64U; pos_in += 64U)
 	{
-		*out = ringbuffer->buffer[ringbuffer->index_flush];
-		--ringbuffer->valid;
-		INCREMENT(ringbuffer->index_flush, ringbuffer->capacity);
-		return TRUE;
+		const __m512i chunk = _mm512_loadu_si512((const void*)(input + pos_in));
+		ULONGLONG mask = (ULONGLONG)_mm512_cmpeq_epi8_mask(chunk, vec_cr);
+		if((*last_linbreak == CHAR_CR) && (input[pos_in] == CHAR_LF))
+		{
+			mask |= 1U;
+		}
+		_mm512_storeu_si512((void*)(output + pos_out), chunk);
+		if(!mask)
+		{
+			*last_linbreak = (input[pos_in + 63U] == CHAR_LF) ? CHAR_LF : 0U;
+			pos_out += 64U;
+		}
+		else
+		{
+			const DWORD prefix = BIT_SCAN_FORWARD64(mask);
+			if(prefix > 0U)
+			{
+				*last_linbreak = (input[pos_in + prefix - 1U] == CHAR_LF) ? CHAR_LF : 0U;
+			}
+			pos_out += prefix + libreplace_normalize_scalar(input + pos_in + prefix, output + pos_out + prefix, 64U - prefix, last_linbreak);
+		}
 	}
-	return FALSE;
-}
-
-static MY_INLINE void ringbuffer_reset(ringbuffer_t *const ringbuffer)
-{
-	ringbuffer->index_write = ringbuffer->valid = 0U;
-	ringbuffer->index_flush = MAXDWORD;
+	return pos_out + libreplace_normalize_scalar(input + pos_in, output + pos_out, length - pos_in, last_linbreak);
 }
 
-/* ======================================================================= */
-/* Utility Functions                                                       */
-/* ======================================================================= */
-
-static __inline BOOL libreplace_print(const libreplace_logger_t *const logger, const CHAR *const text)
-{
-	return (logger) ? logger->logging_func(logger->context, text) : TRUE;
-}
+#endif /*LIBREPLACE_X86*/
 
-static __inline BOOL libreplace_print_fmt(const libreplace_logger_t *const logger, const CHAR *const format, ...)
+static DWORD libreplace_normalize_offset(const BYTE *const input, const DWORD length, BYTE last_linbreak, const DWORD normalized_offset)
 {
-	CHAR temp[256U];
-	BOOL result = FALSE;
-	va_list ap;
-	va_start(ap, format);
-	if(wvsprintfA(temp, format, ap) > 0L)
+	DWORD pos_in, pos_out = 0U;
+	for(pos_in = 0U; (pos_in < length) && (pos_out < normalized_offset); ++pos_in)
 	{
-		result = libreplace_print(logger, temp);
+		BYTE char_in = input[pos_in];
+		if(libreplace_normalize(&char_in, &last_linbreak))
+		{
+			++pos_out;
+		}
 	}
-	va_end(ap);
-	return result;
+	return pos_in;
 }
 
-static MY_INLINE BOOL libreplace_normalize(BYTE *const char_ptr, BYTE *const last_linbreak)
+static __inline BOOL libreplace_read_block(BYTE *const buffer, const DWORD buffer_size, DWORD *const length, const libreplace_io_t *const io_functions, BOOL *const error_flag)
 {
-	if((*char_ptr == CHAR_LF) || (*char_ptr == CHAR_CR))
+	if(io_functions->func_rd_bulk)
 	{
-		if((*last_linbreak != 0U) && (*char_ptr != *last_linbreak))
+		if(!io_functions->func_rd_bulk(buffer, buffer_size, length, io_functions->context_rd, error_flag))
 		{
-			*last_linbreak = 0U;
 			return FALSE;
 		}
-		*last_linbreak = *char_ptr;
-		*char_ptr = CHAR_LF;
+		return (*length > 0U);
 	}
-	else
+	for(*length = 0U; *length < buffer_size; ++*length)
 	{
-		*last_linbreak = 0U; /*not a line-break*/
+		if(!io_functions->func_rd(buffer + *length, io_functions->context_rd, error_flag))
+		{
+			break;
+		}
 	}
-	return TRUE;
+	return (*length > 0U);
+}
+
+/* borrow the next piece of the input from the reader's buffer, instead of copying it */
+static __inline BOOL libreplace_read_view(const BYTE **const data, const DWORD max_len, DWORD *const length, const libreplace_io_t *const io_functions, BOOL *const error_flag)
+{
+	if(!io_functions->func_rd_view(data, max_len, length, io_functions->context_rd, error_flag))
+	{
+		return FALSE;
+	}
+	return (*length > 0U);
 }
 
 static MY_INLINE BOOL libreplace_write(const BYTE *const data, const DWORD data_len, const libreplace_io_t *const io_functions)
 {
 	DWORD data_pos;
+	if(io_functions->func_wr_bulk)
+	{
+		return (data_len > 0U) ? io_functions->func_wr_bulk(data, data_len, io_functions->context_wr) : TRUE;
+	}
 	for(data_pos = 0U; data_pos < data_len; ++data_pos)
 	{
 		if(!io_functions->func_wr(data[data_pos], io_functions->context_wr))
@@ -205,156 +316,611 @@ static MY_INLINE BOOL libreplace_write(const BYTE *const data, const DWORD data_
 	return TRUE;
 }
 
-static MY_INLINE BOOL libreplace_flush_pending(ringbuffer_t *const ringbuffer, const libreplace_io_t *const io_functions)
+static BOOL libreplace_copy_data(BYTE *const buffer, ULONGLONG count, const libreplace_io_t *const io_functions, BOOL *const error_flag, volatile BOOL *const abort_flag)
 {
-	BYTE temp;
-	while(ringbuffer_flush(&temp, ringbuffer))
+	const BYTE *view;
+	DWORD length;
+	if(io_functions->func_rd_view)
+	{
+		while((count > 0U) && (!*abort_flag) && libreplace_read_view(&view, VIEW_LIMIT(count), &length, io_functions, error_flag))
+		{
+			if(!libreplace_write(view, length, io_functions))
+			{
+				return FALSE;
+			}
+			count -= length;
+		}
+		return TRUE;
+	}
+	while((count > 0U) && (!*abort_flag) && libreplace_read_block(buffer, BLOCK_LIMIT(count), &length, io_functions, error_flag))
 	{
-		if(!io_functions->func_wr(temp, io_functions->context_wr))
+		if(!libreplace_write(buffer, length, io_functions))
 		{
 			return FALSE;
 		}
+		count -= length;
 	}
-	ringbuffer_reset(ringbuffer);
 	return TRUE;
 }
 
-/* ======================================================================= */
-/* Search & Replace                                                        */
-/* ======================================================================= */
-
-BOOL libreplace_search_and_replace(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+static BOOL libreplace_pass_head(BYTE *const buffer, const libreplace_flags_t *const options, const libreplace_io_t *const io_functions, ULARGE_INTEGER *const position, BOOL *const error_flag, volatile BOOL *const abort_flag)
 {
-	BYTE char_in, char_out, last_linbreak = 0U;
-	BOOL success = FALSE, pending_input = FALSE, error_flag = FALSE;
-	ULARGE_INTEGER position = { 0U, 0U };
-	ringbuffer_t *ringbuffer = NULL;
-
-	/* check parameters */
-	if(!(io_functions && needle && replacement && (needle_len > 0U) && options && replacement_count && abort_flag))
+	if(options->window_offset > 0U)
 	{
-		libreplace_print(logger, "Invalid function parameters detected!\n");
-		goto finished;
+		position->QuadPart = options->window_offset; /*offsets remain absolute*/
+		return libreplace_copy_data(buffer, options->window_offset, io_functions, error_flag, abort_flag);
 	}
+	return TRUE;
+}
 
-	/* initialize replacement counter */
-	*replacement_count = 0U;
+/* ======================================================================= */
+/* Translation table                                                       */
+/* ======================================================================= */
 
-	/* check the length limitations */
-	if((needle_len > LIBREPLACE_MAXLEN) || (replacement_len > LIBREPLACE_MAXLEN))
-	{
-		libreplace_print(logger, "Needle and/or replacement length exceeds the allowable limit!\n");
-		goto finished;
-	}
+typedef struct xlat_t
+{
+	BYTE table[256U];
+	BYTE discard[256U];
+	BYTE hit[256U];
+	DWORD pair_count;
+	BYTE pair_src[XLAT_MAX_PAIRS];
+	BYTE pair_dst[XLAT_MAX_PAIRS];
+	BOOL pair_discard[XLAT_MAX_PAIRS];
+	DWORD row_count;
+	BYTE row_nibble[16U];
+}
+xlat_t;
 
-	/* allocate ring buffer */
-	ringbuffer = ringbuffer_alloc(needle_len);
-	if(!ringbuffer)
+static BOOL xlat_init(xlat_t *const xlat, const WORD *const table, const BOOL case_insensitive)
+{
+	DWORD char_pos;
+	xlat->pair_count = 0U;
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
 	{
-		libreplace_print(logger, "Failed to allocate ring buffer!\n");
-		goto finished;
+		if((table[char_pos] > 0xFFU) && (table[char_pos] != LIBREPLACE_DISCARD))
+		{
+			return FALSE;
+		}
+		xlat->discard[char_pos] = (table[char_pos] == LIBREPLACE_DISCARD) ? 1U : 0U;
+		xlat->table[char_pos] = xlat->discard[char_pos] ? BYTE_CAST(char_pos) : BYTE_CAST(table[char_pos]);
+		xlat->hit[char_pos] = (xlat->discard[char_pos] || (table[char_pos] != char_pos)) ? 1U : 0U;
 	}
-
-	/* process all available input data */
-	while(pending_input = io_functions->func_rd(&char_in, io_functions->context_rd, &error_flag))
+	if(case_insensitive)
 	{
-		/* fix up CRLF/LFCR line-breaks, if normalization is enabled */
-		if(options->normalize)
+		for(char_pos = 0x61U; char_pos <= 0x7AU; ++char_pos)
 		{
-			if(!libreplace_normalize(&char_in, &last_linbreak))
+			const DWORD other_pos = char_pos - 0x20U;
+			if(xlat->hit[char_pos] != xlat->hit[other_pos])
 			{
-				continue; /*discard char*/
+				const DWORD src_pos = xlat->hit[char_pos] ? char_pos : other_pos, dst_pos = xlat->hit[char_pos] ? other_pos : char_pos;
+				xlat->table[dst_pos] = xlat->table[src_pos];
+				xlat->discard[dst_pos] = xlat->discard[src_pos];
+				xlat->hit[dst_pos] = 1U;
 			}
 		}
-
-		/* add next character to buffer*/
-		if(ringbuffer_append(char_in, &char_out, ringbuffer))
+	}
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
+	{
+		if(xlat->hit[char_pos])
 		{
-			if(!io_functions->func_wr(char_out, io_functions->context_wr))
+			if(xlat->pair_count < XLAT_MAX_PAIRS)
 			{
-				libreplace_print(logger, WR_ERROR_MESSAGE);
-				goto finished;
+				xlat->pair_src[xlat->pair_count] = BYTE_CAST(char_pos);
+				xlat->pair_dst[xlat->pair_count] = xlat->table[char_pos];
+				xlat->pair_discard[xlat->pair_count] = xlat->discard[char_pos];
 			}
+			++xlat->pair_count;
 		}
-		else if(ringbuffer->valid < needle_len)
+	}
+	xlat->row_count = 0U;
+	for(char_pos = 0U; char_pos < 256U; char_pos += 16U)
+	{
+		DWORD row_pos, row_hits = 0U;
+		for(row_pos = 0U; row_pos < 16U; ++row_pos)
 		{
-			goto skip_check; /*not enough data buffered yet!*/
+			row_hits += xlat->hit[char_pos + row_pos];
 		}
-
-		/* perfrom quick pre-test on the first character in the buffer */
-		if((!IS_WILDCARD(needle[0U], ringbuffer_peek(ringbuffer))) && (!COMPARE_CHAR(ringbuffer_peek(ringbuffer), BYTE_CAST(needle[0U]))))
+		if(row_hits)
 		{
-			goto skip_check; 
+			xlat->row_nibble[xlat->row_count++] = BYTE_CAST(char_pos >> 4);
 		}
+	}
+	return TRUE;
+}
+
+static __inline DWORD xlat_apply_scalar(const xlat_t *const xlat, const BYTE *const input, BYTE *const output, const DWORD length, DWORD *const hits)
+{
+	DWORD pos_in, pos_out = 0U, hit_count = 0U;
+	for(pos_in = 0U; pos_in < length; ++pos_in)
+	{
+		const BYTE char_in = input[pos_in];
+		hit_count += xlat->hit[char_in];
+		output[pos_out] = xlat->table[char_in];
+		pos_out += 1U - xlat->discard[char_in];
+	}
+	*hits += hit_count;
+	return pos_out;
+}
 
-		/* perfrom full comparison and, if a match is found, write the replacement */
-		if(ringbuffer_compare(ringbuffer, needle, options))
+#ifdef LIBREPLACE_X86
+
+static TARGET_SSE2 DWORD xlat_apply_sse2(const xlat_t *const xlat, const BYTE *const input, BYTE *const output, const DWORD length, DWORD *const hits)
+{
+	DWORD pos_in = 0U, pos_out = 0U;
+	if(xlat->pair_count <= XLAT_MAX_PAIRS)
+	{
+		DWORD pair_pos;
+		__m128i vec_src[XLAT_MAX_PAIRS], vec_dst[XLAT_MAX_PAIRS];
+		for(pair_pos = 0U; pair_pos < xlat->pair_count; ++pair_pos)
+		{
+			vec_src[pair_pos] = _mm_set1_epi8((char)xlat->pair_src[pair_pos]);
+			vec_dst[pair_pos] = _mm_set1_epi8((char)xlat->pair_dst[pair_pos]);
+		}
+		for(; length - pos_in >= 16U; pos_in += 16U)
 		{
-			if (*replacement_count < MAXDWORD)
+			const __m128i chunk = _mm_loadu_si128((const __m128i*)(input + pos_in));
+			__m128i result = chunk, matched = _mm_setzero_si128(), discarded = _mm_setzero_si128();
+			DWORD match_mask, discard_mask;
+			for(pair_pos = 0U; pair_pos < xlat->pair_count; ++pair_pos)
 			{
-				++*replacement_count;
+				const __m128i mask = _mm_cmpeq_epi8(chunk, vec_src[pair_pos]);
+				matched = _mm_or_si128(matched, mask);
+				if(xlat->pair_discard[pair_pos])
+				{
+					discarded = _mm_or_si128(discarded, mask);
+				}
+				else
+				{
+					result = _mm_or_si128(_mm_andnot_si128(mask, result), _mm_and_si128(mask, vec_dst[pair_pos]));
+				}
 			}
-			if(options->verbose || options->dry_run)
+			if(!(match_mask = (DWORD)_mm_movemask_epi8(matched)))
 			{
-				libreplace_print_fmt(logger, "%s occurence at offset: 0x%08lX%08lX\n", options->dry_run ? "Found" : "Replaced", position.HighPart, position.LowPart);
+				_mm_storeu_si128((__m128i*)(output + pos_out), chunk);
+				pos_out += 16U;
+				continue;
 			}
-			if(!options->dry_run)
+			*hits += libreplace_popcount(match_mask);
+			if(!(discard_mask = (DWORD)_mm_movemask_epi8(discarded)))
 			{
-				if(!libreplace_write(replacement, replacement_len, io_functions))
-				{
-					libreplace_print(logger, WR_ERROR_MESSAGE);
-					goto finished;
-				}
-				ringbuffer_reset(ringbuffer);
+				_mm_storeu_si128((__m128i*)(output + pos_out), result);
+				pos_out += 16U;
 			}
 			else
 			{
-				if(!libreplace_flush_pending(ringbuffer, io_functions))
+				BYTE *const temp = output + pos_out; /*compact in place, the output never overtakes the input*/
+				DWORD char_pos;
+				_mm_storeu_si128((__m128i*)temp, result);
+				for(char_pos = 0U; char_pos < 16U; ++char_pos)
 				{
-					libreplace_print(logger, WR_ERROR_MESSAGE);
-					goto finished;
+					output[pos_out] = temp[char_pos];
+					pos_out += 1U - ((discard_mask >> char_pos) & 1U);
 				}
 			}
-			if(options->replace_once)
-			{
-				break;
-			}
 		}
-
-	skip_check:
-
-		/*incremet the file position*/
-		++position.QuadPart;
-
-		/* check if abort was requested */
-		CHECK_ABORT_REQUEST();
 	}
+	return pos_out + xlat_apply_scalar(xlat, input + pos_in, output + pos_out, length - pos_in, hits);
+}
 
-	/* write any pending data */
-	if(!libreplace_flush_pending(ringbuffer, io_functions))
+/*
+ * Up to XLAT_MAX_PAIRS translated bytes are compared one by one. Larger tables
+ * are split by the high nibble: each 16-byte row of the table that contains a
+ * translated byte is looked up by the low nibble (vpshufb) and selected where
+ * the high nibble matches, so the cost depends on the number of such rows.
+ * SSE2 has no byte shuffle, it leaves larger tables to the scalar loop.
+ */
+static TARGET_AVX2 DWORD xlat_apply_avx2(const xlat_t *const xlat, const BYTE *const input, BYTE *const output, const DWORD length, DWORD *const hits)
+{
+	const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+	DWORD pos_in = 0U, pos_out = 0U, pair_pos, row_pos; /*the pairs are broadcast in the loop: GCC can not align the stack to 32 bytes on Win64*/
+	for(; length - pos_in >= 32U; pos_in += 32U)
 	{
-		libreplace_print(logger, WR_ERROR_MESSAGE);
-		goto finished;
+		const __m256i chunk = _mm256_loadu_si256((const __m256i*)(input + pos_in));
+		__m256i result = chunk, matched = _mm256_setzero_si256(), discarded = _mm256_setzero_si256();
+		DWORD match_mask, discard_mask;
+		if(xlat->pair_count <= XLAT_MAX_PAIRS)
+		{
+			for(pair_pos = 0U; pair_pos < xlat->pair_count; ++pair_pos)
+			{
+				const __m256i mask = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8((char)xlat->pair_src[pair_pos]));
+				matched = _mm256_or_si256(matched, mask);
+				if(xlat->pair_discard[pair_pos])
+				{
+					discarded = _mm256_or_si256(discarded, mask);
+				}
+				else
+				{
+					result = _mm256_blendv_epi8(result, _mm256_set1_epi8((char)xlat->pair_dst[pair_pos]), mask);
+				}
+			}
+		}
+		else
+		{
+			const __m256i char_lo = _mm256_and_si256(chunk, nibble_mask), char_hi = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble_mask);
+			for(row_pos = 0U; row_pos < xlat->row_count; ++row_pos)
+			{
+				const DWORD row_offset = ((DWORD)xlat->row_nibble[row_pos]) << 4;
+				const __m256i in_row = _mm256_cmpeq_epi8(char_hi, _mm256_set1_epi8((char)xlat->row_nibble[row_pos]));
+				const __m256i row_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(xlat->table + row_offset)));
+				const __m256i row_hit = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(xlat->hit + row_offset)));
+				const __m256i row_discard = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(xlat->discard + row_offset)));
+				result = _mm256_blendv_epi8(result, _mm256_shuffle_epi8(row_table, char_lo), in_row);
+				matched = _mm256_or_si256(matched, _mm256_and_si256(in_row, _mm256_shuffle_epi8(row_hit, char_lo)));
+				discarded = _mm256_or_si256(discarded, _mm256_and_si256(in_row, _mm256_shuffle_epi8(row_discard, char_lo)));
+			}
+			matched = _mm256_sub_epi8(_mm256_setzero_si256(), matched); /*the hit and discard tables hold 0 or 1*/
+			discarded = _mm256_sub_epi8(_mm256_setzero_si256(), discarded);
+		}
+		if(!(match_mask = (DWORD)_mm256_movemask_epi8(matched)))
+		{
+			_mm256_storeu_si256((__m256i*)(output + pos_out), chunk);
+			pos_out += 32U;
+			continue;
+		}
+		*hits += libreplace_popcount(match_mask);
+		if(!(discard_mask = (DWORD)_mm256_movemask_epi8(discarded)))
+		{
+			_mm256_storeu_si256((__m256i*)(output + pos_out), result);
+			pos_out += 32U;
+		}
+		else
+		{
+			BYTE *const temp = output + pos_out; /*compact in place, the output never overtakes the input*/
+			DWORD char_pos;
+			_mm256_storeu_si256((__m256i*)temp, result);
+			for(char_pos = 0U; char_pos < 32U; ++char_pos)
+			{
+				output[pos_out] = temp[char_pos];
+				pos_out += 1U - ((discard_mask >> char_pos) & 1U);
+			}
+		}
 	}
+	return pos_out + xlat_apply_scalar(xlat, input + pos_in, output + pos_out, length - pos_in, hits);
+}
 
-	/* check if abort was requested */
-	CHECK_ABORT_REQUEST();
-
-	/* transfer any input data not processed yet */
-	if(pending_input)
+static TARGET_AVX512 DWORD xlat_apply_avx512(const xlat_t *const xlat, const BYTE *const input, BYTE *const output, const DWORD length, DWORD *const hits)
+{
+	const __m512i nibble_mask = _mm512_set1_epi8(0x0F);
+	DWORD pos_in = 0U, pos_out = 0U, pair_pos, row_pos;
+	for(; length - pos_in >= 64U; pos_in += 64U)
 	{
-		while(io_functions->func_rd(&char_in, io_functions->context_rd, &error_flag))
+		const __m512i chunk = _mm512_loadu_si512((const void*)(input + pos_in));
+		__m512i result = chunk;
+		ULONGLONG match_mask = 0U, discard_mask = 0U;
+		if(xlat->pair_count <= XLAT_MAX_PAIRS)
 		{
-			if(!io_functions->func_wr(char_in, io_functions->context_wr))
+			for(pair_pos = 0U; pair_pos < xlat->pair_count; ++pair_pos)
 			{
-				libreplace_print(logger, WR_ERROR_MESSAGE);
-				goto finished;
+				const __mmask64 mask = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8((char)xlat->pair_src[pair_pos]));
+				match_mask |= (ULONGLONG)mask;
+				if(xlat->pair_discard[pair_pos])
+				{
+					discard_mask |= (ULONGLONG)mask;
+				}
+				else
+				{
+					result = _mm512_mask_mov_epi8(result, mask, _mm512_set1_epi8((char)xlat->pair_dst[pair_pos]));
+				}
+			}
+		}
+		else
+		{
+			const __m512i char_lo = _mm512_and_si512(chunk, nibble_mask), char_hi = _mm512_and_si512(_mm512_srli_epi16(chunk, 4), nibble_mask);
+			for(row_pos = 0U; row_pos < xlat->row_count; ++row_pos)
+			{
+				const DWORD row_offset = ((DWORD)xlat->row_nibble[row_pos]) << 4;
+				const __mmask64 in_row = _mm512_cmpeq_epi8_mask(char_hi, _mm512_set1_epi8((char)xlat->row_nibble[row_pos]));
+				const __m512i row_hit = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)(xlat->hit + row_offset))), char_lo);
+				const __m512i row_discard = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)(xlat->discard + row_offset))), char_lo);
+				result = _mm512_mask_shuffle_epi8(result, in_row, _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)(xlat->table + row_offset))), char_lo);
+				match_mask |= (ULONGLONG)_mm512_mask_test_epi8_mask(in_row, row_hit, row_hit);
+				discard_mask |= (ULONGLONG)_mm512_mask_test_epi8_mask(in_row, row_discard, row_discard);
+			}
+		}
+		if(!match_mask)
+		{
+			_mm512_storeu_si512((void*)(output + pos_out), chunk);
+			pos_out += 64U;
+			continue;
+		}
+		*hits += libreplace_popcount((DWORD)match_mask) + libreplace_popcount((DWORD)(match_mask >> 32));
+		if(!discard_mask)
+		{
+			_mm512_storeu_si512((void*)(output + pos_out), result);
+			pos_out += 64U;
+		}
+		else
+		{
+			BYTE *const temp = output + pos_out; /*compact in place, the output never overtakes the input*/
+			DWORD char_pos;
+			_mm512_storeu_si512((void*)temp, result);
+			for(char_pos = 0U; char_pos < 64U; ++char_pos)
+			{
+				output[pos_out] = temp[char_pos];
+				pos_out += 1U - ((DWORD)(discard_mask >> char_pos) & 1U);
 			}
 		}
 	}
+	return pos_out + xlat_apply_scalar(xlat, input + pos_in, output + pos_out, length - pos_in, hits);
+}
 
-	/* check if abort was requested */
-	CHECK_ABORT_REQUEST();
+#endif /*LIBREPLACE_X86*/
+
+/* ======================================================================= */
+/* CPU Dispatch                                                            */
+/* ======================================================================= */
+
+static DWORD find_first_scalar(const BYTE *const data, DWORD pos, const DWORD limit, const BYTE first_lo, const BYTE first_hi)
+{
+	for(; pos < limit; ++pos)
+	{
+		if((data[pos] == first_lo) || (data[pos] == first_hi))
+		{
+			break;
+		}
+	}
+	return pos;
+}
+
+#ifdef LIBREPLACE_X86
+
+static TARGET_SSE2 DWORD find_first_sse2(const BYTE *const data, DWORD pos, const DWORD limit, const BYTE first_lo, const BYTE first_hi)
+{
+	const __m128i vec_lo = _mm_set1_epi8((char)first_lo), vec_hi = _mm_set1_epi8((char)first_hi);
+	for(; limit - pos >= 16U; pos += 16U)
+	{
+		const __m128i chunk = _mm_loadu_si128((const __m128i*)(data + pos));
+		const DWORD mask = (DWORD)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, vec_lo), _mm_cmpeq_epi8(chunk, vec_hi)));
+		if(mask)
+		{
+			return pos + BIT_SCAN_FORWARD(mask);
+		}
+	}
+	return pos;
+}
+
+static TARGET_AVX2 DWORD find_first_avx2(const BYTE *const data, DWORD pos, const DWORD limit, const BYTE first_lo, const BYTE first_hi)
+{
+	const __m256i vec_lo = _mm256_set1_epi8((char)first_lo), vec_hi = _mm256_set1_epi8((char)first_hi);
+	for(; limit - pos >= 32U; pos += 32U)
+	{
+		const __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + pos));
+		const DWORD mask = (DWORD)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, vec_lo), _mm256_cmpeq_epi8(chunk, vec_hi)));
+		if(mask)
+		{
+			return pos + BIT_SCAN_FORWARD(mask);
+		}
+	}
+	return pos;
+}
+
+static TARGET_AVX512 DWORD find_first_avx512(const BYTE *const data, DWORD pos, const DWORD limit, const BYTE first_lo, const BYTE first_hi)
+{
+	const __m512i vec_lo = _mm512_set1_epi8((char)first_lo), vec_hi = _mm512_set1_epi8((char)first_hi);
+	for(; limit - pos >= 64U; pos += 64U)
+	{
+		const __m512i chunk = _mm512_loadu_si512((const void*)(data + pos));
+		const ULONGLONG mask = (ULONGLONG)(_mm512_cmpeq_epi8_mask(chunk, vec_lo) | _mm512_cmpeq_epi8_mask(chunk, vec_hi));
+		if(mask)
+		{
+			return pos + BIT_SCAN_FORWARD64(mask);
+		}
+	}
+	return pos;
+}
+
+#endif /*LIBREPLACE_X86*/
+
+typedef struct kernels_t
+{
+	const CHAR *name;
+	DWORD (*find_first)(const BYTE *const data, DWORD pos, const DWORD limit, const BYTE first_lo, const BYTE first_hi);
+	DWORD (*normalize)(const BYTE *const input, BYTE *const output, const DWORD length, BYTE *const last_linbreak);
+	DWORD (*translate)(const xlat_t *const xlat, const BYTE *const input, BYTE *const output, const DWORD length, DWORD *const hits);
+}
+kernels_t;
+
+static const kernels_t KERNELS[] =
+{
+	{ "scalar",  find_first_scalar, libreplace_normalize_scalar, xlat_apply_scalar },
+#ifdef LIBREPLACE_X86
+	{ "SSE2",    find_first_sse2,   libreplace_normalize_sse2,   xlat_apply_sse2   },
+	{ "AVX2",    find_first_avx2,   libreplace_normalize_avx2,   xlat_apply_avx2   },
+	{ "AVX-512", find_first_avx512, libreplace_normalize_avx512, xlat_apply_avx512 },
+#endif
+};
+
+static const kernels_t *volatile g_kernels = NULL;
+
+#ifdef LIBREPLACE_X86
+
+static void cpu_id(const DWORD leaf, DWORD *const regs)
+{
+#ifdef __GNUC__
+	unsigned int eax, ebx, ecx, edx;
+	__cpuid_count(leaf, 0U, eax, ebx, ecx, edx);
+	regs[0U] = eax; regs[1U] = ebx; regs[2U] = ecx; regs[3U] = edx;
+#else
+	int info[4U];
+	__cpuidex(info, (int)leaf, 0);
+	regs[0U] = (DWORD)info[0U]; regs[1U] = (DWORD)info[1U]; regs[2U] = (DWORD)info[2U]; regs[3U] = (DWORD)info[3U];
+#endif
+}
+
+static DWORD cpu_xgetbv(void)
+{
+#ifdef __GNUC__
+	unsigned int eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0U));
+	return eax;
+#else
+	return (DWORD)_xgetbv(0U);
+#endif
+}
+
+#endif /*LIBREPLACE_X86*/
+
+static DWORD detect_kernels(void)
+{
+	DWORD kernels = LIBREPLACE_KERNELS_SCALAR;
+#ifdef LIBREPLACE_X86
+	DWORD regs[4U], max_leaf, xcr0 = 0U;
+	cpu_id(0U, regs);
+	if((max_leaf = regs[0U]) >= 1U)
+	{
+		cpu_id(1U, regs);
+		if(regs[3U] & (1U << 26))
+		{
+			kernels = LIBREPLACE_KERNELS_SSE2;
+		}
+		if((regs[2U] & (1U << 27)) && (regs[2U] & (1U << 28)))
+		{
+			xcr0 = cpu_xgetbv(); /*the OS must save the YMM/ZMM registers too*/
+		}
+		if((max_leaf >= 7U) && ((xcr0 & 0x06U) == 0x06U))
+		{
+			cpu_id(7U, regs);
+			if(regs[1U] & (1U << 5))
+			{
+				kernels = LIBREPLACE_KERNELS_AVX2;
+				if(((xcr0 & 0xE0U) == 0xE0U) && (regs[1U] & (1U << 16)) && (regs[1U] & (1U << 30)))
+				{
+					kernels = LIBREPLACE_KERNELS_AVX512;
+				}
+			}
+		}
+	}
+#endif
+	return kernels;
+}
+
+static const kernels_t *libreplace_kernels(void)
+{
+	const kernels_t *kernels = g_kernels;
+	if(!kernels)
+	{
+		g_kernels = kernels = &KERNELS[detect_kernels() - 1U];
+	}
+	return kernels;
+}
+
+BOOL libreplace_select_kernels(const DWORD kernels)
+{
+	const DWORD supported = detect_kernels();
+	if(kernels == LIBREPLACE_KERNELS_AUTO)
+	{
+		g_kernels = &KERNELS[supported - 1U];
+		return TRUE;
+	}
+	if((kernels < LIBREPLACE_KERNELS_SCALAR) || (kernels > supported))
+	{
+		return FALSE;
+	}
+	g_kernels = &KERNELS[kernels - 1U];
+	return TRUE;
+}
+
+const CHAR *libreplace_kernels_name(void)
+{
+	return libreplace_kernels()->name;
+}
+
+static __inline DWORD libreplace_normalize_block(const BYTE *const input, BYTE *const output, const DWORD length, BYTE *const last_linbreak)
+{
+	return libreplace_kernels()->normalize(input, output, length, last_linbreak);
+}
+
+static __inline DWORD xlat_apply(const xlat_t *const xlat, const BYTE *const input, BYTE *const output, const DWORD length, DWORD *const hits)
+{
+	return libreplace_kernels()->translate(xlat, input, output, length, hits);
+}
+
+static DWORD xlat_process_block(const xlat_t *const xlat, BYTE *const block_data, DWORD data_len, const libreplace_flags_t *const options, const libreplace_logger_t *const logger, ULARGE_INTEGER *const position, DWORD *const replacement_count)
+{
+	DWORD data_pos, hits = 0U;
+	if(options->verbose || options->dry_run)
+	{
+		DWORD pos_out = 0U;
+		for(data_pos = 0U; data_pos < data_len; ++data_pos, ++position->QuadPart)
+		{
+			const BYTE char_in = block_data[data_pos];
+			if(xlat->hit[char_in])
+			{
+				libreplace_add_count(replacement_count, 1U);
+				libreplace_print_fmt(logger, "%s occurence at offset: 0x%08lX%08lX\n", options->dry_run ? "Found" : "Replaced", position->HighPart, position->LowPart);
+			}
+			if(!options->dry_run)
+			{
+				block_data[pos_out] = xlat->table[char_in];
+				pos_out += 1U - xlat->discard[char_in];
+			}
+		}
+		return options->dry_run ? data_len : pos_out;
+	}
+	position->QuadPart += data_len;
+	data_len = xlat_apply(xlat, block_data, block_data, data_len, &hits);
+	libreplace_add_count(replacement_count, hits);
+	return data_len;
+}
+
+static BOOL libreplace_translate_blocks(const xlat_t *const xlat, BYTE *const block_buffer, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	BYTE last_linbreak = 0U, *block_data;
+	BOOL success = FALSE, error_flag = FALSE;
+	ULARGE_INTEGER position = { 0U, 0U };
+	DWORD block_len, data_len;
+	ULONGLONG window_remaining = 0U;
+
+	/* pass through any input data in front of the window */
+	if(!libreplace_pass_head(block_buffer, options, io_functions, &position, &error_flag, abort_flag))
+	{
+		libreplace_print(logger, WR_ERROR_MESSAGE);
+		goto finished;
+	}
+
+	/* process all available input data within the window */
+	window_remaining = WINDOW_LENGTH(options);
+	while((window_remaining > 0U) && libreplace_read_block(block_buffer, BLOCK_LIMIT(window_remaining), &block_len, io_functions, &error_flag))
+	{
+		window_remaining -= block_len;
+
+		/* fix up CRLF/LFCR line-breaks, if normalization is enabled */
+		if(options->normalize)
+		{
+			data_len = libreplace_normalize_block(block_buffer, block_data = block_buffer + BLOCK_SIZE, block_len, &last_linbreak);
+		}
+		else
+		{
+			data_len = block_len;
+			block_data = block_buffer;
+		}
+
+		/* translate the whole block, in-place */
+		data_len = xlat_process_block(xlat, block_data, data_len, options, logger, &position, replacement_count);
+
+		/* write the translated block */
+		if(!libreplace_write(block_data, data_len, io_functions))
+		{
+			libreplace_print(logger, WR_ERROR_MESSAGE);
+			goto finished;
+		}
+
+		/* check if abort was requested */
+		CHECK_ABORT_REQUEST();
+	}
+
+	/* pass through any input data behind the window */
+	if(window_remaining < 1U)
+	{
+		if(!libreplace_copy_data(block_buffer, MAXULONGLONG, io_functions, &error_flag, abort_flag))
+		{
+			libreplace_print(logger, WR_ERROR_MESSAGE);
+			goto finished;
+		}
+	}
+
+	/* check if abort was requested */
+	CHECK_ABORT_REQUEST();
 
 	/* check for any previous read errors */
 	if(error_flag)
@@ -373,10 +939,1737 @@ BOOL libreplace_search_and_replace(const libreplace_io_t *const io_functions, co
 
 finished:
 
-	if(ringbuffer)
+	return success;
+}
+
+BOOL libreplace_translate(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const table, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	BOOL success = FALSE;
+	BYTE *block_buffer = NULL;
+	xlat_t xlat;
+
+	/* check parameters */
+	if(!(io_functions && table && options && replacement_count && abort_flag))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		goto finished;
+	}
+
+	/* initialize replacement counter */
+	*replacement_count = 0U;
+
+	/* single replacement makes no sense for a translation table */
+	if(options->replace_once || (options->max_replacements > 0U))
+	{
+		libreplace_print(logger, "Replacement limits are not supported by translation tables!\n");
+		goto finished;
+	}
+
+	/* set up translation table */
+	if(!xlat_init(&xlat, table, options->case_insensitive))
+	{
+		libreplace_print(logger, "Translation table contains invalid entries!\n");
+		goto finished;
+	}
+
+	/* allocate block buffers (second half holds the normalized data) */
+	block_buffer = (BYTE*) LocalAlloc(LPTR, sizeof(BYTE) * (options->normalize ? (2U * BLOCK_SIZE) : BLOCK_SIZE));
+	if(!block_buffer)
+	{
+		libreplace_print(logger, "Failed to allocate block buffer!\n");
+		goto finished;
+	}
+
+	success = libreplace_translate_blocks(&xlat, block_buffer, io_functions, logger, options, replacement_count, abort_flag);
+
+finished:
+
+	if(block_buffer)
 	{
-		LocalFree(ringbuffer);
+		LocalFree(block_buffer);
 	}
 
 	return success;
 }
+
+/* ======================================================================= */
+/* Compiled Pattern                                                        */
+/* ======================================================================= */
+
+struct libreplace_pattern_t
+{
+	libreplace_flags_t options;
+	DWORD needle_len;
+	DWORD replacement_len;
+	const WORD *needle; /*case-folded, if case-insensitive*/
+	const BYTE *replacement;
+	DWORD capture_count;
+	const DWORD *captures; /*pairs of replacement position and needle position*/
+	const xlat_t *xlat; /*only for single-byte patterns*/
+	const kernels_t *kernels;
+	BYTE fold[256U];
+	BYTE first_char[256U];
+	BYTE first_lo, first_hi;
+	DWORD skip[256U];          /*Horspool shifts*/
+	DWORD skip_rev[256U];      /*Horspool shifts for backward scanning, by the first byte of the window*/
+	ULONGLONG bit_mask[256U];  /*Shift-And masks, only if needle_len <= BIT_PARALLEL_MAX*/
+	ULONGLONG bit_accept;
+};
+
+static __inline void pattern_case_pair(const libreplace_pattern_t *const pattern, const WORD needle_char, BYTE *const char_lo, BYTE *const char_hi)
+{
+	*char_hi = BYTE_CAST(needle_char); /*already case-folded*/
+	*char_lo = (pattern->options.case_insensitive && (*char_hi >= 0x41U) && (*char_hi <= 0x5AU)) ? BYTE_CAST(*char_hi + 0x20U) : *char_hi;
+}
+
+static libreplace_pattern_t *pattern_compile(const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const WORD *const replacement_template, const DWORD replacement_len, const libreplace_flags_t *const options)
+{
+	libreplace_pattern_t *pattern;
+	BYTE *arena;
+	WORD *needle_copy;
+	BYTE *replacement_copy;
+	DWORD *captures;
+	DWORD char_pos, wildcard_count = 0U, capture_count = 0U, capture_pos, shift_max, shift_rev;
+	BOOL use_xlat;
+
+	/* check parameters */
+	if(!(needle && (replacement || replacement_template) && (needle_len > 0U) && options))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		return NULL;
+	}
+
+	/* check the length limitations */
+	if((needle_len > LIBREPLACE_MAXLEN) || (replacement_len > LIBREPLACE_MAXLEN) || ((needle_len + replacement_len) > (LIBREPLACE_MAXLEN / 2U)))
+	{
+		libreplace_print(logger, "Needle and/or replacement length exceeds the allowable limit!\n");
+		return NULL;
+	}
+
+	/* line-break normalization would invalidate all file offsets */
+	if(options->reverse && options->normalize)
+	{
+		libreplace_print(logger, "Line-break normalization is not supported in reverse scanning mode!\n");
+		return NULL;
+	}
+
+	/* captures refer to the wildcards of the needle, in order of appearance */
+	if(replacement_template)
+	{
+		for(char_pos = 0U; char_pos < needle_len; ++char_pos)
+		{
+			if(needle[char_pos] == LIBREPLACE_WILDCARD)
+			{
+				++wildcard_count;
+			}
+		}
+		for(char_pos = 0U; char_pos < replacement_len; ++char_pos)
+		{
+			if(replacement_template[char_pos] > 0xFFU)
+			{
+				if((replacement_template[char_pos] < LIBREPLACE_CAPTURE(0U)) || ((DWORD)(replacement_template[char_pos] - LIBREPLACE_CAPTURE(0U)) >= wildcard_count))
+				{
+					libreplace_print(logger, "Replacement refers to a wildcard that does not exist in the needle!\n");
+					return NULL;
+				}
+				++capture_count;
+			}
+		}
+	}
+
+	/* a single-byte needle and replacement can be handled by a translation table */
+	use_xlat = (needle_len == 1U) && (replacement_len <= 1U) && (needle[0U] != LIBREPLACE_WILDCARD) && (!options->replace_once) && (options->max_replacements < 1U) && (!options->reverse) && ((replacement_len < 1U) || ((replacement ? replacement[0U] : replacement_template[0U]) != needle[0U]));
+
+	/* allocate everything in a single block, so that the pattern can be freed at once */
+	arena = (BYTE*) LocalAlloc(LPTR, sizeof(libreplace_pattern_t) + (sizeof(DWORD) * 2U * capture_count) + (use_xlat ? sizeof(xlat_t) : 0U) + (sizeof(WORD) * needle_len) + (sizeof(BYTE) * replacement_len));
+	if(!arena)
+	{
+		libreplace_print(logger, "Failed to allocate pattern!\n");
+		return NULL;
+	}
+
+	pattern = (libreplace_pattern_t*) arena;
+	arena += sizeof(libreplace_pattern_t);
+	pattern->options = *options;
+	pattern->needle_len = needle_len;
+	pattern->replacement_len = replacement_len;
+	pattern->capture_count = capture_count;
+	pattern->kernels = libreplace_kernels();
+	captures = (DWORD*) arena;
+	arena += sizeof(DWORD) * 2U * capture_count;
+
+	/* set up the case folding table */
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
+	{
+		pattern->fold[char_pos] = options->case_insensitive ? TO_UPPER(char_pos) : BYTE_CAST(char_pos);
+	}
+
+	/* set up the translation table, if applicable */
+	if(use_xlat)
+	{
+		WORD table[256U];
+		for(char_pos = 0U; char_pos < 256U; ++char_pos)
+		{
+			table[char_pos] = (WORD)char_pos;
+		}
+		table[BYTE_CAST(needle[0U])] = (replacement_len > 0U) ? (replacement ? replacement[0U] : replacement_template[0U]) : LIBREPLACE_DISCARD;
+		xlat_init((xlat_t*)arena, table, options->case_insensitive);
+		pattern->xlat = (const xlat_t*) arena;
+		arena += sizeof(xlat_t);
+	}
+
+	/* copy needle and replacement */
+	needle_copy = (WORD*) arena;
+	for(char_pos = 0U; char_pos < needle_len; ++char_pos)
+	{
+		needle_copy[char_pos] = (needle[char_pos] == LIBREPLACE_WILDCARD) ? LIBREPLACE_WILDCARD : pattern->fold[BYTE_CAST(needle[char_pos])];
+	}
+	pattern->needle = needle_copy;
+	arena += sizeof(WORD) * needle_len;
+	replacement_copy = arena;
+	for(char_pos = 0U; char_pos < replacement_len; ++char_pos)
+	{
+		replacement_copy[char_pos] = replacement ? replacement[char_pos] : BYTE_CAST(replacement_template[char_pos]);
+	}
+	pattern->replacement = replacement_copy;
+
+	/* resolve the captures to needle positions; the placeholder bytes are overwritten at write time */
+	for(char_pos = capture_pos = 0U; capture_pos < capture_count; ++char_pos)
+	{
+		if(replacement_template[char_pos] > 0xFFU)
+		{
+			DWORD wildcard_index = replacement_template[char_pos] - LIBREPLACE_CAPTURE(0U), needle_pos = 0U;
+			for(;; ++needle_pos)
+			{
+				if((needle[needle_pos] == LIBREPLACE_WILDCARD) && (wildcard_index-- < 1U))
+				{
+					break;
+				}
+			}
+			captures[2U * capture_pos] = char_pos;
+			captures[(2U * capture_pos++) + 1U] = needle_pos;
+		}
+	}
+	pattern->captures = captures;
+
+	/* set up the table of characters that may start a match */
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
+	{
+		if(MATCH_CHAR(pattern, pattern->needle[0U], char_pos))
+		{
+			pattern->first_char[char_pos] = 1U;
+			pattern->first_hi = BYTE_CAST(char_pos);
+			if(!pattern->first_lo)
+			{
+				pattern->first_lo = BYTE_CAST(char_pos);
+			}
+		}
+	}
+
+	/* set up the Horspool shift table; a wildcard limits the shift for every character */
+	for(char_pos = 0U, shift_max = needle_len; char_pos + 1U < needle_len; ++char_pos)
+	{
+		if(needle_copy[char_pos] == LIBREPLACE_WILDCARD)
+		{
+			shift_max = needle_len - 1U - char_pos;
+		}
+	}
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
+	{
+		pattern->skip[char_pos] = shift_max;
+	}
+	for(char_pos = 0U; char_pos + 1U < needle_len; ++char_pos)
+	{
+		if((needle_copy[char_pos] != LIBREPLACE_WILDCARD) && ((needle_len - 1U - char_pos) < shift_max))
+		{
+			BYTE char_lo, char_hi;
+			pattern_case_pair(pattern, needle_copy[char_pos], &char_lo, &char_hi);
+			pattern->skip[char_lo] = pattern->skip[char_hi] = needle_len - 1U - char_pos;
+		}
+	}
+
+	/* set up the reversed shift table; the nearest occurrence after the first position determines the shift */
+	for(char_pos = 1U, shift_rev = needle_len; char_pos < needle_len; ++char_pos)
+	{
+		if(needle_copy[char_pos] == LIBREPLACE_WILDCARD)
+		{
+			shift_rev = char_pos;
+			break;
+		}
+	}
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
+	{
+		pattern->skip_rev[char_pos] = shift_rev;
+	}
+	for(char_pos = shift_rev - 1U; char_pos > 0U; --char_pos)
+	{
+		BYTE char_lo, char_hi;
+		pattern_case_pair(pattern, needle_copy[char_pos], &char_lo, &char_hi);
+		pattern->skip_rev[char_lo] = pattern->skip_rev[char_hi] = char_pos;
+	}
+
+	/* set up the Shift-And masks, if the needle fits into the state */
+	if(needle_len <= BIT_PARALLEL_MAX)
+	{
+		ULONGLONG bit = 1U;
+		for(char_pos = 0U; char_pos < needle_len; ++char_pos, bit <<= 1U) /*no variable 64-Bit shifts*/
+		{
+			DWORD char_val;
+			for(char_val = 0U; char_val < 256U; ++char_val)
+			{
+				if(MATCH_CHAR(pattern, needle_copy[char_pos], char_val))
+				{
+					pattern->bit_mask[char_val] |= bit;
+				}
+			}
+			pattern->bit_accept = bit;
+		}
+	}
+
+	return pattern;
+}
+
+libreplace_pattern_t *libreplace_pattern_compile(const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options)
+{
+	return pattern_compile(logger, needle, needle_len, replacement, NULL, replacement_len, options);
+}
+
+libreplace_pattern_t *libreplace_pattern_compile_template(const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options)
+{
+	return pattern_compile(logger, needle, needle_len, NULL, replacement, replacement_len, options);
+}
+
+void libreplace_pattern_free(libreplace_pattern_t *const pattern)
+{
+	if(pattern)
+	{
+		LocalFree(pattern);
+	}
+}
+
+static MY_INLINE BOOL pattern_compare(const libreplace_pattern_t *const pattern, const BYTE *const data, DWORD needle_pos)
+{
+	for(; needle_pos < pattern->needle_len; ++needle_pos)
+	{
+		if(!MATCH_CHAR(pattern, pattern->needle[needle_pos], data[needle_pos]))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* ======================================================================= */
+/* Adaptive Matcher                                                        */
+/* ======================================================================= */
+
+#define MATCHER_FIRST_BYTE   0U
+#define MATCHER_RARE_BYTE    1U
+#define MATCHER_SKIP_TABLE   2U
+#define MATCHER_BIT_PARALLEL 3U
+
+#define MATCHER_SAMPLE_MIN   1024U /*smaller samples are not representative*/
+#define MATCHER_PREFILTER_PM 16U   /*max. candidates per 1000 bytes to choose a prefilter*/
+#define MATCHER_SWITCH_PM    64U   /*candidates per 1000 bytes that prove a prefilter wrong*/
+#define MATCHER_SKIP_MIN     8U    /*min. average shift to choose the skip table*/
+#define MATCHER_SKIP_SWITCH  4U    /*average shift that proves the skip table wrong*/
+
+static const CHAR *const MATCHER_NAMES[] = { "first-byte prefilter", "rare-byte prefilter", "skip table", "bit-parallel" };
+
+static DWORD matcher_find_first(const libreplace_pattern_t *const pattern, libreplace_matcher_t *const matcher, const BYTE *const data, DWORD pos, const DWORD limit)
+{
+	for(;; ++pos)
+	{
+		if(pattern->needle[0U] != LIBREPLACE_WILDCARD)
+		{
+			pos = pattern->kernels->find_first(data, pos, limit, pattern->first_lo, pattern->first_hi);
+		}
+		while((pos < limit) && (!pattern->first_char[data[pos]]))
+		{
+			++pos;
+		}
+		if(pos >= limit)
+		{
+			return limit;
+		}
+		++matcher->scan_steps;
+		if(pattern_compare(pattern, data + pos, 1U)) /*first element is already known to match*/
+		{
+			return pos;
+		}
+	}
+}
+
+static DWORD matcher_find_rare(const libreplace_pattern_t *const pattern, libreplace_matcher_t *const matcher, const BYTE *const data, DWORD pos, const DWORD limit)
+{
+	const BYTE *const rare_data = data + matcher->rare_pos, rare_lo = matcher->rare_lo, rare_hi = matcher->rare_hi;
+	for(;; ++pos)
+	{
+		pos = pattern->kernels->find_first(rare_data, pos, limit, rare_lo, rare_hi);
+		while((pos < limit) && (rare_data[pos] != rare_lo) && (rare_data[pos] != rare_hi))
+		{
+			++pos;
+		}
+		if(pos >= limit)
+		{
+			return limit;
+		}
+		++matcher->scan_steps;
+		if(pattern_compare(pattern, data + pos, 0U))
+		{
+			return pos;
+		}
+	}
+}
+
+static DWORD matcher_find_skip(const libreplace_pattern_t *const pattern, libreplace_matcher_t *const matcher, const BYTE *const data, DWORD pos, const DWORD limit)
+{
+	const DWORD last_pos = pattern->needle_len - 1U;
+	const WORD last_char = pattern->needle[last_pos];
+	for(; pos < limit; pos += pattern->skip[data[pos + last_pos]])
+	{
+		++matcher->scan_steps;
+		if(MATCH_CHAR(pattern, last_char, data[pos + last_pos]) && pattern_compare(pattern, data + pos, 0U))
+		{
+			return pos;
+		}
+	}
+	return limit;
+}
+
+static DWORD matcher_find_bits(const libreplace_pattern_t *const pattern, const BYTE *const data, DWORD pos, const DWORD limit)
+{
+	const DWORD data_len = limit + pattern->needle_len - 1U;
+	ULONGLONG state = 0U;
+	for(; pos < data_len; ++pos)
+	{
+		state = ((state << 1U) | 1U) & pattern->bit_mask[data[pos]];
+		if(state & pattern->bit_accept)
+		{
+			return pos - (pattern->needle_len - 1U);
+		}
+	}
+	return limit;
+}
+
+static BOOL pattern_find(const libreplace_pattern_t *const pattern, libreplace_matcher_t *const matcher, const BYTE *const data, const DWORD data_len, DWORD pos, DWORD *const match_pos)
+{
+	DWORD limit;
+	if((data_len < pattern->needle_len) || (pos > (limit = data_len - pattern->needle_len)))
+	{
+		return FALSE;
+	}
+	++limit; /*number of possible match positions*/
+	switch(matcher->engine)
+	{
+	case MATCHER_RARE_BYTE:
+		pos = matcher_find_rare(pattern, matcher, data, pos, limit);
+		break;
+	case MATCHER_SKIP_TABLE:
+		pos = matcher_find_skip(pattern, matcher, data, pos, limit);
+		break;
+	case MATCHER_BIT_PARALLEL:
+		pos = matcher_find_bits(pattern, data, pos, limit);
+		break;
+	default:
+		pos = matcher_find_first(pattern, matcher, data, pos, limit);
+	}
+	if(pos < limit)
+	{
+		*match_pos = pos;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Picks the matcher from the needle (length, wildcards, case folding) and the
+ * byte histogram of a sample of the input: a prefilter on the rarest needle
+ * byte as long as candidates are rare, otherwise the skip table if the shifts
+ * are long (periodic needles and wildcards shorten them), otherwise the
+ * bit-parallel matcher, whose cost per byte does not depend on the data.
+ */
+static void matcher_select(const libreplace_pattern_t *const pattern, libreplace_matcher_t *const matcher, const BYTE *const sample, DWORD sample_len, const libreplace_logger_t *const logger)
+{
+	DWORD histogram[256U], char_pos, rare_count = MAXDWORD, rare_pm, shift_sum = 0U, shift_avg;
+	BYTE char_lo, char_hi;
+
+	SecureZeroMemory(matcher, sizeof(libreplace_matcher_t));
+	sample_len = BLOCK_LIMIT(sample_len);
+
+	if(sample_len < MATCHER_SAMPLE_MIN)
+	{
+		if(pattern->options.verbose)
+		{
+			libreplace_print_fmt(logger, "Selected matcher: %s (input sample too small)\n", MATCHER_NAMES[MATCHER_FIRST_BYTE]);
+		}
+		return;
+	}
+
+	SecureZeroMemory(histogram, sizeof(histogram));
+	for(char_pos = 0U; char_pos < sample_len; ++char_pos)
+	{
+		++histogram[sample[char_pos]];
+	}
+
+	/* find the needle byte that occurs least often, counting both cases */
+	for(char_pos = 0U; char_pos < pattern->needle_len; ++char_pos)
+	{
+		if(pattern->needle[char_pos] != LIBREPLACE_WILDCARD)
+		{
+			DWORD count;
+			pattern_case_pair(pattern, pattern->needle[char_pos], &char_lo, &char_hi);
+			count = histogram[char_lo] + ((char_lo != char_hi) ? histogram[char_hi] : 0U);
+			if(count < rare_count)
+			{
+				rare_count = count;
+				matcher->rare_pos = char_pos;
+				matcher->rare_lo = char_lo;
+				matcher->rare_hi = char_hi;
+			}
+		}
+	}
+
+	for(char_pos = 0U; char_pos < 256U; ++char_pos)
+	{
+		shift_sum += histogram[char_pos] * ((pattern->skip[char_pos] < MAXWORD) ? pattern->skip[char_pos] : MAXWORD);
+	}
+
+	rare_pm = (rare_count < MAXDWORD) ? ((rare_count * 1000U) / sample_len) : 1000U;
+	shift_avg = shift_sum / sample_len;
+
+	if(rare_pm <= MATCHER_PREFILTER_PM)
+	{
+		matcher->engine = (matcher->rare_pos > 0U) ? MATCHER_RARE_BYTE : MATCHER_FIRST_BYTE;
+	}
+	else if((shift_avg >= MATCHER_SKIP_MIN) || (pattern->needle_len > BIT_PARALLEL_MAX))
+	{
+		matcher->engine = MATCHER_SKIP_TABLE;
+	}
+	else
+	{
+		matcher->engine = MATCHER_BIT_PARALLEL;
+	}
+
+	if(pattern->options.verbose)
+	{
+		if(rare_count < MAXDWORD)
+		{
+			libreplace_print_fmt(logger, "Selected matcher: %s (rarest needle byte 0x%02X at position %lu occurs %lu times per 1000 sample bytes, average shift %lu)\n", MATCHER_NAMES[matcher->engine], matcher->rare_hi, matcher->rare_pos, rare_pm, shift_avg);
+		}
+		else
+		{
+			libreplace_print_fmt(logger, "Selected matcher: %s (needle consists of wildcards only)\n", MATCHER_NAMES[matcher->engine]);
+		}
+	}
+}
+
+/* switches to a matcher whose cost does not depend on the data, if the observed candidate rate is too high */
+static void matcher_update(const libreplace_pattern_t *const pattern, libreplace_matcher_t *const matcher, const DWORD scanned, const libreplace_logger_t *const logger)
+{
+	DWORD engine = matcher->engine;
+	if((matcher->scan_bytes += scanned) < BLOCK_SIZE)
+	{
+		return;
+	}
+	if((engine == MATCHER_FIRST_BYTE) || (engine == MATCHER_RARE_BYTE))
+	{
+		if((matcher->scan_steps / (matcher->scan_bytes / 1000U)) > MATCHER_SWITCH_PM)
+		{
+			engine = (pattern->needle_len <= BIT_PARALLEL_MAX) ? MATCHER_BIT_PARALLEL : MATCHER_SKIP_TABLE;
+		}
+	}
+	else if((engine == MATCHER_SKIP_TABLE) && (pattern->needle_len <= BIT_PARALLEL_MAX))
+	{
+		if((matcher->scan_steps * MATCHER_SKIP_SWITCH) > matcher->scan_bytes)
+		{
+			engine = MATCHER_BIT_PARALLEL;
+		}
+	}
+	if(engine != matcher->engine)
+	{
+		if(pattern->options.verbose)
+		{
+			libreplace_print_fmt(logger, "Switching matcher: %s -> %s (observed %lu candidates in %lu bytes)\n", MATCHER_NAMES[matcher->engine], MATCHER_NAMES[engine], matcher->scan_steps, matcher->scan_bytes);
+		}
+		matcher->engine = engine;
+	}
+	matcher->scan_bytes = matcher->scan_steps = 0U;
+}
+
+/* ======================================================================= */
+/* Context                                                                 */
+/* ======================================================================= */
+
+struct libreplace_context_t
+{
+	const libreplace_pattern_t *pattern;
+	BYTE *buffer_raw;  /*BLOCK_SIZE bytes*/
+	BYTE *buffer_work; /*BLOCK_SIZE + needle_len bytes, directly follows buffer_raw*/
+	DWORD carry_len;
+	BYTE last_linbreak;
+	BOOL limit_reached;
+	ULARGE_INTEGER position;
+	ULONGLONG stream_offset; /*push mode only*/
+	DWORD stream_count;      /*push mode only*/
+	ULONGLONG *matches;
+	DWORD match_capacity;
+	libreplace_match_func_t match_func;
+	DWORD_PTR match_context;
+	libreplace_matcher_t matcher;
+	BOOL matcher_ready; /*selected on the first block of each run*/
+	libreplace_span_t spans[SPAN_LIMIT]; /*gathered output of the current block*/
+	DWORD span_count;
+};
+
+libreplace_context_t *libreplace_context_create(const libreplace_pattern_t *const pattern)
+{
+	libreplace_context_t *context;
+
+	if(!pattern)
+	{
+		return NULL;
+	}
+
+	/* the block buffers live in the same allocation as the context itself */
+	context = (libreplace_context_t*) LocalAlloc(LPTR, sizeof(libreplace_context_t) + (sizeof(BYTE) * ((2U * BLOCK_SIZE) + pattern->needle_len)));
+	if(context)
+	{
+		context->pattern = pattern;
+		context->buffer_raw = ((BYTE*)context) + sizeof(libreplace_context_t);
+		context->buffer_work = context->buffer_raw + BLOCK_SIZE;
+	}
+
+	return context;
+}
+
+void libreplace_context_set_callback(libreplace_context_t *const context, const libreplace_match_func_t match_func, const DWORD_PTR match_context)
+{
+	if(context)
+	{
+		context->match_func = match_func;
+		context->match_context = match_context;
+	}
+}
+
+void libreplace_context_reset(libreplace_context_t *const context)
+{
+	if(context)
+	{
+		context->carry_len = 0U;
+		context->last_linbreak = 0U;
+		context->limit_reached = FALSE;
+		context->position.QuadPart = 0U;
+		context->stream_offset = 0U;
+		context->stream_count = 0U;
+		context->matcher_ready = FALSE;
+		context->span_count = 0U;
+		SecureZeroMemory(&context->matcher, sizeof(libreplace_matcher_t));
+	}
+}
+
+void libreplace_context_free(libreplace_context_t *const context)
+{
+	if(context)
+	{
+		if(context->matches)
+		{
+			LocalFree(context->matches);
+		}
+		LocalFree(context);
+	}
+}
+
+static BOOL context_add_match(libreplace_context_t *const context, DWORD *const match_count, const ULONGLONG offset, const libreplace_logger_t *const logger)
+{
+	if(*match_count >= context->match_capacity)
+	{
+		ULONGLONG *matches_new;
+		const DWORD capacity_new = context->match_capacity ? (2U * context->match_capacity) : 64U;
+		if(context->match_capacity >= (MAXDWORD / (2U * sizeof(ULONGLONG))))
+		{
+			libreplace_print(logger, "Too many occurences to keep track of!\n");
+			return FALSE;
+		}
+		matches_new = (ULONGLONG*) (context->matches ? LocalReAlloc(context->matches, sizeof(ULONGLONG) * capacity_new, LMEM_MOVEABLE) : LocalAlloc(LPTR, sizeof(ULONGLONG) * capacity_new));
+		if(!matches_new)
+		{
+			libreplace_print(logger, "Failed to allocate match list!\n");
+			return FALSE;
+		}
+		context->matches = matches_new;
+		context->match_capacity = capacity_new;
+	}
+	context->matches[(*match_count)++] = offset;
+	return TRUE;
+}
+
+static BOOL context_write_bulk(const BYTE *const data, const DWORD data_len, const DWORD_PTR context)
+{
+	return libreplace_write(data, data_len, (const libreplace_io_t*)context);
+}
+
+static BOOL context_flush_spans(libreplace_context_t *const context, const libreplace_io_t *const io_functions)
+{
+	const DWORD span_count = context->span_count;
+	context->span_count = 0U;
+	return (span_count > 0U) ? io_functions->func_wr_gather(context->spans, span_count, io_functions->context_wr) : TRUE;
+}
+
+/* with gathered output, the spans refer to the work buffer and to the replacement, so they must be flushed before the work buffer changes */
+static MY_INLINE BOOL context_write(libreplace_context_t *const context, const BYTE *const data, const DWORD data_len, const libreplace_io_t *const io_functions)
+{
+	libreplace_span_t *span;
+	if(!io_functions->func_wr_gather)
+	{
+		return libreplace_write(data, data_len, io_functions);
+	}
+	if(data_len < 1U)
+	{
+		return TRUE;
+	}
+	if(context->span_count > 0U)
+	{
+		span = &context->spans[context->span_count - 1U];
+		if(span->data + span->length == data)
+		{
+			span->length += data_len; /*contiguous*/
+			return TRUE;
+		}
+		if((context->span_count >= SPAN_LIMIT) && (!context_flush_spans(context, io_functions)))
+		{
+			return FALSE;
+		}
+	}
+	span = &context->spans[context->span_count++];
+	span->data = data;
+	span->length = data_len;
+	return TRUE;
+}
+
+static BOOL context_write_replacement(libreplace_context_t *const context, const BYTE *const match, const ULONGLONG offset, const DWORD ordinal, const libreplace_io_t *const io_functions)
+{
+	const libreplace_pattern_t *const pattern = context->pattern;
+	libreplace_sink_t output;
+	DWORD capture_pos, done_pos = 0U;
+	if(!context->match_func)
+	{
+		/* captured bytes are taken directly from the verified match */
+		for(capture_pos = 0U; capture_pos < pattern->capture_count; ++capture_pos)
+		{
+			const DWORD *const capture = pattern->captures + (2U * capture_pos);
+			if(!(context_write(context, pattern->replacement + done_pos, capture[0U] - done_pos, io_functions) && context_write(context, match + capture[1U], 1U, io_functions)))
+			{
+				return FALSE;
+			}
+			done_pos = capture[0U] + 1U;
+		}
+		return context_write(context, pattern->replacement + done_pos, pattern->replacement_len - done_pos, io_functions);
+	}
+	if(!context_flush_spans(context, io_functions))
+	{
+		return FALSE; /*the callback writes directly*/
+	}
+	output.func_write = context_write_bulk;
+	output.context = (DWORD_PTR)io_functions;
+	return context->match_func(match, context->pattern->needle_len, offset, ordinal, &output, context->match_context);
+}
+
+/* replace the matches in '<data>' from '<scan_pos>' on, until the replacement limit is reached; '<data_offset>' is the input offset of the data */
+static BOOL context_replace(libreplace_context_t *const context, const BYTE *const data, const DWORD data_len, const ULONGLONG data_offset, DWORD *const scan_pos, DWORD *const done_pos, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count)
+{
+	const libreplace_pattern_t *const pattern = context->pattern;
+	const libreplace_flags_t *const options = &pattern->options;
+	const DWORD max_replacements = options->replace_once ? 1U : options->max_replacements;
+	DWORD match_pos;
+	ULARGE_INTEGER match_offset;
+
+	while(pattern_find(pattern, &context->matcher, data, data_len, *scan_pos, &match_pos))
+	{
+		libreplace_add_count(replacement_count, 1U);
+		if(options->verbose || options->dry_run)
+		{
+			match_offset.QuadPart = data_offset + match_pos + (pattern->needle_len - 1U);
+			libreplace_print_fmt(logger, "%s occurence at offset: 0x%08lX%08lX\n", options->dry_run ? "Found" : "Replaced", match_offset.HighPart, match_offset.LowPart);
+		}
+		if(!options->dry_run)
+		{
+			if(!(context_write(context, data + *done_pos, match_pos - *done_pos, io_functions) && context_write_replacement(context, data + match_pos, data_offset + match_pos, *replacement_count, io_functions)))
+			{
+				return FALSE;
+			}
+			*done_pos = match_pos + pattern->needle_len;
+		}
+		*scan_pos = match_pos + pattern->needle_len;
+		if((max_replacements > 0U) && (*replacement_count >= max_replacements))
+		{
+			context->limit_reached = TRUE;
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL context_scan(libreplace_context_t *const context, const DWORD data_len, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, DWORD *const data_used)
+{
+	const libreplace_pattern_t *const pattern = context->pattern;
+	const DWORD total_len = context->carry_len + data_len;
+	BYTE *const buffer = context->buffer_work;
+	DWORD scan_pos = 0U, done_pos = 0U, keep_pos;
+
+	/* choose the matcher from a sample of the first block; until enough data was seen, the first-byte matcher is used */
+	if((!context->matcher_ready) && (total_len >= MATCHER_SAMPLE_MIN))
+	{
+		matcher_select(pattern, &context->matcher, buffer, total_len, logger);
+		context->matcher_ready = TRUE;
+	}
+
+	/* find all matches in the carried-over data plus the new data */
+	if(!context_replace(context, buffer, total_len, context->position.QuadPart, &scan_pos, &done_pos, io_functions, logger, replacement_count))
+	{
+		return FALSE;
+	}
+
+	if(context->limit_reached)
+	{
+		matcher_update(pattern, &context->matcher, scan_pos, logger);
+		*data_used = scan_pos - context->carry_len;
+		context->position.QuadPart += scan_pos;
+		context->carry_len = 0U;
+		return context_write(context, buffer + done_pos, scan_pos - done_pos, io_functions) && context_flush_spans(context, io_functions);
+	}
+
+	/* revise the choice of the matcher, if the input did not behave like the sample */
+	matcher_update(pattern, &context->matcher, data_len, logger);
+
+	/* the last (needle_len - 1) bytes may be the beginning of a match, so keep them */
+	keep_pos = ((total_len - scan_pos) >= pattern->needle_len) ? (total_len - pattern->needle_len + 1U) : scan_pos;
+	if(!(context_write(context, buffer + done_pos, keep_pos - done_pos, io_functions) && context_flush_spans(context, io_functions)))
+	{
+		return FALSE;
+	}
+
+	for(context->carry_len = 0U; keep_pos + context->carry_len < total_len; ++context->carry_len)
+	{
+		buffer[context->carry_len] = buffer[keep_pos + context->carry_len];
+	}
+
+	context->position.QuadPart += keep_pos;
+	*data_used = data_len;
+	return TRUE;
+}
+
+/*
+ * Same as context_scan(), but the data is scanned where it is, e.g. in the
+ * buffer of the reader, and the unmodified parts are written from there. Only
+ * the carried-over bytes and the first (needle_len - 1) bytes of the data are
+ * joined in the work buffer, because a match that starts in the carried-over
+ * bytes ends within those. The data must not be shorter than the needle.
+ */
+static BOOL context_scan_view(libreplace_context_t *const context, const BYTE *const data, const DWORD data_len, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, DWORD *const data_used)
+{
+	const libreplace_pattern_t *const pattern = context->pattern;
+	const DWORD carry_len = context->carry_len, seam_len = pattern->needle_len - 1U;
+	const ULONGLONG data_offset = context->position.QuadPart + carry_len;
+	BYTE *const buffer = context->buffer_work;
+	DWORD scan_pos = 0U, done_pos = 0U, keep_pos, char_pos;
+
+	/* choose the matcher from a sample of the first block; until enough data was seen, the first-byte matcher is used */
+	if((!context->matcher_ready) && (data_len >= MATCHER_SAMPLE_MIN))
+	{
+		matcher_select(pattern, &context->matcher, data, data_len, logger);
+		context->matcher_ready = TRUE;
+	}
+
+	/* find a match that starts in the carried-over data */
+	if(carry_len > 0U)
+	{
+		for(char_pos = 0U; char_pos < seam_len; ++char_pos)
+		{
+			buffer[carry_len + char_pos] = data[char_pos];
+		}
+		if(!context_replace(context, buffer, carry_len + seam_len, context->position.QuadPart, &scan_pos, &done_pos, io_functions, logger, replacement_count))
+		{
+			return FALSE;
+		}
+		if(done_pos < carry_len)
+		{
+			if(!context_write(context, buffer + done_pos, carry_len - done_pos, io_functions))
+			{
+				return FALSE;
+			}
+			done_pos = carry_len;
+		}
+		scan_pos = (scan_pos > carry_len) ? (scan_pos - carry_len) : 0U;
+		done_pos -= carry_len;
+	}
+
+	/* find all matches in the new data */
+	if((!context->limit_reached) && (!context_replace(context, data, data_len, data_offset, &scan_pos, &done_pos, io_functions, logger, replacement_count)))
+	{
+		return FALSE;
+	}
+
+	if(context->limit_reached)
+	{
+		matcher_update(pattern, &context->matcher, scan_pos, logger);
+		*data_used = scan_pos;
+		context->position.QuadPart = data_offset + scan_pos;
+		context->carry_len = 0U;
+		return context_write(context, data + done_pos, scan_pos - done_pos, io_functions) && context_flush_spans(context, io_functions);
+	}
+
+	/* revise the choice of the matcher, if the input did not behave like the sample */
+	matcher_update(pattern, &context->matcher, data_len, logger);
+
+	/* the last (needle_len - 1) bytes may be the beginning of a match, so keep them in the work buffer */
+	keep_pos = ((data_len - scan_pos) >= pattern->needle_len) ? (data_len - seam_len) : scan_pos;
+	if(!(context_write(context, data + done_pos, keep_pos - done_pos, io_functions) && context_flush_spans(context, io_functions)))
+	{
+		return FALSE;
+	}
+
+	for(context->carry_len = 0U; keep_pos + context->carry_len < data_len; ++context->carry_len)
+	{
+		buffer[context->carry_len] = data[keep_pos + context->carry_len];
+	}
+
+	context->position.QuadPart = data_offset + keep_pos;
+	*data_used = data_len;
+	return TRUE;
+}
+
+/* data that is too short to be scanned where it is has to be copied to the work buffer, at most one block at a time */
+static BOOL context_scan_copy(libreplace_context_t *const context, const BYTE *const data, const DWORD data_len, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, DWORD *const data_used)
+{
+	DWORD data_pos, chunk_len, chunk_used, char_pos;
+	for(data_pos = *data_used = 0U; (data_pos < data_len) && (!context->limit_reached); data_pos += chunk_len)
+	{
+		chunk_len = BLOCK_LIMIT(data_len - data_pos);
+		for(char_pos = 0U; char_pos < chunk_len; ++char_pos)
+		{
+			context->buffer_work[context->carry_len + char_pos] = data[data_pos + char_pos];
+		}
+		if(!context_scan(context, chunk_len, io_functions, logger, replacement_count, &chunk_used))
+		{
+			return FALSE;
+		}
+		*data_used = data_pos + chunk_used;
+	}
+	return TRUE;
+}
+
+static BOOL context_run_forward(libreplace_context_t *const context, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	const libreplace_flags_t *const options = &context->pattern->options;
+	const BOOL use_view = (io_functions->func_rd_view != NULL) && (!options->normalize);
+	BOOL success = FALSE, error_flag = FALSE, scanned;
+	BYTE block_linbreak = 0U, *block_buffer;
+	const BYTE *block_data;
+	DWORD block_len, data_len, data_used;
+	ULONGLONG window_remaining = 0U;
+
+	/* pass through any input data in front of the window */
+	if(!libreplace_pass_head(context->buffer_raw, options, io_functions, &context->position, &error_flag, abort_flag))
+	{
+		libreplace_print(logger, WR_ERROR_MESSAGE);
+		goto finished;
+	}
+
+	/* process all available input data within the window; if the reader provides views of its buffer, the data is scanned in there */
+	window_remaining = WINDOW_LENGTH(options);
+	while((window_remaining > 0U) && (use_view ? libreplace_read_view(&block_data, VIEW_LIMIT(window_remaining), &block_len, io_functions, &error_flag) : libreplace_read_block(block_buffer = (options->normalize ? context->buffer_raw : (context->buffer_work + context->carry_len)), BLOCK_LIMIT(window_remaining), &block_len, io_functions, &error_flag)))
+	{
+		window_remaining -= block_len;
+
+		if(use_view)
+		{
+			/* search the data in place and write the replacements */
+			scanned = (block_len >= context->pattern->needle_len) ? context_scan_view(context, block_data, block_len, io_functions, logger, replacement_count, &data_used) : context_scan_copy(context, block_data, block_len, io_functions, logger, replacement_count, &data_used);
+		}
+		else
+		{
+			/* fix up CRLF/LFCR line-breaks, if normalization is enabled */
+			block_data = block_buffer;
+			if(options->normalize)
+			{
+				block_linbreak = context->last_linbreak;
+				data_len = libreplace_normalize_block(block_data, context->buffer_work + context->carry_len, block_len, &context->last_linbreak);
+			}
+			else
+			{
+				data_len = block_len;
+			}
+
+			/* search the block and write the replacements */
+			scanned = context_scan(context, data_len, io_functions, logger, replacement_count, &data_used);
+		}
+
+		if(!scanned)
+		{
+			libreplace_print(logger, WR_ERROR_MESSAGE);
+			goto finished;
+		}
+
+		/* pass through the rest of the current block unmodified */
+		if(context->limit_reached)
+		{
+			data_used = options->normalize ? libreplace_normalize_offset(block_data, block_len, block_linbreak, data_used) : data_used;
+			if(!libreplace_write(block_data + data_used, block_len - data_used, io_functions))
+			{
+				libreplace_print(logger, WR_ERROR_MESSAGE);
+				goto finished;
+			}
+			break;
+		}
+
+		/* check if abort was requested */
+		CHECK_ABORT_REQUEST();
+	}
+
+	/* write any pending data */
+	if(!libreplace_write(context->buffer_work, context->carry_len, io_functions))
+	{
+		libreplace_print(logger, WR_ERROR_MESSAGE);
+		goto finished;
+	}
+
+	context->position.QuadPart += context->carry_len;
+	context->carry_len = 0U;
+
+	/* check if abort was requested */
+	CHECK_ABORT_REQUEST();
+
+	/* transfer any input data not processed yet, block by block */
+	if(context->limit_reached || (window_remaining < 1U))
+	{
+		if(!libreplace_copy_data(context->buffer_raw, MAXULONGLONG, io_functions, &error_flag, abort_flag))
+		{
+			libreplace_print(logger, WR_ERROR_MESSAGE);
+			goto finished;
+		}
+	}
+
+	/* check if abort was requested */
+	CHECK_ABORT_REQUEST();
+
+	/* check for any previous read errors */
+	if(error_flag)
+	{
+		libreplace_print(logger, RD_ERROR_MESSAGE);
+		goto finished;
+	}
+
+	/* flush output buffers*/
+	success = io_functions->func_wr(LIBREPLACE_FLUSH, io_functions->context_wr);
+
+	if(options->verbose)
+	{
+		libreplace_print_fmt(logger, options->dry_run ? "Total occurences found: %lu\n" : "Total occurences replaced: %lu\n", *replacement_count);
+	}
+
+finished:
+
+	return success;
+}
+
+/* ======================================================================= */
+/* Reverse Search & Replace                                                */
+/* ======================================================================= */
+
+static BOOL libreplace_read_at(BYTE *const buffer, const DWORD length, const ULONGLONG offset, const libreplace_io_t *const io_functions)
+{
+	DWORD length_done = 0U, bytes_read;
+	while(length_done < length)
+	{
+		if(!io_functions->func_rd_at(buffer + length_done, length - length_done, offset + length_done, &bytes_read, io_functions->context_rd))
+		{
+			return FALSE;
+		}
+		if(bytes_read < 1U)
+		{
+			return FALSE; /*file was truncated!*/
+		}
+		length_done += bytes_read;
+	}
+	return TRUE;
+}
+
+static BOOL libreplace_copy_range(BYTE *const buffer, const DWORD buffer_size, ULONGLONG offset, const ULONGLONG offset_end, const libreplace_io_t *const io_functions, BOOL *const error_flag, volatile BOOL *const abort_flag)
+{
+	while((offset < offset_end) && (!*abort_flag))
+	{
+		const DWORD length = ((offset_end - offset) < buffer_size) ? ((DWORD)(offset_end - offset)) : buffer_size;
+		if(!libreplace_read_at(buffer, length, offset, io_functions))
+		{
+			*error_flag = TRUE;
+			return FALSE;
+		}
+		if(!libreplace_write(buffer, length, io_functions))
+		{
+			return FALSE;
+		}
+		offset += length;
+	}
+	return TRUE;
+}
+
+/* returns zero, if the needle matches at the given position, or else the distance to the next candidate position towards the beginning */
+static MY_INLINE DWORD pattern_shift_backwards(const libreplace_pattern_t *const pattern, const BYTE *const data)
+{
+	if(MATCH_CHAR(pattern, pattern->needle[0U], data[0U]) && pattern_compare(pattern, data, 1U))
+	{
+		return 0U;
+	}
+	return pattern->skip_rev[data[0U]];
+}
+
+static BOOL context_run_reverse(libreplace_context_t *const context, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	const libreplace_pattern_t *const pattern = context->pattern;
+	const libreplace_flags_t *const options = &pattern->options;
+	const DWORD needle_len = pattern->needle_len, buffer_size = BLOCK_SIZE + needle_len;
+	BOOL success = FALSE, error_flag = FALSE;
+	ULONGLONG input_size, range_lo, range_hi, chunk_lo = 0U, chunk_hi = 0U, offset, offset_done = 0U;
+	ULARGE_INTEGER position;
+	DWORD match_count = 0U, max_replacements, shift;
+
+	/* reverse scanning requires random access to the input */
+	if(!(io_functions->func_rd_at && io_functions->func_get_size))
+	{
+		libreplace_print(logger, "Reverse scanning requires a seekable input!\n");
+		goto finished;
+	}
+
+	/* determine the input size */
+	if(!io_functions->func_get_size(&input_size, io_functions->context_rd))
+	{
+		libreplace_print(logger, RD_ERROR_MESSAGE);
+		goto finished;
+	}
+
+	/* single replacement mode is the same as a limit of one */
+	max_replacements = options->replace_once ? 1U : options->max_replacements;
+
+	/* clip the window to the actual input size */
+	range_lo = (options->window_offset < input_size) ? options->window_offset : input_size;
+	range_hi = ((input_size - range_lo) > WINDOW_LENGTH(options)) ? (range_lo + options->window_length) : input_size;
+
+	/* scan the input backwards, starting at the end, one block at a time */
+	if((range_hi - range_lo) >= needle_len)
+	{
+		offset = range_hi - needle_len;
+		for(;;)
+		{
+			if((offset < chunk_lo) || ((offset + needle_len) > chunk_hi))
+			{
+				CHECK_ABORT_REQUEST();
+				chunk_hi = offset + needle_len;
+				chunk_lo = ((chunk_hi - range_lo) > buffer_size) ? (chunk_hi - buffer_size) : range_lo;
+				if(!libreplace_read_at(context->buffer_work, (DWORD)(chunk_hi - chunk_lo), chunk_lo, io_functions))
+				{
+					libreplace_print(logger, RD_ERROR_MESSAGE);
+					goto finished;
+				}
+			}
+			if((shift = pattern_shift_backwards(pattern, context->buffer_work + ((DWORD)(offset - chunk_lo)))) < 1U)
+			{
+				if(!context_add_match(context, &match_count, offset, logger))
+				{
+					goto finished;
+				}
+				libreplace_add_count(replacement_count, 1U);
+				if(options->verbose || options->dry_run)
+				{
+					position.QuadPart = offset + needle_len - 1U;
+					libreplace_print_fmt(logger, "%s occurence at offset: 0x%08lX%08lX\n", options->dry_run ? "Found" : "Replaced", position.HighPart, position.LowPart);
+				}
+				if(((max_replacements > 0U) && (match_count >= max_replacements)) || ((offset - range_lo) < needle_len))
+				{
+					break;
+				}
+				offset -= needle_len; /*matches must not overlap*/
+			}
+			else
+			{
+				if((offset - range_lo) < shift)
+				{
+					break;
+				}
+				offset -= shift;
+			}
+		}
+	}
+
+	/* write the output, copying everything in between the matches */
+	if(!options->dry_run)
+	{
+		while(match_count > 0U)
+		{
+			offset = context->matches[--match_count];
+			if(!libreplace_copy_range(context->buffer_work, buffer_size, offset_done, offset, io_functions, &error_flag, abort_flag))
+			{
+				libreplace_print(logger, error_flag ? RD_ERROR_MESSAGE : WR_ERROR_MESSAGE);
+				goto finished;
+			}
+			CHECK_ABORT_REQUEST();
+			if((context->match_func || pattern->capture_count) && (!libreplace_read_at(context->buffer_work, needle_len, offset, io_functions)))
+			{
+				libreplace_print(logger, RD_ERROR_MESSAGE);
+				goto finished;
+			}
+			if(!(context_write_replacement(context, context->buffer_work, offset, match_count + 1U, io_functions) && context_flush_spans(context, io_functions)))
+			{
+				libreplace_print(logger, WR_ERROR_MESSAGE);
+				goto finished;
+			}
+			offset_done = offset + needle_len;
+		}
+	}
+
+	/* transfer any input data not processed yet */
+	if(!libreplace_copy_range(context->buffer_work, buffer_size, offset_done, input_size, io_functions, &error_flag, abort_flag))
+	{
+		libreplace_print(logger, error_flag ? RD_ERROR_MESSAGE : WR_ERROR_MESSAGE);
+		goto finished;
+	}
+
+	/* check if abort was requested */
+	CHECK_ABORT_REQUEST();
+
+	/* flush output buffers*/
+	success = io_functions->func_wr(LIBREPLACE_FLUSH, io_functions->context_wr);
+
+	if(options->verbose)
+	{
+		libreplace_print_fmt(logger, options->dry_run ? "Total occurences found: %lu\n" : "Total occurences replaced: %lu\n", *replacement_count);
+	}
+
+finished:
+
+	return success;
+}
+
+/* ======================================================================= */
+/* Search & Replace                                                        */
+/* ======================================================================= */
+
+BOOL libreplace_context_run(libreplace_context_t *const context, const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	/* check parameters */
+	if(!(context && io_functions && replacement_count && abort_flag))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		return FALSE;
+	}
+
+	/* initialize replacement counter and context */
+	*replacement_count = 0U;
+	libreplace_context_reset(context);
+
+	/* select the appropriate engine */
+	if(context->pattern->xlat && (!context->match_func))
+	{
+		return libreplace_translate_blocks(context->pattern->xlat, context->buffer_raw, io_functions, logger, &context->pattern->options, replacement_count, abort_flag);
+	}
+	else if(context->pattern->options.reverse)
+	{
+		return context_run_reverse(context, io_functions, logger, replacement_count, abort_flag);
+	}
+	else
+	{
+		return context_run_forward(context, io_functions, logger, replacement_count, abort_flag);
+	}
+}
+
+static BOOL search_and_replace(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const WORD *const replacement_template, const DWORD replacement_len, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	BOOL success = FALSE;
+	libreplace_pattern_t *pattern = NULL;
+	libreplace_context_t *context = NULL;
+
+	/* check parameters */
+	if(!(io_functions && replacement_count && abort_flag))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		goto finished;
+	}
+
+	/* prepare the pattern */
+	if(!(pattern = pattern_compile(logger, needle, needle_len, replacement, replacement_template, replacement_len, options)))
+	{
+		goto finished;
+	}
+
+	/* allocate the context */
+	if(!(context = libreplace_context_create(pattern)))
+	{
+		libreplace_print(logger, "Failed to allocate context!\n");
+		goto finished;
+	}
+
+	success = libreplace_context_run(context, io_functions, logger, replacement_count, abort_flag);
+
+finished:
+
+	libreplace_context_free(context);
+	libreplace_pattern_free(pattern);
+
+	return success;
+}
+
+BOOL libreplace_search_and_replace(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const BYTE *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	return search_and_replace(io_functions, logger, needle, needle_len, replacement, NULL, replacement_len, options, replacement_count, abort_flag);
+}
+
+BOOL libreplace_search_and_replace_template(const libreplace_io_t *const io_functions, const libreplace_logger_t *const logger, const WORD *const needle, const DWORD needle_len, const WORD *const replacement, const DWORD replacement_len, const libreplace_flags_t *const options, DWORD *const replacement_count, volatile BOOL *const abort_flag)
+{
+	return search_and_replace(io_functions, logger, needle, needle_len, NULL, replacement, replacement_len, options, replacement_count, abort_flag);
+}
+
+/* ======================================================================= */
+/* Push-based Streaming                                                    */
+/* ======================================================================= */
+
+static MY_INLINE BOOL stream_write(const libreplace_sink_t *const sink, const BYTE *const data, const DWORD data_len)
+{
+	return (data_len > 0U) ? sink->func_write(data, data_len, sink->context) : TRUE;
+}
+
+BOOL libreplace_feed(libreplace_context_t *const context, const BYTE *data, DWORD data_len, const libreplace_sink_t *const sink, const libreplace_logger_t *const logger)
+{
+	const libreplace_flags_t *options;
+	libreplace_io_t io_functions;
+	ULONGLONG window_used;
+	DWORD chunk_len, block_len, data_used, data_pos;
+	BYTE block_linbreak;
+
+	/* check parameters */
+	if(!(context && (data || (data_len < 1U)) && sink && sink->func_write))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		return FALSE;
+	}
+
+	options = &context->pattern->options;
+	if(options->reverse)
+	{
+		libreplace_print(logger, "Reverse scanning is not supported for streamed input!\n");
+		return FALSE;
+	}
+
+	/* the engines only ever use the bulk output function */
+	SecureZeroMemory(&io_functions, sizeof(libreplace_io_t));
+	io_functions.func_wr_bulk = sink->func_write;
+	io_functions.context_wr = sink->context;
+
+	while(data_len > 0U)
+	{
+		/* pass through any input data in front of the window */
+		if(context->stream_offset < options->window_offset)
+		{
+			chunk_len = ((options->window_offset - context->stream_offset) < data_len) ? ((DWORD)(options->window_offset - context->stream_offset)) : data_len;
+			if(!stream_write(sink, data, chunk_len))
+			{
+				return FALSE;
+			}
+			context->position.QuadPart = context->stream_offset += chunk_len; /*offsets remain absolute*/
+			data += chunk_len;
+			data_len -= chunk_len;
+			continue;
+		}
+
+		/* pass through any input data behind the window or after the last replacement */
+		window_used = context->stream_offset - options->window_offset;
+		if(context->limit_reached || (window_used >= WINDOW_LENGTH(options)))
+		{
+			if(!stream_write(sink, context->buffer_work, context->carry_len))
+			{
+				return FALSE;
+			}
+			context->position.QuadPart += context->carry_len;
+			context->carry_len = 0U;
+			context->stream_offset += data_len;
+			return stream_write(sink, data, data_len);
+		}
+
+		/* process the next piece of the window; it is scanned in the caller's buffer, unless it has to be transformed or is too short */
+		chunk_len = VIEW_LIMIT(WINDOW_LENGTH(options) - window_used);
+		chunk_len = (chunk_len < data_len) ? chunk_len : data_len;
+		block_linbreak = context->last_linbreak;
+
+		if((!(context->pattern->xlat && (!context->match_func))) && (!options->normalize) && (chunk_len >= context->pattern->needle_len))
+		{
+			if(!context_scan_view(context, data, chunk_len, &io_functions, logger, &context->stream_count, &data_used))
+			{
+				return FALSE;
+			}
+			if(context->limit_reached && (!stream_write(sink, data + data_used, chunk_len - data_used)))
+			{
+				return FALSE;
+			}
+		}
+		else if(context->pattern->xlat && (!context->match_func))
+		{
+			chunk_len = BLOCK_LIMIT(chunk_len);
+			block_len = options->normalize ? libreplace_normalize_block(data, context->buffer_work, chunk_len, &context->last_linbreak) : chunk_len;
+			if(!options->normalize)
+			{
+				for(data_pos = 0U; data_pos < chunk_len; ++data_pos)
+				{
+					context->buffer_work[data_pos] = data[data_pos];
+				}
+			}
+			block_len = xlat_process_block(context->pattern->xlat, context->buffer_work, block_len, options, logger, &context->position, &context->stream_count);
+			if(!stream_write(sink, context->buffer_work, block_len))
+			{
+				return FALSE;
+			}
+		}
+		else
+		{
+			BYTE *const block_data = context->buffer_work + context->carry_len;
+			chunk_len = BLOCK_LIMIT(chunk_len);
+			if(options->normalize)
+			{
+				block_len = libreplace_normalize_block(data, block_data, chunk_len, &context->last_linbreak);
+			}
+			else
+			{
+				for(data_pos = 0U; data_pos < chunk_len; ++data_pos)
+				{
+					block_data[data_pos] = data[data_pos];
+				}
+				block_len = chunk_len;
+			}
+			if(!context_scan(context, block_len, &io_functions, logger, &context->stream_count, &data_used))
+			{
+				return FALSE;
+			}
+			if(context->limit_reached)
+			{
+				data_used = options->normalize ? libreplace_normalize_offset(data, chunk_len, block_linbreak, data_used) : data_used;
+				if(!stream_write(sink, data + data_used, chunk_len - data_used))
+				{
+					return FALSE;
+				}
+			}
+		}
+
+		context->stream_offset += chunk_len;
+		data += chunk_len;
+		data_len -= chunk_len;
+	}
+
+	return TRUE;
+}
+
+BOOL libreplace_finish(libreplace_context_t *const context, const libreplace_sink_t *const sink, const libreplace_logger_t *const logger, DWORD *const replacement_count)
+{
+	BOOL success = FALSE;
+
+	/* check parameters */
+	if(!(context && sink && sink->func_write))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		return FALSE;
+	}
+
+	/* write any pending data */
+	if(stream_write(sink, context->buffer_work, context->carry_len))
+	{
+		success = TRUE;
+		if(context->pattern->options.verbose)
+		{
+			libreplace_print_fmt(logger, context->pattern->options.dry_run ? "Total occurences found: %lu\n" : "Total occurences replaced: %lu\n", context->stream_count);
+		}
+		if(replacement_count)
+		{
+			*replacement_count = context->stream_count;
+		}
+	}
+
+	/* ready for the next stream */
+	libreplace_context_reset(context);
+	return success;
+}
+
+/* the output is complete up to '<input_offset>', so a new stream that is resumed there produces the same remaining output */
+BOOL libreplace_progress(const libreplace_context_t *const context, ULONGLONG *const input_offset, DWORD *const replacement_count)
+{
+	/* check parameters */
+	if(!(context && input_offset && replacement_count))
+	{
+		return FALSE;
+	}
+
+	/* the state of a pending line-break can not be resumed */
+	if(context->pattern->options.normalize)
+	{
+		return FALSE;
+	}
+
+	*input_offset = context->stream_offset - context->carry_len;
+	*replacement_count = context->stream_count;
+	return TRUE;
+}
+
+BOOL libreplace_resume(libreplace_context_t *const context, const ULONGLONG input_offset, const DWORD replacement_count)
+{
+	const libreplace_flags_t *options;
+	libreplace_matcher_t matcher;
+	DWORD max_replacements;
+	BOOL matcher_ready;
+
+	/* check parameters */
+	if(!context)
+	{
+		return FALSE;
+	}
+
+	options = &context->pattern->options;
+	if(options->normalize || options->reverse)
+	{
+		return FALSE;
+	}
+
+	/* offsets remain absolute, so the window and the replacement limit still apply; the matcher selected so far is kept */
+	matcher = context->matcher;
+	matcher_ready = context->matcher_ready;
+	libreplace_context_reset(context);
+	context->matcher = matcher;
+	context->matcher_ready = matcher_ready;
+	context->position.QuadPart = context->stream_offset = input_offset;
+	context->stream_count = replacement_count;
+	max_replacements = options->replace_once ? 1U : options->max_replacements;
+	context->limit_reached = (max_replacements > 0U) && (replacement_count >= max_replacements);
+	return TRUE;
+}
+
+/* ======================================================================= */
+/* Match Cursor                                                            */
+/* ======================================================================= */
+
+BOOL libreplace_cursor_init(libreplace_cursor_t *const cursor, const libreplace_pattern_t *const pattern, const BYTE *const data, const SIZE_T data_len, const libreplace_logger_t *const logger)
+{
+	/* check parameters */
+	if(!(cursor && pattern && (data || (data_len < 1U))))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		return FALSE;
+	}
+
+	if(pattern->options.normalize)
+	{
+		libreplace_print(logger, "Line-break normalization is not supported for in-memory buffers!\n");
+		return FALSE;
+	}
+
+	cursor->pattern = pattern;
+	cursor->data = data;
+	cursor->match_count = 0U;
+
+	/* clip the window to the actual data size */
+	cursor->range_lo = (pattern->options.window_offset < data_len) ? ((SIZE_T)pattern->options.window_offset) : data_len;
+	cursor->range_hi = ((data_len - cursor->range_lo) > WINDOW_LENGTH(&pattern->options)) ? ((SIZE_T)(cursor->range_lo + pattern->options.window_length)) : data_len;
+
+	/* forward cursors start at the beginning, reverse cursors at the end */
+	cursor->position = pattern->options.reverse ? cursor->range_hi : cursor->range_lo;
+
+	/* choose the matcher from a sample at the beginning of the window */
+	SecureZeroMemory(&cursor->matcher, sizeof(libreplace_matcher_t));
+	if(!pattern->options.reverse)
+	{
+		matcher_select(pattern, &cursor->matcher, cursor->data + cursor->range_lo, VIEW_LIMIT(cursor->range_hi - cursor->range_lo), logger);
+	}
+
+	return TRUE;
+}
+
+void libreplace_cursor_seek(libreplace_cursor_t *const cursor, const SIZE_T offset)
+{
+	cursor->position = (offset < cursor->range_lo) ? cursor->range_lo : ((offset > cursor->range_hi) ? cursor->range_hi : offset);
+}
+
+BOOL libreplace_cursor_next(libreplace_cursor_t *const cursor, SIZE_T *const match_offset)
+{
+	const libreplace_pattern_t *const pattern = cursor->pattern;
+	const DWORD needle_len = pattern->needle_len, max_replacements = pattern->options.replace_once ? 1U : pattern->options.max_replacements;
+	DWORD shift, view_len, view_pos;
+	SIZE_T offset, view_lo;
+
+	if((max_replacements > 0U) && (cursor->match_count >= max_replacements))
+	{
+		return FALSE;
+	}
+
+	if(pattern->options.reverse)
+	{
+		/* the next match has to end at or before the current position */
+		if((cursor->position - cursor->range_lo) < needle_len)
+		{
+			return FALSE;
+		}
+		for(offset = cursor->position - needle_len; (shift = pattern_shift_backwards(pattern, cursor->data + offset)) > 0U; offset -= shift)
+		{
+			if((offset - cursor->range_lo) < shift)
+			{
+				cursor->position = cursor->range_lo;
+				return FALSE;
+			}
+		}
+		cursor->position = offset;
+	}
+	else
+	{
+		/* the next match has to start at or after the current position; the matchers take views of up to 4 GiB, which overlap by needle_len-1 bytes */
+		for(view_lo = cursor->position;; view_lo += view_len - (needle_len - 1U))
+		{
+			view_len = VIEW_LIMIT(cursor->range_hi - view_lo);
+			if(pattern_find(pattern, &cursor->matcher, cursor->data + view_lo, view_len, 0U, &view_pos))
+			{
+				break;
+			}
+			if(view_len < MAXDWORD)
+			{
+				cursor->position = cursor->range_hi;
+				return FALSE;
+			}
+		}
+		offset = view_lo + view_pos;
+		matcher_update(pattern, &cursor->matcher, VIEW_LIMIT(offset + needle_len - cursor->position), NULL);
+		cursor->position = offset + needle_len; /*matches must not overlap*/
+	}
+
+	++cursor->match_count;
+	*match_offset = offset;
+	return TRUE;
+}
+
+/* ======================================================================= */
+/* In-memory Replacement                                                   */
+/* ======================================================================= */
+
+static MY_INLINE BYTE *libreplace_copy_bytes(BYTE *output, const BYTE *input, SIZE_T length)
+{
+#ifdef LIBREPLACE_SSE2
+	for(; length >= 16U; length -= 16U, input += 16U, output += 16U)
+	{
+		_mm_storeu_si128((__m128i*)output, _mm_loadu_si128((const __m128i*)input));
+	}
+#endif
+	while(length-- > 0U)
+	{
+		*(output++) = *(input++);
+	}
+	return output;
+}
+
+BOOL libreplace_replace_memory(libreplace_context_t *const context, const BYTE *const input, const SIZE_T input_len, BYTE **const output, SIZE_T *const output_len, const libreplace_logger_t *const logger, DWORD *const replacement_count)
+{
+	const libreplace_pattern_t *pattern;
+	const libreplace_flags_t *options;
+	DWORD match_count = 0U, match_pos, capture_pos;
+	SIZE_T match_offset, input_pos = 0U;
+	libreplace_cursor_t cursor;
+	ULARGE_INTEGER position;
+	ULONGLONG size;
+	BYTE *output_pos, *replacement_pos;
+
+	/* check parameters */
+	if(!(context && (input || (input_len < 1U)) && output && output_len && replacement_count))
+	{
+		libreplace_print(logger, "Invalid function parameters detected!\n");
+		return FALSE;
+	}
+
+	*output = NULL;
+	*output_len = 0U;
+	*replacement_count = 0U;
+
+	pattern = context->pattern;
+	options = &pattern->options;
+
+	/* the exact output size can not be known in advance with computed replacements */
+	if(context->match_func && (!options->dry_run))
+	{
+		libreplace_print(logger, "Match callbacks are not supported for in-memory replacement!\n");
+		return FALSE;
+	}
+
+	/* first pass: locate all matches */
+	if(!libreplace_cursor_init(&cursor, pattern, input, input_len, logger))
+	{
+		return FALSE;
+	}
+	while(libreplace_cursor_next(&cursor, &match_offset))
+	{
+		if(!context_add_match(context, &match_count, match_offset, logger))
+		{
+			return FALSE;
+		}
+	}
+
+	*replacement_count = match_count;
+	if(options->verbose || options->dry_run)
+	{
+		for(match_pos = 0U; match_pos < match_count; ++match_pos)
+		{
+			position.QuadPart = context->matches[match_pos] + (pattern->needle_len - 1U);
+			libreplace_print_fmt(logger, "%s occurence at offset: 0x%08lX%08lX\n", options->dry_run ? "Found" : "Replaced", position.HighPart, position.LowPart);
+		}
+	}
+
+	/* compute the exact output size */
+	size = options->dry_run ? input_len : ((((ULONGLONG)input_len) - (((ULONGLONG)match_count) * pattern->needle_len)) + (((ULONGLONG)match_count) * pattern->replacement_len));
+	if(size > MAXSIZE_T)
+	{
+		libreplace_print(logger, "Output size exceeds the allowable limit!\n");
+		return FALSE;
+	}
+
+	/* allocate the output just once (no need to zero-initialize) */
+	if(!(*output = (BYTE*) LocalAlloc(LMEM_FIXED, (size > 0U) ? ((SIZE_T)size) : 1U)))
+	{
+		libreplace_print(logger, "Failed to allocate output buffer!\n");
+		return FALSE;
+	}
+
+	/* second pass: copy the data in between the matches and insert the replacements */
+	output_pos = *output;
+	if(!options->dry_run)
+	{
+		for(match_pos = 0U; match_pos < match_count; ++match_pos)
+		{
+			const SIZE_T offset = (SIZE_T)context->matches[options->reverse ? (match_count - match_pos - 1U) : match_pos];
+			output_pos = libreplace_copy_bytes(output_pos, input + input_pos, offset - input_pos);
+			replacement_pos = output_pos;
+			output_pos = libreplace_copy_bytes(output_pos, pattern->replacement, pattern->replacement_len);
+			for(capture_pos = 0U; capture_pos < pattern->capture_count; ++capture_pos)
+			{
+				replacement_pos[pattern->captures[2U * capture_pos]] = input[offset + pattern->captures[(2U * capture_pos) + 1U]];
+			}
+			input_pos = offset + pattern->needle_len;
+		}
+	}
+	libreplace_copy_bytes(output_pos, input + input_pos, input_len - input_pos);
+
+	*output_len = (SIZE_T)size;
+
+	if(options->verbose)
+	{
+		libreplace_print_fmt(logger, options->dry_run ? "Total occurences found: %lu\n" : "Total occurences replaced: %lu\n", *replacement_count);
+	}
+
+	return TRUE;
+}
+
+void libreplace_memory_free(BYTE *const buffer)
+{
+	if(buffer)
+	{
+		LocalFree(buffer);
+	}
+}